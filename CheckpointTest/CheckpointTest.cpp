@@ -0,0 +1,198 @@
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/model/Checkpoint.hpp"
+#include "../src/model/EngineManager.hpp"
+
+struct TestResult
+{
+    bool success = true;
+    std::string resultString = "";
+};
+
+constexpr int WIDTH = 1400;
+constexpr int HEIGHT = 400;
+
+//A soup in one corner only, so most tiles stay empty and the updates after the base stay small.
+void fillSoup(EngineManager& engine, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::bernoulli_distribution alive(0.3);
+    std::vector<uint8_t> cells((size_t)WIDTH * HEIGHT, 0);
+    for (int row = 10; row < 90; row++) {
+        for (int column = 20; column < 150; column++) cells[(size_t)row * WIDTH + column] = alive(random) ? 1 : 0;
+    }
+    engine.resize(WIDTH, HEIGHT);
+    engine.setRule(LifeRule());
+    engine.loadCells(cells);
+}
+
+bool sameCells(EngineManager& first, EngineManager& second)
+{
+    const GridEngine& a = first.getGrid();
+    const GridEngine& b = second.getGrid();
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight()) return false;
+    for (int row = 0; row < a.getHeight(); row++) {
+        for (int column = 0; column < a.getWidth(); column++) {
+            if (a.getCell(row, column) != b.getCell(row, column)) return false;
+        }
+    }
+    return true;
+}
+
+//Restores the checkpoint at path into a new engine, which should be at expectedGeneration, and steps it on to
+//finalGeneration next to a run that was never interrupted.
+void checkRestore(TestResult& result, const std::string& path, long long expectedGeneration, int expectedSegments, long long finalGeneration)
+{
+    Checkpoint::Reader reader;
+    if (!reader.open(path)) {
+        result.success = false;
+        result.resultString += "Could not open the checkpoint: " + reader.getError() + "\n";
+        return;
+    }
+    if (reader.getHeader().generation != expectedGeneration || reader.getSegmentCount() != expectedSegments) {
+        result.success = false;
+        result.resultString += "Expected generation " + std::to_string(expectedGeneration) + " in " + std::to_string(expectedSegments)
+            + " segments, found generation " + std::to_string(reader.getHeader().generation) + " in "
+            + std::to_string(reader.getSegmentCount()) + ".\n";
+        return;
+    }
+
+    EngineManager restored;
+    reader.load(restored);
+    restored.step((int)(finalGeneration - restored.getGeneration()));
+
+    EngineManager uninterrupted;
+    fillSoup(uninterrupted, 11);
+    uninterrupted.step((int)finalGeneration);
+
+    if (restored.getGeneration() != finalGeneration || !sameCells(restored, uninterrupted)) {
+        result.success = false;
+        result.resultString += "The run restored from generation " + std::to_string(expectedGeneration) + " doesn't match an uninterrupted run at "
+            + std::to_string(finalGeneration) + ".\n";
+    }
+}
+
+//Writes a base and then updates while the run goes on, restoring after each.
+//An update cut short at the end of the file should leave the checkpoint before it.
+TestResult testRestore(bool truncateLastUpdate)
+{
+    TestResult result;
+    const std::string path = (std::filesystem::temp_directory_path() / "gol-checkpoint-test.ckpt").string();
+    std::remove(path.c_str());
+
+    EngineManager engine;
+    fillSoup(engine, 11);
+    ModelParameters parameters;
+    parameters.modelWidth = WIDTH;
+    parameters.modelHeight = HEIGHT;
+
+    Checkpoint::Writer writer;
+    const long long checkpoints[] = { 40, 90, 160 };
+    for (int index = 0; index < 3; index++) {
+        engine.step((int)(checkpoints[index] - engine.getGeneration()));
+        writer.write(path, engine.getGrid(), engine.getGeneration(), parameters);
+        if (!writer.wait()) {
+            result.success = false;
+            result.resultString += "The checkpoint at " + std::to_string(checkpoints[index]) + " failed: " + writer.getError() + "\n";
+            break;
+        }
+        const Checkpoint::WriteResult written = writer.getLastResult();
+        if (written.full != (index == 0) || (index > 0 && written.tilesWritten >= written.tileCount)) {
+            result.success = false;
+            result.resultString += "Checkpoint " + std::to_string(index) + " wrote " + std::to_string(written.tilesWritten) + " of "
+                + std::to_string(written.tileCount) + " tiles as " + ((written.full) ? "a base" : "an update") + ".\n";
+        }
+        if (!truncateLastUpdate) checkRestore(result, path, checkpoints[index], index + 1, 300);
+    }
+
+    if (result.success && truncateLastUpdate) {
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - Checkpoint::BLOCK_BYTES);
+        checkRestore(result, path, checkpoints[1], 2, 300);
+    }
+
+    std::remove(path.c_str());
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+//Files without a whole base checkpoint have to fail to open, and a failed open can't pass on what an earlier
+//one read.
+TestResult testRejected()
+{
+    TestResult result;
+    const std::string path = (std::filesystem::temp_directory_path() / "gol-checkpoint-test.ckpt").string();
+    const std::string cutPath = (std::filesystem::temp_directory_path() / "gol-checkpoint-cut.ckpt").string();
+    std::remove(path.c_str());
+
+    EngineManager engine;
+    fillSoup(engine, 11);
+    ModelParameters parameters;
+    parameters.modelWidth = WIDTH;
+    parameters.modelHeight = HEIGHT;
+    Checkpoint::Writer writer;
+    writer.write(path, engine.getGrid(), engine.getGeneration(), parameters);
+    if (!writer.wait()) {
+        result.success = false;
+        result.resultString += "The base failed: " + writer.getError() + "\n";
+        result.resultString += "Test failed.\n";
+        return result;
+    }
+
+    std::ifstream baseFile(path, std::ios::binary);
+    const std::string base((std::istreambuf_iterator<char>(baseFile)), std::istreambuf_iterator<char>());
+    baseFile.close();
+
+    Checkpoint::Reader reader;
+    for (size_t size : { (size_t)0, (size_t)1, (size_t)Checkpoint::BLOCK_BYTES, base.size() / 2, base.size() - 1 }) {
+        if (!reader.open(path)) {
+            result.success = false;
+            result.resultString += "The whole base didn't open: " + reader.getError() + "\n";
+            break;
+        }
+        std::ofstream(cutPath, std::ios::binary | std::ios::trunc).write(base.data(), (std::streamsize)size);
+        if (reader.open(cutPath)) {
+            result.success = false;
+            result.resultString += "A base cut to " + std::to_string(size) + " of " + std::to_string(base.size()) + " bytes opened as "
+                + std::to_string(reader.getSegmentCount()) + " segments.\n";
+        }
+        else if (reader.getSegmentCount() != 0 || reader.getHeader().width != 0 || reader.getHeader().height != 0) {
+            result.success = false;
+            result.resultString += "Failing to open " + std::to_string(size) + " bytes kept the earlier checkpoint's header.\n";
+        }
+    }
+
+    std::remove(path.c_str());
+    std::remove(cutPath.c_str());
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+int main()
+{
+    bool success = true;
+
+    auto result = testRestore(false);
+    std::cout << "Test result for restoring a base and each update against an uninterrupted run:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    result = testRestore(true);
+    std::cout << "Test result for restoring after the last update was cut short:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    result = testRejected();
+    std::cout << "Test result for rejecting an empty file and a base cut short:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    std::cout << "Test complete.\n";
+    return success ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/model/DistributedStrip.hpp"
+#include "../src/model/GridEngine.hpp"
+
+struct TestResult
+{
+    bool success = true;
+    std::string resultString = "";
+};
+
+void fillSoup(GridEngine& board, int width, int height, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::bernoulli_distribution alive(0.3);
+    std::vector<uint8_t> cells((size_t)width * height);
+    for (auto& cell : cells) cell = alive(random) ? 1 : 0;
+    board.resize(width, height);
+    board.loadCells(cells);
+}
+
+//Runs the board split over rankCount strips, each on its own thread over a local socket ring, and checks
+//the population they add up to against the same board stepped whole.
+TestResult testPopulationMatchesSingleProcess(int width, int height, int rankCount, int haloDepth, long long generations)
+{
+    TestResult result;
+    const LifeRule rule;
+    GridEngine board;
+    fillSoup(board, width, height, 7);
+    board.setRule(rule);
+
+    GridEngine single;
+    single.copyCellsFrom(board);
+    single.setRule(rule);
+    single.step((int)generations);
+    const uint64_t expected = single.countPopulation();
+
+    std::vector<std::pair<int, int>> links;
+    std::string error;
+    if (!DistributedStrip::makeLocalRing(rankCount, links, error)) {
+        result.success = false;
+        result.resultString += "Could not make the socket ring: " + error + "\n";
+        return result;
+    }
+
+    std::vector<uint64_t> totals(rankCount, 0);
+    std::vector<std::string> errors(rankCount);
+    std::vector<std::thread> ranks;
+    for (int rank = 0; rank < rankCount; rank++) {
+        ranks.emplace_back([&, rank]() {
+            DistributedStrip strip;
+            strip.attach(rank, rankCount, links[rank].second, links[(rank + 1) % rankCount].first);
+            if (!strip.load(board, haloDepth)) {
+                errors[rank] = strip.getError();
+                return;
+            }
+            strip.setRule(rule);
+            if (!strip.step(generations) || !strip.allReduceSum(strip.countPopulation(), totals[rank])) errors[rank] = strip.getError();
+        });
+    }
+    for (auto& rank : ranks) rank.join();
+
+    for (int rank = 0; rank < rankCount; rank++) {
+        if (!errors[rank].empty()) {
+            result.success = false;
+            result.resultString += "Rank " + std::to_string(rank) + " failed: " + errors[rank] + "\n";
+        }
+        else if (totals[rank] != expected) {
+            result.success = false;
+            result.resultString += "Rank " + std::to_string(rank) + " counted " + std::to_string(totals[rank])
+                + " live cells, the single process " + std::to_string(expected) + ".\n";
+        }
+    }
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+int main()
+{
+    bool success = true;
+    struct Case { int width; int height; int ranks; int halo; long long generations; };
+    for (const Case& test : { Case{ 200, 150, 1, 1, 100 }, Case{ 200, 150, 2, 1, 100 }, Case{ 200, 150, 3, 1, 101 },
+        Case{ 333, 150, 3, 4, 97 }, Case{ 130, 96, 4, 8, 64 } }) {
+        auto result = testPopulationMatchesSingleProcess(test.width, test.height, test.ranks, test.halo, test.generations);
+        std::cout << "Test result for " << test.width << "x" << test.height << " over " << test.ranks << " ranks, halo "
+            << test.halo << ", " << test.generations << " generations:\n";
+        std::cout << result.resultString;
+        success = success && result.success;
+    }
+
+    std::cout << "Test complete.\n";
+    return success ? 0 : 1;
+}
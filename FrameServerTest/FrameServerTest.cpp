@@ -0,0 +1,345 @@
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "../src/model/FrameServer.hpp"
+#include "../src/model/GridEngine.hpp"
+
+struct TestResult
+{
+    bool success = true;
+    std::string resultString = "";
+};
+
+//A message as the server lays it out, built by hand.
+struct Message
+{
+    std::vector<uint8_t> bytes;
+
+    void put(uint64_t value, int count)
+    {
+        for (int byte = 0; byte < count; byte++) bytes.push_back((uint8_t)(value >> (8 * byte)));
+    }
+
+    Message(FrameServer::MessageType type, uint32_t tileCount, uint32_t width, uint32_t height, long long generation, uint64_t population)
+    {
+        put((uint8_t)type, 1);
+        put(FrameServer::VERSION, 1);
+        put(FrameServer::TILE_SIZE, 2);
+        put(tileCount, 4);
+        put(width, 4);
+        put(height, 4);
+        put((uint64_t)generation, 8);
+        put(population, 8);
+    }
+
+    void addTile(uint32_t index, FrameServer::TileEncoding encoding, const std::vector<uint8_t>& payload)
+    {
+        put(index, 4);
+        put((uint8_t)encoding, 1);
+        put(payload.size(), 4);
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+    }
+};
+
+std::vector<uint8_t> packRows(const std::vector<uint64_t>& rows)
+{
+    Message message(FrameServer::MessageType::Keyframe, 0, 0, 0, 0, 0);
+    message.bytes.clear();
+    for (uint64_t row : rows) message.put(row, 8);
+    return message.bytes;
+}
+
+void check(TestResult& result, bool condition, const std::string& failure)
+{
+    if (condition) return;
+    result.success = false;
+    result.resultString += failure + "\n";
+}
+
+//A 100x70 board is two tiles across and two down; the right and bottom ones are 36 and 6 cells.
+TestResult testApplyMessage()
+{
+    TestResult result;
+    FrameServer::ClientBoard board;
+    std::string error;
+
+    Message keyframe(FrameServer::MessageType::Keyframe, 3, 100, 70, 12, 47);
+    std::vector<uint64_t> rows(64, 0);
+    rows[0] = 0b1011;
+    keyframe.addTile(0, FrameServer::TileEncoding::Packed, packRows(rows));
+    //Bits past the edge of a tile are dropped.
+    keyframe.addTile(1, FrameServer::TileEncoding::Packed, packRows(std::vector<uint64_t>(64, ~0ull)));
+    //5 dead, 3 live, then the other 208 of the 36x6 tile dead; 208 takes two LEB128 bytes.
+    keyframe.addTile(3, FrameServer::TileEncoding::Runs, { 5, 3, 0xd0, 0x01 });
+    check(result, FrameServer::applyMessage(keyframe.bytes.data(), keyframe.bytes.size(), board, error), "The keyframe was rejected: " + error);
+    check(result, board.width == 100 && board.height == 70 && board.wordsPerRow == 2 && board.generation == 12 && board.population == 47,
+        "The keyframe's header wasn't taken.");
+    if (board.words.size() == 140) {
+        check(result, board.words[0] == 0b1011, "The packed tile's first row is wrong.");
+        check(result, board.words[1] == (1ull << 36) - 1 && board.words[63 * 2 + 1] == (1ull << 36) - 1, "The edge tile kept bits past the board.");
+        check(result, board.words[64 * 2 + 1] == 0b11100000ull && board.words[65 * 2 + 1] == 0, "The run tile is wrong.");
+    }
+    else check(result, false, "The keyframe made a board of " + std::to_string(board.words.size()) + " words.");
+
+    Message delta(FrameServer::MessageType::Delta, 1, 100, 70, 13, 44);
+    delta.addTile(0, FrameServer::TileEncoding::Empty, {});
+    check(result, FrameServer::applyMessage(delta.bytes.data(), delta.bytes.size(), board, error), "The delta was rejected: " + error);
+    check(result, board.generation == 13 && board.words[0] == 0 && board.words[1] == (1ull << 36) - 1, "The delta changed the wrong tiles.");
+
+    //Each of these is rejected and leaves the board as it was.
+    const FrameServer::ClientBoard before = board;
+    auto reject = [&](const std::string& name, const std::vector<uint8_t>& bytes) {
+        FrameServer::ClientBoard copy = board;
+        std::string messageError;
+        const bool applied = FrameServer::applyMessage(bytes.data(), bytes.size(), copy, messageError);
+        check(result, !applied && !messageError.empty(), "A message with " + name + " was applied.");
+        check(result, copy.words == before.words && copy.generation == before.generation && copy.width == before.width,
+            "A message with " + name + " changed the board.");
+    };
+
+    reject("a short header", std::vector<uint8_t>(delta.bytes.begin(), delta.bytes.begin() + 20));
+    Message version = delta;
+    version.bytes[1] = FrameServer::VERSION + 1;
+    reject("another version", version.bytes);
+    Message type = delta;
+    type.bytes[0] = 7;
+    reject("an unknown type", type.bytes);
+    Message resized(FrameServer::MessageType::Delta, 1, 64, 64, 14, 0);
+    resized.addTile(0, FrameServer::TileEncoding::Empty, {});
+    reject("another board size", resized.bytes);
+    Message outside(FrameServer::MessageType::Delta, 1, 100, 70, 14, 0);
+    outside.addTile(4, FrameServer::TileEncoding::Empty, {});
+    reject("a tile past the board", outside.bytes);
+    Message cut(FrameServer::MessageType::Delta, 2, 100, 70, 14, 0);
+    cut.addTile(2, FrameServer::TileEncoding::Empty, {});
+    cut.addTile(0, FrameServer::TileEncoding::Packed, packRows(rows));
+    reject("a payload cut short", std::vector<uint8_t>(cut.bytes.begin(), cut.bytes.end() - 8));
+    reject("a tile header cut short", std::vector<uint8_t>(cut.bytes.begin(), cut.bytes.begin() + FrameServer::HEADER_BYTES + FrameServer::TILE_HEADER_BYTES + 4));
+    Message wrongSize(FrameServer::MessageType::Delta, 1, 100, 70, 14, 0);
+    wrongSize.addTile(2, FrameServer::TileEncoding::Packed, packRows(rows));
+    reject("a packed tile of the wrong size", wrongSize.bytes);
+    Message overrun(FrameServer::MessageType::Delta, 1, 100, 70, 14, 0);
+    overrun.addTile(3, FrameServer::TileEncoding::Runs, { 0, 0xd9, 0x01 });
+    reject("runs past the tile", overrun.bytes);
+    Message underrun(FrameServer::MessageType::Delta, 1, 100, 70, 14, 0);
+    underrun.addTile(3, FrameServer::TileEncoding::Runs, { 5, 3 });
+    reject("runs short of the tile", underrun.bytes);
+    Message encoding(FrameServer::MessageType::Delta, 1, 100, 70, 14, 0);
+    encoding.addTile(0, (FrameServer::TileEncoding)9, {});
+    reject("an unknown encoding", encoding.bytes);
+    //The good tile first, so a message that is only checked as it is applied would change the board.
+    Message later(FrameServer::MessageType::Delta, 2, 100, 70, 14, 0);
+    later.addTile(1, FrameServer::TileEncoding::Empty, {});
+    later.addTile(9, FrameServer::TileEncoding::Empty, {});
+    reject("a bad tile after a good one", later.bytes);
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+bool receiveAll(int socketHandle, uint8_t* bytes, size_t count)
+{
+    while (count > 0) {
+        ssize_t received = recv(socketHandle, bytes, count, 0);
+        if (received <= 0) return false;
+        bytes += received;
+        count -= (size_t)received;
+    }
+    return true;
+}
+
+//Sends a WebSocket upgrade, with origin if it isn't empty, and returns the status line of the answer.
+//socketHandle is left open for streaming, or -1 if connecting failed.
+std::string requestUpgrade(int port, const std::string& origin, int& socketHandle)
+{
+    socketHandle = -1;
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = nullptr;
+    if (getaddrinfo("127.0.0.1", std::to_string(port).c_str(), &hints, &address) != 0 || !address) return "";
+    socketHandle = socket(address->ai_family, address->ai_socktype, 0);
+    bool connected = socketHandle >= 0 && connect(socketHandle, address->ai_addr, address->ai_addrlen) == 0;
+    freeaddrinfo(address);
+    if (!connected) return "";
+    //A broken server fails the test rather than hanging it.
+    timeval timeout{ 10, 0 };
+    setsockopt(socketHandle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1:" + std::to_string(port) + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n";
+    if (!origin.empty()) request += "Origin: " + origin + "\r\n";
+    request += "\r\n";
+    send(socketHandle, request.data(), request.size(), 0);
+
+    std::string response;
+    uint8_t character = 0;
+    while (response.size() < 4 || response.compare(response.size() - 4, 4, "\r\n\r\n") != 0) {
+        if (!receiveAll(socketHandle, &character, 1)) break;
+        response += (char)character;
+    }
+    return response.substr(0, response.find("\r\n"));
+}
+
+//Only an upgrade without an Origin or from the server's own page is taken; anything else is a page
+//elsewhere trying to reach the local server through the browser.
+TestResult testOrigin()
+{
+    TestResult result;
+    FrameServer server;
+    std::string error;
+    if (!server.start(0, error)) {
+        result.success = false;
+        result.resultString += "Could not start the server: " + error + "\nTest failed.\n";
+        return result;
+    }
+    const std::string port = std::to_string(server.getPort());
+    struct Case { std::string origin; bool accepted; };
+    for (const Case& test : { Case{ "", true }, Case{ "http://127.0.0.1:" + port, true }, Case{ "http://localhost:" + port, true },
+        Case{ "HTTP://LocalHost:" + port, true }, Case{ "http://[::1]:" + port, true }, Case{ "http://evil.example", false },
+        Case{ "http://evil.example:" + port, false }, Case{ "http://localhost:1", false }, Case{ "http://localhost", false },
+        Case{ "https://localhost:" + port, false }, Case{ "null", false }, Case{ "http://127.0.0.1:" + port + ".evil.example", false } }) {
+        int socketHandle = -1;
+        const std::string status = requestUpgrade(server.getPort(), test.origin, socketHandle);
+        const std::string expected = test.accepted ? "HTTP/1.1 101 Switching Protocols" : "HTTP/1.1 403 Forbidden";
+        check(result, status == expected, "Origin \"" + test.origin + "\" got \"" + status + "\", not \"" + expected + "\".");
+        if (socketHandle >= 0) close(socketHandle);
+    }
+    server.stop();
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+//Reads one server message. False if the connection dropped or it wasn't a binary message.
+bool receiveMessage(int socketHandle, std::vector<uint8_t>& payload)
+{
+    uint8_t header[2];
+    if (!receiveAll(socketHandle, header, 2)) return false;
+    uint64_t size = header[1] & 0x7f;
+    const int extendedBytes = (size == 126) ? 2 : (size == 127) ? 8 : 0;
+    if (extendedBytes > 0) {
+        uint8_t extended[8];
+        if (!receiveAll(socketHandle, extended, extendedBytes)) return false;
+        size = 0;
+        for (int byte = 0; byte < extendedBytes; byte++) size = size << 8 | extended[byte];
+    }
+    payload.resize(size);
+    return receiveAll(socketHandle, payload.data(), size) && (header[0] & 0x0f) == 0x2;
+}
+
+//The answer a client sends once it has shown a frame: an empty, masked text message.
+void acknowledge(int socketHandle)
+{
+    const uint8_t frame[6] = { 0x81, 0x80, 1, 2, 3, 4 };
+    send(socketHandle, frame, sizeof(frame), 0);
+}
+
+//A fast client and one that takes 50 ms over each frame both follow a run of 4000 generations. The slow one
+//skips most of them, and both should end up with the board the run finished on.
+TestResult testFastAndSlowClients()
+{
+    TestResult result;
+    FrameServer server;
+    server.maxFramesPerSecond = 1000;
+    std::string error;
+    if (!server.start(0, error)) {
+        result.success = false;
+        result.resultString += "Could not start the server: " + error + "\nTest failed.\n";
+        return result;
+    }
+
+    GridEngine board;
+    board.resize(333, 150);
+    std::mt19937 random(1);
+    std::vector<uint8_t> cells((size_t)333 * 150);
+    for (auto& cell : cells) cell = (random() % 3 == 0) ? 1 : 0;
+    board.loadCells(cells);
+
+    int fast = -1;
+    int slow = -1;
+    check(result, requestUpgrade(server.getPort(), "", fast) == "HTTP/1.1 101 Switching Protocols", "The fast client wasn't upgraded.");
+    check(result, requestUpgrade(server.getPort(), "", slow) == "HTTP/1.1 101 Switching Protocols", "The slow client wasn't upgraded.");
+    constexpr long long LAST_GENERATION = 4000;
+
+    std::atomic<bool> clientsDone = false;
+    std::thread run([&]() {
+        for (long long generation = 1; generation <= LAST_GENERATION; generation++) {
+            board.step(1, false);
+            server.publish(board, generation);
+        }
+        //Keep offering the last board until both clients have it.
+        while (!clientsDone) {
+            server.publish(board, LAST_GENERATION);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    auto follow = [&](int socketHandle, FrameServer::ClientBoard& clientBoard, int delayMilliseconds, std::string& clientError) {
+        std::vector<uint8_t> payload;
+        while (clientBoard.generation != LAST_GENERATION) {
+            if (!receiveMessage(socketHandle, payload)) {
+                clientError = "The connection dropped";
+                return;
+            }
+            if (!FrameServer::applyMessage(payload.data(), payload.size(), clientBoard, clientError)) return;
+            if (delayMilliseconds > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMilliseconds));
+            acknowledge(socketHandle);
+        }
+    };
+    FrameServer::ClientBoard fastBoard;
+    FrameServer::ClientBoard slowBoard;
+    std::string fastError;
+    std::string slowError;
+    if (result.success) {
+        std::thread slowClient([&]() { follow(slow, slowBoard, 50, slowError); });
+        follow(fast, fastBoard, 0, fastError);
+        slowClient.join();
+    }
+    clientsDone = true;
+    run.join();
+
+    const auto& words = board.getWords();
+    check(result, fastError.empty() && slowError.empty(), "A client failed: " + fastError + slowError);
+    check(result, std::vector<uint64_t>(words.begin(), words.end()) == fastBoard.words, "The fast client's board differs from the run's.");
+    check(result, std::vector<uint64_t>(words.begin(), words.end()) == slowBoard.words, "The slow client's board differs from the run's.");
+    check(result, fastBoard.population == board.countPopulation(), "The fast client was sent the wrong population.");
+
+    server.stop();
+    if (fast >= 0) close(fast);
+    if (slow >= 0) close(slow);
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+int main()
+{
+    bool success = true;
+
+    auto result = testApplyMessage();
+    std::cout << "Test result for applying messages:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    result = testOrigin();
+    std::cout << "Test result for WebSocket origins:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    result = testFastAndSlowClients();
+    std::cout << "Test result for a fast and a slow client:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    std::cout << "Test complete.\n";
+    return success ? 0 : 1;
+}
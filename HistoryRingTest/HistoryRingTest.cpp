@@ -0,0 +1,171 @@
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/model/EngineManager.hpp"
+#include "../src/model/GridEngine.hpp"
+#include "../src/model/HistoryRing.hpp"
+
+struct TestResult
+{
+    bool success = true;
+    std::string resultString = "";
+};
+
+constexpr int WIDTH = 300;
+constexpr int HEIGHT = 200;
+
+std::vector<uint8_t> makeSoup(unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::bernoulli_distribution alive(0.3);
+    std::vector<uint8_t> cells((size_t)WIDTH * HEIGHT);
+    for (auto& cell : cells) cell = alive(random) ? 1 : 0;
+    return cells;
+}
+
+void fillSoup(EngineManager& engine, unsigned int seed)
+{
+    engine.resize(WIDTH, HEIGHT);
+    engine.setRule(LifeRule());
+    engine.loadCells(makeSoup(seed));
+}
+
+bool sameWords(const GridEngine::Words& first, const GridEngine::Words& second)
+{
+    return first.size() == second.size() && std::equal(first.begin(), first.end(), second.begin());
+}
+
+//Seeks to generation and checks the board against expected.
+void checkSeek(TestResult& result, EngineManager& engine, long long generation, const GridEngine& expected)
+{
+    if (!engine.seek(generation)) {
+        result.success = false;
+        result.resultString += "Generation " + std::to_string(generation) + " isn't held.\n";
+    }
+    else if (!sameWords(engine.getGrid().getWords(), expected.getWords())) {
+        result.success = false;
+        result.resultString += "Seeking to generation " + std::to_string(generation) + " gave a different board.\n";
+    }
+}
+
+//Runs, rewinds, edits a cell and runs on. The edited generation and everything after it should follow the
+//edit, and the generations before it should still be the original run.
+TestResult testSeekAfterEdit()
+{
+    TestResult result;
+    EngineManager engine;
+    engine.recordHistory = true;
+    fillSoup(engine, 5);
+    engine.step(60);
+    engine.seek(20);
+    const bool alive = engine.getGrid().getCell(100, 150);
+    engine.setCell(100, 150, !alive);
+    engine.step(40);
+
+    GridEngine original;
+    original.resize(WIDTH, HEIGHT);
+    original.setRule(LifeRule());
+    original.loadCells(makeSoup(5));
+    original.step(10);
+
+    GridEngine edited;
+    edited.copyCellsFrom(original);
+    edited.setRule(LifeRule());
+    edited.step(10);
+    edited.setCell(100, 150, !alive);
+
+    checkSeek(result, engine, 10, original);
+    checkSeek(result, engine, 20, edited);
+    edited.step(25);
+    checkSeek(result, engine, 45, edited);
+    if (engine.getHistory().getNewestGeneration() != 60) {
+        result.success = false;
+        result.resultString += "The history should end at generation 60, where the edited run stopped, not "
+            + std::to_string(engine.getHistory().getNewestGeneration()) + ".\n";
+    }
+
+    //An edit without a seek first carries on the history from the edited board.
+    engine.step(15);
+    engine.setCell(10, 10, !engine.getGrid().getCell(10, 10));
+    GridEngine editedAgain;
+    editedAgain.copyCellsFrom(engine.getGrid());
+    editedAgain.setRule(LifeRule());
+    engine.step(10);
+    editedAgain.step(5);
+    checkSeek(result, engine, 65, editedAgain);
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+//Records a busy board under a small limit. The oldest segments should go, and every generation still held
+//should restore to what a run one generation at a time saw.
+TestResult testLimit(size_t maxBytes, int generations)
+{
+    TestResult result;
+    GridEngine board;
+    board.resize(WIDTH, HEIGHT);
+    board.setRule(LifeRule());
+    board.loadCells(makeSoup(9));
+    board.setChangeTracking(true);
+
+    HistoryRing history;
+    history.maxBytes = maxBytes;
+    history.recordKeyframe(board, 0);
+    std::vector<GridEngine::Words> expected{ board.getWords() };
+    for (int generation = 1; generation <= generations; generation++) {
+        board.step(1);
+        if (!history.recordStep(board, generation)) history.recordKeyframe(board, generation);
+        expected.push_back(board.getWords());
+    }
+
+    if (history.getBytes() > maxBytes && history.getKeyframeCount() > 1) {
+        result.success = false;
+        result.resultString += "The history takes " + std::to_string(history.getBytes()) + " bytes over "
+            + std::to_string(history.getKeyframeCount()) + " segments, past its limit of " + std::to_string(maxBytes) + ".\n";
+    }
+    if (history.getOldestGeneration() <= 0 || history.getNewestGeneration() != generations) {
+        result.success = false;
+        result.resultString += "Expected the oldest generations dropped and " + std::to_string(generations) + " kept, held "
+            + std::to_string(history.getOldestGeneration()) + " to " + std::to_string(history.getNewestGeneration()) + ".\n";
+    }
+    if (history.contains(history.getOldestGeneration() - 1)) {
+        result.success = false;
+        result.resultString += "A generation before the oldest is still held.\n";
+    }
+
+    GridEngine::Words words;
+    for (long long generation = history.getOldestGeneration(); generation <= history.getNewestGeneration(); generation++) {
+        if (!history.restore(generation, words) || !sameWords(words, expected[(size_t)generation])) {
+            result.success = false;
+            result.resultString += "Generation " + std::to_string(generation) + " didn't restore to the board it was.\n";
+            break;
+        }
+    }
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+int main()
+{
+    bool success = true;
+
+    auto result = testSeekAfterEdit();
+    std::cout << "Test result for seeking after an edit:\n";
+    std::cout << result.resultString;
+    success = success && result.success;
+
+    for (size_t maxBytes : { (size_t)64 << 10, (size_t)256 << 10 }) {
+        result = testLimit(maxBytes, 400);
+        std::cout << "Test result for 400 generations under " << (maxBytes >> 10) << " KiB:\n";
+        std::cout << result.resultString;
+        success = success && result.success;
+    }
+
+    std::cout << "Test complete.\n";
+    return success ? 0 : 1;
+}
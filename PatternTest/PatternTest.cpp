@@ -0,0 +1,158 @@
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/model/GridEngine.hpp"
+#include "../src/model/HashLifeEngine.hpp"
+#include "../src/model/PatternLoader.hpp"
+#include "../src/model/PatternWriter.hpp"
+
+struct TestResult
+{
+    bool success = true;
+    std::string resultString = "";
+};
+
+ModelParameters makeParameters(int width, int height)
+{
+    ModelParameters parameters;
+    parameters.modelWidth = width;
+    parameters.modelHeight = height;
+    return parameters;
+}
+
+//A soup in the middle of the board, stepped a little so it has gliders and ragged edges.
+void fillBoard(GridEngine& board, int width, int height, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::bernoulli_distribution alive(0.35);
+    std::vector<uint8_t> cells((size_t)width * height, 0);
+    for (int row = height / 4; row < height * 3 / 4; row++) {
+        for (int column = width / 5; column < width * 4 / 5; column++) cells[(size_t)row * width + column] = alive(random) ? 1 : 0;
+    }
+    board.resize(width, height);
+    board.loadCells(cells);
+    board.setRule(LifeRule());
+    board.step(7);
+}
+
+//The live cells relative to the top left of their bounding box, so boards placed differently still compare equal.
+std::vector<std::pair<int, int>> getShape(const GridEngine& board)
+{
+    std::vector<std::pair<int, int>> cells;
+    int top = board.getHeight(), left = board.getWidth();
+    for (int row = 0; row < board.getHeight(); row++) {
+        for (int column = 0; column < board.getWidth(); column++) {
+            if (!board.getCell(row, column)) continue;
+            cells.emplace_back(row, column);
+            if (row < top) top = row;
+            if (column < left) left = column;
+        }
+    }
+    for (auto& cell : cells) {
+        cell.first -= top;
+        cell.second -= left;
+    }
+    return cells;
+}
+
+//Writes the board in format, reads it back through parsePattern and checks the same cells come out.
+TestResult testRoundTrip(PatternWriter::Format format, const std::string& path, const std::string& comment, bool emptyBoard)
+{
+    TestResult result;
+    GridEngine board;
+    fillBoard(board, 150, 110, 3);
+    if (emptyBoard) board.loadCells(std::vector<uint8_t>((size_t)board.getWidth() * board.getHeight(), 0));
+
+    std::ostringstream stream;
+    if (!PatternWriter::write(board, stream, format, comment)) {
+        result.success = false;
+        result.resultString += "The writer failed.\n";
+        result.resultString += "Test failed.\n";
+        return result;
+    }
+
+    LoadedPattern pattern;
+    std::string error;
+    if (!PatternLoader::parsePattern(stream.str(), makeParameters(150, 110), pattern, &error, nullptr, nullptr, path)) {
+        result.success = false;
+        result.resultString += "The loader rejected its own output: " + error + "\n";
+        result.resultString += "Test failed.\n";
+        return result;
+    }
+
+    GridEngine loaded;
+    loaded.resize(pattern.parameters.modelWidth, pattern.parameters.modelHeight);
+    if (pattern.tree) pattern.tree->storeToGrid(loaded);
+    else loaded.loadCells(pattern.cells);
+
+    const auto expected = getShape(board);
+    const auto actual = getShape(loaded);
+    if (actual != expected) {
+        result.success = false;
+        result.resultString += "Wrote " + std::to_string(expected.size()) + " live cells and read back "
+            + std::to_string(actual.size()) + ", or the same count in a different shape.\n";
+    }
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+//Text that isn't a pattern has to fail with a position, and only an explicit x = 0, y = 0 header may be empty.
+TestResult testParse(const std::string& text, const std::string& path, bool shouldLoad, const std::string& errorPart)
+{
+    TestResult result;
+    LoadedPattern pattern;
+    std::string error;
+    const bool loaded = PatternLoader::parsePattern(text, makeParameters(64, 64), pattern, &error, nullptr, nullptr, path);
+    if (loaded != shouldLoad) {
+        result.success = false;
+        result.resultString += (loaded) ? "The text was accepted.\n" : "The text was rejected: " + error + "\n";
+    }
+    else if (!loaded && error.find(errorPart) == std::string::npos) {
+        result.success = false;
+        result.resultString += "The error should mention \"" + errorPart + "\": " + error + "\n";
+    }
+
+    result.resultString += (result.success) ? "Test passed.\n" : "Test failed.\n";
+    return result;
+}
+
+int main()
+{
+    bool success = true;
+    struct RoundTrip { PatternWriter::Format format; const char* path; const char* comment; bool empty; };
+    for (const RoundTrip& test : {
+        RoundTrip{ PatternWriter::Format::RLE, "x.rle", "", false },
+        RoundTrip{ PatternWriter::Format::RLE, "x.rle", "", true },
+        RoundTrip{ PatternWriter::Format::Plaintext, "x.cells", "", false },
+        RoundTrip{ PatternWriter::Format::Plaintext, "", "Name: soup", false },
+        RoundTrip{ PatternWriter::Format::Macrocell, "x.mc", "", false } }) {
+        auto result = testRoundTrip(test.format, test.path, test.comment, test.empty);
+        std::cout << "Test result for a " << PatternWriter::FormatNames[(int)test.format] << " round trip"
+            << ((test.empty) ? " of an empty board" : "") << ((test.path[0] == '\0') ? " without a path" : "") << ":\n";
+        std::cout << result.resultString;
+        success = success && result.success;
+    }
+
+    struct Parse { const char* name; const char* text; const char* path; bool load; const char* error; };
+    for (const Parse& test : {
+        Parse{ "a bare '!'", "!", "x.rle", false, "line 1, column 1" },
+        Parse{ "comments only", "#C nothing here\n#N empty\n", "x.rle", false, "line 3" },
+        Parse{ "a headerless body without cells", "3!", "x.rle", false, "line 1, column 2" },
+        Parse{ "a 3 by 3 header without cells", "x = 3, y = 3\n!", "x.rle", false, "line 2, column 1" },
+        Parse{ "an x = 0, y = 0 header", "x = 0, y = 0\n!", "x.rle", true, "" },
+        Parse{ "a headerless glider", "bo$2bo$3o!", "x.rle", true, "" },
+        Parse{ "a plaintext glider", "!Name: Glider\n.O\n..O\nOOO\n", "", true, "" },
+        Parse{ "a plaintext stray character", ".O\n..X\nOOO\n", "x.cells", false, "line 2, column 3" } }) {
+        auto result = testParse(test.text, test.path, test.load, test.error);
+        std::cout << "Test result for " << test.name << ":\n";
+        std::cout << result.resultString;
+        success = success && result.success;
+    }
+
+    std::cout << "Test complete.\n";
+    return success ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 
 #include "../submodules/ImGuiScope/ImGuiScope.hpp"
 
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -35,44 +36,66 @@ bool Core::init_() {
 
 bool Core::run() {
     if(!init_()) return false;
-    int lastDisplayUpdate, lastModelUpdate, now;
-    now = lastDisplayUpdate = lastModelUpdate = SDL_GetTicks();
 
     while (coreAppRunning_) {  
+        scheduler_.beginFrame();
 
-        now = SDL_GetTicks();
+        //When the model is paused and nothing is dirty, sleep in the event queue rather than redrawing at 60 Hz.
+        processEvents_(!modelRunning_ && !redrawRequired_());
 
-        processEvents_();
-        // if (modelRunning_ && now - lastModelUpdate > 1000 / desiredModelFPS_)
-        // {
-        //     update_();
-        //     measuredModelFPS_ = 1000 / (now - lastModelUpdate);
-        //     lastModelUpdate = now;
-        // }
-        if (now - lastDisplayUpdate > 1000 / displayFPS_)
-        {
+        //Generation boundary: swap in boards that finished loading in the background.
+        cpuModel_.applyPendingChanges();
+
+        //The scheduler decides how many generations fit in this frame.
+        //Only the last one gets colored and uploaded when we render.
+        if (modelRunning_) update_(scheduler_.generationsThisFrame());
+
+        if (redrawRequired_()) {
             render_();
-            measuredModelFPS_ = 1000 / (now - lastDisplayUpdate);
-            lastDisplayUpdate = now;
+            scheduler_.markRendered();
+
+            auto presentTimer = std::make_optional<ImGuiScope::TimeScope>("renderpresent");
+            gui_.mainWindow.renderPresent();
+            presentTimer.reset();
+
+            if (guiFramesPending_ > 0) guiFramesPending_--;
+        }
+
+        auto waitTime = scheduler_.endFrame();
+        if (waitTime.count() > 0) {
+            SDL_DelayNS(waitTime.count());
+            scheduler_.recordIdle(waitTime);
         }
-        int waitTime = std::min(1000 / displayFPS_ - (now - lastDisplayUpdate), 1000 / desiredModelFPS_ - (now - lastModelUpdate));
-        if (waitTime > 0) SDL_Delay(waitTime);
     }
 
     return true;
 }
 
-void Core::processEvents_() {
+bool Core::redrawRequired_() const {
+    return guiFramesPending_ > 0 || guiActive_ || surfClear || cpuModel_.needsRedraw();
+}
+
+void Core::processEvents_(bool waitForEvent) {
     //You will be able to register callbacks for events
     //For example the sidebar, which uses ImGui, will be able to use ImGui_ImplSDL2_ProcessEvent(&event) as a callback.
 
     //each event handler function will recieve the SDL_Event as well as a global state struct containing e.g. current button states.
     //Or maybe I  can grab the state from SDL directly?
     
-    auto timer = ImGuiScope::TimeScope("process events", false);
     SDL_Event event;
+    bool eventPending = false;
+    if (waitForEvent) {
+        auto waitStart = std::chrono::steady_clock::now();
+        eventPending = SDL_WaitEventTimeout(&event, idleWaitTimeoutMs_);
+        scheduler_.recordIdle(std::chrono::steady_clock::now() - waitStart);
+    }
+    else eventPending = SDL_PollEvent(&event);
 
-    while(SDL_PollEvent(&event)) {
+    auto timer = ImGuiScope::TimeScope("process events", false);
+
+    for (; eventPending; eventPending = SDL_PollEvent(&event)) {
+        //Any input may change what ImGui shows, so give it a few frames to catch up.
+        guiFramesPending_ = guiSettleFrames_;
 
         switch(event.type)
         {
@@ -93,12 +116,21 @@ void Core::processEvents_() {
                 if (event.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT)) {
                     cpuModel_.setMouseMove(event.motion.x, event.motion.y, true);
                 }
+                //Right drag paints. The edits are queued and applied between generations.
+                if ((event.motion.state & SDL_BUTTON(SDL_BUTTON_RIGHT)) && !ImGui::GetIO().WantCaptureMouse) {
+                    SDL_ConvertEventToRenderCoordinates(gui_.mainWindow.sdlRenderer, &event);
+                    cpuModel_.paintAt(event.motion.x, event.motion.y, true);
+                }
                 break;
             case SDL_EventType::SDL_EVENT_MOUSE_BUTTON_DOWN:
-                if (event.button.clicks == 1) {
+                if (event.button.button == SDL_BUTTON_LEFT && event.button.clicks == 1) {
                     SDL_ConvertEventToRenderCoordinates(gui_.mainWindow.sdlRenderer, &event);
                     cpuModel_.setMouseMove(event.button.x, event.button.y);
                 }
+                else if (event.button.button == SDL_BUTTON_RIGHT && !ImGui::GetIO().WantCaptureMouse) {
+                    SDL_ConvertEventToRenderCoordinates(gui_.mainWindow.sdlRenderer, &event);
+                    cpuModel_.paintAt(event.button.x, event.button.y, false);
+                }
                 break;
         }
         //In the future, I would like an event manager where you can register objects to receive events.
@@ -111,10 +143,15 @@ void Core::processEvents_() {
     }
 }
 
-void Core::update_() {
+void Core::update_(int generationCount) {
     //I might also have a model manager where I can register models, and have the manager call update on all models.
+    if (generationCount <= 0) return;
     auto timer = ImGuiScope::TimeScope("update", false);
-    cpuModel_.update();
+    auto stepStart = std::chrono::steady_clock::now();
+    cpuModel_.update(generationCount);
+    scheduler_.recordGenerations(
+        generationCount,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count());
 }
 
 void Core::render_() {
@@ -124,19 +161,20 @@ void Core::render_() {
     cpuModel_.draw(gui_.mainWindow.sdlRenderer);
 
     auto guiDrawTimer = std::make_optional<ImGuiScope::TimeScope>("Draw Gui");
-    gui_.interface.startDraw(surfClear, desiredModelFPS_, measuredModelFPS_);
+    bool wasRunning = modelRunning_;
+    gui_.interface.startDraw(surfClear, modelRunning_, scheduler_);
+    if (modelRunning_ != wasRunning) scheduler_.reset();
     if (surfClear) {
         cpuModel_.clear();
         surfClear = false;
     }
     cpuModel_.drawImGuiWidgets(modelRunning_);
     ImGuiScope::drawResultsHeader("Timer Results");
+    ImGui::Text("Idle CPU: %.1f%%", scheduler_.idlePercent());
     gui_.interface.endDraw(gui_.mainWindow.sdlRenderer);
     guiDrawTimer.reset();
 
-    auto presentTimer = std::make_optional<ImGuiScope::TimeScope>("renderpresent");
-    gui_.mainWindow.renderPresent();
-    //guiDrawTimer.reset();
+    guiActive_ = ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput;
 }
 
 void Core::handleSDL_KEYDOWN(SDL_Event& event) {
@@ -147,6 +185,11 @@ void Core::handleSDL_KEYDOWN(SDL_Event& event) {
             coreAppRunning_ = false;
             std::cout << "Escape key pressed: Exiting application." << std::endl;
             break;
+        case SDLK_SPACE:
+            if (ImGui::GetIO().WantCaptureKeyboard) break;
+            modelRunning_ = !modelRunning_;
+            scheduler_.reset();
+            break;
         default:
             break;
     }
@@ -155,5 +198,7 @@ void Core::handleSDL_KEYDOWN(SDL_Event& event) {
 Core::~Core() {
     //ImGui interface must be deleted before SDL
     gui_.shutdown();
+    //The model's GL context and textures must go before SDL_Quit
+    cpuModel_.shutdown();
     sdlManager_.shutdown();
 }
\ No newline at end of file
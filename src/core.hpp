@@ -8,6 +8,7 @@
 #include "gui/gui.hpp"
 #include "model/CpuModel.hpp"
 //#include "presets\modelpresets.hpp"
+#include "generation_scheduler.hpp"
 #include "sdl_manager.hpp"
 
 union SDL_Event;
@@ -20,9 +21,12 @@ public:
 
 private:
     bool init_();
-    void processEvents_();
-    void update_();
+    //If waitForEvent is set, blocks in SDL_WaitEventTimeout until something happens instead of polling.
+    void processEvents_(bool waitForEvent);
+    void update_(int generationCount);
     void render_();
+    //Anything on screen out of date? If not, there is no point drawing a frame.
+    bool redrawRequired_() const;
 
     void handleSDL_KEYDOWN(SDL_Event& event);
 
@@ -39,8 +43,14 @@ private:
     };
 
     const int displayFPS_ = 60;
-    int desiredModelFPS_ = 60;
-    int measuredModelFPS_ = 0;
+    //ImGui needs a few frames after input to settle hover and popup states.
+    const int guiSettleFrames_ = 3;
+    int guiFramesPending_ = guiSettleFrames_;
+    //An ImGui widget is being dragged or has text focus, so keep drawing.
+    bool guiActive_ = false;
+    //Upper bound on how long an idle loop blocks, so nothing waits forever on a missed wakeup.
+    const int idleWaitTimeoutMs_ = 500;
+    GenerationScheduler scheduler_{displayFPS_};
 
     SDLManager sdlManager_;
     GUI gui_;
@@ -0,0 +1,121 @@
+#include "generation_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+GenerationScheduler::GenerationScheduler(int displayFPS) :
+	framePeriodSeconds_(1.0 / std::max(displayFPS, 1))
+{
+}
+
+void GenerationScheduler::beginFrame()
+{
+	auto now = Clock::now();
+	if (firstFrame_) {
+		lastFrameStart_ = rateWindowStart_ = now;
+		frameTimeSeconds_ = framePeriodSeconds_;
+		firstFrame_ = false;
+	}
+	else {
+		frameTimeSeconds_ = std::chrono::duration<double>(now - lastFrameStart_).count();
+		if (frameTimeSeconds_ > 0.0) measuredDisplayFPS_ = (int)std::lround(1.0 / frameTimeSeconds_);
+	}
+	lastFrameStart_ = now;
+	frameStart_ = now;
+	frameStepSeconds_ = 0.0;
+}
+
+int GenerationScheduler::maxSpeedBatch_() const
+{
+	//Until we've timed at least one step we have no idea how expensive the model is.
+	if (stepSecondsPerGeneration_ <= 0.0) return 1;
+
+	//Leave room for rendering. Never squeeze stepping below a quarter of the frame though,
+	//otherwise a slow frame (window drag, dialog) would starve the model.
+	double budget = std::max(framePeriodSeconds_ - overheadSeconds_, framePeriodSeconds_ * 0.25);
+	double target = budget / stepSecondsPerGeneration_;
+	return (int)std::clamp<double>(target, 1.0, MAX_BATCH_SIZE);
+}
+
+int GenerationScheduler::generationsThisFrame()
+{
+	int generations = 0;
+	if (mode == Mode::MaxSpeed) {
+		//Only let the batch double per frame so a single fast measurement can't blow the budget.
+		generations = std::min(maxSpeedBatch_(), std::max(lastBatchSize_, 1) * 2);
+		lastBatchSize_ = generations;
+		return generations;
+	}
+
+	desiredGenerationsPerSecond = std::clamp(desiredGenerationsPerSecond, 1, MAX_DESIRED_GENERATIONS_PER_SECOND);
+	//Frame time is capped so coming back from a stall doesn't try to catch up on seconds of generations.
+	generationDebt_ += desiredGenerationsPerSecond * std::min(frameTimeSeconds_, framePeriodSeconds_ * 4);
+	generations = (int)generationDebt_;
+	int cap = maxSpeedBatch_();
+	if (generations > cap) {
+		//Can't keep up with the requested rate; run what fits and drop the rest.
+		generations = cap;
+		generationDebt_ = 0.0;
+	}
+	else generationDebt_ -= generations;
+
+	lastBatchSize_ = generations;
+	return generations;
+}
+
+void GenerationScheduler::recordGenerations(int generationCount, double stepSeconds)
+{
+	if (generationCount <= 0) return;
+
+	double perGeneration = stepSeconds / generationCount;
+	if (stepSecondsPerGeneration_ <= 0.0) stepSecondsPerGeneration_ = perGeneration;
+	else stepSecondsPerGeneration_ += EMA_WEIGHT * (perGeneration - stepSecondsPerGeneration_);
+
+	frameStepSeconds_ += stepSeconds;
+	generationsInWindow_ += generationCount;
+}
+
+void GenerationScheduler::markRendered()
+{
+	//Everything in the frame that wasn't stepping: events, coloring, upload, ImGui.
+	//Measured before present so vsync waits don't count against the stepping budget.
+	double busy = std::chrono::duration<double>(Clock::now() - frameStart_).count();
+	double overhead = std::max(busy - frameStepSeconds_, 0.0);
+	overheadSeconds_ += EMA_WEIGHT * (overhead - overheadSeconds_);
+}
+
+std::chrono::nanoseconds GenerationScheduler::endFrame()
+{
+	auto now = Clock::now();
+
+	double window = std::chrono::duration<double>(now - rateWindowStart_).count();
+	if (window >= 0.5) {
+		achievedGenerationsPerSecond_ = generationsInWindow_ / window;
+		idlePercent_ = std::clamp(100.0 * idleSecondsInWindow_ / window, 0.0, 100.0);
+		generationsInWindow_ = 0;
+		idleSecondsInWindow_ = 0.0;
+		rateWindowStart_ = now;
+	}
+
+	//Max speed mode already filled the frame with work.
+	if (mode == Mode::MaxSpeed) return std::chrono::nanoseconds(0);
+
+	auto elapsed = now - frameStart_;
+	auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(framePeriodSeconds_));
+	if (elapsed >= period) return std::chrono::nanoseconds(0);
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(period - elapsed);
+}
+
+void GenerationScheduler::recordIdle(std::chrono::nanoseconds idleTime)
+{
+	idleSecondsInWindow_ += std::chrono::duration<double>(idleTime).count();
+}
+
+void GenerationScheduler::reset()
+{
+	generationDebt_ = 0.0;
+	generationsInWindow_ = 0;
+	achievedGenerationsPerSecond_ = 0.0;
+	lastBatchSize_ = 0;
+	rateWindowStart_ = Clock::now();
+}
@@ -0,0 +1,88 @@
+#ifndef GAMEOFLIFE_GENERATION_SCHEDULER_HPP
+#define GAMEOFLIFE_GENERATION_SCHEDULER_HPP
+
+#include <chrono>
+
+//Decides how many generations the model advances each display frame.
+//In Paced mode it tries to hit desiredGenerationsPerSecond, which may be well above the display rate,
+//because generations are batched rather than tied one-to-one to frames.
+//In MaxSpeed mode it fills whatever is left of the frame budget after rendering,
+//sizing the batch from a running average of the measured step time.
+//Only the last generation of a batch gets colored and uploaded, so the rest cost nothing but the step.
+class GenerationScheduler {
+public:
+	enum class Mode {
+		Paced = 0,
+		MaxSpeed
+	};
+
+	explicit GenerationScheduler(int displayFPS);
+
+	//Call at the top of the main loop, before events are processed.
+	void beginFrame();
+
+	//Number of generations to run this frame. Zero is a valid answer in Paced mode.
+	int generationsThisFrame();
+
+	//Report the generations actually run this frame and how long the stepping took.
+	void recordGenerations(int generationCount, double stepSeconds);
+
+	//Call once the frame is drawn but before it is presented, so vsync waits aren't counted as render cost.
+	void markRendered();
+
+	//Call after the frame has been presented. Returns how long to sleep before the next frame.
+	std::chrono::nanoseconds endFrame();
+
+	//Forget accumulated timing, e.g. when the model is paused or regenerated.
+	void reset();
+
+	//Time the main loop spent blocked waiting for events or sleeping off the rest of a frame.
+	void recordIdle(std::chrono::nanoseconds idleTime);
+
+	double achievedGenerationsPerSecond() const { return achievedGenerationsPerSecond_; }
+	double frameTimeMs() const { return frameTimeSeconds_ * 1000.0; }
+	double stepTimeMs() const { return stepSecondsPerGeneration_ * 1000.0; }
+	int lastBatchSize() const { return lastBatchSize_; }
+	int measuredDisplayFPS() const { return measuredDisplayFPS_; }
+	//Share of wall time the main thread spent idle over the last measurement window.
+	double idlePercent() const { return idlePercent_; }
+
+	Mode mode = Mode::Paced;
+	int desiredGenerationsPerSecond = 60;
+
+	//Upper bounds so a single slow frame can't snowball into a huge batch.
+	static constexpr int MAX_DESIRED_GENERATIONS_PER_SECOND = 100000;
+	static constexpr int MAX_BATCH_SIZE = 1 << 16;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	int maxSpeedBatch_() const;
+
+	const double framePeriodSeconds_;
+
+	Clock::time_point frameStart_;
+	Clock::time_point lastFrameStart_;
+	Clock::time_point rateWindowStart_;
+	bool firstFrame_ = true;
+
+	//Fractional generations owed in Paced mode.
+	double generationDebt_ = 0.0;
+
+	//Exponential moving averages used by the governor.
+	double stepSecondsPerGeneration_ = 0.0;
+	double overheadSeconds_ = 0.0;
+	static constexpr double EMA_WEIGHT = 0.2;
+
+	double frameStepSeconds_ = 0.0;
+	int lastBatchSize_ = 0;
+
+	long long generationsInWindow_ = 0;
+	double idleSecondsInWindow_ = 0.0;
+	double idlePercent_ = 0.0;
+	double achievedGenerationsPerSecond_ = 0.0;
+	double frameTimeSeconds_ = 0.0;
+	int measuredDisplayFPS_ = 0;
+};
+
+#endif //GAMEOFLIFE_GENERATION_SCHEDULER_HPP
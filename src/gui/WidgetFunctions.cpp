@@ -1,9 +1,13 @@
 #include "WidgetFunctions.hpp"
+#include "../model/KernelTuner.hpp"
 #include "../presets/modelpresets.hpp"
 #include "../submodules/portable-file-dialogs/portable-file-dialogs.h"
 #include <imgui.h>
 #include <misc/cpp/imgui_stdlib.h>
 #include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 
 void WidgetFunctions::drawGOLRulesHeader(
     ModelParameters& modelParameters,
@@ -23,8 +27,12 @@ void WidgetFunctions::drawGOLRulesHeader(
             generateModelCallback(modelParameters);
         }
 
+        //A pattern's own rule is used until one of the inputs below is changed.
+        if (!modelParameters.ruleString.empty()) ImGui::Text("Pattern rule: %s", modelParameters.ruleString.c_str());
+
         if (ImGui::InputInt("Conway Rule 1 Cutoff", &modelParameters.rule1, 1, 1))
         {
+            modelParameters.ruleString.clear();
             if (modelParameters.rule1 < 0) modelParameters.rule1 = 0;
             if (modelParameters.rule1 > 8) modelParameters.rule1 = 8;
             if (modelParameters.rule1 >= modelParameters.rule3) modelParameters.rule1 = modelParameters.rule3 - 1;
@@ -33,6 +41,7 @@ void WidgetFunctions::drawGOLRulesHeader(
 
         if (ImGui::InputInt("Conway Rule 3 Cutoff", &modelParameters.rule3, 1, 1))
         {
+            modelParameters.ruleString.clear();
             if (modelParameters.rule3 < 1) modelParameters.rule3 = 1;
             if (modelParameters.rule3 > 8) modelParameters.rule3 = 8;
             if (modelParameters.rule3 <= modelParameters.rule1) modelParameters.rule3 = modelParameters.rule1 + 1;
@@ -41,6 +50,7 @@ void WidgetFunctions::drawGOLRulesHeader(
 
         if (ImGui::InputInt("Conway Rule 4", &modelParameters.rule4, 1, 1))
         {
+            modelParameters.ruleString.clear();
             if (modelParameters.rule4 < 0) modelParameters.rule4 = 0;
             if (modelParameters.rule4 > 8) modelParameters.rule4 = 8;
         };
@@ -130,29 +140,40 @@ void WidgetFunctions::drawVisualizationHeader(
 
 void WidgetFunctions::drawPresetsHeader(
     ModelParameters& modelParameters,
-    std::function<void(const ModelParameters&)> generateModelCallback,
-    std::function<void(std::string)> loadPresetFileCallback,
+    std::function<void(const ModelPresets::Preset&)> loadPresetCallback,
+    std::function<void(PatternLoader::ChooseFileFunction)> loadPresetFileCallback,
     std::function<void()> loadRLEStringCallback,
+    std::function<void(const std::string&)> savePatternCallback,
     std::string& RLEString,
+    const std::string& saveStatus,
     const bool modelRunning
 )
 {
     if (ImGui::CollapsingHeader("Presets"))
     {
         if (ImGui::Button("random")) {
-            generateModelCallback(ModelPresets::randomParams);
+            loadPresetCallback(ModelPresets::randomParams);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("a randomly generated field to observe conway's game of life.");
         if (ImGui::Button("From File")) {
-            auto fileDialog = pfd::open_file(
-                "Choose file",
-                pfd::path::home(),
-                { "RLE Pattern Files (.rle)", "*.rle" },
-                false);
-            auto result = fileDialog.result();
-            if (!result.empty()) loadPresetFileCallback(result[0]);
+            //Runs on the loader thread. Poll instead of blocking in result() so a cancel can close the dialog.
+            loadPresetFileCallback([](const std::atomic<bool>& cancelled) -> std::string {
+                auto fileDialog = pfd::open_file(
+                    "Choose file",
+                    pfd::path::home(),
+                    { "Pattern Files (.rle, .cells, .mc)", "*.rle *.cells *.mc" },
+                    false);
+                while (!fileDialog.ready(50)) {
+                    if (cancelled) {
+                        fileDialog.kill();
+                        return "";
+                    }
+                }
+                auto result = fileDialog.result();
+                return result.empty() ? "" : result[0];
+            });
         }
-        if (ImGui::IsItemHovered()) ImGui::SetTooltip("RLE encoded files can be downloaded from https://conwaylife.com/");
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("RLE and macrocell files can be downloaded from https://conwaylife.com/");
 
         if (ImGui::Button("From String")) ImGui::OpenPopup("Enter RLE string:");
         if (ImGui::BeginPopup("Enter RLE string:"))
@@ -168,107 +189,436 @@ void WidgetFunctions::drawPresetsHeader(
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("RLE text can be copied and pasted from https://conwaylife.com/");
 
+        if (ImGui::Button("Save to File")) {
+            auto path = pfd::save_file(
+                "Save pattern",
+                pfd::path::home(),
+                { "RLE Pattern Files (.rle)", "*.rle", "Plaintext Pattern Files (.cells)", "*.cells", "Macrocell Files (.mc)", "*.mc" }).result();
+            if (!path.empty()) savePatternCallback(path);
+        }
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Saves the live cells as RLE, as plaintext if the name ends in .cells or as a macrocell for .mc.");
+        if (!saveStatus.empty()) {
+            ImGui::SameLine();
+            ImGui::TextUnformatted(saveStatus.c_str());
+        }
+
         if (ImGui::Button("swiss cheese")) {
-            generateModelCallback(ModelPresets::swissCheeseParams);
+            loadPresetCallback(ModelPresets::swissCheeseParams);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("modified rules can produce different results.");
 
         if (ImGui::Button("decomposition")) {
-            generateModelCallback(ModelPresets::decompositionParams);
+            loadPresetCallback(ModelPresets::decompositionParams);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("modified rules can produce different results.");
 
         //if (ImGui::Button("blinker")) {
-        //    generateModelCallback(ModelPresets::blinkerParams);
+        //    loadPresetCallback(ModelPresets::blinkerParams);
         //}
         //if (ImGui::IsItemHovered()) ImGui::SetTooltip("the smallest oscillator in conway's game of life.");
 
         //if (ImGui::Button("lightweight spaceship")) {
-        //    generateModelCallback(ModelPresets::lightweightSpaceshipParams);
+        //    loadPresetCallback(ModelPresets::lightweightSpaceshipParams);
         //}
         //if (ImGui::IsItemHovered()) ImGui::SetTooltip("the smallest orthoganal spaceship in conway's game of life.");
 
         //if (ImGui::Button("blocker")) {
-        //    generateModelCallback(ModelPresets::blockerParams);
+        //    loadPresetCallback(ModelPresets::blockerParams);
         //}
         //if (ImGui::IsItemHovered()) ImGui::SetTooltip("blocker.");
 
         if (ImGui::Button("nihonium")) {
-            generateModelCallback(ModelPresets::nihoniumParams);
+            loadPresetCallback(ModelPresets::nihoniumParams);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("nihonium emu.");
 
 
 
         if (ImGui::Button("gabriel's p138 oscillator")) {
-            generateModelCallback(ModelPresets::gabrielsPOneThirtyEightParams);
+            loadPresetCallback(ModelPresets::gabrielsPOneThirtyEightParams);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("cool period 138 oscillator discovered by gabriel nivasch on october 13, 2002.");
 
         if (ImGui::Button("Backrack 1 Puffer")) {
-            generateModelCallback(ModelPresets::backrakeOnePufferVarTwo);
+            loadPresetCallback(ModelPresets::backrakeOnePufferVarTwo);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Variation 2 of backrake puffer discovered by Jason Summers in 2001.");
 
         if (ImGui::Button("Connected Phoenix Parts")) {
-            generateModelCallback(ModelPresets::connectedPhoenix);
+            loadPresetCallback(ModelPresets::connectedPhoenix);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("In a phoenix pattern, all live cells die every generation. Here a are a bunch of them connected together.");
 
         if (ImGui::Button("Double X")) {
-            generateModelCallback(ModelPresets::doubleX);
+            loadPresetCallback(ModelPresets::doubleX);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 46 oscillator discovered by Robert Wainwright");
 
         if (ImGui::Button("Frothing Puffer Rake")) {
-            generateModelCallback(ModelPresets::frothingPufferRake);
+            loadPresetCallback(ModelPresets::frothingPufferRake);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 270 puffer rake.");
 
         if (ImGui::Button("New Shuttle")) {
-            generateModelCallback(ModelPresets::newShuttle);
+            loadPresetCallback(ModelPresets::newShuttle);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 28 oscillator discovered by David Buckingham in 1973.");
 
         if (ImGui::Button("P28 Glider Shuttle")) {
-            generateModelCallback(ModelPresets::pTwentyEightGliderShuttle);
+            loadPresetCallback(ModelPresets::pTwentyEightGliderShuttle);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 28 glider shuttle constructed from 4 34P14 glider shuttles. Discovered 2018.");
 
         if (ImGui::Button("p47 B-heptomino hassler")) {
-            generateModelCallback(ModelPresets::pFourtySevenBHeptominoHassler);
+            loadPresetCallback(ModelPresets::pFourtySevenBHeptominoHassler);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Constructed from P47 Pre-Pulsar Shuttles.");
 
         if (ImGui::Button("Pre-Pulsar Shuttle 26")) {
-            generateModelCallback(ModelPresets::prePulsarShuttle26);
+            loadPresetCallback(ModelPresets::prePulsarShuttle26);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 26 Pre-Pulsar Shuttle Oscillatory discovered by David Buckingham in 1983.");
 
         if (ImGui::Button("Ring Of Fire")) {
-            generateModelCallback(ModelPresets::ringOfFire);
+            loadPresetCallback(ModelPresets::ringOfFire);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Period 2 oscillator discovered by Dean Hickerson in 1992.");
 
         if (ImGui::Button("Sir Robin")) {
-            generateModelCallback(ModelPresets::sirRobbin);
+            loadPresetCallback(ModelPresets::sirRobbin);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Interesting spaceship that known as a knightship that travels like a chess knight rather than on a pure diagonal.");
 
         if (ImGui::Button("Slow Puffer 2")) {
-            generateModelCallback(ModelPresets::slowPuffer2);
+            loadPresetCallback(ModelPresets::slowPuffer2);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Puffer that forms a large wick.");
 
         if (ImGui::Button("T-Nosed P8")) {
-            generateModelCallback(ModelPresets::tNosedP8);
+            loadPresetCallback(ModelPresets::tNosedP8);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("T-Nosed P8.");
 
         if (ImGui::Button("Vex Stabilization")) {
-            generateModelCallback(ModelPresets::vexStabilisation);
+            loadPresetCallback(ModelPresets::vexStabilisation);
         }
         if (ImGui::IsItemHovered()) ImGui::SetTooltip("Stabilization of Vex, a pattern discovered by Achim Flammenkamp in 1994.");
     }
     //ImDrawData* draw_data = ImGui::GetDrawData();//null
-}
\ No newline at end of file
+}
+
+void WidgetFunctions::drawCheckpointHeader(
+    std::string& checkpointPath,
+    int& checkpointInterval,
+    std::function<void()> checkpointCallback,
+    std::function<void()> restoreCallback,
+    const std::string& checkpointStatus
+)
+{
+    if (ImGui::CollapsingHeader("Checkpoint"))
+    {
+        ImGui::InputText("File", &checkpointPath);
+
+        if (ImGui::Button("Checkpoint Now") && !checkpointPath.empty()) checkpointCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Saves the board, rules and settings in the background. After the first, only the parts of the board that changed are added.");
+        ImGui::SameLine();
+        if (ImGui::Button("Restore") && !checkpointPath.empty()) restoreCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Picks the run up from the last checkpoint in the file.");
+
+        ImGui::InputInt("Every N Generations", &checkpointInterval, 100, 1000);
+        checkpointInterval = std::max(checkpointInterval, 0);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Checkpoints automatically while the model runs. 0 only checkpoints when asked.");
+
+        if (!checkpointStatus.empty()) ImGui::TextUnformatted(checkpointStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawEditHeader(EditBrush& editBrush)
+{
+    if (ImGui::CollapsingHeader("Edit")) {
+        ImGui::Combo("Brush", &editBrush.selectedModeIndex, editBrush.ModeNames, 3);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Right click or drag on the board. Edits apply between generations, so the model can keep running.");
+        if (editBrush.selectedModeIndex == (int)EditBrush::Mode::Stamp) {
+            ImGui::Combo("Stamp", &editBrush.selectedStampIndex, editBrush.StampSourceNames, 5);
+            if (ImGui::IsItemHovered()) ImGui::SetTooltip("RLE String uses the text from Presets > From String.");
+        }
+    }
+}
+
+void WidgetFunctions::drawEngineHeader(EngineManager& engineManager)
+{
+    if (ImGui::CollapsingHeader("Engine")) {
+        ImGui::Combo("Engine", &engineManager.selectedModeIndex, engineManager.ModeNames, 3);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Automatic runs dense boards on the grid and sparse, quiet patterns on HashLife.");
+        ImGui::SliderInt("Sample Interval", &engineManager.sampleInterval, 8, 1024);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Generations between looks at the pattern when choosing an engine.");
+        ImGui::Checkbox("Detect Cycles", &engineManager.cycleDetection);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Once the board repeats, replay the cached cycle instead of computing it.");
+
+        ImGui::Text("Running: %s", engineManager.EngineNames[(int)engineManager.getActiveEngine()]);
+        ImGui::TextWrapped("%s", engineManager.getReason().c_str());
+        if (engineManager.cycleDetection) ImGui::TextWrapped("Cycles: %s", engineManager.getCycleDetector().getStatusText().c_str());
+
+        const GridEngine::Stats stats = engineManager.getStats();
+        ImGui::Text("Population: %llu", (unsigned long long)stats.population);
+        if (engineManager.getActiveEngine() != EngineManager::Engine::HashLife) {
+            ImGui::Text("Births: %llu  Deaths: %llu", (unsigned long long)stats.births, (unsigned long long)stats.deaths);
+        }
+        if (!stats.isEmpty()) {
+            ImGui::Text("Live bounds: %d x %d at (%d, %d)",
+                stats.right - stats.left + 1, stats.bottom - stats.top + 1, stats.left, stats.top);
+        }
+        const auto& sample = engineManager.getLastSample();
+        if (!sample.bounds.isEmpty()) ImGui::Text("Bounds growing %.2f cells/gen", sample.boundsGrowthPerGeneration);
+        ImGui::Text("Grid: %.0f ns/gen", engineManager.getGridNanosecondsPerGeneration());
+        ImGui::TextWrapped("Grid kernel: %s", KernelTuner::describe(engineManager.getKernelConfig()).c_str());
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Picked by timing the candidates in the background the first time a board size and rule are used. Delete %s to retune.", KernelTuner::getDefaultCachePath().c_str());
+        bool pinned = !engineManager.getAffinity().empty();
+        if (ImGui::Checkbox("Pin Worker Threads", &pinned)) {
+            engineManager.setAffinity(pinned ? WorkerPool::getCompactAffinity(engineManager.getKernelConfig().threadCount) : std::vector<int>());
+        }
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keeps each worker on its own core, next to the rows of the board it steps.");
+        ImGui::Text("Huge pages: %s", GridMemory::isHugePageAdvised() ? "advised" : "not used");
+        ImGui::Text("HashLife: %.0f ns/gen", engineManager.getHashLifeNanosecondsPerGeneration());
+    }
+}
+
+void WidgetFunctions::drawLibraryHeader(
+    PatternLibrary& patternLibrary,
+    std::string& libraryDirectory,
+    std::string& query,
+    const std::vector<int>& matches,
+    int& selectedEntry,
+    std::function<void()> scanCallback,
+    std::function<void()> searchCallback,
+    std::function<void(const PatternLibrary::Entry&)> loadCallback
+)
+{
+    if (ImGui::CollapsingHeader("Pattern Library"))
+    {
+        ImGui::InputText("Directory", &libraryDirectory);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("RLE and macrocell files in here and its subdirectories are listed.");
+        if (ImGui::Button("Browse")) {
+            auto directory = pfd::select_folder("Choose pattern directory", pfd::path::home()).result();
+            if (!directory.empty()) {
+                libraryDirectory = directory;
+                scanCallback();
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Scan") && !libraryDirectory.empty()) scanCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Only new and changed files are read; the rest come from the index kept in the directory.");
+
+        if (patternLibrary.isScanning()) {
+            ImGui::ProgressBar(patternLibrary.getProgress());
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel##library")) patternLibrary.cancel();
+        }
+        else {
+            std::string status = patternLibrary.getStatusText();
+            if (!status.empty()) ImGui::TextUnformatted(status.c_str());
+        }
+
+        const std::vector<PatternLibrary::Entry>& entries = patternLibrary.getEntries();
+        if (entries.empty()) return;
+
+        if (ImGui::InputTextWithHint("Search", "name, rule, p46 or folder", &query)) searchCallback();
+        ImGui::Text("%zu of %zu patterns", matches.size(), entries.size());
+
+        //Only the rows in view are laid out, so ten thousand entries cost no more than a screenful.
+        float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        if (ImGui::BeginChild("##libraryList", ImVec2(0, rowHeight * 12), ImGuiChildFlags_Border)) {
+            ImGuiListClipper clipper;
+            clipper.Begin((int)matches.size(), rowHeight);
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                    int index = matches[row];
+                    const PatternLibrary::Entry& entry = entries[index];
+                    char label[256];
+                    if (entry.period > 0) std::snprintf(label, sizeof(label), "%s  (%s, p%d)", entry.name.c_str(), entry.rule.c_str(), entry.period);
+                    else std::snprintf(label, sizeof(label), "%s  (%s)", entry.name.c_str(), entry.rule.c_str());
+
+                    ImGui::PushID(index);
+                    if (ImGui::Selectable(label, selectedEntry == index)) selectedEntry = index;
+                    if (ImGui::IsItemHovered()) {
+                        if (entry.width > 0 || entry.height > 0) ImGui::SetTooltip("%s\n%d x %d cells", entry.file.c_str(), entry.width, entry.height);
+                        else ImGui::SetTooltip("%s", entry.file.c_str());
+                    }
+                    ImGui::PopID();
+                }
+            }
+            clipper.End();
+        }
+        ImGui::EndChild();
+
+        bool selected = selectedEntry >= 0 && selectedEntry < (int)entries.size();
+        if (ImGui::Button("Load Selected") && selected) loadCallback(entries[selectedEntry]);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("The pattern is only read now, in the background like From File.");
+    }
+}
+
+void WidgetFunctions::drawPosterHeader(
+    std::string& posterPath,
+    int& cellsPerPixel,
+    int& pixelsPerCell,
+    std::function<void()> exportCallback,
+    const std::string& posterStatus
+)
+{
+    if (ImGui::CollapsingHeader("Poster"))
+    {
+        ImGui::InputText("Image File", &posterPath);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("A PNG, or PPM if the name ends in .ppm.");
+        ImGui::InputInt("Cells Per Pixel", &cellsPerPixel, 1, 10);
+        cellsPerPixel = std::max(cellsPerPixel, 1);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Shrinks big boards. Each pixel is colored by how many of its cells are alive.");
+        ImGui::InputInt("Pixels Per Cell", &pixelsPerCell, 1, 10);
+        pixelsPerCell = std::max(pixelsPerCell, 1);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Enlarges small boards.");
+
+        if (ImGui::Button("Export Poster") && !posterPath.empty()) exportCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Renders the whole board in the current colormap, a band at a time, so the image never has to fit in memory.");
+
+        if (!posterStatus.empty()) ImGui::TextUnformatted(posterStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawRecordingHeader(
+    std::string& recordPath,
+    int& framesPerSecond,
+    const bool recording,
+    std::function<void()> toggleCallback,
+    const std::string& recordStatus
+)
+{
+    if (ImGui::CollapsingHeader("Record"))
+    {
+        ImGuiInputTextFlags recordingFlag = recording ? ImGuiInputTextFlags_ReadOnly : 0;
+        ImGui::InputText("Video File", &recordPath, recordingFlag);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("An animated GIF, or raw Y4M video if the name ends in .y4m.");
+        ImGui::InputInt("Frames Per Second", &framesPerSecond, 1, 10, recordingFlag);
+        framesPerSecond = std::clamp(framesPerSecond, 1, 50);
+
+        if (ImGui::Button(recording ? "Stop Recording" : "Start Recording") && !recordPath.empty()) toggleCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Records every generation shown, in the current colors. Frames are encoded in the background, and dropped rather than slow the model down.");
+
+        if (!recordStatus.empty()) ImGui::TextUnformatted(recordStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawTelemetryHeader(
+    std::string& telemetryPath,
+    int& telemetryInterval,
+    const TelemetrySink& telemetry,
+    std::function<void()> toggleCallback,
+    const std::string& telemetryStatus
+)
+{
+    if (ImGui::CollapsingHeader("Telemetry"))
+    {
+        const bool recording = telemetry.isRecording();
+        ImGui::InputText("Telemetry Folder", &telemetryPath, recording ? ImGuiInputTextFlags_ReadOnly : 0);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("One binary file per column goes here. gol-telemetry turns them into CSV.");
+
+        ImGui::InputInt("Row Every N Generations", &telemetryInterval, 1, 64);
+        telemetryInterval = std::max(telemetryInterval, 1);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("1 records every generation, which gathers the stats on each and costs about half as much again as the model. HashLife and cycle playback write a row after each jump.");
+
+        if (ImGui::Button(recording ? "Stop Telemetry" : "Start Telemetry") && !telemetryPath.empty()) toggleCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Records population, births, deaths, live bounds, changed words and step time from the stats the model gathers anyway, so it runs as fast as without.");
+
+        if (recording) ImGui::Text("%llu rows", (unsigned long long)telemetry.getRowCount());
+        if (!telemetryStatus.empty()) ImGui::TextUnformatted(telemetryStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawShareHeader(
+    std::string& shareName,
+    const bool sharing,
+    std::function<void()> toggleCallback,
+    const std::string& shareStatus
+)
+{
+    if (ImGui::CollapsingHeader("Share"))
+    {
+        ImGui::InputText("Shared Memory Name", &shareName, sharing ? ImGuiInputTextFlags_ReadOnly : 0);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("A POSIX shared memory name like /gol-board. gol-board-reader shows how to read it.");
+
+        if (ImGui::Button(sharing ? "Stop Sharing" : "Start Sharing") && !shareName.empty()) toggleCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Copies the board into shared memory after every update. Readers never slow the model down.");
+
+        if (!shareStatus.empty()) ImGui::TextUnformatted(shareStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawServeHeader(
+    int& servePort,
+    const FrameServer& server,
+    std::function<void()> toggleCallback,
+    const std::string& serveStatus
+)
+{
+    if (ImGui::CollapsingHeader("Stream"))
+    {
+        const bool serving = server.isServing();
+        ImGui::InputInt("Port", &servePort, 1, 100, serving ? ImGuiInputTextFlags_ReadOnly : 0);
+        servePort = std::clamp(servePort, 0, 65535);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Port on localhost to listen on. Open http://localhost:port/ in a browser to watch.");
+
+        if (ImGui::Button(serving ? "Stop Streaming" : "Start Streaming")) toggleCallback();
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Sends each client the tiles that changed since its last frame. Slow clients skip generations instead of slowing the model.");
+
+        if (serving) {
+            ImGui::Text("http://%s:%d/", server.bindAddress.c_str(), server.getPort());
+            ImGui::Text("%d clients, %lld frames, %.1f MiB sent", server.getClientCount(), server.getFrameCount(), server.getBytesSent() / 1048576.0);
+        }
+        if (!serveStatus.empty()) ImGui::TextUnformatted(serveStatus.c_str());
+    }
+}
+
+void WidgetFunctions::drawHistoryHeader(EngineManager& engineManager, std::function<void(long long)> seekCallback)
+{
+    if (ImGui::CollapsingHeader("History")) {
+        ImGui::Checkbox("Record History", &engineManager.recordHistory);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Keeps past generations to rewind to. Runs on the grid, and cycles aren't detected while recording.");
+
+        HistoryRing& history = engineManager.getHistory();
+        int megabytes = (int)(history.maxBytes >> 20);
+        ImGui::InputInt("Memory (MiB)", &megabytes, 16, 256);
+        history.maxBytes = (size_t)std::max(megabytes, 1) << 20;
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("The oldest generations are dropped once the history is bigger than this.");
+
+        if (history.isEmpty()) {
+            ImGui::TextUnformatted("Nothing recorded");
+            return;
+        }
+        long long oldest = history.getOldestGeneration();
+        long long newest = history.getNewestGeneration();
+        //The slider works in ints, so it counts from the oldest generation.
+        int span = (int)std::min<long long>(newest - oldest, std::numeric_limits<int>::max());
+        int offset = (int)std::clamp<long long>(engineManager.getGeneration() - oldest, 0, span);
+        if (ImGui::SliderInt("Generation", &offset, 0, span)) seekCallback(oldest + offset);
+        if (ImGui::IsItemHovered()) ImGui::SetTooltip("Generations %lld to %lld. Running on from an earlier one records over the ones after it.", oldest, newest);
+
+        if (ImGui::Button("Step Back") && engineManager.getGeneration() > oldest) seekCallback(engineManager.getGeneration() - 1);
+        ImGui::SameLine();
+        if (ImGui::Button("Latest")) seekCallback(newest);
+
+        ImGui::Text("%.1f MiB in %zu keyframes", history.getBytes() / (1024.0 * 1024.0), history.getKeyframeCount());
+    }
+}
+
+void WidgetFunctions::drawPatternLoaderStatus(PatternLoader& patternLoader)
+{
+    auto state = patternLoader.getState();
+    if (state == PatternLoader::State::Idle) return;
+
+    if (patternLoader.isBusy()) {
+        if (state == PatternLoader::State::Loading) ImGui::ProgressBar(patternLoader.getProgress(), ImVec2(-1, 0));
+        else ImGui::TextUnformatted(patternLoader.getStatusText().c_str());
+        if (ImGui::SmallButton("Cancel Load")) patternLoader.cancel();
+    }
+    else if (state == PatternLoader::State::Failed) {
+        ImGui::TextUnformatted(patternLoader.getStatusText().c_str());
+    }
+}
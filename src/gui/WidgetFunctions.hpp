@@ -2,13 +2,23 @@
 #define WIDGET_FUNCTIONS_HPP
 
 #include "../model/modelparameters.hpp"
+#include "../model/CellEditQueue.hpp"
 #include "../model/ColorMapper.hpp"
+#include "../model/EngineManager.hpp"
+#include "../model/FrameServer.hpp"
+#include "../model/PatternLibrary.hpp"
+#include "../model/PatternLoader.hpp"
+#include "../presets/modelpresets.hpp"
 
 #include <functional>
+#include <string>
+#include <vector>
 
 //Functions for drawing groups of ImGui widgets.
 //generateModelCallback is a function that will generate a new model with the given parameters.
-//loadPresetFileCallback returns a std::string with the path of a file to load.
+//loadPresetCallback replaces the board with a built in preset.
+//loadPresetFileCallback receives a function that shows the file dialog and returns the chosen path.
+//It is run on the loader thread, so the dialog doesn't block the frame.
 // loadRLEStringCallback and RLEString are used in a popup window to enter an RLE string.
 //loadRLEStringCallback returns void when the user is finished entering an RLE string.
 //RLEString is a string is modified whenever the user enters data,
@@ -32,14 +42,95 @@ namespace WidgetFunctions
 
 	void drawPresetsHeader(
 		ModelParameters& modelParameters,
-		std::function<void(const ModelParameters&)> generateModelCallback,
-		std::function<void(std::string)> loadPresetFileCallback,
+		std::function<void(const ModelPresets::Preset&)> loadPresetCallback,
+		std::function<void(PatternLoader::ChooseFileFunction)> loadPresetFileCallback,
 		std::function<void()> loadRLEStringCallback,
+		std::function<void(const std::string&)> savePatternCallback,
 		std::string& RLEString,
+		const std::string& saveStatus,
 		const bool modelRunning
 	);
 
+	//A scanned directory of patterns, searched as query is typed. matches holds the indices of the entries
+	//that match query and searchCallback is called whenever it changes. loadCallback gets the chosen entry.
+	void drawLibraryHeader(
+		PatternLibrary& patternLibrary,
+		std::string& libraryDirectory,
+		std::string& query,
+		const std::vector<int>& matches,
+		int& selectedEntry,
+		std::function<void()> scanCallback,
+		std::function<void()> searchCallback,
+		std::function<void(const PatternLibrary::Entry&)> loadCallback
+	);
+
+	//Saving and restoring the whole run, by hand or every so many generations.
+	void drawCheckpointHeader(
+		std::string& checkpointPath,
+		int& checkpointInterval,
+		std::function<void()> checkpointCallback,
+		std::function<void()> restoreCallback,
+		const std::string& checkpointStatus
+	);
+
 	void drawBlendFuncHeader(BlendFactor& blendFactor, bool& blendFactorChanged);
+
+	//Brush used for painting and stamping with the right mouse button.
+	void drawEditHeader(EditBrush& editBrush);
+
+	//Engine choice, and which engine is running and why.
+	void drawEngineHeader(EngineManager& engineManager);
+
+	//Rendering the whole board to one image, shrunk or enlarged.
+	void drawPosterHeader(
+		std::string& posterPath,
+		int& cellsPerPixel,
+		int& pixelsPerCell,
+		std::function<void()> exportCallback,
+		const std::string& posterStatus
+	);
+
+	//Recording the board as an animation. toggleCallback starts or stops it.
+	void drawRecordingHeader(
+		std::string& recordPath,
+		int& framesPerSecond,
+		const bool recording,
+		std::function<void()> toggleCallback,
+		const std::string& recordStatus
+	);
+
+	//Writing the stats every telemetryInterval generations to telemetryPath for gol-telemetry. toggleCallback
+	//starts or stops it.
+	void drawTelemetryHeader(
+		std::string& telemetryPath,
+		int& telemetryInterval,
+		const TelemetrySink& telemetry,
+		std::function<void()> toggleCallback,
+		const std::string& telemetryStatus
+	);
+
+	//Publishing the board in shared memory as shareName for other processes. toggleCallback starts or stops it.
+	void drawShareHeader(
+		std::string& shareName,
+		const bool sharing,
+		std::function<void()> toggleCallback,
+		const std::string& shareStatus
+	);
+
+	//Streaming the board over WebSocket on servePort to browsers and other local clients.
+	//toggleCallback starts or stops the server.
+	void drawServeHeader(
+		int& servePort,
+		const FrameServer& server,
+		std::function<void()> toggleCallback,
+		const std::string& serveStatus
+	);
+
+	//Recording the run and seeking back through it. seekCallback gets the generation to go to.
+	void drawHistoryHeader(EngineManager& engineManager, std::function<void(long long)> seekCallback);
+
+	//Progress bar and cancel button while a pattern loads in the background.
+	void drawPatternLoaderStatus(PatternLoader& patternLoader);
 }
 
 #endif //WIDGET_FUNCTIONS_HPP
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "gui.hpp"
+#include "../model/ConfigDirectory.hpp"
 
 #include <iostream>
 
@@ -34,6 +35,9 @@ bool GUI::initialize(
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableSetMousePos;
 	io.FontGlobalScale = 1;
+	//Kept with the other settings rather than in whatever directory the program was started from.
+	static const std::string iniPath = ConfigDirectory::getFilePath("imgui.ini");
+	io.IniFilename = iniPath.c_str();
 
 	if (!ImGui_ImplSDL3_InitForSDLRenderer(mainWindow.sdlWindow, mainWindow.sdlRenderer)) return false;//fails... mainwindow does not have a renderer
 	if (!ImGui_ImplSDLRenderer3_Init(mainWindow.sdlRenderer)) return false;
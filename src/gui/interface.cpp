@@ -1,5 +1,6 @@
 #include <gui/interface.hpp>
 #include <presets/modelpresets.hpp>
+#include <generation_scheduler.hpp>
 
 
 #include <iostream>
@@ -12,16 +13,39 @@
 
 void Interface::startDraw(
     bool& surfClear,
-    int& desiredModelFPS,
-    const int measuredModelFPS) 
+    bool& modelRunning,
+    GenerationScheduler& scheduler) 
 {
 	ImGui_ImplSDLRenderer3_NewFrame();
 	ImGui_ImplSDL3_NewFrame();
 	ImGui::NewFrame();
 
     ImGui::Begin("Options");
-    ImGui::SliderInt("Desired Model FPS", &desiredModelFPS, 1, 1000);
-    ImGui::Text("Measured FPS: %d", measuredModelFPS);
+    if (ImGui::Button(modelRunning ? "Pause" : "Run")) modelRunning = !modelRunning;
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Space also toggles the model.");
+
+    bool maxSpeed = scheduler.mode == GenerationScheduler::Mode::MaxSpeed;
+    ImGui::SameLine();
+    if (ImGui::Checkbox("Max Speed", &maxSpeed)) {
+        scheduler.mode = maxSpeed ? GenerationScheduler::Mode::MaxSpeed : GenerationScheduler::Mode::Paced;
+        scheduler.reset();
+    }
+    if (ImGui::IsItemHovered()) ImGui::SetTooltip("Run as many generations as fit in each frame. Only the last one is drawn.");
+
+    if (!maxSpeed) {
+        //Generations are batched per frame, so rates above the display rate are fine.
+        ImGui::SliderInt(
+            "Desired Model FPS",
+            &scheduler.desiredGenerationsPerSecond,
+            1,
+            GenerationScheduler::MAX_DESIRED_GENERATIONS_PER_SECOND,
+            "%d",
+            ImGuiSliderFlags_Logarithmic);
+    }
+    ImGui::Text("Measured FPS: %d", scheduler.measuredDisplayFPS());
+    ImGui::Text("Generations/s: %.0f", scheduler.achievedGenerationsPerSecond());
+    ImGui::Text("Frame time: %.2f ms (step %.3f ms x %d)",
+        scheduler.frameTimeMs(), scheduler.stepTimeMs(), scheduler.lastBatchSize());
     if (ImGui::SmallButton("Clear"))
         surfClear = true;
 }
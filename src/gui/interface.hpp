@@ -10,6 +10,7 @@
 #include <SDL3/SDL_rect.h>
 
 //class ModelPresets::ModelPresetName;
+class GenerationScheduler;
 struct SDL_Window;
 struct SDL_Renderer;
 
@@ -20,8 +21,8 @@ class Interface {
 
 		void startDraw(
 			bool& surfClear,
-			int& desiredModelFPS,
-			const int measuredModelFPS = 0
+			bool& modelRunning,
+			GenerationScheduler& scheduler
 		);
 
 		void endDraw(SDL_Renderer* renderer);
@@ -0,0 +1,41 @@
+#include "CellEditQueue.hpp"
+
+CellEditQueue::~CellEditQueue()
+{
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    while (node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+void CellEditQueue::push(CellEdit edit)
+{
+    Node* node = new Node{ std::move(edit), head_.load(std::memory_order_relaxed) };
+    //On failure compare_exchange reloads node->next with the current head, so just retry.
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {}
+}
+
+bool CellEditQueue::drain(std::vector<CellEdit>& edits)
+{
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    if (!node) return false;
+
+    //The stack is newest first. Reverse it so edits apply in the order they were made.
+    Node* reversed = nullptr;
+    while (node) {
+        Node* next = node->next;
+        node->next = reversed;
+        reversed = node;
+        node = next;
+    }
+
+    while (reversed) {
+        Node* next = reversed->next;
+        edits.push_back(std::move(reversed->edit));
+        delete reversed;
+        reversed = next;
+    }
+    return true;
+}
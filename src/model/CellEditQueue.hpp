@@ -0,0 +1,97 @@
+#ifndef CELL_EDIT_QUEUE_HPP
+#define CELL_EDIT_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct CellOffset
+{
+	int row = 0;
+	int column = 0;
+};
+
+//Live cells of a pattern relative to its center, for stamping at the cursor.
+struct CellStamp
+{
+	std::vector<CellOffset> cells;
+};
+
+struct CellEdit
+{
+	enum class Kind : uint8_t
+	{
+		SetAlive,
+		SetDead,
+		Stamp
+	};
+
+	Kind kind = Kind::SetAlive;
+	int row = 0;
+	int column = 0;
+	//Only used by Kind::Stamp. Shared so a stroke of stamps doesn't copy the pattern each time.
+	std::shared_ptr<const CellStamp> stamp;
+};
+
+//What the right mouse button does to the board.
+struct EditBrush
+{
+	enum class Mode
+	{
+		Draw,
+		Erase,
+		Stamp
+	};
+
+	constexpr static const char* ModeNames[3] = { "Draw", "Erase", "Stamp" };
+
+	//Stamps are built from these presets, or from the RLE string box.
+	enum class StampSource
+	{
+		Glider,
+		LightweightSpaceship,
+		Blinker,
+		Blocker,
+		RLEString
+	};
+
+	constexpr static const char* StampSourceNames[5] = {
+		"Glider", "Lightweight Spaceship", "Blinker", "Blocker", "RLE String" };
+
+	int selectedModeIndex = (int)Mode::Draw;
+	int selectedStampIndex = (int)StampSource::Glider;
+};
+
+//Multi-producer, single-consumer queue of board edits.
+//Producers push onto an intrusive stack with a CAS, so they never block or wait on the simulation.
+//The consumer takes the whole stack with one exchange between generations and reverses it into push order.
+//Because the consumer never pops single nodes, the CAS can't suffer from ABA.
+class CellEditQueue
+{
+public:
+	CellEditQueue() = default;
+	~CellEditQueue();
+
+	CellEditQueue(const CellEditQueue&) = delete;
+	CellEditQueue& operator=(const CellEditQueue&) = delete;
+
+	//Safe from any thread.
+	void push(CellEdit edit);
+
+	//Consumer only. Appends everything pushed so far to edits, oldest first. Returns false if there was nothing.
+	bool drain(std::vector<CellEdit>& edits);
+
+	bool empty() const { return head_.load(std::memory_order_acquire) == nullptr; }
+
+private:
+	struct Node
+	{
+		CellEdit edit;
+		Node* next = nullptr;
+	};
+
+	std::atomic<Node*> head_ = nullptr;
+};
+
+#endif //CELL_EDIT_QUEUE_HPP
@@ -0,0 +1,698 @@
+#include "Checkpoint.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <system_error>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'G', 'O', 'L', 'C', 'K', 'P', 'T', '\0' };
+    constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    constexpr uint32_t VERSION = 1;
+
+    enum class SegmentKind : uint32_t
+    {
+        Base,
+        Update
+    };
+
+    size_t roundUpToBlock(size_t bytes)
+    {
+        return (bytes + Checkpoint::BLOCK_BYTES - 1) / Checkpoint::BLOCK_BYTES * Checkpoint::BLOCK_BYTES;
+    }
+
+    Checkpoint::Blocks allocateBlocks(size_t bytes)
+    {
+        return Checkpoint::Blocks(static_cast<uint64_t*>(::operator new[](bytes, std::align_val_t(Checkpoint::BLOCK_BYTES))));
+    }
+
+    //Catches torn or corrupted updates; not meant to resist anyone forging one.
+    uint64_t checksum(uint64_t hash, const char* data, size_t bytes)
+    {
+        size_t index = 0;
+        for (; index + sizeof(uint64_t) <= bytes; index += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + index, sizeof(word));
+            hash = ((hash ^ word) * 0x9E3779B97F4A7C15ull) ^ (hash >> 29);
+        }
+        for (; index < bytes; index++) hash = ((hash ^ (unsigned char)data[index]) * 0x9E3779B97F4A7C15ull) ^ (hash >> 29);
+        return hash;
+    }
+
+    class Encoder
+    {
+    public:
+        template <typename T>
+        void put(const T& value)
+        {
+            bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+        void putString(const std::string& text)
+        {
+            put<uint32_t>((uint32_t)text.size());
+            bytes_ += text;
+        }
+        template <typename T>
+        void patch(size_t offset, const T& value)
+        {
+            std::memcpy(&bytes_[offset], &value, sizeof(T));
+        }
+        size_t size() const { return bytes_.size(); }
+        const std::string& getBytes() const { return bytes_; }
+
+    private:
+        std::string bytes_;
+    };
+
+    //Reads fields back in order. Running off the end leaves it failed and the fields zero.
+    class Decoder
+    {
+    public:
+        Decoder(const char* data, size_t size) : data_(data), size_(size) {}
+
+        template <typename T>
+        T get()
+        {
+            T value{};
+            if (sizeof(T) > size_ - position_) {
+                ok_ = false;
+                return value;
+            }
+            std::memcpy(&value, data_ + position_, sizeof(T));
+            position_ += sizeof(T);
+            return value;
+        }
+        std::string getString()
+        {
+            uint32_t length = get<uint32_t>();
+            if (!ok_ || length > size_ - position_) {
+                ok_ = false;
+                return "";
+            }
+            std::string text(data_ + position_, length);
+            position_ += length;
+            return text;
+        }
+        const char* skip(size_t bytes)
+        {
+            if (bytes > size_ - position_) {
+                ok_ = false;
+                return nullptr;
+            }
+            const char* start = data_ + position_;
+            position_ += bytes;
+            return start;
+        }
+        bool isOk() const { return ok_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+        size_t position_ = 0;
+        bool ok_ = true;
+    };
+
+    //Offsets of the fields written after the fact.
+    constexpr size_t HEADER_BYTES_OFFSET = sizeof(MAGIC) + 3 * sizeof(uint32_t);
+    constexpr size_t CHECKSUM_OFFSET = HEADER_BYTES_OFFSET + sizeof(uint32_t) + sizeof(uint64_t) + 4 * sizeof(int32_t)
+        + sizeof(int64_t) + 2 * sizeof(uint16_t);
+
+    void encodeHeader(Encoder& encoder, SegmentKind kind, uint64_t tileCount, const Checkpoint::Header& header)
+    {
+        encoder.put(MAGIC);
+        encoder.put<uint32_t>(BYTE_ORDER_MARK);
+        encoder.put<uint32_t>(VERSION);
+        encoder.put<uint32_t>((uint32_t)kind);
+        //Header bytes, patched in once the index list is on.
+        encoder.put<uint32_t>(0);
+        encoder.put<uint64_t>(tileCount);
+        encoder.put<int32_t>(header.width);
+        encoder.put<int32_t>(header.height);
+        encoder.put<int32_t>(Checkpoint::TILE_ROWS);
+        encoder.put<int32_t>(Checkpoint::TILE_WORDS);
+        encoder.put<int64_t>(header.generation);
+        encoder.put<uint16_t>(header.rule.birth);
+        encoder.put<uint16_t>(header.rule.survive);
+        //Checksum of an update's index list and tiles, patched in. Bases are renamed into place whole, so never torn.
+        encoder.put<uint64_t>(0);
+
+        const ModelParameters& parameters = header.parameters;
+        encoder.put<int32_t>(parameters.modelWidth);
+        encoder.put<int32_t>(parameters.modelHeight);
+        encoder.put<float>(parameters.fillFactor);
+        encoder.put<int32_t>(parameters.rule1);
+        encoder.put<int32_t>(parameters.rule3);
+        encoder.put<int32_t>(parameters.rule4);
+        encoder.put<int32_t>(parameters.minWidth);
+        encoder.put<int32_t>(parameters.minHeight);
+        encoder.put<int32_t>(parameters.displacementX);
+        encoder.put<int32_t>(parameters.displacementY);
+        encoder.put<int32_t>(parameters.zoomLevel);
+        encoder.putString(parameters.ruleString);
+    }
+
+    struct Segment
+    {
+        Checkpoint::Header header;
+        SegmentKind kind = SegmentKind::Base;
+        uint64_t tileCount = 0;
+        uint64_t checksum = 0;
+        //An update's tile numbers, tileCount uint32s.
+        const char* indices = nullptr;
+        const char* tiles = nullptr;
+        uint64_t bytes = 0;
+    };
+
+    //Checks that a whole segment is there and makes sense, without looking at the tiles.
+    bool readSegment(const char* data, size_t size, Segment& segment, std::string& problem)
+    {
+        Decoder decoder(data, size);
+        const char* magic = decoder.skip(sizeof(MAGIC));
+        if (!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+            problem = "not a checkpoint";
+            return false;
+        }
+        if (decoder.get<uint32_t>() != BYTE_ORDER_MARK) {
+            problem = "written on a machine with the other byte order";
+            return false;
+        }
+        if (decoder.get<uint32_t>() != VERSION) {
+            problem = "written by a different version";
+            return false;
+        }
+        segment.kind = (SegmentKind)decoder.get<uint32_t>();
+        uint64_t headerBytes = decoder.get<uint32_t>();
+        segment.tileCount = decoder.get<uint64_t>();
+        Checkpoint::Header& header = segment.header;
+        header.width = decoder.get<int32_t>();
+        header.height = decoder.get<int32_t>();
+        int tileRows = decoder.get<int32_t>();
+        int tileWords = decoder.get<int32_t>();
+        header.generation = decoder.get<int64_t>();
+        header.rule.birth = decoder.get<uint16_t>();
+        header.rule.survive = decoder.get<uint16_t>();
+        segment.checksum = decoder.get<uint64_t>();
+
+        ModelParameters& parameters = header.parameters;
+        parameters.random = false;
+        parameters.modelWidth = decoder.get<int32_t>();
+        parameters.modelHeight = decoder.get<int32_t>();
+        parameters.fillFactor = decoder.get<float>();
+        parameters.rule1 = decoder.get<int32_t>();
+        parameters.rule3 = decoder.get<int32_t>();
+        parameters.rule4 = decoder.get<int32_t>();
+        parameters.minWidth = decoder.get<int32_t>();
+        parameters.minHeight = decoder.get<int32_t>();
+        parameters.displacementX = decoder.get<int32_t>();
+        parameters.displacementY = decoder.get<int32_t>();
+        parameters.zoomLevel = decoder.get<int32_t>();
+        parameters.ruleString = decoder.getString();
+        if (segment.kind == SegmentKind::Update) segment.indices = decoder.skip(segment.tileCount * sizeof(uint32_t));
+
+        if (!decoder.isOk() || headerBytes % Checkpoint::BLOCK_BYTES != 0 || headerBytes > size) {
+            problem = "cut short";
+            return false;
+        }
+        if ((segment.kind != SegmentKind::Base && segment.kind != SegmentKind::Update)
+            || tileRows != Checkpoint::TILE_ROWS || tileWords != Checkpoint::TILE_WORDS
+            || header.width <= 0 || header.height <= 0) {
+            problem = "header is damaged";
+            return false;
+        }
+        if (segment.tileCount > (size - headerBytes) / Checkpoint::TILE_BYTES) {
+            problem = "cut short";
+            return false;
+        }
+        segment.tiles = data + headerBytes;
+        segment.bytes = headerBytes + segment.tileCount * Checkpoint::TILE_BYTES;
+        return true;
+    }
+
+    struct Span
+    {
+        const void* data = nullptr;
+        size_t bytes = 0;
+    };
+
+    //A file written a whole block at a time, bypassing the page cache where it can.
+    class OutputFile
+    {
+    public:
+        ~OutputFile()
+        {
+            close();
+        }
+
+        //Appending keeps what is there and returns its size in existingBytes.
+        bool open(const std::string& path, bool append, uint64_t& existingBytes, std::string& error)
+        {
+            existingBytes = 0;
+#if !defined(_WIN32)
+            int flags = O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC);
+#if defined(O_DIRECT)
+            descriptor_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            direct_ = descriptor_ >= 0;
+#endif
+            //Some file systems, tmpfs among them, refuse O_DIRECT.
+            if (descriptor_ < 0) descriptor_ = ::open(path.c_str(), flags, 0644);
+            if (descriptor_ < 0) {
+                error = "Could not open " + path + " for writing";
+                return false;
+            }
+            if (append) {
+                off_t end = lseek(descriptor_, 0, SEEK_END);
+                if (end < 0) {
+                    error = "Could not seek in " + path;
+                    return false;
+                }
+                existingBytes = (uint64_t)end;
+            }
+#else
+            if (append) {
+                std::error_code code;
+                existingBytes = std::filesystem::file_size(path, code);
+                if (code) existingBytes = 0;
+            }
+            stream_.open(path, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+            if (!stream_.is_open()) {
+                error = "Could not open " + path + " for writing";
+                return false;
+            }
+#endif
+            path_ = path;
+            return true;
+        }
+
+        //Writes the spans back to back. With O_DIRECT each must start on a block and be whole blocks.
+        bool write(const std::vector<Span>& spans, std::string& error)
+        {
+#if !defined(_WIN32)
+            constexpr size_t MAX_VECTORS = std::min<size_t>(IOV_MAX, 1024);
+            std::vector<iovec> vectors;
+            vectors.reserve(std::min(spans.size(), MAX_VECTORS));
+            size_t next = 0;
+            while (next < spans.size()) {
+                vectors.clear();
+                for (; next < spans.size() && vectors.size() < MAX_VECTORS; next++) {
+                    vectors.push_back(iovec{ const_cast<void*>(spans[next].data), spans[next].bytes });
+                }
+                size_t first = 0;
+                while (first < vectors.size()) {
+                    ssize_t written = ::writev(descriptor_, &vectors[first], (int)(vectors.size() - first));
+                    if (written < 0) {
+                        if (errno == EINTR) continue;
+                        //Alignment is the usual complaint; carry on through the page cache.
+                        if (errno == EINVAL && direct_ && dropDirect_()) continue;
+                        error = "Could not write " + path_ + ": " + std::strerror(errno);
+                        return false;
+                    }
+                    //Skip whatever went out, which may end part way through a span.
+                    size_t remaining = (size_t)written;
+                    while (first < vectors.size() && remaining >= vectors[first].iov_len) remaining -= vectors[first++].iov_len;
+                    if (remaining > 0) {
+                        vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+                        vectors[first].iov_len -= remaining;
+                        //The rest of that span is no longer block aligned.
+                        if (direct_ && !dropDirect_()) {
+                            error = "Could not write " + path_;
+                            return false;
+                        }
+                    }
+                }
+            }
+#else
+            for (const Span& span : spans) stream_.write(static_cast<const char*>(span.data), (std::streamsize)span.bytes);
+            if (!stream_) {
+                error = "Could not write " + path_;
+                return false;
+            }
+#endif
+            return true;
+        }
+
+        //Flushes the data to the disk and closes the file.
+        bool finish(std::string& error)
+        {
+#if !defined(_WIN32)
+#if defined(__linux__)
+            bool synced = fdatasync(descriptor_) == 0;
+#else
+            bool synced = fsync(descriptor_) == 0;
+#endif
+            bool closed = ::close(descriptor_) == 0;
+            descriptor_ = -1;
+#else
+            stream_.close();
+            bool synced = !stream_.fail();
+            bool closed = true;
+#endif
+            if (!synced || !closed) {
+                error = "Could not finish writing " + path_;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        void close()
+        {
+#if !defined(_WIN32)
+            if (descriptor_ >= 0) ::close(descriptor_);
+            descriptor_ = -1;
+#endif
+        }
+
+#if !defined(_WIN32)
+        bool dropDirect_()
+        {
+            direct_ = false;
+#if defined(O_DIRECT)
+            int flags = fcntl(descriptor_, F_GETFL);
+            return flags >= 0 && fcntl(descriptor_, F_SETFL, flags & ~O_DIRECT) == 0;
+#else
+            return true;
+#endif
+        }
+
+        int descriptor_ = -1;
+        bool direct_ = false;
+#else
+        std::ofstream stream_;
+#endif
+        std::string path_;
+    };
+}
+
+void Checkpoint::BlockDeleter::operator()(uint64_t* words) const
+{
+    ::operator delete[](words, std::align_val_t(BLOCK_BYTES));
+}
+
+Checkpoint::Writer::~Writer()
+{
+    wait();
+}
+
+void Checkpoint::Writer::write(const std::string& path, const GridEngine& board, long long generation, const ModelParameters& parameters)
+{
+    wait();
+
+    const int wordsPerRow = board.getWordsPerRow();
+    const int tileColumns = (wordsPerRow + TILE_WORDS - 1) / TILE_WORDS;
+    const int tileRows = (board.getHeight() + TILE_ROWS - 1) / TILE_ROWS;
+    if (board.getWidth() != header_.width || board.getHeight() != header_.height || !current_) {
+        tileColumns_ = tileColumns;
+        tileCount_ = (size_t)tileColumns * tileRows;
+        current_ = allocateBlocks(tileCount_ * TILE_BYTES);
+        previous_ = allocateBlocks(tileCount_ * TILE_BYTES);
+        haveBase_ = false;
+    }
+    if (path != path_) haveBase_ = false;
+
+    //Rows of a tile are TILE_WORDS words, a cache line, so this streams through the board once.
+    //Tiles hanging over the right or bottom edge are padded with dead cells.
+    for (int tileRow = 0; tileRow < tileRows; tileRow++) {
+        uint64_t* tileRowStart = current_.get() + (size_t)tileRow * tileColumns * TILE_ROWS * TILE_WORDS;
+        for (int rowInTile = 0; rowInTile < TILE_ROWS; rowInTile++) {
+            int row = tileRow * TILE_ROWS + rowInTile;
+            const uint64_t* words = (row < board.getHeight()) ? board.getRow(row) : nullptr;
+            for (int tileColumn = 0; tileColumn < tileColumns; tileColumn++) {
+                uint64_t* target = tileRowStart + ((size_t)tileColumn * TILE_ROWS + rowInTile) * TILE_WORDS;
+                int firstWord = tileColumn * TILE_WORDS;
+                int wordCount = words ? std::min(TILE_WORDS, wordsPerRow - firstWord) : 0;
+                if (wordCount > 0) std::memcpy(target, words + firstWord, (size_t)wordCount * sizeof(uint64_t));
+                std::fill(target + wordCount, target + TILE_WORDS, 0ull);
+            }
+        }
+    }
+
+    path_ = path;
+    header_.width = board.getWidth();
+    header_.height = board.getHeight();
+    header_.generation = generation;
+    header_.rule = board.getRule();
+    header_.parameters = parameters;
+    header_.parameters.random = false;
+    header_.parameters.runLengthEncoding.clear();
+    header_.parameters.modelWidth = board.getWidth();
+    header_.parameters.modelHeight = board.getHeight();
+
+    busy_ = true;
+    worker_ = std::thread([this]() {
+        writeQueued_();
+        busy_ = false;
+    });
+}
+
+bool Checkpoint::Writer::wait()
+{
+    if (worker_.joinable()) worker_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_.empty();
+}
+
+Checkpoint::WriteResult Checkpoint::Writer::getLastResult() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return result_;
+}
+
+Checkpoint::WriteTotals Checkpoint::Writer::getTotals() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return totals_;
+}
+
+std::string Checkpoint::Writer::getError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void Checkpoint::Writer::writeQueued_()
+{
+    auto start = std::chrono::steady_clock::now();
+    WriteResult result;
+    result.tileCount = tileCount_;
+    result.generation = header_.generation;
+
+    std::vector<uint32_t> changedTiles;
+    bool full = !haveBase_;
+    if (!full) {
+        for (size_t tile = 0; tile < tileCount_; tile++) {
+            const uint64_t* now = current_.get() + tile * TILE_ROWS * TILE_WORDS;
+            const uint64_t* before = previous_.get() + tile * TILE_ROWS * TILE_WORDS;
+            if (std::memcmp(now, before, TILE_BYTES) != 0) changedTiles.push_back((uint32_t)tile);
+        }
+        //Past this, restoring would read more updates than board, so start a new base.
+        full = tilesSinceBase_ + changedTiles.size() > tileCount_ / 2;
+    }
+
+    std::string error;
+    bool written = full ? writeBase_(result, error) : writeUpdate_(changedTiles, result, error);
+    if (written) {
+        std::swap(current_, previous_);
+        haveBase_ = true;
+        tilesSinceBase_ = full ? 0 : tilesSinceBase_ + changedTiles.size();
+    }
+    else {
+        //Whatever reached the file may be half an update; start again from a base.
+        haveBase_ = false;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = error;
+    if (!written) return;
+    result_ = result;
+    totals_.checkpoints++;
+    if (result.full) totals_.bases++;
+    totals_.tilesWritten += result.tilesWritten;
+    totals_.bytesWritten += result.bytesWritten;
+    totals_.seconds += result.seconds;
+}
+
+bool Checkpoint::Writer::writeBase_(WriteResult& result, std::string& error)
+{
+    Encoder encoder;
+    encodeHeader(encoder, SegmentKind::Base, tileCount_, header_);
+    size_t headerBytes = roundUpToBlock(encoder.size());
+    encoder.patch<uint32_t>(HEADER_BYTES_OFFSET, (uint32_t)headerBytes);
+    Blocks headerBlocks = allocateBlocks(headerBytes);
+    std::memset(headerBlocks.get(), 0, headerBytes);
+    std::memcpy(headerBlocks.get(), encoder.getBytes().data(), encoder.size());
+
+    std::vector<Span> spans = {
+        Span{ headerBlocks.get(), headerBytes },
+        Span{ current_.get(), tileCount_ * TILE_BYTES } };
+
+    //Written aside and renamed over the old file, so a crash leaves one checkpoint or the other.
+    std::string temporaryPath = path_ + ".tmp";
+    OutputFile file;
+    uint64_t existingBytes = 0;
+    if (!file.open(temporaryPath, false, existingBytes, error) || !file.write(spans, error) || !file.finish(error)) return false;
+    std::error_code code;
+    std::filesystem::rename(temporaryPath, path_, code);
+    if (code) {
+        error = "Could not replace " + path_ + ": " + code.message();
+        return false;
+    }
+
+    fileBytes_ = headerBytes + tileCount_ * TILE_BYTES;
+    result.full = true;
+    result.tilesWritten = tileCount_;
+    result.bytesWritten = fileBytes_;
+    return true;
+}
+
+bool Checkpoint::Writer::writeUpdate_(const std::vector<uint32_t>& changedTiles, WriteResult& result, std::string& error)
+{
+    Encoder encoder;
+    encodeHeader(encoder, SegmentKind::Update, changedTiles.size(), header_);
+    size_t indicesOffset = encoder.size();
+    for (uint32_t tile : changedTiles) encoder.put<uint32_t>(tile);
+    size_t headerBytes = roundUpToBlock(encoder.size());
+    encoder.patch<uint32_t>(HEADER_BYTES_OFFSET, (uint32_t)headerBytes);
+
+    //Runs of neighboring tiles go out as one span.
+    std::vector<Span> spans(1);
+    uint64_t hash = checksum(0, encoder.getBytes().data() + indicesOffset, encoder.size() - indicesOffset);
+    for (size_t index = 0; index < changedTiles.size(); index++) {
+        const char* tile = reinterpret_cast<const char*>(current_.get() + (size_t)changedTiles[index] * TILE_ROWS * TILE_WORDS);
+        hash = checksum(hash, tile, TILE_BYTES);
+        if (index > 0 && changedTiles[index] == changedTiles[index - 1] + 1) spans.back().bytes += TILE_BYTES;
+        else spans.push_back(Span{ tile, TILE_BYTES });
+    }
+    encoder.patch<uint64_t>(CHECKSUM_OFFSET, hash);
+
+    Blocks headerBlocks = allocateBlocks(headerBytes);
+    std::memset(headerBlocks.get(), 0, headerBytes);
+    std::memcpy(headerBlocks.get(), encoder.getBytes().data(), encoder.size());
+    spans[0] = Span{ headerBlocks.get(), headerBytes };
+
+    OutputFile file;
+    uint64_t existingBytes = 0;
+    if (!file.open(path_, true, existingBytes, error)) return false;
+    if (existingBytes != fileBytes_) {
+        error = path_ + " changed since the last checkpoint";
+        return false;
+    }
+    if (!file.write(spans, error) || !file.finish(error)) return false;
+
+    uint64_t segmentBytes = headerBytes + changedTiles.size() * TILE_BYTES;
+    fileBytes_ += segmentBytes;
+    result.full = false;
+    result.tilesWritten = changedTiles.size();
+    result.bytesWritten = segmentBytes;
+    return true;
+}
+
+bool Checkpoint::Reader::fail_(const std::string& error)
+{
+    error_ = error;
+    file_.close();
+    header_ = Header();
+    tileColumns_ = 0;
+    tiles_.clear();
+    segmentCount_ = 0;
+    return false;
+}
+
+bool Checkpoint::Reader::open(const std::string& path)
+{
+    error_.clear();
+    header_ = Header();
+    tileColumns_ = 0;
+    tiles_.clear();
+    segmentCount_ = 0;
+    ignoredBytes_ = 0;
+    if (!file_.open(path)) return fail_(file_.getError());
+
+    const char* data = file_.getText().data();
+    const size_t size = file_.getSize();
+    size_t position = 0;
+    while (position < size) {
+        Segment segment;
+        std::string problem;
+        bool valid = readSegment(data + position, size - position, segment, problem);
+        if (segmentCount_ == 0) {
+            if (!valid) return fail_(path + ": " + problem);
+            if (segment.kind != SegmentKind::Base) return fail_(path + ": doesn't start with a full checkpoint");
+
+            int wordsPerRow = (segment.header.width + GridEngine::BITS_PER_WORD - 1) / GridEngine::BITS_PER_WORD;
+            tileColumns_ = (wordsPerRow + TILE_WORDS - 1) / TILE_WORDS;
+            uint64_t tileCount = (uint64_t)tileColumns_ * ((segment.header.height + TILE_ROWS - 1) / TILE_ROWS);
+            if (segment.tileCount != tileCount) return fail_(path + ": header is damaged");
+            tiles_.resize(tileCount);
+            for (size_t tile = 0; tile < tiles_.size(); tile++) tiles_[tile] = segment.tiles + tile * TILE_BYTES;
+        }
+        else {
+            //Updates are appended in place, so the last one can be torn. Keep the checkpoint before it.
+            if (!valid || segment.kind != SegmentKind::Update
+                || segment.header.width != header_.width || segment.header.height != header_.height) break;
+            uint64_t hash = checksum(0, segment.indices, segment.tileCount * sizeof(uint32_t));
+            hash = checksum(hash, segment.tiles, segment.tileCount * TILE_BYTES);
+            if (hash != segment.checksum) break;
+
+            bool indicesValid = true;
+            for (uint64_t index = 0; index < segment.tileCount && indicesValid; index++) {
+                uint32_t tile;
+                std::memcpy(&tile, segment.indices + index * sizeof(uint32_t), sizeof(tile));
+                indicesValid = tile < tiles_.size();
+            }
+            if (!indicesValid) break;
+            for (uint64_t index = 0; index < segment.tileCount; index++) {
+                uint32_t tile;
+                std::memcpy(&tile, segment.indices + index * sizeof(uint32_t), sizeof(tile));
+                tiles_[tile] = segment.tiles + index * TILE_BYTES;
+            }
+        }
+        header_ = segment.header;
+        position += segment.bytes;
+        segmentCount_++;
+    }
+    if (segmentCount_ == 0) return fail_(path + ": not a checkpoint");
+    ignoredBytes_ = size - position;
+    return true;
+}
+
+void Checkpoint::Reader::load(EngineManager& engine) const
+{
+    const int width = header_.width;
+    const int height = header_.height;
+    engine.setRule(header_.rule);
+    engine.loadRows(width, height, header_.generation, [&](GridEngine& grid) {
+        const int wordsPerRow = grid.getWordsPerRow();
+        const int lastBits = width % GridEngine::BITS_PER_WORD;
+        const uint64_t lastWordMask = (lastBits == 0) ? ~0ull : (1ull << lastBits) - 1;
+        //One row of tiles at a time, gathered into whole rows for the grid.
+        std::vector<uint64_t> band((size_t)TILE_ROWS * wordsPerRow);
+        for (int rowBegin = 0, tileRow = 0; rowBegin < height; rowBegin += TILE_ROWS, tileRow++) {
+            const int rowCount = std::min(TILE_ROWS, height - rowBegin);
+            for (int tileColumn = 0; tileColumn < tileColumns_; tileColumn++) {
+                const char* tile = tiles_[(size_t)tileRow * tileColumns_ + tileColumn];
+                const int firstWord = tileColumn * TILE_WORDS;
+                const int wordCount = std::min(TILE_WORDS, wordsPerRow - firstWord);
+                for (int row = 0; row < rowCount; row++) {
+                    std::memcpy(&band[(size_t)row * wordsPerRow + firstWord], tile + (size_t)row * TILE_WORDS * sizeof(uint64_t),
+                        (size_t)wordCount * sizeof(uint64_t));
+                }
+            }
+            //A damaged file mustn't leave cells past the width, which the kernel assumes are dead.
+            for (int row = 0; row < rowCount; row++) band[(size_t)row * wordsPerRow + wordsPerRow - 1] &= lastWordMask;
+            grid.setRows(rowBegin, rowCount, band.data());
+        }
+    });
+}
@@ -0,0 +1,159 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "EngineManager.hpp"
+#include "GridEngine.hpp"
+#include "LifeRule.hpp"
+#include "MappedFile.hpp"
+#include "modelparameters.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Binary snapshots of a run, so a long run can be stopped and picked up again later.
+//A checkpoint file is one full base followed by any number of updates. Each is a segment of whole 4 KiB
+//blocks: a header with the generation, rule and ModelParameters, then the board cut into tiles of
+//TILE_ROWS rows by TILE_WORDS packed words, one block per tile. A base has every tile; an update has only
+//the tiles that changed since the checkpoint before it, so a mostly settled board costs little to save.
+//Numbers are in the writer's byte order, which the header records.
+namespace Checkpoint
+{
+	constexpr size_t BLOCK_BYTES = 4096;
+	constexpr int TILE_ROWS = 64;
+	constexpr int TILE_WORDS = 8;
+	constexpr size_t TILE_BYTES = (size_t)TILE_ROWS * TILE_WORDS * sizeof(uint64_t);
+	static_assert(TILE_BYTES == BLOCK_BYTES, "a tile should fill a block exactly");
+
+	//What a checkpoint holds besides the cells, as of its newest segment.
+	struct Header
+	{
+		int width = 0;
+		int height = 0;
+		long long generation = 0;
+		LifeRule rule;
+		//As they were when it was written, except that random is false and runLengthEncoding is empty;
+		//the cells take their place.
+		ModelParameters parameters;
+	};
+
+	struct WriteResult
+	{
+		bool full = false;
+		size_t tilesWritten = 0;
+		size_t tileCount = 0;
+		uint64_t bytesWritten = 0;
+		long long generation = 0;
+		//Spent on the background thread, comparing tiles and writing them out.
+		double seconds = 0.0;
+	};
+
+	//Everything a Writer has put out so far.
+	struct WriteTotals
+	{
+		int checkpoints = 0;
+		int bases = 0;
+		uint64_t tilesWritten = 0;
+		uint64_t bytesWritten = 0;
+		double seconds = 0.0;
+	};
+
+	//Blocks of BLOCK_BYTES alignment, as O_DIRECT wants.
+	struct BlockDeleter
+	{
+		void operator()(uint64_t* words) const;
+	};
+	using Blocks = std::unique_ptr<uint64_t[], BlockDeleter>;
+
+	//Writes checkpoints on a background thread. write() copies the board into tiles, about as quick as
+	//a memcpy, and returns; comparing the tiles and writing them happen while the caller keeps stepping.
+	//Files are opened with O_DIRECT where the file system allows it, and the tiles go out with writev
+	//straight from the copy. Keeps two copies of the board: the one being written and the one before it.
+	class Writer
+	{
+	public:
+		Writer() = default;
+		~Writer();
+
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+
+		//Queues a checkpoint of board. The first one to a path is a full base, as is any after the board
+		//is resized, a write fails, or the updates since the base add up to half the board; a base goes to
+		//a temporary file that is renamed over path once it is on disk. The rest are appended as updates.
+		//If the previous checkpoint is still being written this waits for it first.
+		void write(const std::string& path, const GridEngine& board, long long generation, const ModelParameters& parameters);
+		//Blocks until the queued checkpoint is on disk. False if it failed; getError() says why.
+		bool wait();
+		bool isBusy() const { return busy_.load(); }
+
+		//Of the last checkpoint to finish.
+		WriteResult getLastResult() const;
+		WriteTotals getTotals() const;
+		std::string getError() const;
+
+	private:
+		//These run on the worker thread.
+		void writeQueued_();
+		bool writeBase_(WriteResult& result, std::string& error);
+		bool writeUpdate_(const std::vector<uint32_t>& changedTiles, WriteResult& result, std::string& error);
+
+		std::thread worker_;
+		std::atomic<bool> busy_ = false;
+
+		//Set by write() for the worker.
+		std::string path_;
+		Header header_;
+		Blocks current_;
+		Blocks previous_;
+		size_t tileCount_ = 0;
+		int tileColumns_ = 0;
+		//Whether previous_ holds what is in path_, so the next checkpoint can be an update.
+		bool haveBase_ = false;
+		size_t tilesSinceBase_ = 0;
+		uint64_t fileBytes_ = 0;
+
+		mutable std::mutex mutex_;
+		WriteResult result_;
+		WriteTotals totals_;
+		std::string error_;
+	};
+
+	//Maps a checkpoint file and checks its segments. An update cut short, by a crash mid write say, is
+	//dropped along with anything after it, which leaves the checkpoint before it.
+	class Reader
+	{
+	public:
+		bool open(const std::string& path);
+
+		const Header& getHeader() const { return header_; }
+		//Base included.
+		int getSegmentCount() const { return segmentCount_; }
+		//Bytes at the end that didn't make a whole, valid update.
+		uint64_t getIgnoredBytes() const { return ignoredBytes_; }
+		const std::string& getError() const { return error_; }
+
+		//Replaces the engine's board with the checkpoint's cells and carries on from its generation.
+		//Each tile is copied from the newest segment that has it straight into the grid.
+		void load(EngineManager& engine) const;
+
+	private:
+		bool fail_(const std::string& error);
+
+		MappedFile file_;
+		Header header_;
+		int tileColumns_ = 0;
+		//Newest copy of each tile, in the mapped file.
+		std::vector<const char*> tiles_;
+		int segmentCount_ = 0;
+		uint64_t ignoredBytes_ = 0;
+		std::string error_;
+	};
+}
+
+#endif //CHECKPOINT_HPP
@@ -0,0 +1,40 @@
+#include "ConfigDirectory.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr const char* APPLICATION_NAME = "gameoflife";
+
+    fs::path getBaseDirectory()
+    {
+#if defined(_WIN32)
+        if (const char* appData = std::getenv("APPDATA"); appData && *appData) return appData;
+#else
+        if (const char* configHome = std::getenv("XDG_CONFIG_HOME"); configHome && *configHome) return configHome;
+        if (const char* home = std::getenv("HOME"); home && *home) return fs::path(home) / ".config";
+#endif
+        return {};
+    }
+}
+
+std::string ConfigDirectory::getPath()
+{
+    fs::path base = getBaseDirectory();
+    if (base.empty()) return "";
+    fs::path directory = base / APPLICATION_NAME;
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error || !fs::is_directory(directory, error)) return "";
+    return directory.string();
+}
+
+std::string ConfigDirectory::getFilePath(const std::string& fileName)
+{
+    std::string directory = getPath();
+    return directory.empty() ? fileName : (fs::path(directory) / fileName).string();
+}
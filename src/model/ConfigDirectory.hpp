@@ -0,0 +1,16 @@
+#ifndef CONFIG_DIRECTORY_HPP
+#define CONFIG_DIRECTORY_HPP
+
+#include <string>
+
+//Where settings and caches are kept between runs, so they don't depend on the directory the program is started from:
+//$XDG_CONFIG_HOME/gameoflife or ~/.config/gameoflife, %APPDATA%\gameoflife on Windows.
+namespace ConfigDirectory
+{
+	//The directory, created the first time it is asked for. Empty, meaning the current directory, if none of the above is set or it can't be created.
+	std::string getPath();
+	//fileName inside getPath().
+	std::string getFilePath(const std::string& fileName);
+}
+
+#endif //CONFIG_DIRECTORY_HPP
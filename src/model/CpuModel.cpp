@@ -1,4 +1,7 @@
 #include "CpuModel.hpp"
+#include "KernelTuner.hpp"
+#include "PatternWriter.hpp"
+#include "PosterExporter.hpp"
 #include "presets/modelpresets.hpp"
 #include "gui/WidgetFunctions.hpp"
 #include "ImGuiScope/ImGuiScope.hpp"
@@ -7,22 +10,54 @@
 #include <imgui.h>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <random>
-#include <sstream>
+#include <thread>
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_render.h>
 
+namespace
+{
+    constexpr std::string_view gliderRle = "bo$2bo$3o!";
+    constexpr PackedPattern gliderPattern = PackedRle::decode<gliderRle>();
+
+    //For work that finishes on another thread, in case the main loop is idling in SDL_WaitEventTimeout.
+    void wakeMainLoop()
+    {
+        SDL_Event event{};
+        event.type = SDL_EVENT_USER;
+        SDL_PushEvent(&event);
+    }
+}
+
 CpuModel::CpuModel() :
     glRenderer_(nullptr),
-    gridBackBuffer_(nullptr, SDL_DestroyTexture)
-{}
+    gridBackBuffer_(nullptr, SDL_DestroyTexture),
+    gridTexture_(nullptr, SDL_DestroyTexture)
+{
+    //The loader and library finish on their own threads.
+    patternLoader_.setFinishedCallback(wakeMainLoop);
+    patternLibrary_.setFinishedCallback(wakeMainLoop);
+    engine_.setThreadCount((int)std::max(std::thread::hardware_concurrency(), 1u));
+}
 
 CpuModel::~CpuModel()
 {
-    glRenderer_->cleanup();
+    cancelKernelTuning_();
+    shutdown();
+}
+
+void CpuModel::shutdown()
+{
+    glRenderer_.reset();
+    gridTexture_.reset();
+    gridBackBuffer_.reset();
 }
 
 void CpuModel::initialize(const SDL_Rect& viewport)
@@ -50,6 +85,7 @@ void CpuModel::setMouseMove(float x, float y, bool motion)
             x - screenSpaceDisplacementX_,
             y - screenSpaceDisplacementY_,
             activeModelParams_.zoomLevel);
+    overlayChanged_ = true;
     std::cout << x << ", " << y << std::endl;
 }
 
@@ -68,22 +104,196 @@ void CpuModel::setBlendFactor(const BlendFactor& blendFactor)
 void CpuModel::clear()
 {
     glRenderer_->clearPoint();
+    overlayChanged_ = true;
+}
+
+bool CpuModel::needsRedraw() const
+{
+    if (initBackbufferRequired_ || recalcDrawRange_ || resetBlendFactor_ || overlayChanged_) return true;
+    if (colorizeRequired_ || generationsSinceColorize_ > 0 || !dirtyTiles_.empty()) return true;
+    //Keep the progress bar moving, and pick up the result as soon as it lands.
+    auto loaderState = patternLoader_.getState();
+    if (loaderState == PatternLoader::State::Loading || loaderState == PatternLoader::State::Ready) return true;
+    if (patternLibrary_.isScanning()) return true;
+
+    const auto& palette = colorMapper_.ColormapMap.at(static_cast<ColorMapper::ColormapType>(colorMapper_.selectedColorMapIndex));
+    return std::memcmp(palette.data(), colorizedPalette_.data(), sizeof(colorizedPalette_)) != 0;
 }
 
 void CpuModel::resizeGrid_()
 {
-	grid_.resize(activeModelParams_.modelHeight, std::vector<uint8_t>(activeModelParams_.modelWidth, 0));
-    for (auto& row : grid_) {
-		row.resize(activeModelParams_.modelWidth, 0);
-	}
+    //Frames of a recording all have to be the same size.
+    if (recorder_.isRecording()) {
+        toggleRecording_();
+        if (recordStatus_.empty()) recordStatus_ = "Stopped when the board was resized";
+    }
+    gridWidth_ = activeModelParams_.modelWidth;
+    gridHeight_ = activeModelParams_.modelHeight;
+    size_t cellCount = (size_t)gridWidth_ * gridHeight_;
+    engine_.resize(gridWidth_, gridHeight_);
+    //The fastest kernel settings depend on the board size.
+    engine_.setRule(LifeRule::fromParameters(activeModelParams_));
+    tuneKernel_();
+    grid_.assign(cellCount, 0);
+    tileColumns_ = (gridWidth_ + EDIT_TILE_SIZE - 1) / EDIT_TILE_SIZE;
+    tileRows_ = (gridHeight_ + EDIT_TILE_SIZE - 1) / EDIT_TILE_SIZE;
+    tileDirty_.assign((size_t)tileColumns_ * tileRows_, 0);
+    dirtyTiles_.clear();
+    colorizeRequired_ = true;
     recalcDrawRange_ = true;
 }
 
+void CpuModel::tuneKernel_()
+{
+    LifeRule rule = LifeRule::fromParameters(activeModelParams_);
+    if (gridWidth_ == tunedWidth_ && gridHeight_ == tunedHeight_ && rule == tunedRule_) return;
+    cancelKernelTuning_();
+    tunedWidth_ = gridWidth_;
+    tunedHeight_ = gridHeight_;
+    tunedRule_ = rule;
+    if (gridWidth_ <= 0 || gridHeight_ <= 0) return;
+
+    KernelTuner::Result cached;
+    if (KernelTuner::findCached(gridWidth_, gridHeight_, rule, cached)) {
+        engine_.setKernelConfig(cached.config);
+        return;
+    }
+    //Timing takes up to a second, too long to hold up the window. applyPendingChanges() picks up the result.
+    kernelTuningCancelled_ = false;
+    kernelTuning_ = std::async(std::launch::async, [this, width = gridWidth_, height = gridHeight_, rule]() {
+        auto result = KernelTuner::tune(width, height, rule, KernelTuner::getDefaultCachePath(), false, &kernelTuningCancelled_);
+        wakeMainLoop();
+        return result;
+    });
+}
+
+void CpuModel::cancelKernelTuning_()
+{
+    if (!kernelTuning_.valid()) return;
+    kernelTuningCancelled_ = true;
+    kernelTuning_.get();
+}
+
 void CpuModel::clearGrid_()
 {
-    for (auto& row : grid_) {
-        row.assign(row.size(), 0);
-	}
+    engine_.clear();
+    std::fill(grid_.begin(), grid_.end(), 0);
+    generationsSinceColorize_ = 0;
+    colorizeRequired_ = true;
+}
+
+void CpuModel::setCell_(int row, int column, bool alive)
+{
+    if (gridWidth_ <= 0 || gridHeight_ <= 0) return;
+    row = ((row % gridHeight_) + gridHeight_) % gridHeight_;
+    column = ((column % gridWidth_) + gridWidth_) % gridWidth_;
+
+    size_t index = (size_t)row * gridWidth_ + column;
+    engine_.setCell(row, column, alive);
+    grid_[index] = alive ? aliveValue_ : deadValue_;
+
+    int tile = (row / EDIT_TILE_SIZE) * tileColumns_ + (column / EDIT_TILE_SIZE);
+    if (!tileDirty_[tile]) {
+        tileDirty_[tile] = 1;
+        dirtyTiles_.push_back(tile);
+    }
+}
+
+void CpuModel::applyEdit_(const CellEdit& edit)
+{
+    switch (edit.kind)
+    {
+        case CellEdit::Kind::SetAlive:
+            setCell_(edit.row, edit.column, true);
+            break;
+        case CellEdit::Kind::SetDead:
+            setCell_(edit.row, edit.column, false);
+            break;
+        case CellEdit::Kind::Stamp:
+            if (!edit.stamp) break;
+            for (const auto& offset : edit.stamp->cells) setCell_(edit.row + offset.row, edit.column + offset.column, true);
+            break;
+    }
+}
+
+void CpuModel::paintAt(float x, float y, bool continueStroke)
+{
+    int column = (int)std::floor((x - screenSpaceDisplacementX_) / activeModelParams_.zoomLevel);
+    int row = (int)std::floor((y - screenSpaceDisplacementY_) / activeModelParams_.zoomLevel);
+    if (column < 0 || column >= gridWidth_ || row < 0 || row >= gridHeight_) return;
+
+    auto mode = static_cast<EditBrush::Mode>(editBrush_.selectedModeIndex);
+    if (mode == EditBrush::Mode::Stamp) {
+        //One stamp per cell moved into, not per motion event, or a slow drag smears the pattern.
+        if (continueStroke && row == lastPaintRow_ && column == lastPaintColumn_) return;
+        auto stamp = getStamp_();
+        if (stamp) editQueue_.push(CellEdit{ CellEdit::Kind::Stamp, row, column, stamp });
+    }
+    else {
+        auto kind = (mode == EditBrush::Mode::Erase) ? CellEdit::Kind::SetDead : CellEdit::Kind::SetAlive;
+        //Walk the line from the last cell so fast strokes stay connected.
+        int fromRow = continueStroke ? lastPaintRow_ : row;
+        int fromColumn = continueStroke ? lastPaintColumn_ : column;
+        int steps = std::max(std::abs(row - fromRow), std::abs(column - fromColumn));
+        for (int step = (continueStroke && steps > 0) ? 1 : 0; step <= steps; step++) {
+            int stepRow = fromRow + (steps ? (row - fromRow) * step / steps : 0);
+            int stepColumn = fromColumn + (steps ? (column - fromColumn) * step / steps : 0);
+            editQueue_.push(CellEdit{ kind, stepRow, stepColumn, nullptr });
+        }
+    }
+    lastPaintRow_ = row;
+    lastPaintColumn_ = column;
+}
+
+std::shared_ptr<const CellStamp> CpuModel::getStamp_()
+{
+    auto source = static_cast<EditBrush::StampSource>(editBrush_.selectedStampIndex);
+    if (stamp_ && stampIndex_ == editBrush_.selectedStampIndex &&
+        (source != EditBrush::StampSource::RLEString || stampRLE_ == inputString_)) return stamp_;
+
+    //Built in stamps are already packed; only a pasted string needs parsing.
+    PackedPattern pattern;
+    std::vector<uint8_t> parsedCells;
+    switch (source)
+    {
+        case EditBrush::StampSource::Glider: pattern = gliderPattern; break;
+        case EditBrush::StampSource::LightweightSpaceship: pattern = ModelPresets::lightweightSpaceshipParams.pattern; break;
+        case EditBrush::StampSource::Blinker: pattern = ModelPresets::blinkerParams.pattern; break;
+        case EditBrush::StampSource::Blocker: pattern = ModelPresets::blockerParams.pattern; break;
+        case EditBrush::StampSource::RLEString: break;
+    }
+    stampIndex_ = editBrush_.selectedStampIndex;
+    stampRLE_ = inputString_;
+
+    int width = pattern.width;
+    int height = pattern.height;
+    if (source == EditBrush::StampSource::RLEString) {
+        //Parse onto the smallest board that fits.
+        ModelParameters stampParams;
+        stampParams.modelWidth = 1;
+        stampParams.modelHeight = 1;
+        stampParams.minWidth = 1;
+        stampParams.minHeight = 1;
+        LoadedPattern loaded;
+        if (!PatternLoader::parseRLE(inputString_, stampParams, loaded)) {
+            stamp_.reset();
+            return stamp_;
+        }
+        parsedCells = std::move(loaded.cells);
+        width = loaded.parameters.modelWidth;
+        height = loaded.parameters.modelHeight;
+    }
+
+    //Keep the live cells relative to the center.
+    auto stamp = std::make_shared<CellStamp>();
+    for (int row = 0; row < height; row++) {
+        for (int column = 0; column < width; column++) {
+            bool alive = parsedCells.empty() ? pattern.getCell(row, column) : parsedCells[(size_t)row * width + column];
+            if (alive) stamp->cells.push_back({ row - height / 2, column - width / 2 });
+        }
+    }
+    stamp_ = stamp;
+    return stamp_;
 }
 
 void CpuModel::initBackbuffer_(SDL_Renderer* renderer)
@@ -100,10 +310,26 @@ void CpuModel::initBackbuffer_(SDL_Renderer* renderer)
         )
     );
     SDL_SetTextureScaleMode(gridBackBuffer_.get(), SDL_SCALEMODE_NEAREST);
+    //The triangles are composited over the cells, so the overlay needs its alpha.
+    SDL_SetTextureBlendMode(gridBackBuffer_.get(), SDL_BLENDMODE_BLEND);
+
+    gridTexture_.reset(
+        SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_RGBA32, //Byte order matches SDL_Color so palette entries can be copied straight in.
+            SDL_TEXTUREACCESS_STREAMING,
+            gridWidth_,
+            gridHeight_
+        )
+    );
+    SDL_SetTextureScaleMode(gridTexture_.get(), SDL_SCALEMODE_NEAREST);
+    colorizeRequired_ = true;
     initBackbufferRequired_ = false;
 
     glRenderer_.reset(new GL_Renderer(SDL_GetRenderWindow(renderer)));
     glRenderer_->prepare();
+    resetBlendFactor_ = true;
+    overlayChanged_ = true;
 }
 
 void CpuModel::setParameters(const ModelParameters& modelParameters)
@@ -118,52 +344,85 @@ ModelParameters CpuModel::getParameters()
 
 void CpuModel::update()
 {
-    //I should just be swapping these between two allocated vectors.
-    std::vector<std::vector<uint8_t>> previousState = grid_;
-    int livingNeighbors = 0;
-    bool cellAlive = false;
-    int rowCount = grid_.size();
-    int columnCount = grid_[0].size();
-    for (int rowIndex = 0; rowIndex < rowCount; rowIndex++) {
-        for (int columnIndex = 0; columnIndex < columnCount; columnIndex++) {
-            uint8_t* cellValue = &grid_[rowIndex][columnIndex];
-            cellAlive = (*cellValue == aliveValue_) ? true: false;
-            livingNeighbors = 0;
-            //count living neighbors
-
-            for (int neighborRow = -1; neighborRow <= 1; neighborRow++) {
-                int neighborRowIndex = rowIndex + neighborRow;
-
-                //wrap the rows
-                if (neighborRowIndex < 0) neighborRowIndex = rowCount - 1;
-                if (neighborRowIndex >= rowCount) neighborRowIndex = 0;
-
-                for (int neighborColumn = -1; neighborColumn <= 1; neighborColumn++) {
-                    //skip center pixel
-                    if (neighborRow == 0 && neighborColumn == 0) continue;
-
-                    int neighborColumnIndex = columnIndex + neighborColumn;
-
-                    //wrap the columnsa
-                    if (neighborColumnIndex < 0) neighborColumnIndex = columnCount - 1;
-                    if (neighborColumnIndex >= columnCount) neighborColumnIndex = 0;
-
-                    //count
-                    if (previousState[neighborRowIndex][neighborColumnIndex] == aliveValue_) livingNeighbors++;
-                }
-            }
+    update(1);
+}
 
-            //If not alive and has 3 neighbors, become alive
-            if (!cellAlive) {
-                if (livingNeighbors == activeModelParams_.rule4) *cellValue = aliveValue_;
-                else *cellValue = (*cellValue >= deadValueDecrement_) ? *cellValue -= deadValueDecrement_ : 0;
-            }
-            //If neighbors are less than 2 or more than 3, kill it.
-            else if (livingNeighbors < activeModelParams_.rule1 || livingNeighbors > activeModelParams_.rule3) {
-                *cellValue = (*cellValue >= deadValueDecrement_) ? *cellValue -= deadValueDecrement_ : 0;
+void CpuModel::update(int generationCount)
+{
+    //The rules can change in the gui at any time.
+    engine_.setRule(LifeRule::fromParameters(activeModelParams_));
+    engine_.step(generationCount);
+    generationsSinceColorize_ += generationCount;
+
+    if (boardPublisher_.isPublishing() && !boardPublisher_.publish(engine_.getGrid(), engine_.getGeneration())) {
+        shareStatus_ = boardPublisher_.getError();
+        boardPublisher_.stop();
+    }
+    frameServer_.publish(engine_.getGrid(), engine_.getGeneration());
+
+    if (checkpointInterval_ > 0 && engine_.getGeneration() >= nextCheckpointGeneration_ && checkpoint_()) {
+        nextCheckpointGeneration_ = engine_.getGeneration() + checkpointInterval_;
+    }
+}
+
+void CpuModel::colorizeGrid_()
+{
+    //Dead cells decay once per generation, so a frame that covers several generations decays by all of them.
+    int decrement = std::min(deadValueDecrement_ * generationsSinceColorize_, 255);
+    if (decrement > 0) {
+        const GridEngine& grid = engine_.getGrid();
+        for (int rowIndex = 0; rowIndex < gridHeight_; rowIndex++) {
+            const uint64_t* cells = grid.getRow(rowIndex);
+            uint8_t* values = &grid_[(size_t)rowIndex * gridWidth_];
+            for (int columnIndex = 0; columnIndex < gridWidth_; columnIndex++) {
+                uint8_t& value = values[columnIndex];
+                if ((cells[columnIndex / GridEngine::BITS_PER_WORD] >> (columnIndex % GridEngine::BITS_PER_WORD)) & 1) value = aliveValue_;
+                else value = (value >= decrement) ? value - decrement : deadValue_;
             }
         }
     }
+    generationsSinceColorize_ = 0;
+
+    const auto& palette = colorMapper_.ColormapMap[static_cast<ColorMapper::ColormapType>(colorMapper_.selectedColorMapIndex)];
+    colorizedPalette_ = palette;
+    if (recorder_.isRecording()) recordFrame_(palette);
+
+    Uint8* pixels = nullptr;
+    int pitch = 0;
+    if (!SDL_LockTexture(gridTexture_.get(), nullptr, (void**)&pixels, &pitch)) return;
+    for (int rowIndex = 0; rowIndex < gridHeight_; rowIndex++) {
+        const uint8_t* values = &grid_[(size_t)rowIndex * gridWidth_];
+        SDL_Color* texels = reinterpret_cast<SDL_Color*>(pixels + (size_t)rowIndex * pitch);
+        for (int columnIndex = 0; columnIndex < gridWidth_; columnIndex++) texels[columnIndex] = palette[values[columnIndex]];
+    }
+    SDL_UnlockTexture(gridTexture_.get());
+    colorizeRequired_ = false;
+
+    //A full upload covers anything the edits touched.
+    for (int tile : dirtyTiles_) tileDirty_[tile] = 0;
+    dirtyTiles_.clear();
+}
+
+void CpuModel::uploadDirtyTiles_()
+{
+    const auto& palette = colorizedPalette_;
+    std::array<SDL_Color, EDIT_TILE_SIZE * EDIT_TILE_SIZE> texels;
+    for (int tile : dirtyTiles_) {
+        tileDirty_[tile] = 0;
+        SDL_Rect rect{
+            (tile % tileColumns_) * EDIT_TILE_SIZE,
+            (tile / tileColumns_) * EDIT_TILE_SIZE,
+            0,
+            0 };
+        rect.w = std::min(EDIT_TILE_SIZE, gridWidth_ - rect.x);
+        rect.h = std::min(EDIT_TILE_SIZE, gridHeight_ - rect.y);
+        for (int row = 0; row < rect.h; row++) {
+            const uint8_t* values = &grid_[(size_t)(rect.y + row) * gridWidth_ + rect.x];
+            for (int column = 0; column < rect.w; column++) texels[row * rect.w + column] = palette[values[column]];
+        }
+        SDL_UpdateTexture(gridTexture_.get(), &rect, texels.data(), rect.w * (int)sizeof(SDL_Color));
+    }
+    dirtyTiles_.clear();
 }
 
 void CpuModel::draw(SDL_Renderer* renderer)
@@ -190,56 +449,75 @@ void CpuModel::draw(SDL_Renderer* renderer)
     if (resetBlendFactor_) {
         setBlendFactor(blendFactor_);
         resetBlendFactor_ = false;
+        overlayChanged_ = true;
     }
 
     //****Drawing by swapping my backbuffer****
     // NEXT:
     //-I should have it check for changes in model, so I can skip rendering step when rendering is higher frequency than model.
 
-    if (!gridBackBuffer_) {
+    if (!gridBackBuffer_ || !gridTexture_) {
         std::cout << "Invalid backbuffer!\n";
         return;
     }
-    auto drawBackBufferTimer = std::make_optional<ImGuiScope::TimeScope>("Draw My Backbuffer");
 
-    SDL_SetRenderTarget(renderer, gridBackBuffer_.get());
+    //Only the generation that is actually shown gets colored and uploaded.
+    const auto& palette = colorMapper_.ColormapMap[static_cast<ColorMapper::ColormapType>(colorMapper_.selectedColorMapIndex)];
+    if (colorizeRequired_ || generationsSinceColorize_ > 0 ||
+        std::memcmp(palette.data(), colorizedPalette_.data(), sizeof(colorizedPalette_)) != 0) {
+        auto colorizeTimer = ImGuiScope::TimeScope("Colorize Grid");
+        colorizeGrid_();
+    }
+    else if (!dirtyTiles_.empty()) {
+        auto uploadTimer = ImGuiScope::TimeScope("Upload Edited Tiles");
+        uploadDirtyTiles_();
+    }
+
+    auto drawBackBufferTimer = std::make_optional<ImGuiScope::TimeScope>("Draw My Backbuffer");
 
-    // Uint16* pixels;
-    // int pitch = 0;
-    // SDL_LockTexture(gridBackBuffer_.get(), nullptr, (void**)&pixels, &pitch);
+    //The overlay only depends on the points and blend settings, so keep the last readback until those change.
+    if (overlayChanged_) {
+        SDL_SetRenderTarget(renderer, gridBackBuffer_.get());
 
-    // int rowCount = grid_.size();
-    // int columnCount = grid_[0].size();
-    // for (int rowIndex = 0; rowIndex < rowCount; rowIndex++)
-    // {
-    //     for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
-    //     //for (int columnIndex = drawRange_.columnBegin; columnIndex <= drawRange_.columnEnd; columnIndex++)
-    //     {
-    //         //I could optimize this a tiny bit by having pixel format defined at compile time,
-    //         //and having pitch defined just one when model size changes.
-    //         SDL_Color color = colorMapper_.getSDLColor(grid_[rowIndex][columnIndex]);
+        // Uint16* pixels;
+        // int pitch = 0;
+        // SDL_LockTexture(gridBackBuffer_.get(), nullptr, (void**)&pixels, &pitch);
 
-    //         pixels[(rowIndex ) * grid_[0].size() + columnIndex] = SDL_MapRGB(
-    //             SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGB565),
-    //             nullptr,
-    //             color.r,
-    //             color.g,
-    //             color.b);
-    //     }
-    // }
+        // int rowCount = grid_.size();
+        // int columnCount = grid_[0].size();
+        // for (int rowIndex = 0; rowIndex < rowCount; rowIndex++)
+        // {
+        //     for (int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+        //     //for (int columnIndex = drawRange_.columnBegin; columnIndex <= drawRange_.columnEnd; columnIndex++)
+        //     {
+        //         //I could optimize this a tiny bit by having pixel format defined at compile time,
+        //         //and having pitch defined just one when model size changes.
+        //         SDL_Color color = colorMapper_.getSDLColor(grid_[rowIndex][columnIndex]);
+
+        //         pixels[(rowIndex ) * grid_[0].size() + columnIndex] = SDL_MapRGB(
+        //             SDL_GetPixelFormatDetails(SDL_PIXELFORMAT_RGB565),
+        //             nullptr,
+        //             color.r,
+        //             color.g,
+        //             color.b);
+        //     }
+        // }
 
-    // SDL_UnlockTexture(gridBackBuffer_.get());
+        // SDL_UnlockTexture(gridBackBuffer_.get());
 
-    glRenderer_->drawToSDLTexture(gridBackBuffer_.get());
+        //The readback lands a frame or so later, so keep coming back until it has.
+        overlayChanged_ = glRenderer_->drawToSDLTexture(gridBackBuffer_.get());
 
-    SDL_SetRenderTarget(renderer, nullptr);
+        SDL_SetRenderTarget(renderer, nullptr);
+    }
 
 
     auto destRect = SDL_FRect{
         (float)screenSpaceDisplacementX_,
         (float)screenSpaceDisplacementY_,
-        (float)grid_[0].size() * activeModelParams_.zoomLevel, 
-        (float)grid_.size() * activeModelParams_.zoomLevel };
+        (float)gridWidth_ * activeModelParams_.zoomLevel, 
+        (float)gridHeight_ * activeModelParams_.zoomLevel };
+    SDL_RenderTexture(renderer, gridTexture_.get(), nullptr, &destRect);
     SDL_RenderTexture(renderer, gridBackBuffer_.get(), nullptr, &destRect);
 
     drawBackBufferTimer.reset();
@@ -254,6 +532,10 @@ void CpuModel::drawImGuiWidgets(const bool& isModelRunning)
 
     WidgetFunctions::drawBlendFuncHeader(blendFactor_, resetBlendFactor_);
 
+    WidgetFunctions::drawEditHeader(editBrush_);
+
+    WidgetFunctions::drawEngineHeader(engine_);
+
     WidgetFunctions::drawVisualizationHeader(
 		activeModelParams_,
 		colorMapper_,
@@ -263,12 +545,74 @@ void CpuModel::drawImGuiWidgets(const bool& isModelRunning)
     
     WidgetFunctions::drawPresetsHeader(
 		activeModelParams_,
-		[this](const ModelParameters& params) {generateModel(params);},
-		[this](std::string filePath) {loadRLE_(filePath);},
+		[this](const ModelPresets::Preset& preset) {loadPreset_(preset);},
+		[this](PatternLoader::ChooseFileFunction chooseFile) {loadRLE_(std::move(chooseFile));},
         [this]() {populateFromRLEString_(inputString_);},
+        [this](const std::string& path) {savePattern_(path);},
         inputString_,
+        saveStatus_,
         isModelRunning
         );
+
+    if (patternLibrary_.takeResult()) {
+        librarySelectedEntry_ = -1;
+        searchLibrary_();
+    }
+    WidgetFunctions::drawLibraryHeader(
+        patternLibrary_,
+        libraryDirectory_,
+        libraryQuery_,
+        libraryMatches_,
+        librarySelectedEntry_,
+        [this]() {patternLibrary_.scan(libraryDirectory_);},
+        [this]() {searchLibrary_();},
+        [this](const PatternLibrary::Entry& entry) {loadLibraryPattern_(entry);});
+
+    WidgetFunctions::drawCheckpointHeader(
+        checkpointPath_,
+        checkpointInterval_,
+        [this]() {checkpoint_();},
+        [this]() {restoreCheckpoint_();},
+        getCheckpointStatus_());
+
+    WidgetFunctions::drawPosterHeader(
+        posterPath_,
+        posterCellsPerPixel_,
+        posterPixelsPerCell_,
+        [this]() {exportPoster_();},
+        posterStatus_);
+
+    WidgetFunctions::drawRecordingHeader(
+        recordPath_,
+        recorder_.framesPerSecond,
+        recorder_.isRecording(),
+        [this]() {toggleRecording_();},
+        getRecordingStatus_());
+
+    WidgetFunctions::drawTelemetryHeader(
+        telemetryPath_,
+        engine_.telemetryInterval,
+        engine_.getTelemetry(),
+        [this]() {toggleTelemetry_();},
+        engine_.getTelemetry().isRecording() ? engine_.getTelemetry().getError() : telemetryStatus_);
+
+    WidgetFunctions::drawShareHeader(
+        shareName_,
+        boardPublisher_.isPublishing(),
+        [this]() {toggleSharing_();},
+        boardPublisher_.isPublishing() ? std::to_string(boardPublisher_.getPublishedCount()) + " boards published" : shareStatus_);
+
+    WidgetFunctions::drawServeHeader(
+        servePort_,
+        frameServer_,
+        [this]() {toggleServing_();},
+        frameServer_.isServing() ? frameServer_.getError() : serveStatus_);
+
+    WidgetFunctions::drawHistoryHeader(
+        engine_,
+        [this](long long generation) {seek_(generation);});
+
+    WidgetFunctions::drawPatternLoaderStatus(patternLoader_);
 }
 
 void CpuModel::handleSDLEvent(const SDL_Event& event)
@@ -325,8 +669,9 @@ void CpuModel::generateModel(const ModelParameters& params) {
     if (params.rule1 > 0) activeModelParams_.rule1 = params.rule1;
     if (params.rule3 > 0) activeModelParams_.rule3 = params.rule3;
     if (params.rule4 > 0) activeModelParams_.rule4 = params.rule4;
+    activeModelParams_.ruleString = params.ruleString;
 
-    if (grid_.size() != activeModelParams_.modelHeight || grid_[0].size() != activeModelParams_.modelWidth) {
+    if (gridHeight_ != activeModelParams_.modelHeight || gridWidth_ != activeModelParams_.modelWidth) {
 		resizeGrid_();
 	}
     else {
@@ -338,10 +683,12 @@ void CpuModel::generateModel(const ModelParameters& params) {
         std::mt19937 rng(randomDevice());
         std::uniform_real_distribution<double> distribution(0.0, 1.0);
 
-        for (auto& row : grid_) {
-            for (auto& cell : row) {
-				cell = distribution(rng) < params.fillFactor ? aliveValue_ : deadValue_;
-			}
+        for (int row = 0; row < gridHeight_; row++) {
+            for (int column = 0; column < gridWidth_; column++) {
+                bool alive = distribution(rng) < params.fillFactor;
+                engine_.setCell(row, column, alive);
+                grid_[(size_t)row * gridWidth_ + column] = alive ? aliveValue_ : deadValue_;
+            }
 		}
         std::cout << "Random model generated" << std::endl;
         recalcDrawRange_ = true;
@@ -351,130 +698,299 @@ void CpuModel::generateModel(const ModelParameters& params) {
 
     else {
         if (!params.runLengthEncoding.empty()) {
-            std::istringstream rleStream(params.runLengthEncoding);
-            populateFromRLE_(rleStream);
+            populateFromRLE_(params.runLengthEncoding);
         }
     }
 
     initBackbufferRequired_ = true;
 }
 
-void CpuModel::populateFromRLE_(std::istream& modelStream)
+void CpuModel::populateFromRLE_(std::string_view rle)
 {
-    std::string line = "";
-    std::string RLEstring = "";
-    while(std::getline(modelStream, line))
-    {
-        //Find the header line containing specifications, which begins with the char 'x'
-		if (line[0] == '#') continue;
-		if (line[0] == 'x') {
-            std::string::iterator lineIterator = line.begin();
-            std::string minWidthString = "";
-            std::string minHeightString = "";
-            int bornNeighborCount = 3;
-            int surviveNeighborMin = 2;
-            int surviveNeighborMax = 3;
-
-            //minimum width
-            while (!std::isdigit(*lineIterator)) lineIterator++;
-            while (std::isdigit(*lineIterator)) {
-				minWidthString += *lineIterator;
-				lineIterator++;
-			}
-            activeModelParams_.minWidth = std::stoi(minWidthString);
-
-            //minimum height
-            while (!std::isdigit(*lineIterator)) lineIterator++;
-            while (std::isdigit(*lineIterator)) {
-                minHeightString += *lineIterator;
-                lineIterator++;
-            }
-            activeModelParams_.minHeight = std::stoi(minHeightString);
-            
-            //Neighbor count to be born
-            while (*lineIterator != 'B' && *lineIterator != 'b') lineIterator++;
-            lineIterator++;
-            activeModelParams_.rule4 = (int)(*lineIterator - '0');
-            lineIterator++;
-            //minimum and maximum neighbors to survive
-            while (!std::isdigit(*lineIterator)) lineIterator++;
-            activeModelParams_.rule1 = (int)(*lineIterator - '0');
-            lineIterator++;
-            activeModelParams_.rule3 = (int)(*lineIterator - '0');//lineiterator '/S23'
-            continue;
-		}
+    LoadedPattern pattern;
+    std::string error;
+    if (PatternLoader::parseRLE(rle, activeModelParams_, pattern, &error)) adoptPattern_(pattern);
+    else std::cerr << error << std::endl;
+}
 
-        //If lines don't start with # or X, they must be part of the RLE encoded model.
-        RLEstring += line;
-	}
-    activeModelParams_.modelWidth = std::max<int>(activeModelParams_.modelWidth, activeModelParams_.minWidth);
-    activeModelParams_.modelHeight= std::max<int>(activeModelParams_.modelHeight, activeModelParams_.minHeight);
-    if (grid_.size() != activeModelParams_.modelHeight || grid_[0].size() != activeModelParams_.modelWidth) {
-        resizeGrid_();
+void CpuModel::loadPreset_(const ModelPresets::Preset& preset)
+{
+    generateModel(preset.getParameters());
+    if (preset.random || preset.pattern.isEmpty()) return;
+
+    //Centered the way an RLE pattern with the preset's size in its header would be.
+    int row = (activeModelParams_.modelHeight - activeModelParams_.minHeight) / 2;
+    int column = (activeModelParams_.modelWidth / 2) - (activeModelParams_.minWidth / 2);
+    engine_.loadPattern(preset.pattern, row, column);
+    activeModelParams_.random = false;
+    fillGridFromEngine_();
+    generationsSinceColorize_ = 0;
+    colorizeRequired_ = true;
+    recalcDrawRange_ = true;
+}
+
+void CpuModel::loadRLE_(PatternLoader::ChooseFileFunction chooseFile)
+{
+    patternLoader_.loadFile(std::move(chooseFile), activeModelParams_);
+}
+
+void CpuModel::populateFromRLEString_(const std::string& rleString)
+{
+    patternLoader_.loadString(rleString, activeModelParams_);
+}
+
+void CpuModel::searchLibrary_()
+{
+    patternLibrary_.search(libraryQuery_, libraryMatches_);
+}
+
+void CpuModel::loadLibraryPattern_(const PatternLibrary::Entry& entry)
+{
+    std::string path = patternLibrary_.getPath(entry);
+    loadRLE_([path](const std::atomic<bool>&) { return path; });
+}
+
+void CpuModel::savePattern_(const std::string& path)
+{
+    std::string error;
+    PatternWriter::Format format = PatternWriter::getFormat(path);
+    std::string comment = "generation " + std::to_string(engine_.getGeneration());
+    //A running tree is written as it is, without filling in the grid.
+    bool saved = (format == PatternWriter::Format::Macrocell && engine_.getActiveEngine() == EngineManager::Engine::HashLife)
+        ? PatternWriter::save(engine_.getHashLife(), path, error, engine_.getGeneration(), comment)
+        : PatternWriter::save(engine_.getGrid(), path, format, error, comment);
+    if (saved) {
+        saveStatus_ = "Saved " + path;
     }
     else {
-        clearGrid_();
+        saveStatus_ = error;
+        std::cerr << error << std::endl;
     }
-    //minwidth is wrong!
-    int startColumn = (activeModelParams_.modelWidth / 2) - (activeModelParams_.minWidth/2);
-    int startRow = (activeModelParams_.modelHeight - activeModelParams_.minHeight) / 2;
-    int row = startRow;
-    int column = startColumn;
+}
 
-    std::string::iterator RLEit;
-    for (std::string::iterator it = RLEstring.begin(); it != RLEstring.end(); ++it)
-    {
-        if (*it == '!') break;
+bool CpuModel::checkpoint_()
+{
+    //The writer waits for its last checkpoint, which would stall the frame; try again next generation instead.
+    if (checkpointWriter_.isBusy()) return false;
+    checkpointWriter_.write(checkpointPath_, engine_.getGrid(), engine_.getGeneration(), activeModelParams_);
+    checkpointStatus_.clear();
+    return true;
+}
 
-        std::string stringInteger = "";
-        while ( isdigit(*it) || *it == '\n')
-        {
-            if (*it != '\n') stringInteger += *it;
-            it++;
-        }
-        //If there is no preceding integer, set the count to 1
-        if (stringInteger.empty()) stringInteger = "1";
-        int count = std::stoi(stringInteger);
-        //b is dead, o is alive, $ is newline
-        if (*it == 'b') {
-            for (int i = 0; i < count; i++) {
-                column++;
-            }
-        }
-        else if (*it == 'o') {
-            for (int i = 0; i < count; i++) {
-                grid_[row][column] = aliveValue_;
-                column++;
-            }
-        }
-        else if (*it == '$')
-        {
-            column = startColumn;
-            for (int i = 0; i < count; i++) {
-                row++;
-            }
-        }
+void CpuModel::restoreCheckpoint_()
+{
+    checkpointWriter_.wait();
+    Checkpoint::Reader reader;
+    if (!reader.open(checkpointPath_)) {
+        checkpointStatus_ = reader.getError();
+        std::cerr << checkpointStatus_ << std::endl;
+        return;
     }
+    const Checkpoint::Header& header = reader.getHeader();
+    activeModelParams_ = header.parameters;
+    //The run may have used the rule boxes; make sure they still say the same rule.
+    if (LifeRule::fromParameters(activeModelParams_) != header.rule) activeModelParams_.ruleString = header.rule.toString();
 
+    if (gridHeight_ != activeModelParams_.modelHeight || gridWidth_ != activeModelParams_.modelWidth) {
+        resizeGrid_();
+        initBackbufferRequired_ = true;
+    }
+    reader.load(engine_);
+    fillGridFromEngine_();
+    generationsSinceColorize_ = 0;
+    colorizeRequired_ = true;
     recalcDrawRange_ = true;
-    initBackbufferRequired_ = true;
+    nextCheckpointGeneration_ = engine_.getGeneration() + checkpointInterval_;
+
+    checkpointStatus_ = "Restored generation " + std::to_string(header.generation);
+    if (reader.getIgnoredBytes() > 0) checkpointStatus_ += ", skipping an unfinished update";
 }
 
-void CpuModel::loadRLE_(const std::string& filePath)
+std::string CpuModel::getCheckpointStatus_() const
 {
-	std::ifstream filestream(filePath);
-	if (filestream.is_open())
-	{
-		clearGrid_();
-		populateFromRLE_(filestream);
-		filestream.close();
-	}
+    if (checkpointWriter_.isBusy()) return "Writing...";
+    std::string error = checkpointWriter_.getError();
+    if (!error.empty()) return error;
+    if (!checkpointStatus_.empty()) return checkpointStatus_;
+
+    Checkpoint::WriteResult result = checkpointWriter_.getLastResult();
+    if (result.tileCount == 0) return "";
+    char status[160];
+    std::snprintf(status, sizeof(status), "Generation %lld: %s %zu of %zu tiles, %.0f KiB in %.0f ms",
+        result.generation, result.full ? "wrote all" : "updated", result.tilesWritten, result.tileCount,
+        result.bytesWritten / 1024.0, result.seconds * 1000.0);
+    return status;
 }
 
-void CpuModel::populateFromRLEString_(const std::string& rleString)
+void CpuModel::exportPoster_()
+{
+    const auto& palette = colorMapper_.ColormapMap[static_cast<ColorMapper::ColormapType>(colorMapper_.selectedColorMapIndex)];
+    PosterExporter::Settings settings;
+    settings.cellsPerPixel = posterCellsPerPixel_;
+    settings.pixelsPerCell = posterPixelsPerCell_;
+    for (size_t index = 0; index < palette.size(); index++) settings.palette[index] = FrameRecorder::Color{ palette[index].r, palette[index].g, palette[index].b };
+
+    PosterExporter::Result result;
+    std::string error;
+    if (!PosterExporter::save(engine_.getGrid(), posterPath_, settings, error, &result)) {
+        posterStatus_ = error;
+        return;
+    }
+    char status[160];
+    std::snprintf(status, sizeof(status), "Wrote %d x %d, %.1f MiB in %.0f ms",
+        result.width, result.height, result.bytesWritten / (1024.0 * 1024.0), result.seconds * 1000.0);
+    posterStatus_ = status;
+}
+
+void CpuModel::toggleRecording_()
 {
-	std::stringstream rleStream(rleString);
-	populateFromRLE_(rleStream);
+    if (recorder_.isRecording()) {
+        recordStatus_ = recorder_.stop() ? "" : recorder_.getError();
+        return;
+    }
+    std::string error;
+    if (!recorder_.start(recordPath_, gridWidth_, gridHeight_, error)) {
+        recordStatus_ = error;
+        return;
+    }
+    recordStatus_.clear();
+    lastRecordedGeneration_ = -1;
+    //Start with what is on screen now rather than waiting for the next generation.
+    colorizeRequired_ = true;
+}
+
+void CpuModel::recordFrame_(const std::array<SDL_Color, 256>& palette)
+{
+    if (engine_.getGeneration() == lastRecordedGeneration_) return;
+    lastRecordedGeneration_ = engine_.getGeneration();
+    FrameRecorder::Palette colors;
+    for (size_t index = 0; index < palette.size(); index++) colors[index] = FrameRecorder::Color{ palette[index].r, palette[index].g, palette[index].b };
+    recorder_.addFrame(grid_.data(), colors);
+}
+
+std::string CpuModel::getRecordingStatus_() const
+{
+    if (!recorder_.isRecording()) return recordStatus_;
+    FrameRecorder::Status status = recorder_.getStatus();
+    std::string error = recorder_.getError();
+    if (!error.empty()) return error;
+    char text[160];
+    std::snprintf(text, sizeof(text), "%lld frames, %.1f MiB, %lld dropped",
+        status.framesWritten, status.bytesWritten / (1024.0 * 1024.0), status.framesDropped);
+    return text;
+}
+
+void CpuModel::toggleTelemetry_()
+{
+    TelemetrySink& telemetry = engine_.getTelemetry();
+    if (telemetry.isRecording()) {
+        if (!telemetry.stop()) {
+            telemetryStatus_ = telemetry.getError();
+            return;
+        }
+        telemetryStatus_ = "Wrote " + std::to_string(telemetry.getRowCount()) + " rows to " + telemetry.getDirectory();
+        return;
+    }
+    std::string error;
+    telemetryStatus_ = telemetry.start(telemetryPath_, error) ? "" : error;
+}
+
+void CpuModel::toggleSharing_()
+{
+    if (boardPublisher_.isPublishing()) {
+        boardPublisher_.stop();
+        shareStatus_.clear();
+        return;
+    }
+    std::string error;
+    if (!boardPublisher_.start(shareName_, error)) {
+        shareStatus_ = error;
+        return;
+    }
+    //Readers see the board as it is now rather than waiting for the next generation.
+    if (!boardPublisher_.publish(engine_.getGrid(), engine_.getGeneration())) {
+        shareStatus_ = boardPublisher_.getError();
+        boardPublisher_.stop();
+    }
+}
+
+void CpuModel::toggleServing_()
+{
+    if (frameServer_.isServing()) {
+        frameServer_.stop();
+        serveStatus_.clear();
+        return;
+    }
+    std::string error;
+    serveStatus_ = frameServer_.start(servePort_, error) ? "" : error;
+}
+
+void CpuModel::seek_(long long generation)
+{
+    if (!engine_.seek(generation)) return;
+    fillGridFromEngine_();
+    generationsSinceColorize_ = 0;
+    colorizeRequired_ = true;
+}
+
+void CpuModel::fillGridFromEngine_()
+{
+    const GridEngine& board = engine_.getGrid();
+    for (int row = 0; row < gridHeight_; row++) {
+        const uint64_t* cells = board.getRow(row);
+        uint8_t* values = &grid_[(size_t)row * gridWidth_];
+        for (int column = 0; column < gridWidth_; column++) {
+            bool alive = (cells[column / GridEngine::BITS_PER_WORD] >> (column % GridEngine::BITS_PER_WORD)) & 1;
+            values[column] = alive ? aliveValue_ : deadValue_;
+        }
+    }
+}
+
+void CpuModel::applyPendingChanges()
+{
+    LoadedPattern pattern;
+    if (patternLoader_.takeResult(pattern)) adoptPattern_(pattern);
+
+    if (kernelTuning_.valid() && kernelTuning_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        engine_.setKernelConfig(kernelTuning_.get().config);
+    }
+    //The rules can change in the gui at any time, and the settings are tuned per rule.
+    tuneKernel_();
+
+    //Edits touch only their own cells and tiles; the rest of the board is left alone.
+    pendingEdits_.clear();
+    if (!editQueue_.drain(pendingEdits_)) return;
+    for (const auto& edit : pendingEdits_) applyEdit_(edit);
+    pendingEdits_.clear();
+}
+
+void CpuModel::adoptPattern_(LoadedPattern& pattern)
+{
+    //Keep the current view; only the board and its rules come from the pattern.
+    int zoomLevel = activeModelParams_.zoomLevel;
+    int displacementX = activeModelParams_.displacementX;
+    int displacementY = activeModelParams_.displacementY;
+    activeModelParams_ = pattern.parameters;
+    activeModelParams_.zoomLevel = zoomLevel;
+    activeModelParams_.displacementX = displacementX;
+    activeModelParams_.displacementY = displacementY;
+
+    if (gridHeight_ != activeModelParams_.modelHeight || gridWidth_ != activeModelParams_.modelWidth) {
+        resizeGrid_();
+        initBackbufferRequired_ = true;
+    }
+    if (pattern.tree) {
+        //Stays a tree for the engine; only the display needs the cells.
+        engine_.loadTree(std::move(*pattern.tree), pattern.generation);
+        fillGridFromEngine_();
+    }
+    else {
+        engine_.loadCells(pattern.cells);
+        for (size_t index = 0; index < std::min(grid_.size(), pattern.cells.size()); index++) grid_[index] = pattern.cells[index] ? aliveValue_ : deadValue_;
+    }
+    generationsSinceColorize_ = 0;
+    colorizeRequired_ = true;
+    recalcDrawRange_ = true;
 }
 
 //I should only be calculating this when it changes.
@@ -487,8 +1003,8 @@ CpuModel::GridDrawRange CpuModel::getDrawRange_()
     drawRange.columnEnd = drawRange.columnBegin + (viewPort_.w / activeModelParams_.zoomLevel);
 
     //Don't try and draw something not in grid_
-    int gridRows = grid_.size();
-    int gridColumns = grid_[0].size();
+    int gridRows = gridHeight_;
+    int gridColumns = gridWidth_;
     if (drawRange.rowEnd >= gridRows) drawRange.rowEnd = gridRows - 1;
     if (drawRange.columnEnd >= gridColumns) drawRange.columnEnd = gridColumns - 1;
     if (drawRange.rowBegin < 0) drawRange.rowBegin = 0;
@@ -2,14 +2,28 @@
 #define CPU_MODEL_H
 
 #include "abstract_model.hpp"
+#include "CellEditQueue.hpp"
+#include "Checkpoint.hpp"
 #include "ColorMapper.hpp"
 #include "GlRenderer.hpp"
+#include "EngineManager.hpp"
+#include "FrameRecorder.hpp"
+#include "FrameServer.hpp"
+#include "KernelTuner.hpp"
+#include "PatternLibrary.hpp"
+#include "PatternLoader.hpp"
+#include "SharedBoard.hpp"
 
 
+#include <array>
+#include <atomic>
+#include <future>
 #include <vector>
 //#include <SDL.h>
 #include <memory>
 
+namespace ModelPresets { struct Preset; }
+
 //Next:: make and sdl texture backbuffer system. Only modify the buffer if there has been a change.
 struct SDL_Texture;
 
@@ -19,10 +33,17 @@ public:
 	CpuModel();
 	~CpuModel();
 
+	//Release the GL renderer and grid textures. Core calls this before SDL_Quit, since the
+	//model itself outlives SDL.
+	void shutdown();
+
 	void initialize(const SDL_Rect& viewport) override;
 
 	void update() override;
 
+	//Advance the model several generations without coloring the intermediate ones.
+	void update(int generationCount);
+
 	void handleSDLEvent(const SDL_Event& event) override;
 
 	void draw(SDL_Renderer* renderer) override;
@@ -36,22 +57,80 @@ public:
 
 	void setMouseMove(float x, float y, bool motion=false);
 
+	//Apply the edit brush at a screen position. With continueStroke, fills in the cells
+	//between the last position and this one so fast drags don't leave gaps.
+	void paintAt(float x, float y, bool continueStroke);
+
+	//Edits pushed here from any thread are applied between generations by applyPendingChanges().
+	CellEditQueue& getEditQueue() { return editQueue_; }
+
 	void setBlendFactor(const BlendFactor& blendFactor);
 
 	void clear();
 
 	void generateModel(const ModelParameters& modelParameters);
 
+	//True if anything that draw() shows has changed since the last draw: new generations,
+	//a regenerated board, the view transform, blend settings or the triangle overlay.
+	bool needsRedraw() const;
+
+	//Swap in anything that finished off the main thread, e.g. a pattern from the loader.
+	//Core calls this between generations so a new board never lands mid step.
+	void applyPendingChanges();
+
 private:
 	
-	//Take a stream representing the RLE encoded model and populate board.
-	void populateFromRLE_(std::istream& modelStream);
-	//Load an RLE file and populate the board. Intended as a callback sent to gui.
-	void loadRLE_(const std::string& filePath);
-	//Convert and RLE string to a stream and call populateFromRLE_
+	//Take RLE text and populate the board. Runs synchronously.
+	void populateFromRLE_(std::string_view rle);
+	//Size the board and rules for a preset and copy in its pattern, which was decoded at compile time.
+	void loadPreset_(const ModelPresets::Preset& preset);
+	//Choose and load an RLE file on the loader thread. Intended as a callback sent to gui.
+	void loadRLE_(PatternLoader::ChooseFileFunction chooseFile);
+	//Parse an RLE string on the loader thread.
 	void populateFromRLEString_(const std::string& rleString);
+	//Refresh libraryMatches_ for libraryQuery_.
+	void searchLibrary_();
+	//Load a library entry on the loader thread.
+	void loadLibraryPattern_(const PatternLibrary::Entry& entry);
+	//Write the current board to path, RLE or plaintext by its extension. Fast enough to run on the main thread.
+	void savePattern_(const std::string& path);
+	//Replace the board with a parsed pattern.
+	void adoptPattern_(LoadedPattern& pattern);
+	//Hand a copy of the board to the checkpoint writer. Returns false, doing nothing, while the last one is still being written.
+	bool checkpoint_();
+	//Replace the board, rule and parameters with the ones in the checkpoint file.
+	void restoreCheckpoint_();
+	std::string getCheckpointStatus_() const;
+	//Render the whole board to posterPath_ in the current colormap. Runs on the main thread, on every core.
+	void exportPoster_();
+	//Start recording to recordPath_, or stop and finish the file.
+	void toggleRecording_();
+	//Queue grid_ as the next frame if it shows a generation not recorded yet.
+	void recordFrame_(const std::array<SDL_Color, 256>& palette);
+	std::string getRecordingStatus_() const;
+	//Start the engine's telemetry in telemetryPath_, or stop and finish the files.
+	void toggleTelemetry_();
+	//Start publishing the board in shared memory as shareName_, or stop and remove it.
+	void toggleSharing_();
+	//Start streaming the board on servePort_, or stop and disconnect every client.
+	void toggleServing_();
+	//Put the board back to a generation from the engine's history.
+	void seek_(long long generation);
+	//Set every color value to alive or dead from the engine's current board.
+	void fillGridFromEngine_();
 	void resizeGrid_();
+	//Use the cached kernel settings for the board's size and rule, or time them on a thread of their own.
+	void tuneKernel_();
+	void cancelKernelTuning_();
 	void clearGrid_();
+	//Sets a cell and marks its tile for upload. Wraps around the edges like the model does.
+	void setCell_(int row, int column, bool alive);
+	void applyEdit_(const CellEdit& edit);
+	//Color and upload only the tiles touched by edits since the last draw.
+	void uploadDirtyTiles_();
+	std::shared_ptr<const CellStamp> getStamp_();
+	//Fold the generations run since the last draw into the color values and upload them.
+	void colorizeGrid_();
 	//Whenever the model size is changed, the backbuffer texture must be reinitialized.
 	void initBackbuffer_(SDL_Renderer* renderer);
 
@@ -72,11 +151,47 @@ private:
 	//and an int with the value. 
 	//Or I could do some bit shifting to have it all in an int.
 
-	std::vector<std::vector<uint8_t>> grid_; //I use an 8 bit int so I can represent some other info for visualization.
+	//Alive cells, on whichever engine suits the pattern. Stepping only touches these; coloring is left for draw().
+	EngineManager engine_;
+	int gridWidth_ = 0;
+	int gridHeight_ = 0;
+
+	//The first time a size and rule are used the board carries on with the settings it has until this is ready.
+	std::future<KernelTuner::Result> kernelTuning_;
+	std::atomic<bool> kernelTuningCancelled_ = false;
+	int tunedWidth_ = 0;
+	int tunedHeight_ = 0;
+	LifeRule tunedRule_;
+
+	std::vector<uint8_t> grid_; //I use an 8 bit int so I can represent some other info for visualization.
+	//Generations stepped since grid_ was last colored. Skipped frames just decay further.
+	int generationsSinceColorize_ = 0;
+	bool colorizeRequired_ = true;
+	//Palette the texture was last colored with, so changing colormap recolors without a step.
+	std::array<SDL_Color, 256> colorizedPalette_{};
+
+	//Edits land in tiles of this many cells square. Only dirty tiles get re-uploaded.
+	static constexpr int EDIT_TILE_SIZE = 32;
+	int tileColumns_ = 0;
+	int tileRows_ = 0;
+	std::vector<uint8_t> tileDirty_;
+	std::vector<int> dirtyTiles_;
+
+	CellEditQueue editQueue_;
+	//Reused between drains so applying edits doesn't allocate.
+	std::vector<CellEdit> pendingEdits_;
+	EditBrush editBrush_;
+	std::shared_ptr<const CellStamp> stamp_;
+	int stampIndex_ = -1;
+	std::string stampRLE_ = "";
+	int lastPaintRow_ = 0;
+	int lastPaintColumn_ = 0;
 
 	//Because the SDL_Texture type is obfuscated and requires an SDL deleter, 
 	//we need a template that can accept that deleter.
 	std::unique_ptr<SDL_Texture, void(*)(SDL_Texture*)> gridBackBuffer_;
+	//Cell colors, one texel per cell. Only re-uploaded when a new generation is shown.
+	std::unique_ptr<SDL_Texture, void(*)(SDL_Texture*)> gridTexture_;
 
 	ModelParameters activeModelParams_{
 		true,
@@ -99,6 +214,8 @@ private:
 	bool recalcDrawRange_ = true;
 	//On first pass or on resized model, backbuffer needs reinitialized.
 	bool initBackbufferRequired_ = true;
+	//Points of the triangle overlay were added, moved or cleared.
+	bool overlayChanged_ = true;
 	////On backbuffer reinitilization or zoom change, complete redraw of 
 	//bool completeBackbufferRedrawRequired_ = true;
 
@@ -111,6 +228,51 @@ private:
 
 	//for handling ImGui RLE user input
 	std::string inputString_ = "";
+	//Result of the last save, for the gui.
+	std::string saveStatus_ = "";
+
+	Checkpoint::Writer checkpointWriter_;
+	std::string checkpointPath_ = "gameoflife.ckpt";
+	//Generations between automatic checkpoints, or 0 for only when asked.
+	int checkpointInterval_ = 0;
+	long long nextCheckpointGeneration_ = 0;
+	//Result of the last restore, until the next checkpoint.
+	std::string checkpointStatus_ = "";
+
+	std::string posterPath_ = "gameoflife.png";
+	int posterCellsPerPixel_ = 1;
+	int posterPixelsPerCell_ = 1;
+	std::string posterStatus_ = "";
+
+	//Each generation the view shows, colors and all.
+	FrameRecorder recorder_;
+	std::string recordPath_ = "gameoflife.gif";
+	long long lastRecordedGeneration_ = -1;
+	//Why the last recording failed or stopped, until the next one starts.
+	std::string recordStatus_ = "";
+
+	std::string telemetryPath_ = "telemetry";
+	//Why the last telemetry failed, or what the last one wrote.
+	std::string telemetryStatus_ = "";
+
+	//The board after every update, for other processes to read.
+	SharedBoard::Publisher boardPublisher_;
+	std::string shareName_ = SharedBoard::DEFAULT_NAME;
+	std::string shareStatus_ = "";
+
+	//The board after every update, for browsers to watch.
+	FrameServer frameServer_;
+	int servePort_ = FrameServer::DEFAULT_PORT;
+	std::string serveStatus_ = "";
+
+	PatternLoader patternLoader_;
+
+	PatternLibrary patternLibrary_;
+	std::string libraryDirectory_ = "";
+	std::string libraryQuery_ = "";
+	//Indices into the library's entries, in its order.
+	std::vector<int> libraryMatches_;
+	int librarySelectedEntry_ = -1;
 };
 
 #endif // CPU_MODEL_H
@@ -0,0 +1,131 @@
+#include "CycleDetector.hpp"
+
+#include <algorithm>
+
+void CycleDetector::reset()
+{
+    state_ = State::Watching;
+    history_.clear();
+    lastSeen_.clear();
+    firstGeneration_ = 0;
+    lastGeneration_ = -1;
+    period_ = 0;
+    frameStart_ = 0;
+    cycleStart_ = 0;
+    frames_.clear();
+    frames_.shrink_to_fit();
+    skippedPeriod_ = 0;
+}
+
+bool CycleDetector::isInHistory_(long long generation) const
+{
+    return !history_.empty()
+        && generation >= firstGeneration_
+        && generation <= lastGeneration_
+        && generation > lastGeneration_ - (long long)history_.size();
+}
+
+void CycleDetector::addToHistory_(uint64_t hash, long long generation)
+{
+    const long long length = (long long)history_.size();
+    long long oldest = generation - length;
+    if (oldest >= firstGeneration_) {
+        //Forget the hash that is about to be overwritten, unless it was seen again since.
+        auto seen = lastSeen_.find(getHistoryHash_(oldest));
+        if (seen != lastSeen_.end() && seen->second == oldest) lastSeen_.erase(seen);
+    }
+    history_[(size_t)(generation % length)] = hash;
+    lastSeen_[hash] = generation;
+    lastGeneration_ = generation;
+}
+
+void CycleDetector::saveFrame_(const GridEngine& board)
+{
+    frames_.push_back(Frame{ board.getWords(), GridEngine::Stats() });
+}
+
+void CycleDetector::startVerifying_(GridEngine& board, long long generation, int period)
+{
+    state_ = State::Verifying;
+    period_ = period;
+    frameStart_ = generation;
+    frames_.clear();
+    frames_.reserve(period);
+    saveFrame_(board);
+}
+
+bool CycleDetector::record(GridEngine& board, long long generation)
+{
+    if (history_.empty() || generation != lastGeneration_ + 1) {
+        reset();
+        //One extra slot, so the generation maxPeriod back is still there to match against.
+        history_.assign((size_t)std::max(maxPeriod, 1) + 1, 0);
+        firstGeneration_ = generation;
+    }
+    if (state_ == State::Confirmed) return false;
+
+    uint64_t hash = board.getHash();
+    if (state_ == State::Watching) {
+        auto seen = lastSeen_.find(hash);
+        long long previous = (seen != lastSeen_.end()) ? seen->second : -1;
+        addToHistory_(hash, generation);
+        if (previous < 0) return false;
+
+        int period = (int)(generation - previous);
+        size_t frameBytes = board.getWords().size() * sizeof(uint64_t);
+        if ((size_t)period * frameBytes > maxCacheBytes) {
+            skippedPeriod_ = period;
+            return false;
+        }
+        startVerifying_(board, generation, period);
+        return false;
+    }
+
+    addToHistory_(hash, generation);
+    long long offset = generation - frameStart_;
+    if (offset < period_) {
+        if (getHistoryHash_(generation - period_) == hash) {
+            saveFrame_(board);
+            return false;
+        }
+    }
+    else if (board.getWords() == frames_[0].words) {
+        state_ = State::Confirmed;
+        //Each frame follows the one before it, and the first follows the last.
+        for (int frame = 0; frame < period_; frame++) {
+            const Frame& previous = frames_[(frame + period_ - 1) % period_];
+            frames_[frame].stats = board.countStats(previous.words, frames_[frame].words);
+        }
+        //The hashes repeat from further back than the first match, if the history still has them.
+        cycleStart_ = frameStart_;
+        while (isInHistory_(cycleStart_ - 1) && getHistoryHash_(cycleStart_ - 1) == getHistoryHash_(cycleStart_ - 1 + period_)) {
+            cycleStart_--;
+        }
+        return true;
+    }
+
+    //Hash collision, or a board that only passed through a repeated state.
+    state_ = State::Watching;
+    period_ = 0;
+    frames_.clear();
+    return false;
+}
+
+size_t CycleDetector::getFrameIndex_(long long generation) const
+{
+    return (size_t)(std::max(generation - frameStart_, 0ll) % period_);
+}
+
+std::string CycleDetector::getStatusText() const
+{
+    switch (state_) {
+    case State::Watching:
+        if (skippedPeriod_ > 0) return "Watching; period " + std::to_string(skippedPeriod_) + " was too big to cache";
+        return "Watching for a repeated board";
+    case State::Verifying:
+        return "Checking a possible period " + std::to_string(period_) + " cycle";
+    case State::Confirmed:
+        return "Period " + std::to_string(period_) + " cycle since generation " + std::to_string(cycleStart_);
+    }
+    return "";
+}
@@ -0,0 +1,86 @@
+#ifndef CYCLE_DETECTOR_HPP
+#define CYCLE_DETECTOR_HPP
+
+#include "GridEngine.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Spots a board that has fallen into a cycle so its frames can be replayed instead of recomputed.
+//Each generation's GridEngine hash goes into a history of the last maxPeriod generations. A hash seen
+//before gives a candidate period p; the next p generations are then saved as frames while their hashes
+//are checked against the ones p generations earlier, and the cycle is confirmed by comparing the board
+//with the first saved frame word for word, so a hash collision can never start a bogus playback.
+class CycleDetector
+{
+public:
+	enum class State
+	{
+		Watching,
+		Verifying,
+		Confirmed
+	};
+
+	constexpr static const char* StateNames[3] = { "Watching", "Verifying", "Confirmed" };
+
+	CycleDetector() = default;
+
+	//Longest period looked for, which is also the length of the hash history.
+	int maxPeriod = 4096;
+	//Periods whose frames would take more memory than this are not cached.
+	size_t maxCacheBytes = (size_t)256 << 20;
+
+	void reset();
+
+	//Call once per generation with the board after that generation. Generations must follow on from
+	//each other; a gap starts the history over. Returns true on the generation a cycle is confirmed.
+	bool record(GridEngine& board, long long generation);
+
+	State getState() const { return state_; }
+	//Newest generation recorded, or -1 before the first.
+	long long getLastGeneration() const { return lastGeneration_; }
+	int getPeriod() const { return (state_ == State::Confirmed) ? period_ : 0; }
+	//First generation of the cycle, as far back as the hash history reaches.
+	long long getCycleStart() const { return cycleStart_; }
+
+	//Cached board and stats for any generation after the cycle started. Only valid once confirmed.
+	const GridEngine::Words& getFrame(long long generation) const { return frames_[getFrameIndex_(generation)].words; }
+	const GridEngine::Stats& getFrameStats(long long generation) const { return frames_[getFrameIndex_(generation)].stats; }
+
+	std::string getStatusText() const;
+
+private:
+	struct Frame
+	{
+		GridEngine::Words words;
+		GridEngine::Stats stats;
+	};
+
+	size_t getFrameIndex_(long long generation) const;
+	//Hash recorded for generation, which must still be in the history.
+	uint64_t getHistoryHash_(long long generation) const { return history_[(size_t)(generation % (long long)history_.size())]; }
+	bool isInHistory_(long long generation) const;
+	void addToHistory_(uint64_t hash, long long generation);
+	void startVerifying_(GridEngine& board, long long generation, int period);
+	void saveFrame_(const GridEngine& board);
+
+	State state_ = State::Watching;
+
+	//Ring of hashes by generation, and the newest generation each hash was seen at.
+	std::vector<uint64_t> history_;
+	std::unordered_map<uint64_t, long long> lastSeen_;
+	long long firstGeneration_ = 0;
+	long long lastGeneration_ = -1;
+
+	int period_ = 0;
+	//Generation of frames_[0].
+	long long frameStart_ = 0;
+	long long cycleStart_ = 0;
+	std::vector<Frame> frames_;
+	//Last candidate that was too big to cache, so the status can say why nothing happened.
+	int skippedPeriod_ = 0;
+};
+
+#endif //CYCLE_DETECTOR_HPP
@@ -0,0 +1,410 @@
+#include "DistributedStrip.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <tuple>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    //What neighbors swap on load, so a mismatched launch fails up front instead of scrambling the board.
+    struct Handshake
+    {
+        int32_t width = 0;
+        int32_t haloDepth = 0;
+        int32_t rank = 0;
+        int32_t rankCount = 0;
+    };
+
+    //One socket's share of an exchange. Either side may be empty.
+    struct Channel
+    {
+        int socket = -1;
+        const uint8_t* send = nullptr;
+        size_t sendLeft = 0;
+        uint8_t* receive = nullptr;
+        size_t receiveLeft = 0;
+    };
+
+#if !defined(_WIN32)
+#if defined(MSG_NOSIGNAL)
+    constexpr int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+    constexpr int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+    //Sends and receives on every channel at once, so neither side can stall the other by filling its buffer first.
+    bool transfer(Channel* channels, int channelCount, std::string& error)
+    {
+        while (true) {
+            pollfd fds[2] = {};
+            bool pending = false;
+            for (int index = 0; index < channelCount; index++) {
+                fds[index].fd = channels[index].socket;
+                fds[index].events = (short)((channels[index].sendLeft ? POLLOUT : 0) | (channels[index].receiveLeft ? POLLIN : 0));
+                pending = pending || fds[index].events;
+            }
+            if (!pending) return true;
+
+            if (poll(fds, channelCount, -1) < 0) {
+                if (errno == EINTR) continue;
+                error = std::string("poll failed: ") + std::strerror(errno);
+                return false;
+            }
+
+            for (int index = 0; index < channelCount; index++) {
+                Channel& channel = channels[index];
+                short events = fds[index].revents;
+                if (channel.receiveLeft && (events & (POLLIN | POLLHUP | POLLERR))) {
+                    ssize_t received = recv(channel.socket, channel.receive, channel.receiveLeft, MSG_DONTWAIT);
+                    if (received == 0) {
+                        error = "A neighbor closed the connection";
+                        return false;
+                    }
+                    if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                        error = std::string("recv failed: ") + std::strerror(errno);
+                        return false;
+                    }
+                    if (received > 0) {
+                        channel.receive += received;
+                        channel.receiveLeft -= (size_t)received;
+                    }
+                }
+                if (channel.sendLeft && (events & (POLLOUT | POLLERR | POLLHUP))) {
+                    ssize_t sent = send(channel.socket, channel.send, channel.sendLeft, SEND_FLAGS);
+                    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                        error = std::string("send failed: ") + std::strerror(errno);
+                        return false;
+                    }
+                    if (sent > 0) {
+                        channel.send += sent;
+                        channel.sendLeft -= (size_t)sent;
+                    }
+                }
+            }
+        }
+    }
+
+    bool splitHost(const std::string& host, std::string& name, std::string& port)
+    {
+        size_t colon = host.rfind(':');
+        if (colon == std::string::npos || colon + 1 == host.size()) return false;
+        name = host.substr(0, colon);
+        port = host.substr(colon + 1);
+        //[::1]:5000 style
+        if (name.size() >= 2 && name.front() == '[' && name.back() == ']') name = name.substr(1, name.size() - 2);
+        return true;
+    }
+
+    void setNoDelay(int socketHandle)
+    {
+        int enabled = 1;
+        setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    }
+#else
+    bool transfer(Channel*, int, std::string& error)
+    {
+        error = "Distributed runs need POSIX sockets";
+        return false;
+    }
+#endif
+}
+
+DistributedStrip::~DistributedStrip()
+{
+    closeSockets_();
+}
+
+void DistributedStrip::closeSockets_()
+{
+#if !defined(_WIN32)
+    if (upSocket_ >= 0) close(upSocket_);
+    if (downSocket_ >= 0 && downSocket_ != upSocket_) close(downSocket_);
+#endif
+    upSocket_ = -1;
+    downSocket_ = -1;
+}
+
+bool DistributedStrip::fail_(const std::string& error)
+{
+    error_ = "Rank " + std::to_string(rank_) + ": " + error;
+    return false;
+}
+
+std::pair<int, int> DistributedStrip::getStripRows(int height, int rank, int rankCount)
+{
+    return { (int)((long long)height * rank / rankCount), (int)((long long)height * (rank + 1) / rankCount) };
+}
+
+bool DistributedStrip::makeLocalRing(int rankCount, std::vector<std::pair<int, int>>& links, std::string& error)
+{
+    links.clear();
+#if !defined(_WIN32)
+    for (int index = 0; index < rankCount; index++) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+            error = std::string("socketpair failed: ") + std::strerror(errno);
+            for (auto& link : links) {
+                close(link.first);
+                close(link.second);
+            }
+            links.clear();
+            return false;
+        }
+        links.push_back({ pair[0], pair[1] });
+    }
+    return true;
+#else
+    (void)rankCount;
+    error = "Distributed runs need POSIX sockets";
+    return false;
+#endif
+}
+
+void DistributedStrip::attach(int rank, int rankCount, int upSocket, int downSocket)
+{
+    closeSockets_();
+    rank_ = rank;
+    rankCount_ = std::max(rankCount, 1);
+    upSocket_ = upSocket;
+    downSocket_ = downSocket;
+}
+
+bool DistributedStrip::connect(const std::vector<std::string>& hosts, int rank, double timeoutSeconds)
+{
+    rank_ = rank;
+    if (hosts.empty() || rank < 0 || rank >= (int)hosts.size()) return fail_("rank is outside the host list");
+#if !defined(_WIN32)
+    std::string name;
+    std::string port;
+    std::string belowName;
+    std::string belowPort;
+    if (!splitHost(hosts[rank], name, port)) return fail_("expected host:port, got " + hosts[rank]);
+    const std::string& below = hosts[(rank + 1) % hosts.size()];
+    if (!splitHost(below, belowName, belowPort)) return fail_("expected host:port, got " + below);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* listenAddress = nullptr;
+    if (getaddrinfo(nullptr, port.c_str(), &hints, &listenAddress) != 0 || !listenAddress) return fail_("can't listen on port " + port);
+    int listener = socket(listenAddress->ai_family, listenAddress->ai_socktype, listenAddress->ai_protocol);
+    int reuse = 1;
+    if (listener >= 0) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    bool listening = listener >= 0
+        && bind(listener, listenAddress->ai_addr, listenAddress->ai_addrlen) == 0
+        && listen(listener, 1) == 0;
+    freeaddrinfo(listenAddress);
+    if (!listening) {
+        std::string reason = std::strerror(errno);
+        if (listener >= 0) close(listener);
+        return fail_("can't listen on port " + port + ": " + reason);
+    }
+
+    //The rank below may not be listening yet, so keep trying until the deadline.
+    auto start = Clock::now();
+    int downSocket = -1;
+    hints.ai_flags = 0;
+    while (downSocket < 0 && secondsSince(start) < timeoutSeconds) {
+        addrinfo* belowAddress = nullptr;
+        if (getaddrinfo(belowName.c_str(), belowPort.c_str(), &hints, &belowAddress) == 0) {
+            for (addrinfo* address = belowAddress; address && downSocket < 0; address = address->ai_next) {
+                int candidate = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                if (candidate < 0) continue;
+                if (::connect(candidate, address->ai_addr, address->ai_addrlen) == 0) downSocket = candidate;
+                else close(candidate);
+            }
+            freeaddrinfo(belowAddress);
+        }
+        if (downSocket < 0) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (downSocket < 0) {
+        close(listener);
+        return fail_("timed out connecting to " + below);
+    }
+
+    pollfd waiting = { listener, POLLIN, 0 };
+    double remaining = std::max(timeoutSeconds - secondsSince(start), 0.0);
+    int upSocket = (poll(&waiting, 1, (int)(remaining * 1000.0)) > 0) ? accept(listener, nullptr, nullptr) : -1;
+    close(listener);
+    if (upSocket < 0) {
+        close(downSocket);
+        return fail_("timed out waiting for the rank above");
+    }
+
+    setNoDelay(upSocket);
+    setNoDelay(downSocket);
+    attach(rank, (int)hosts.size(), upSocket, downSocket);
+    return true;
+#else
+    (void)timeoutSeconds;
+    return fail_("Distributed runs need POSIX sockets");
+#endif
+}
+
+bool DistributedStrip::load(const GridEngine& board, int haloDepth)
+{
+    error_.clear();
+    timing_ = Timing();
+    haloDepth_ = std::max(haloDepth, 1);
+    std::tie(rowBegin_, rowEnd_) = getStripRows(board.getHeight(), rank_, rankCount_);
+    const int height = rowEnd_ - rowBegin_;
+    if (height < haloDepth_) {
+        return fail_("strip of " + std::to_string(height) + " rows is thinner than the " + std::to_string(haloDepth_) + " row halo");
+    }
+
+    //The halos start out filled straight from the full board; after that they come from the neighbors.
+    strip_.resize(board.getWidth(), height + 2 * haloDepth_);
+    for (int row = 0; row < strip_.getHeight(); row++) {
+        int boardRow = ((rowBegin_ - haloDepth_ + row) % board.getHeight() + board.getHeight()) % board.getHeight();
+        strip_.setRows(row, 1, board.getRow(boardRow));
+    }
+    const size_t haloWords = (size_t)haloDepth_ * strip_.getWordsPerRow();
+    sendTop_.assign(haloWords, 0);
+    sendBottom_.assign(haloWords, 0);
+    haloTop_.assign(haloWords, 0);
+    haloBottom_.assign(haloWords, 0);
+
+    Handshake mine{ board.getWidth(), haloDepth_, rank_, rankCount_ };
+    Handshake above;
+    Handshake below;
+    Channel channels[2];
+    channels[0] = { upSocket_, (const uint8_t*)&mine, sizeof(mine), (uint8_t*)&above, sizeof(above) };
+    channels[1] = { downSocket_, (const uint8_t*)&mine, sizeof(mine), (uint8_t*)&below, sizeof(below) };
+    std::string error;
+    if (!transfer(channels, 2, error)) return fail_(error);
+
+    for (const Handshake& neighbor : { above, below }) {
+        if (neighbor.width != mine.width || neighbor.haloDepth != mine.haloDepth || neighbor.rankCount != mine.rankCount) {
+            return fail_("rank " + std::to_string(neighbor.rank) + " has a different board width, halo depth or rank count");
+        }
+    }
+    if (above.rank != (rank_ + rankCount_ - 1) % rankCount_ || below.rank != (rank_ + 1) % rankCount_) {
+        return fail_("neighbors are out of order; check the host list");
+    }
+    return true;
+}
+
+bool DistributedStrip::exchangeHalos_()
+{
+    const size_t bytes = sendTop_.size() * sizeof(uint64_t);
+    Channel channels[2];
+    channels[0] = { upSocket_, (const uint8_t*)sendTop_.data(), bytes, (uint8_t*)haloTop_.data(), bytes };
+    channels[1] = { downSocket_, (const uint8_t*)sendBottom_.data(), bytes, (uint8_t*)haloBottom_.data(), bytes };
+    std::string error;
+    if (!transfer(channels, 2, error)) return fail_(error);
+    return true;
+}
+
+bool DistributedStrip::step(long long generations)
+{
+    const int depth = haloDepth_;
+    const int height = getStripHeight();
+    const int localHeight = strip_.getHeight();
+    const size_t haloWords = sendTop_.size();
+
+    while (generations > 0) {
+        //Owned rows are local rows depth to depth + height. The halos are good for depth generations.
+        int round = (int)std::min<long long>(generations, depth);
+        std::copy(strip_.getRow(depth), strip_.getRow(depth) + haloWords, sendTop_.begin());
+        std::copy(strip_.getRow(height), strip_.getRow(height) + haloWords, sendBottom_.begin());
+
+        auto exchangeStart = Clock::now();
+        bool exchanged = false;
+        double exchangeSeconds = 0.0;
+        std::thread exchange([&]() {
+            exchanged = exchangeHalos_();
+            exchangeSeconds = secondsSince(exchangeStart);
+        });
+
+        //Rows whose neighbors are all owned don't need the halos for the first generation.
+        auto computeStart = Clock::now();
+        strip_.stepRows(depth + 1, depth + height - 1);
+        double overlappedSeconds = secondsSince(computeStart);
+
+        auto waitStart = Clock::now();
+        exchange.join();
+        timing_.communicationSeconds += secondsSince(waitStart);
+        timing_.exchangeSeconds += exchangeSeconds;
+        if (!exchanged) return false;
+        timing_.exchanges++;
+        timing_.bytesSent += 2 * haloWords * sizeof(uint64_t);
+
+        auto edgeStart = Clock::now();
+        strip_.setRows(0, depth, haloTop_.data());
+        strip_.setRows(depth + height, depth, haloBottom_.data());
+        strip_.stepRows(0, depth + 1);
+        strip_.stepRows(depth + height - 1, localHeight);
+        strip_.finishStep();
+        if (round > 1) strip_.step(round - 1, false);
+        timing_.computeSeconds += overlappedSeconds + secondsSince(edgeStart);
+
+        generations -= round;
+    }
+    return true;
+}
+
+uint64_t DistributedStrip::countPopulation() const
+{
+    uint64_t population = 0;
+    for (int row = haloDepth_; row < haloDepth_ + getStripHeight(); row++) {
+        const uint64_t* words = strip_.getRow(row);
+        for (int word = 0; word < strip_.getWordsPerRow(); word++) population += std::popcount(words[word]);
+    }
+    return population;
+}
+
+bool DistributedStrip::allReduceSum(uint64_t value, uint64_t& total)
+{
+    //Each pass hands on what came from above, so after rankCount - 1 passes everyone has seen every value.
+    total = value;
+    uint64_t passing = value;
+    for (int pass = 1; pass < rankCount_; pass++) {
+        uint64_t received = 0;
+        Channel channels[2];
+        channels[0] = { downSocket_, (const uint8_t*)&passing, sizeof(passing), nullptr, 0 };
+        channels[1] = { upSocket_, nullptr, 0, (uint8_t*)&received, sizeof(received) };
+        std::string error;
+        if (!transfer(channels, 2, error)) return fail_(error);
+        total += received;
+        passing = received;
+    }
+    return true;
+}
+
+bool DistributedStrip::allReduceMax(double value, double& maximum)
+{
+    maximum = value;
+    double passing = value;
+    for (int pass = 1; pass < rankCount_; pass++) {
+        double received = 0.0;
+        Channel channels[2];
+        channels[0] = { downSocket_, (const uint8_t*)&passing, sizeof(passing), nullptr, 0 };
+        channels[1] = { upSocket_, nullptr, 0, (uint8_t*)&received, sizeof(received) };
+        std::string error;
+        if (!transfer(channels, 2, error)) return fail_(error);
+        maximum = std::max(maximum, received);
+        passing = received;
+    }
+    return true;
+}
@@ -0,0 +1,98 @@
+#ifndef DISTRIBUTED_STRIP_HPP
+#define DISTRIBUTED_STRIP_HPP
+
+#include "GridEngine.hpp"
+#include "LifeRule.hpp"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//One horizontal strip of a torus that is split across several processes, rank 0 at the top.
+//The strip is held in a local GridEngine with haloDepth extra rows above and below. Every haloDepth
+//generations the top and bottom owned rows are swapped with the neighboring ranks over a pair of
+//connected sockets, and the strip then runs that many generations on its own; the rows that go stale
+//from the edges in the meantime are all in the halos. While the halos are in flight, the first of those
+//generations is computed for every row that doesn't need them.
+//The links form a ring: up goes to rank - 1, down to rank + 1, wrapping. One rank has up and down connected
+//to each other. Sockets are POSIX file descriptors; elsewhere connecting fails with an error.
+class DistributedStrip
+{
+public:
+	struct Timing
+	{
+		//Time spent stepping, including the overlapped part.
+		double computeSeconds = 0.0;
+		//Time spent waiting for halos after the overlapped work ran out.
+		double communicationSeconds = 0.0;
+		//How long exchanges were in flight in total, overlapped or not.
+		double exchangeSeconds = 0.0;
+		uint64_t bytesSent = 0;
+		long long exchanges = 0;
+	};
+
+	DistributedStrip() = default;
+	~DistributedStrip();
+
+	DistributedStrip(const DistributedStrip&) = delete;
+	DistributedStrip& operator=(const DistributedStrip&) = delete;
+
+	//First and one past the last board row owned by rank.
+	static std::pair<int, int> getStripRows(int height, int rank, int rankCount);
+
+	//rankCount connected socket pairs in a ring, for running every rank on one machine.
+	//Rank r uses links[r].second as up and links[(r + 1) % rankCount].first as down.
+	static bool makeLocalRing(int rankCount, std::vector<std::pair<int, int>>& links, std::string& error);
+	//Over TCP. hosts holds host:port for every rank; this rank listens on its own port for the rank above
+	//and connects to the rank below, retrying until timeoutSeconds.
+	bool connect(const std::vector<std::string>& hosts, int rank, double timeoutSeconds = 30.0);
+	//Takes ownership of two already connected sockets.
+	void attach(int rank, int rankCount, int upSocket, int downSocket);
+
+	//Copies this rank's rows out of the full board, which every rank builds the same way, and checks the
+	//neighbors agree on the width and halo depth.
+	bool load(const GridEngine& board, int haloDepth);
+	void setRule(const LifeRule& rule) { strip_.setRule(rule); }
+	void setKernelConfig(const GridEngine::KernelConfig& config) { strip_.setKernelConfig(config); }
+
+	bool step(long long generations);
+
+	int getRank() const { return rank_; }
+	int getRankCount() const { return rankCount_; }
+	int getStripHeight() const { return rowEnd_ - rowBegin_; }
+	//Live cells in the owned rows, not the halos.
+	uint64_t countPopulation() const;
+	const Timing& getTiming() const { return timing_; }
+	const std::string& getError() const { return error_; }
+
+	//Sums or maxes a value over every rank, passing it round the ring. Every rank must call it.
+	bool allReduceSum(uint64_t value, uint64_t& total);
+	bool allReduceMax(double value, double& maximum);
+
+private:
+	//Sends sendTop_ up and sendBottom_ down, and receives the neighbors' edge rows into haloTop_ and haloBottom_.
+	//Runs on its own thread while step() computes.
+	bool exchangeHalos_();
+	bool fail_(const std::string& error);
+	void closeSockets_();
+
+	int rank_ = 0;
+	int rankCount_ = 1;
+	int upSocket_ = -1;
+	int downSocket_ = -1;
+
+	GridEngine strip_;
+	int haloDepth_ = 1;
+	int rowBegin_ = 0;
+	int rowEnd_ = 0;
+	std::vector<uint64_t> sendTop_;
+	std::vector<uint64_t> sendBottom_;
+	std::vector<uint64_t> haloTop_;
+	std::vector<uint64_t> haloBottom_;
+
+	Timing timing_;
+	std::string error_;
+};
+
+#endif //DISTRIBUTED_STRIP_HPP
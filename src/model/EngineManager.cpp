@@ -0,0 +1,430 @@
+#include "EngineManager.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+namespace
+{
+    //Below this fraction of the board changing per generation, HashLife's memoization usually wins.
+    constexpr double QUIET_CHANGE_RATE = 0.002;
+    //HashLife has to be this much slower than the grid before switching back, so the choice doesn't flap.
+    constexpr double HASHLIFE_SLOWDOWN_TOLERANCE = 1.25;
+    //Samples to give HashLife to fill its caches before judging its speed.
+    constexpr int HASHLIFE_WARMUP_SAMPLES = 4;
+    constexpr int MAX_HASHLIFE_BACKOFF = 256;
+    //Boards busier than this are rarely about to repeat, and hashing every generation would cost more
+    //than playback could win back, so cycles are only looked for below it.
+    constexpr double CYCLE_CHANGE_RATE = 0.005;
+
+    template <typename... Args>
+    std::string formatReason(const char* format, Args... args)
+    {
+        char buffer[160];
+        std::snprintf(buffer, sizeof(buffer), format, args...);
+        return buffer;
+    }
+
+    double updateAverage(double average, double value)
+    {
+        return (average <= 0.0) ? value : 0.8 * average + 0.2 * value;
+    }
+}
+
+void EngineManager::resize(int width, int height)
+{
+    grid_.resize(width, height);
+    hashLife_.clear();
+    cycleDetector_.reset();
+    history_.clear();
+    activeEngine_ = Engine::Grid;
+    reason_ = "New board";
+    gridStale_ = false;
+    generation_ = 0;
+    gridNanosecondsPerGeneration_ = 0.0;
+    resetSampling_();
+}
+
+void EngineManager::clear()
+{
+    grid_.clear();
+    hashLife_.clear();
+    cycleDetector_.reset();
+    history_.clear();
+    activeEngine_ = Engine::Grid;
+    reason_ = "Board cleared";
+    gridStale_ = false;
+    generation_ = 0;
+    resetSampling_();
+}
+
+void EngineManager::setRule(const LifeRule& rule)
+{
+    //The gui sets the rule every frame, so only a real change throws the cached cycle away.
+    if (rule != grid_.getRule()) {
+        if (activeEngine_ == Engine::Playback) migrateTo_(Engine::Grid, "Rule changed");
+        cycleDetector_.reset();
+    }
+    grid_.setRule(rule);
+    if (activeEngine_ == Engine::HashLife && !HashLifeEngine::supportsRule(rule)) {
+        migrateTo_(Engine::Grid, "Rule " + rule.toString() + " has B0, which HashLife can't run");
+    }
+    if (activeEngine_ == Engine::HashLife) hashLife_.setRule(rule);
+}
+
+void EngineManager::setCell(int row, int column, bool alive)
+{
+    if (activeEngine_ != Engine::Grid) migrateTo_(Engine::Grid, "Cells edited");
+    cycleDetector_.reset();
+    historyEdited_ = true;
+    grid_.setCell(row, column, alive);
+}
+
+void EngineManager::loadCells(const std::vector<uint8_t>& aliveFlags)
+{
+    grid_.loadCells(aliveFlags);
+    adoptGrid_(0, "New pattern");
+}
+
+void EngineManager::loadPattern(const PackedPattern& pattern, int row, int column)
+{
+    grid_.loadPattern(pattern, row, column);
+    adoptGrid_(0, "New pattern");
+}
+
+void EngineManager::adoptGrid_(long long generation, const std::string& reason)
+{
+    hashLife_.clear();
+    cycleDetector_.reset();
+    history_.clear();
+    activeEngine_ = Engine::Grid;
+    reason_ = reason;
+    gridStale_ = false;
+    generation_ = generation;
+    resetSampling_();
+}
+
+void EngineManager::loadTree(HashLifeEngine&& tree, long long generation)
+{
+    hashLife_ = std::move(tree);
+    grid_.setRule(hashLife_.getRule());
+    cycleDetector_.reset();
+    history_.clear();
+    generation_ = generation;
+    resetSampling_();
+    hashLifeNanosecondsPerGeneration_ = 0.0;
+
+    if ((Mode)selectedModeIndex != Mode::Grid && getHashLifeHeadroom_(hashLife_.getBounds()) >= 1) {
+        activeEngine_ = Engine::HashLife;
+        reason_ = "Loaded as a HashLife tree";
+        gridStale_ = true;
+        return;
+    }
+    hashLife_.storeToGrid(grid_);
+    hashLife_.clear();
+    activeEngine_ = Engine::Grid;
+    reason_ = "New pattern";
+    gridStale_ = false;
+}
+
+const GridEngine& EngineManager::getGrid()
+{
+    if (gridStale_) {
+        if (activeEngine_ == Engine::HashLife) hashLife_.storeToGrid(grid_);
+        else if (activeEngine_ == Engine::Playback) grid_.setWords(cycleDetector_.getFrame(generation_), &cycleDetector_.getFrameStats(generation_));
+        gridStale_ = false;
+    }
+    return grid_;
+}
+
+GridEngine::Stats EngineManager::getStats() const
+{
+    if (activeEngine_ == Engine::Playback) return cycleDetector_.getFrameStats(generation_);
+    if (activeEngine_ == Engine::Grid) return grid_.getStats();
+
+    GridEngine::Stats stats;
+    stats.population = hashLife_.getPopulation();
+    HashLifeEngine::Bounds bounds = hashLife_.getBounds();
+    if (!bounds.isEmpty()) {
+        stats.left = (int)bounds.left;
+        stats.top = (int)bounds.top;
+        stats.right = (int)bounds.right;
+        stats.bottom = (int)bounds.bottom;
+    }
+    return stats;
+}
+
+void EngineManager::resetSampling_()
+{
+    generationsUntilSample_ = sampleInterval;
+    lastSampleGeneration_ = generation_;
+    lastSample_ = Sample();
+    hashLifeSamples_ = 0;
+    hashLifeBackoff_ = 1;
+    samplesUntilHashLifeRetry_ = 0;
+}
+
+void EngineManager::migrateTo_(Engine engine, const std::string& reason)
+{
+    reason_ = reason;
+    if (engine == activeEngine_) return;
+
+    if (engine == Engine::HashLife) {
+        hashLife_.setRule(grid_.getRule());
+        hashLife_.loadFromGrid(grid_);
+        hashLifeSamples_ = 0;
+        hashLifeNanosecondsPerGeneration_ = 0.0;
+        gridStale_ = false;
+    }
+    else if (engine == Engine::Playback) {
+        //Entered straight from the grid on the generation the cycle was confirmed, so the grid is current.
+        gridStale_ = false;
+    }
+    else {
+        getGrid();
+        //Nothing is memoized for long enough to be worth the memory once the grid takes over.
+        hashLife_.clear();
+    }
+    //The hash history only follows the grid, and cached frames are no use once something else runs.
+    if (engine != Engine::Playback) cycleDetector_.reset();
+    activeEngine_ = engine;
+}
+
+void EngineManager::step(int generations)
+{
+    //A forced choice applies right away rather than at the next sample.
+    if ((Mode)selectedModeIndex == Mode::Grid && activeEngine_ == Engine::HashLife) {
+        migrateTo_(Engine::Grid, "Grid selected");
+    }
+    if (!cycleDetection) {
+        if (activeEngine_ == Engine::Playback) migrateTo_(Engine::Grid, "Cycle detection turned off");
+        cycleDetector_.reset();
+    }
+    if (!recordHistory) history_.clear();
+    else if (activeEngine_ != Engine::Grid) migrateTo_(Engine::Grid, "Recording history");
+    const bool recordTelemetry = telemetry_.isRecording();
+    if (recordTelemetry && telemetry_.getRowCount() == 0) {
+        telemetryGenerations_ = 0;
+        telemetryNanoseconds_ = 0;
+        telemetry_.record(generation_, getStats(), 0);
+    }
+
+    while (generations > 0) {
+        auto start = recordTelemetry ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        if (activeEngine_ == Engine::Playback) {
+            //Nothing to compute; getGrid() picks the frame when someone looks.
+            generation_ += generations;
+            gridStale_ = true;
+            if (recordTelemetry) addTelemetry_(generations, start);
+            break;
+        }
+        if (activeEngine_ == Engine::Grid) {
+            int chunk = std::min(generations, std::max(generationsUntilSample_, 1));
+            //End on the next row, so its stats come from the kernel's pass over the chunk's last generation.
+            if (recordTelemetry) chunk = std::min(chunk, std::max(telemetryInterval - telemetryGenerations_, 1));
+            int stepped = stepGrid_(chunk);
+            generations -= stepped;
+            generationsUntilSample_ -= stepped;
+            //Before sampling, which may hand the board to HashLife, since only the grid has births and deaths.
+            if (recordTelemetry) addTelemetry_(stepped, start);
+            if (generationsUntilSample_ <= 0 && activeEngine_ == Engine::Grid) {
+                generationsUntilSample_ = sampleInterval;
+                sampleGrid_();
+            }
+        }
+        else {
+            int stepped = stepHashLife_(generations);
+            generations -= stepped;
+            if (recordTelemetry) addTelemetry_(stepped, start);
+        }
+    }
+}
+
+void EngineManager::addTelemetry_(int generations, std::chrono::steady_clock::time_point start)
+{
+    telemetryNanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    telemetryGenerations_ += generations;
+    if (telemetryGenerations_ < std::max(telemetryInterval, 1)) return;
+    telemetry_.record(generation_, getStats(), telemetryNanoseconds_ / telemetryGenerations_);
+    telemetryGenerations_ = 0;
+    telemetryNanoseconds_ = 0;
+}
+
+int EngineManager::stepGrid_(int generations)
+{
+    auto start = std::chrono::steady_clock::now();
+    int stepped = 0;
+    //The stats are from the kernel's last pass, so checking how busy the board is costs nothing.
+    const GridEngine::Stats& stats = grid_.getStats();
+    double changeRate = (double)(stats.births + stats.deaths) / ((double)grid_.getWidth() * grid_.getHeight());
+    bool detectCycles = cycleDetection && !recordHistory && changeRate < CYCLE_CHANGE_RATE;
+    grid_.setHashTracking(detectCycles);
+    grid_.setChangeTracking(recordHistory);
+
+    if (!detectCycles && !recordHistory) {
+        grid_.step(generations);
+        stepped = generations;
+        generation_ += generations;
+    }
+    else {
+        //One at a time so the detector and the history see every generation. The kernel keeps the hash
+        //and the change lists as it goes, and the stats are only gathered on the last one.
+        //Start the history from the current board, e.g. generation 0 or where HashLife handed back.
+        if (detectCycles && cycleDetector_.getLastGeneration() != generation_) cycleDetector_.record(grid_, generation_);
+        if (recordHistory && (historyEdited_ || !history_.contains(generation_))) {
+            history_.recordKeyframe(grid_, generation_);
+            historyEdited_ = false;
+        }
+        bool confirmed = false;
+        while (stepped < generations && !confirmed) {
+            grid_.step(1, stepped == generations - 1);
+            stepped++;
+            generation_++;
+            if (detectCycles) confirmed = cycleDetector_.record(grid_, generation_);
+            if (recordHistory && !history_.recordStep(grid_, generation_)) history_.recordKeyframe(grid_, generation_);
+        }
+        if (confirmed) migrateTo_(Engine::Playback, cycleDetector_.getStatusText());
+    }
+    double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    gridNanosecondsPerGeneration_ = updateAverage(gridNanosecondsPerGeneration_, nanoseconds / stepped);
+    return stepped;
+}
+
+bool EngineManager::seek(long long generation)
+{
+    if (!history_.contains(generation)) return false;
+    if (activeEngine_ != Engine::Grid) migrateTo_(Engine::Grid, "Rewinding");
+    history_.restore(generation, seekWords_);
+    grid_.setWords(seekWords_);
+    generation_ = generation;
+    historyEdited_ = false;
+    cycleDetector_.reset();
+    resetSampling_();
+    reason_ = formatReason("Rewound to generation %lld", generation);
+    return true;
+}
+
+int EngineManager::stepHashLife_(int generations)
+{
+    long long headroom = getHashLifeHeadroom_(hashLife_.getBounds());
+    if (headroom < 1) {
+        migrateTo_(Engine::Grid, "Pattern reached the board edge");
+        return 0;
+    }
+
+    int chunk = (int)std::min<long long>(generations, headroom);
+    auto start = std::chrono::steady_clock::now();
+    hashLife_.step(chunk);
+    double nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    hashLifeNanosecondsPerGeneration_ = updateAverage(hashLifeNanosecondsPerGeneration_, nanoseconds / chunk);
+    gridStale_ = true;
+    generation_ += chunk;
+
+    sampleHashLife_();
+    return chunk;
+}
+
+long long EngineManager::getHashLifeHeadroom_(const HashLifeEngine::Bounds& bounds) const
+{
+    if (bounds.isEmpty()) return std::numeric_limits<int>::max();
+    //Patterns grow at most one cell per generation. Keep the outermost row and column empty,
+    //since on the torus they neighbor the opposite edge.
+    return std::min({
+        bounds.left - 1,
+        bounds.top - 1,
+        (long long)grid_.getWidth() - 2 - bounds.right,
+        (long long)grid_.getHeight() - 2 - bounds.bottom });
+}
+
+void EngineManager::recordSample_(uint64_t population, uint64_t changedCells, const HashLifeEngine::Bounds& bounds)
+{
+    Sample sample;
+    sample.population = population;
+    sample.changedCells = changedCells;
+    sample.bounds = bounds;
+
+    long long generations = generation_ - lastSampleGeneration_;
+    const auto& previous = lastSample_.bounds;
+    if (generations > 0 && !bounds.isEmpty() && !previous.isEmpty()) {
+        long long growth = std::max({
+            previous.left - bounds.left,
+            previous.top - bounds.top,
+            bounds.right - previous.right,
+            bounds.bottom - previous.bottom,
+            0ll });
+        sample.boundsGrowthPerGeneration = (double)growth / generations;
+    }
+
+    lastSample_ = sample;
+    lastSampleGeneration_ = generation_;
+}
+
+void EngineManager::sampleGrid_()
+{
+    //All of it comes from the kernel's last pass, so sampling doesn't touch the board.
+    const GridEngine::Stats& stats = grid_.getStats();
+    HashLifeEngine::Bounds bounds;
+    if (!stats.isEmpty()) bounds = HashLifeEngine::Bounds{ stats.left, stats.top, stats.right, stats.bottom };
+    recordSample_(stats.population, stats.births + stats.deaths, bounds);
+    if (samplesUntilHashLifeRetry_ > 0) samplesUntilHashLifeRetry_--;
+
+    Mode mode = (Mode)selectedModeIndex;
+    if (mode == Mode::Grid) {
+        reason_ = "Grid selected";
+        return;
+    }
+    if (recordHistory) {
+        reason_ = "Recording history, which needs every generation";
+        return;
+    }
+    if (!HashLifeEngine::supportsRule(grid_.getRule())) {
+        reason_ = "Rule " + grid_.getRule().toString() + " has B0, which HashLife can't run";
+        return;
+    }
+
+    long long headroom = getHashLifeHeadroom_(lastSample_.bounds);
+    if (headroom < sampleInterval) {
+        reason_ = "Pattern fills the board; HashLife needs room to grow";
+        return;
+    }
+    if (mode == Mode::HashLife) {
+        migrateTo_(Engine::HashLife, "HashLife selected");
+        return;
+    }
+
+    //A pattern that will hit the edge within a few samples isn't worth converting.
+    double growth = lastSample_.boundsGrowthPerGeneration;
+    if (growth > 0.0 && headroom / growth < 16.0 * sampleInterval) {
+        reason_ = formatReason("Pattern growing %.2f cells per generation toward the edge", growth);
+        return;
+    }
+
+    double changeRate = (double)lastSample_.changedCells / ((double)grid_.getWidth() * grid_.getHeight());
+    if (changeRate >= QUIET_CHANGE_RATE) {
+        reason_ = formatReason("Busy board: %.2f%% of cells changing", changeRate * 100.0);
+        return;
+    }
+    if (samplesUntilHashLifeRetry_ > 0) {
+        reason_ = "HashLife was slower; waiting before trying it again";
+        return;
+    }
+    migrateTo_(Engine::HashLife, formatReason("Quiet pattern: %.3f%% of cells changing", changeRate * 100.0));
+}
+
+void EngineManager::sampleHashLife_()
+{
+    recordSample_(hashLife_.getPopulation(), 0, hashLife_.getBounds());
+    hashLifeSamples_++;
+
+    if ((Mode)selectedModeIndex != Mode::Automatic) return;
+    if (hashLifeSamples_ < HASHLIFE_WARMUP_SAMPLES || gridNanosecondsPerGeneration_ <= 0.0) return;
+
+    if (hashLifeNanosecondsPerGeneration_ > gridNanosecondsPerGeneration_ * HASHLIFE_SLOWDOWN_TOLERANCE) {
+        samplesUntilHashLifeRetry_ = hashLifeBackoff_;
+        hashLifeBackoff_ = std::min(hashLifeBackoff_ * 2, MAX_HASHLIFE_BACKOFF);
+        migrateTo_(Engine::Grid, formatReason(
+            "HashLife was slower: %.0f vs %.0f ns per generation",
+            hashLifeNanosecondsPerGeneration_, gridNanosecondsPerGeneration_));
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef ENGINE_MANAGER_HPP
+#define ENGINE_MANAGER_HPP
+
+#include "CycleDetector.hpp"
+#include "GridEngine.hpp"
+#include "HashLifeEngine.hpp"
+#include "HistoryRing.hpp"
+#include "LifeRule.hpp"
+#include "TelemetrySink.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Owns one board and runs it on whichever engine suits the pattern.
+//Dense, chaotic boards run on the packed GridEngine; sparse or repetitive patterns that stay clear of
+//the board edges run on HashLifeEngine. Population, bounding box and change rate are sampled every
+//sampleInterval generations, and the board is converted in bulk when the other engine looks faster.
+//HashLife works on an unbounded plane, so it is only used while nothing can reach the wrapped edges.
+//With cycleDetection on, the grid also feeds a CycleDetector, and once a cycle is confirmed the board
+//is replayed from its cached frames without computing anything until it is edited or the rule changes.
+//With recordHistory on, it stays on the grid and keeps every generation in a HistoryRing to seek back to.
+//While getTelemetry() is recording, a row of stats goes to it every telemetryInterval generations from
+//whichever engine is running, so recording doesn't change how the run is stepped.
+class EngineManager
+{
+public:
+	enum class Engine
+	{
+		Grid,
+		HashLife,
+		Playback
+	};
+
+	constexpr static const char* EngineNames[3] = { "Grid", "HashLife", "Cycle Playback" };
+
+	enum class Mode
+	{
+		Automatic,
+		Grid,
+		HashLife
+	};
+
+	constexpr static const char* ModeNames[3] = { "Automatic", "Grid", "HashLife" };
+
+	//What the last sample saw. Changed cells is only measured on the grid.
+	struct Sample
+	{
+		uint64_t population = 0;
+		uint64_t changedCells = 0;
+		HashLifeEngine::Bounds bounds;
+		//How fast the bounding box edges moved out since the previous sample, in cells per generation.
+		double boundsGrowthPerGeneration = 0.0;
+	};
+
+	EngineManager() = default;
+
+	int selectedModeIndex = (int)Mode::Automatic;
+	int sampleInterval = 64;
+	bool cycleDetection = true;
+	//Keeps the run on the grid, one generation at a time, and cycle detection waits while it is on.
+	bool recordHistory = false;
+	//Generations between telemetry rows. Grid steps end on a row, so a row costs only the stats the kernel
+	//gathers on the last generation of every step anyway; 1 gathers them on every generation, which costs
+	//about half as much again as the kernel. HashLife and playback jump further and write a row after each jump.
+	int telemetryInterval = 64;
+
+	void resize(int width, int height);
+	void clear();
+	int getWidth() const { return grid_.getWidth(); }
+	int getHeight() const { return grid_.getHeight(); }
+
+	void setRule(const LifeRule& rule);
+	const LifeRule& getRule() const { return grid_.getRule(); }
+	void setThreadCount(int threadCount) { grid_.setThreadCount(threadCount); }
+	void setKernelConfig(const GridEngine::KernelConfig& config) { grid_.setKernelConfig(config); }
+	const GridEngine::KernelConfig& getKernelConfig() const { return grid_.getKernelConfig(); }
+	bool setAffinity(const std::vector<int>& cpus) { return grid_.setAffinity(cpus); }
+	const std::vector<int>& getAffinity() const { return grid_.getAffinity(); }
+
+	//Edits go to the grid, so an edit while HashLife runs converts back first.
+	void setCell(int row, int column, bool alive);
+	void loadCells(const std::vector<uint8_t>& aliveFlags);
+	//A built in pattern, see GridEngine::loadPattern().
+	void loadPattern(const PackedPattern& pattern, int row, int column);
+	//Takes over a pattern that is already a HashLife tree, e.g. from a macrocell file, placed in board
+	//coordinates. It stays a tree and runs on HashLife while it is clear of the edges; the grid only
+	//gets its cells once someone asks for them.
+	void loadTree(HashLifeEngine&& tree, long long generation = 0);
+	//Resizes the grid if need be and hands it to fill, which writes every row of it, e.g. straight out of
+	//a checkpoint. The run carries on counting from generation.
+	template <typename Fill>
+	void loadRows(int width, int height, long long generation, Fill&& fill)
+	{
+		if (width != grid_.getWidth() || height != grid_.getHeight()) grid_.resize(width, height);
+		fill(grid_);
+		adoptGrid_(generation, "Restored from a checkpoint");
+	}
+
+	void step(int generations);
+
+	//Generations recorded so far, with recordHistory on. Set getHistory().maxBytes to cap its memory.
+	HistoryRing& getHistory() { return history_; }
+	const HistoryRing& getHistory() const { return history_; }
+	//Puts the board back to a recorded generation. Stepping from there records over the generations after it.
+	bool seek(long long generation);
+
+	//Start it to record a row of stats and step time every telemetryInterval generations, stop it to finish
+	//the files. The first row is the board as it was when the recording started.
+	TelemetrySink& getTelemetry() { return telemetry_; }
+	const TelemetrySink& getTelemetry() const { return telemetry_; }
+
+	//The board as of the current generation. Converts HashLife's cells into the grid if they are newer.
+	const GridEngine& getGrid();
+
+	uint64_t countPopulation() const { return getStats().population; }
+	//Population, births, deaths and live bounds of the current generation, without a pass over the board.
+	//HashLife doesn't track births and deaths, so they read zero while it runs.
+	GridEngine::Stats getStats() const;
+	long long getGeneration() const { return generation_; }
+
+	Engine getActiveEngine() const { return activeEngine_; }
+	//Why the active engine was chosen, for the gui.
+	const std::string& getReason() const { return reason_; }
+	const Sample& getLastSample() const { return lastSample_; }
+	double getGridNanosecondsPerGeneration() const { return gridNanosecondsPerGeneration_; }
+	double getHashLifeNanosecondsPerGeneration() const { return hashLifeNanosecondsPerGeneration_; }
+	const CycleDetector& getCycleDetector() const { return cycleDetector_; }
+	//Only current while the active engine is HashLife.
+	const HashLifeEngine& getHashLife() const { return hashLife_; }
+
+private:
+	//Starts over on the grid with the cells it now holds.
+	void adoptGrid_(long long generation, const std::string& reason);
+	void migrateTo_(Engine engine, const std::string& reason);
+	void resetSampling_();
+	//Generations HashLife may run before anything could wrap around the board edges.
+	long long getHashLifeHeadroom_(const HashLifeEngine::Bounds& bounds) const;
+	void recordSample_(uint64_t population, uint64_t changedCells, const HashLifeEngine::Bounds& bounds);
+	void sampleGrid_();
+	void sampleHashLife_();
+	//Returns the generations actually run, which is fewer than asked if a cycle was confirmed part way.
+	int stepGrid_(int generations);
+	//Returns the generations actually run, which is 0 if the pattern is too near the edge.
+	int stepHashLife_(int generations);
+	//Adds generations, stepped since start, to the next telemetry row and writes it once it is due.
+	void addTelemetry_(int generations, std::chrono::steady_clock::time_point start);
+
+	GridEngine grid_;
+	HashLifeEngine hashLife_;
+	CycleDetector cycleDetector_;
+	HistoryRing history_;
+	TelemetrySink telemetry_;
+	//Generations and time since the last telemetry row.
+	int telemetryGenerations_ = 0;
+	long long telemetryNanoseconds_ = 0;
+	//The board was edited since its generation was recorded, so the next step records it again.
+	bool historyEdited_ = false;
+	GridEngine::Words seekWords_;
+	Engine activeEngine_ = Engine::Grid;
+	std::string reason_ = "Starting on the grid";
+	//HashLife or playback has stepped since the grid was last brought up to date.
+	bool gridStale_ = false;
+
+	long long generation_ = 0;
+	int generationsUntilSample_ = 64;
+	long long lastSampleGeneration_ = 0;
+	Sample lastSample_;
+
+	double gridNanosecondsPerGeneration_ = 0.0;
+	double hashLifeNanosecondsPerGeneration_ = 0.0;
+	int hashLifeSamples_ = 0;
+	//After HashLife loses on speed, wait this many samples before trying it again. Doubles every loss.
+	int hashLifeBackoff_ = 1;
+	int samplesUntilHashLifeRetry_ = 0;
+};
+
+#endif //ENGINE_MANAGER_HPP
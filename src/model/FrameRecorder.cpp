@@ -0,0 +1,405 @@
+#include "FrameRecorder.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    //GIF codes are at most 12 bits; the table starts over at clear once it holds this many.
+    constexpr int MAX_CODES = 4095;
+    constexpr int MIN_CODE_SIZE = 8;
+    constexpr int CLEAR_CODE = 1 << MIN_CODE_SIZE;
+    constexpr int END_CODE = CLEAR_CODE + 1;
+    constexpr int FIRST_CODE = CLEAR_CODE + 2;
+    //Open addressing, kept under half full so a probe rarely goes past the first slot.
+    constexpr int HASH_BITS = 13;
+    constexpr uint32_t HASH_SIZE = 1u << HASH_BITS;
+    constexpr int MAX_GIF_SIDE = 65535;
+
+    void putShort(std::vector<uint8_t>& out, int value)
+    {
+        out.push_back((uint8_t)(value & 0xFF));
+        out.push_back((uint8_t)(value >> 8));
+    }
+
+    void putPalette(std::vector<uint8_t>& out, const FrameRecorder::Palette& palette)
+    {
+        for (const FrameRecorder::Color& color : palette) {
+            out.push_back(color.r);
+            out.push_back(color.g);
+            out.push_back(color.b);
+        }
+    }
+
+    //LZW codes for a rectangle of values, least significant bit first, in the 255 byte sub-blocks GIF
+    //wants. The dictionary maps a prefix code and the next value to a code, in a hash table that is
+    //only 32 KiB so starting over at each clear code is cheap.
+    class LzwEncoder
+    {
+    public:
+        void encode(const uint8_t* values, size_t stride, int width, int height, std::vector<uint8_t>& out)
+        {
+            out.push_back(MIN_CODE_SIZE);
+            blockStart_ = out.size();
+            out.push_back(0);
+            bits_ = 0;
+            bitCount_ = 0;
+
+            reset_();
+            put_(CLEAR_CODE, out);
+            int prefix = values[0];
+            for (int row = 0; row < height; row++) {
+                const uint8_t* rowValues = values + row * stride;
+                for (int column = (row == 0) ? 1 : 0; column < width; column++) {
+                    uint32_t key = ((uint32_t)prefix << 8 | rowValues[column]) + 1;
+                    uint32_t slot = (key * 2654435761u) >> (32 - HASH_BITS);
+                    while (keys_[slot] != 0 && keys_[slot] != key) slot = (slot + 1) & (HASH_SIZE - 1);
+                    if (keys_[slot] == key) {
+                        prefix = codes_[slot];
+                        continue;
+                    }
+                    put_(prefix, out);
+                    if (nextCode_ < MAX_CODES) {
+                        keys_[slot] = key;
+                        codes_[slot] = (uint16_t)nextCode_++;
+                        if (nextCode_ > (1 << codeSize_) && codeSize_ < 12) codeSize_++;
+                    }
+                    else {
+                        put_(CLEAR_CODE, out);
+                        reset_();
+                    }
+                    prefix = rowValues[column];
+                }
+            }
+            put_(prefix, out);
+            put_(END_CODE, out);
+            if (bitCount_ > 0) putByte_((uint8_t)bits_, out);
+            //An empty block ends the image.
+            out.push_back(0);
+        }
+
+    private:
+        void reset_()
+        {
+            std::fill(std::begin(keys_), std::end(keys_), 0u);
+            nextCode_ = FIRST_CODE;
+            codeSize_ = MIN_CODE_SIZE + 1;
+        }
+
+        void put_(int code, std::vector<uint8_t>& out)
+        {
+            bits_ |= (uint32_t)code << bitCount_;
+            bitCount_ += codeSize_;
+            while (bitCount_ >= 8) {
+                putByte_((uint8_t)bits_, out);
+                bits_ >>= 8;
+                bitCount_ -= 8;
+            }
+        }
+
+        void putByte_(uint8_t byte, std::vector<uint8_t>& out)
+        {
+            if (out[blockStart_] == 255) {
+                blockStart_ = out.size();
+                out.push_back(0);
+            }
+            out.push_back(byte);
+            out[blockStart_]++;
+        }
+
+        uint32_t keys_[HASH_SIZE];
+        uint16_t codes_[HASH_SIZE];
+        int nextCode_ = FIRST_CODE;
+        int codeSize_ = MIN_CODE_SIZE + 1;
+        uint32_t bits_ = 0;
+        int bitCount_ = 0;
+        size_t blockStart_ = 0;
+    };
+
+    uint8_t clampByte(double value)
+    {
+        return (uint8_t)std::clamp((int)std::lround(value), 0, 255);
+    }
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    stop();
+}
+
+FrameRecorder::Format FrameRecorder::getFormat(const std::string& path)
+{
+    std::string extension = path.substr(std::min(path.size(), path.rfind('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return (extension == ".y4m") ? Format::Y4m : Format::Gif;
+}
+
+bool FrameRecorder::start(const std::string& path, int width, int height, std::string& error)
+{
+    stop();
+    format_ = getFormat(path);
+    if (width <= 0 || height <= 0) {
+        error = "Nothing to record";
+        return false;
+    }
+    if (format_ == Format::Gif && (width > MAX_GIF_SIDE || height > MAX_GIF_SIDE)) {
+        error = "GIF frames are at most " + std::to_string(MAX_GIF_SIDE) + " cells a side; record a Y4M instead";
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+
+    path_ = path;
+    width_ = width;
+    height_ = height;
+    havePrevious_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.clear();
+        stopping_ = false;
+        status_ = Status();
+        status_.recording = true;
+        error_.clear();
+    }
+    recording_ = true;
+
+    //The GIF header carries the first frame's palette, so it waits for that frame.
+    if (format_ == Format::Y4m) {
+        char header[96];
+        int length = std::snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width_, height_, std::max(framesPerSecond, 1));
+        write_(header, (size_t)length);
+    }
+    worker_ = std::thread([this]() { encodeQueued_(); });
+    return true;
+}
+
+bool FrameRecorder::addFrame(const uint8_t* values, const Palette& palette)
+{
+    if (!recording_) return false;
+    Frame frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if ((int)queue_.size() >= std::max(maxQueuedFrames, 1)) {
+            if (dropWhenFull) {
+                status_.framesDropped++;
+                return false;
+            }
+            frameTaken_.wait(lock, [this]() { return (int)queue_.size() < std::max(maxQueuedFrames, 1); });
+        }
+        if (!spare_.empty()) {
+            frame = std::move(spare_.back());
+            spare_.pop_back();
+        }
+    }
+    //Copied outside the lock so the encoder isn't held up by it.
+    frame.values.assign(values, values + (size_t)width_ * height_);
+    frame.palette = palette;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(frame));
+        status_.framesQueued++;
+    }
+    frameQueued_.notify_one();
+    return true;
+}
+
+bool FrameRecorder::stop()
+{
+    if (!recording_) return getError().empty();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    frameQueued_.notify_one();
+    if (worker_.joinable()) worker_.join();
+
+    if (format_ == Format::Gif) {
+        if (havePrevious_) {
+            const uint8_t trailer = 0x3B;
+            write_(&trailer, 1);
+        }
+        else if (getError().empty()) {
+            fail_("No frames were recorded");
+        }
+    }
+    file_.close();
+    if (file_.fail()) fail_("Could not finish writing " + path_);
+    recording_ = false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.recording = false;
+    spare_.clear();
+    return error_.empty();
+}
+
+FrameRecorder::Status FrameRecorder::getStatus() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return status_;
+}
+
+std::string FrameRecorder::getError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void FrameRecorder::encodeQueued_()
+{
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frameQueued_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return;
+            frame = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        frameTaken_.notify_one();
+
+        auto start = std::chrono::steady_clock::now();
+        //After a failed write the rest are taken off the queue and thrown away.
+        bool written = getError().empty() && ((format_ == Format::Gif) ? writeGifFrame_(frame) : writeY4mFrame_(frame));
+        //GIF compares each frame with the one before, so keep it and recycle the older buffer.
+        if (format_ == Format::Gif) std::swap(previous_, frame);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (written) status_.framesWritten++;
+        status_.seconds += seconds;
+        spare_.push_back(std::move(frame));
+    }
+}
+
+bool FrameRecorder::writeGifFrame_(const Frame& frame)
+{
+    encoded_.clear();
+    if (!havePrevious_) {
+        const char signature[] = "GIF89a";
+        encoded_.insert(encoded_.end(), signature, signature + 6);
+        putShort(encoded_, width_);
+        putShort(encoded_, height_);
+        //Global color table of 256 entries, 8 bits per primary.
+        encoded_.push_back(0xF7);
+        encoded_.push_back(0);
+        encoded_.push_back(0);
+        putPalette(encoded_, frame.palette);
+        //Loop forever.
+        const uint8_t loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+        encoded_.insert(encoded_.end(), loop, loop + sizeof(loop));
+    }
+
+    //Only the rectangle that changed is encoded; the frame before stays on screen around it. A new
+    //palette recolors everything, so that frame is whole and brings its own color table.
+    bool paletteChanged = havePrevious_ && frame.palette != previous_.palette;
+    int left = 0;
+    int top = 0;
+    int right = width_ - 1;
+    int bottom = height_ - 1;
+    if (havePrevious_ && !paletteChanged) {
+        left = width_;
+        top = height_;
+        right = -1;
+        bottom = -1;
+        for (int row = 0; row < height_; row++) {
+            const uint8_t* values = &frame.values[(size_t)row * width_];
+            const uint8_t* before = &previous_.values[(size_t)row * width_];
+            if (std::memcmp(values, before, (size_t)width_) == 0) continue;
+            top = std::min(top, row);
+            bottom = row;
+            int first = 0;
+            while (values[first] == before[first]) first++;
+            int last = width_ - 1;
+            while (values[last] == before[last]) last--;
+            left = std::min(left, first);
+            right = std::max(right, last);
+        }
+        //Nothing changed: a one cell frame still holds the delay.
+        if (right < left) {
+            left = 0;
+            top = 0;
+            right = 0;
+            bottom = 0;
+        }
+    }
+    int frameWidth = right - left + 1;
+    int frameHeight = bottom - top + 1;
+
+    //Graphic control: leave the frame in place, delay in hundredths of a second.
+    int delay = std::max((int)std::lround(100.0 / std::max(framesPerSecond, 1)), 2);
+    const uint8_t control[] = { 0x21, 0xF9, 0x04, 0x04 };
+    encoded_.insert(encoded_.end(), control, control + sizeof(control));
+    putShort(encoded_, delay);
+    encoded_.push_back(0);
+    encoded_.push_back(0);
+
+    encoded_.push_back(0x2C);
+    putShort(encoded_, left);
+    putShort(encoded_, top);
+    putShort(encoded_, frameWidth);
+    putShort(encoded_, frameHeight);
+    encoded_.push_back(paletteChanged ? 0x87 : 0x00);
+    if (paletteChanged) putPalette(encoded_, frame.palette);
+
+    LzwEncoder encoder;
+    encoder.encode(&frame.values[(size_t)top * width_ + left], (size_t)width_, frameWidth, frameHeight, encoded_);
+    havePrevious_ = true;
+    return write_(encoded_.data(), encoded_.size());
+}
+
+bool FrameRecorder::writeY4mFrame_(const Frame& frame)
+{
+    if (!havePrevious_ || frame.palette != previous_.palette) {
+        //BT.601 studio range, which is what players assume of Y4M.
+        for (int index = 0; index < 256; index++) {
+            double r = frame.palette[index].r / 255.0;
+            double g = frame.palette[index].g / 255.0;
+            double b = frame.palette[index].b / 255.0;
+            yuv_[index][0] = clampByte(16.0 + 65.481 * r + 128.553 * g + 24.966 * b);
+            yuv_[index][1] = clampByte(128.0 - 37.797 * r - 74.203 * g + 112.0 * b);
+            yuv_[index][2] = clampByte(128.0 + 112.0 * r - 93.786 * g - 18.214 * b);
+        }
+        previous_.palette = frame.palette;
+        havePrevious_ = true;
+    }
+
+    const size_t cellCount = (size_t)width_ * height_;
+    const char marker[] = "FRAME\n";
+    planes_.resize(sizeof(marker) - 1 + 3 * cellCount);
+    std::memcpy(planes_.data(), marker, sizeof(marker) - 1);
+    uint8_t* luma = planes_.data() + sizeof(marker) - 1;
+    uint8_t* blue = luma + cellCount;
+    uint8_t* red = blue + cellCount;
+    for (size_t index = 0; index < cellCount; index++) {
+        const std::array<uint8_t, 3>& yuv = yuv_[frame.values[index]];
+        luma[index] = yuv[0];
+        blue[index] = yuv[1];
+        red[index] = yuv[2];
+    }
+    return write_(planes_.data(), planes_.size());
+}
+
+bool FrameRecorder::write_(const void* data, size_t size)
+{
+    file_.write(static_cast<const char*>(data), (std::streamsize)size);
+    if (!file_) {
+        fail_("Could not write " + path_);
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_.bytesWritten += size;
+    return true;
+}
+
+void FrameRecorder::fail_(const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) error_ = error;
+}
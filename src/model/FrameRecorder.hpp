@@ -0,0 +1,125 @@
+#ifndef FRAME_RECORDER_HPP
+#define FRAME_RECORDER_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Records the board as an animation, one frame per call to addFrame(), encoded on a background thread.
+//Frames are the 8 bit cell values the view colors, one byte per cell, and the 256 entry palette that
+//colors them. GIF uses the values as they are, since the palette is already the color table, and LZW
+//codes them; each frame only covers the rectangle that changed since the one before. Y4M is raw 4:4:4
+//video for piping into an encoder. Frames wait in a queue of at most maxQueuedFrames; a full queue
+//drops the frame rather than hold up the simulation, unless dropWhenFull is off.
+class FrameRecorder
+{
+public:
+	enum class Format
+	{
+		Gif,
+		Y4m
+	};
+
+	constexpr static const char* FormatNames[2] = { "GIF", "Y4M" };
+
+	struct Color
+	{
+		uint8_t r = 0;
+		uint8_t g = 0;
+		uint8_t b = 0;
+
+		bool operator==(const Color& color) const = default;
+	};
+	using Palette = std::array<Color, 256>;
+
+	//Where the recording has got to. The counts go on from the start of the recording.
+	struct Status
+	{
+		bool recording = false;
+		long long framesQueued = 0;
+		long long framesWritten = 0;
+		long long framesDropped = 0;
+		uint64_t bytesWritten = 0;
+		//Spent encoding and writing on the background thread.
+		double seconds = 0.0;
+	};
+
+	FrameRecorder() = default;
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder&) = delete;
+	FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+	int maxQueuedFrames = 8;
+	bool dropWhenFull = true;
+	//Playback speed. GIF delays are in hundredths of a second, so it is rounded to one of those.
+	int framesPerSecond = 25;
+
+	//Y4M for a name ending in .y4m, otherwise GIF.
+	static Format getFormat(const std::string& path);
+
+	//Opens path and starts the encoder. Stops any recording already running. GIF frames are at most
+	//65535 cells a side.
+	bool start(const std::string& path, int width, int height, std::string& error);
+	//Copies width * height values, row major, and queues them. False if the frame was dropped or
+	//nothing is recording.
+	bool addFrame(const uint8_t* values, const Palette& palette);
+	//Encodes what is queued, finishes the file and closes it. False if anything failed; getError() says why.
+	bool stop();
+
+	bool isRecording() const { return recording_; }
+	Format getActiveFormat() const { return format_; }
+	const std::string& getPath() const { return path_; }
+	Status getStatus() const;
+	std::string getError() const;
+
+private:
+	struct Frame
+	{
+		std::vector<uint8_t> values;
+		Palette palette;
+	};
+
+	//These run on the worker thread.
+	void encodeQueued_();
+	bool writeGifFrame_(const Frame& frame);
+	bool writeY4mFrame_(const Frame& frame);
+	bool write_(const void* data, size_t size);
+	void fail_(const std::string& error);
+
+	Format format_ = Format::Gif;
+	std::string path_;
+	int width_ = 0;
+	int height_ = 0;
+	bool recording_ = false;
+	std::thread worker_;
+	std::ofstream file_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable frameQueued_;
+	std::condition_variable frameTaken_;
+	std::deque<Frame> queue_;
+	//Buffers of frames already written, so a long recording doesn't allocate for every frame.
+	std::vector<Frame> spare_;
+	bool stopping_ = false;
+	Status status_;
+	std::string error_;
+
+	//Worker state: the frame before, so GIF can encode only the change and Y4M knows when the palette
+	//changed, and Y4M's Y, Cb and Cr for each value.
+	Frame previous_;
+	bool havePrevious_ = false;
+	std::array<std::array<uint8_t, 3>, 256> yuv_;
+	std::vector<uint8_t> planes_;
+	std::vector<uint8_t> encoded_;
+};
+
+#endif //FRAME_RECORDER_HPP
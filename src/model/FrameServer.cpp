@@ -0,0 +1,954 @@
+#include "FrameServer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <string_view>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    //A request line and headers longer than this aren't from a browser.
+    constexpr size_t MAX_REQUEST_BYTES = 8192;
+    //Clients only send control frames; anything bigger is dropped along with the client.
+    constexpr uint64_t MAX_CLIENT_FRAME_BYTES = 1 << 16;
+    //Guards applyMessage() against headers that would allocate absurd boards: 1 GiB of words.
+    constexpr uint64_t MAX_CLIENT_WORDS = 1ull << 27;
+    constexpr const char* WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    //Served for GET /. Connects back to the same host and draws each message into a canvas, a pixel per cell.
+    constexpr const char* VIEWER_PAGE = R"HTML(<!doctype html>
+<html><head><meta charset="utf-8"><title>Game of Life</title>
+<style>
+body { margin: 0; background: #101010; color: #c0c0c0; font: 13px monospace; }
+#status { height: 20px; padding: 2px 6px; }
+canvas { display: block; width: 100vw; height: calc(100vh - 24px); object-fit: contain; image-rendering: pixelated; }
+</style></head>
+<body><div id="status">connecting</div><canvas id="board" width="1" height="1"></canvas>
+<script>
+const canvas = document.getElementById('board'), status = document.getElementById('status');
+const context = canvas.getContext('2d');
+const LIVE = 0xffffffff, DEAD = 0xff202020;
+let image = null, pixels = null, width = 0, height = 0;
+
+function connect() {
+    const socket = new WebSocket((location.protocol == 'https:' ? 'wss://' : 'ws://') + location.host + '/stream');
+    socket.binaryType = 'arraybuffer';
+    socket.onclose = () => { status.textContent += ', disconnected'; setTimeout(connect, 1000); };
+    socket.onmessage = event => {
+        const view = new DataView(event.data);
+        const type = view.getUint8(0), size = view.getUint16(2, true), tiles = view.getUint32(4, true);
+        const w = view.getUint32(8, true), h = view.getUint32(12, true);
+        if (type == 1) {
+            if (w != width || h != height) {
+                width = canvas.width = w;
+                height = canvas.height = h;
+                image = context.createImageData(w, h);
+                pixels = new Uint32Array(image.data.buffer);
+            }
+            pixels.fill(DEAD);
+        }
+        else if (w != width || h != height) return;
+        const across = Math.ceil(width / size);
+        let offset = 32;
+        for (let tile = 0; tile < tiles; tile++) {
+            const index = view.getUint32(offset, true), encoding = view.getUint8(offset + 4), length = view.getUint32(offset + 5, true);
+            offset += 9;
+            const left = (index % across) * size, top = Math.floor(index / across) * size;
+            const columns = Math.min(size, width - left), rows = Math.min(size, height - top);
+            if (encoding == 2) {
+                let cell = 0, alive = false;
+                for (let at = offset; at < offset + length; alive = !alive) {
+                    let run = 0, shift = 0, byte;
+                    do { byte = view.getUint8(at++); run += (byte & 127) * 2 ** shift; shift += 7; } while (byte & 128);
+                    for (const end = cell + run; cell < end; cell++) {
+                        pixels[(top + Math.floor(cell / columns)) * width + left + cell % columns] = alive ? LIVE : DEAD;
+                    }
+                }
+            }
+            else {
+                for (let row = 0; row < rows; row++) {
+                    const start = (top + row) * width + left;
+                    if (encoding == 0) { pixels.fill(DEAD, start, start + columns); continue; }
+                    const low = view.getUint32(offset + row * 8, true), high = view.getUint32(offset + row * 8 + 4, true);
+                    for (let x = 0; x < columns; x++) pixels[start + x] = ((x < 32 ? low >>> x : high >>> (x - 32)) & 1) ? LIVE : DEAD;
+                }
+            }
+            offset += length;
+        }
+        context.putImageData(image, 0, 0);
+        socket.send('next');
+        status.textContent = 'generation ' + view.getBigInt64(16, true) + '  ' + width + 'x' + height
+            + '  population ' + view.getBigUint64(24, true) + '  ' + tiles + ' tiles in ' + (event.data.byteLength / 1024).toFixed(1) + ' KiB';
+    };
+}
+connect();
+</script></body></html>
+)HTML";
+
+    void putLittle(std::vector<uint8_t>& out, uint64_t value, int bytes)
+    {
+        for (int byte = 0; byte < bytes; byte++) out.push_back((uint8_t)(value >> (8 * byte)));
+    }
+
+    uint64_t getLittle(const uint8_t* in, int bytes)
+    {
+        uint64_t value = 0;
+        for (int byte = 0; byte < bytes; byte++) value |= (uint64_t)in[byte] << (8 * byte);
+        return value;
+    }
+
+    void putVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back((uint8_t)value);
+    }
+
+    uint64_t getColumnMask(int columns)
+    {
+        return (columns >= 64) ? ~0ull : (1ull << columns) - 1;
+    }
+
+    //One tile of a board laid out like GridEngine::getWords(), tile header first. Tiles are one word wide.
+    void encodeTile(const uint64_t* words, int wordsPerRow, int width, int height, size_t tile, std::vector<uint8_t>& out)
+    {
+        const int tileX = (int)(tile % (size_t)wordsPerRow);
+        const int rowBegin = (int)(tile / (size_t)wordsPerRow) * FrameServer::TILE_SIZE;
+        const int columns = std::min(FrameServer::TILE_SIZE, width - tileX * FrameServer::TILE_SIZE);
+        const int rows = std::min(FrameServer::TILE_SIZE, height - rowBegin);
+        const uint64_t mask = getColumnMask(columns);
+        const uint64_t* first = words + (size_t)rowBegin * wordsPerRow + tileX;
+        auto getRow = [&](int row) { return first[(size_t)row * wordsPerRow] & mask; };
+
+        out.clear();
+        putLittle(out, tile, 4);
+        out.push_back((uint8_t)FrameServer::TileEncoding::Empty);
+        putLittle(out, 0, 4);
+        bool empty = true;
+        for (int row = 0; row < rows && empty; row++) empty = getRow(row) == 0;
+        if (empty) return;
+
+        //Runs first, given up as soon as they are no smaller than the packed rows.
+        const size_t packedBytes = (size_t)rows * sizeof(uint64_t);
+        const size_t header = FrameServer::TILE_HEADER_BYTES;
+        uint64_t run = 0;
+        bool alive = false;
+        bool runsSmaller = true;
+        for (int row = 0; row < rows && runsSmaller; row++) {
+            const uint64_t bits = getRow(row);
+            int position = 0;
+            while (position < columns) {
+                //The next cell unlike the run so far; past the tile's columns every bit looks unlike a live run.
+                uint64_t ahead = (alive ? ~bits : bits) >> position;
+                int span = std::min(ahead ? std::countr_zero(ahead) : 64, columns - position);
+                run += (uint64_t)span;
+                position += span;
+                if (position < columns) {
+                    putVarint(out, run);
+                    run = 0;
+                    alive = !alive;
+                    if (out.size() - header >= packedBytes) {
+                        runsSmaller = false;
+                        break;
+                    }
+                }
+            }
+        }
+        if (runsSmaller) putVarint(out, run);
+
+        if (runsSmaller && out.size() - header < packedBytes) {
+            out[4] = (uint8_t)FrameServer::TileEncoding::Runs;
+        }
+        else {
+            out.resize(header);
+            out[4] = (uint8_t)FrameServer::TileEncoding::Packed;
+            for (int row = 0; row < rows; row++) putLittle(out, getRow(row), 8);
+        }
+        const size_t payloadBytes = out.size() - header;
+        for (int byte = 0; byte < 4; byte++) out[5 + byte] = (uint8_t)(payloadBytes >> (8 * byte));
+    }
+
+    //A server to client WebSocket frame header: final, binary or the given control opcode, unmasked.
+    void putFrameHeader(std::vector<uint8_t>& out, uint8_t opcode, uint64_t payloadBytes)
+    {
+        out.push_back((uint8_t)(0x80 | opcode));
+        if (payloadBytes < 126) {
+            out.push_back((uint8_t)payloadBytes);
+        }
+        else if (payloadBytes <= 0xffff) {
+            out.push_back(126);
+            out.push_back((uint8_t)(payloadBytes >> 8));
+            out.push_back((uint8_t)payloadBytes);
+        }
+        else {
+            out.push_back(127);
+            for (int byte = 7; byte >= 0; byte--) out.push_back((uint8_t)(payloadBytes >> (8 * byte)));
+        }
+    }
+
+    std::array<uint8_t, 20> sha1(const std::string& text)
+    {
+        uint32_t state[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+        std::vector<uint8_t> message(text.begin(), text.end());
+        const uint64_t bitCount = (uint64_t)text.size() * 8;
+        message.push_back(0x80);
+        while (message.size() % 64 != 56) message.push_back(0);
+        for (int byte = 7; byte >= 0; byte--) message.push_back((uint8_t)(bitCount >> (8 * byte)));
+
+        for (size_t block = 0; block < message.size(); block += 64) {
+            uint32_t schedule[80];
+            for (int index = 0; index < 16; index++) {
+                const uint8_t* in = &message[block + index * 4];
+                schedule[index] = (uint32_t)in[0] << 24 | (uint32_t)in[1] << 16 | (uint32_t)in[2] << 8 | in[3];
+            }
+            for (int index = 16; index < 80; index++) {
+                schedule[index] = std::rotl(schedule[index - 3] ^ schedule[index - 8] ^ schedule[index - 14] ^ schedule[index - 16], 1);
+            }
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+            for (int index = 0; index < 80; index++) {
+                uint32_t f;
+                uint32_t k;
+                if (index < 20) { f = (b & c) | (~b & d); k = 0x5a827999; }
+                else if (index < 40) { f = b ^ c ^ d; k = 0x6ed9eba1; }
+                else if (index < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+                else { f = b ^ c ^ d; k = 0xca62c1d6; }
+                uint32_t next = std::rotl(a, 5) + f + e + k + schedule[index];
+                e = d;
+                d = c;
+                c = std::rotl(b, 30);
+                b = a;
+                a = next;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+        }
+
+        std::array<uint8_t, 20> digest;
+        for (int index = 0; index < 20; index++) digest[index] = (uint8_t)(state[index / 4] >> (24 - 8 * (index % 4)));
+        return digest;
+    }
+
+    std::string toBase64(const uint8_t* data, size_t size)
+    {
+        constexpr const char* ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string text;
+        for (size_t index = 0; index < size; index += 3) {
+            uint32_t group = (uint32_t)data[index] << 16;
+            if (index + 1 < size) group |= (uint32_t)data[index + 1] << 8;
+            if (index + 2 < size) group |= data[index + 2];
+            text += ALPHABET[(group >> 18) & 63];
+            text += ALPHABET[(group >> 12) & 63];
+            text += (index + 1 < size) ? ALPHABET[(group >> 6) & 63] : '=';
+            text += (index + 2 < size) ? ALPHABET[group & 63] : '=';
+        }
+        return text;
+    }
+
+    std::string toLower(std::string text)
+    {
+        for (char& character : text) character = (char)std::tolower((unsigned char)character);
+        return text;
+    }
+
+    std::string trim(const std::string& text)
+    {
+        size_t begin = text.find_first_not_of(" \t");
+        size_t end = text.find_last_not_of(" \t\r");
+        return (begin == std::string::npos) ? std::string() : text.substr(begin, end - begin + 1);
+    }
+
+#if !defined(_WIN32)
+#if defined(MSG_NOSIGNAL)
+    constexpr int SEND_FLAGS = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+    constexpr int SEND_FLAGS = MSG_DONTWAIT;
+#endif
+
+    //Gets the thread out of poll(). A full pipe already has a wake up waiting in it.
+    void wake(int descriptor)
+    {
+        uint8_t byte = 0;
+        if (write(descriptor, &byte, 1) < 0) return;
+    }
+
+    bool setNonBlocking(int descriptor)
+    {
+        int flags = fcntl(descriptor, F_GETFL, 0);
+        return flags >= 0 && fcntl(descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+#endif
+}
+
+struct FrameServer::Client
+{
+    enum class State
+    {
+        //Waiting for the HTTP request.
+        Request,
+        Streaming,
+        //Sending what is queued, then hanging up.
+        Closing
+    };
+
+    int socket = -1;
+    State state = State::Request;
+    std::string received;
+    std::vector<uint8_t> outbox;
+    size_t sent = 0;
+    bool needsKeyframe = true;
+    //The frame number this client last got.
+    uint64_t frame = 0;
+    //Frames sent that the client hasn't answered yet.
+    int framesInFlight = 0;
+
+    bool isDrained() const { return sent == outbox.size(); }
+    bool isReady() const { return state == State::Streaming && isDrained() && framesInFlight < MAX_FRAMES_IN_FLIGHT; }
+};
+
+//Here, where Client is complete.
+FrameServer::FrameServer() = default;
+
+FrameServer::~FrameServer()
+{
+    stop();
+}
+
+bool FrameServer::start(int port, std::string& error)
+{
+    stop();
+#if !defined(_WIN32)
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* address = nullptr;
+    const std::string portName = std::to_string(port);
+    if (getaddrinfo(bindAddress.empty() ? nullptr : bindAddress.c_str(), portName.c_str(), &hints, &address) != 0 || !address) {
+        error = "Can't listen on " + bindAddress + ":" + portName;
+        return false;
+    }
+    int listener = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    int reuse = 1;
+    if (listener >= 0) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    bool listening = listener >= 0
+        && bind(listener, address->ai_addr, address->ai_addrlen) == 0
+        && listen(listener, 16) == 0
+        && setNonBlocking(listener);
+    freeaddrinfo(address);
+    int wake[2] = { -1, -1 };
+    if (listening && (pipe(wake) != 0 || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1]))) listening = false;
+    if (!listening) {
+        error = "Can't listen on " + bindAddress + ":" + portName + ": " + std::strerror(errno);
+        if (listener >= 0) close(listener);
+        if (wake[0] >= 0) close(wake[0]);
+        if (wake[1] >= 0) close(wake[1]);
+        return false;
+    }
+
+    sockaddr_storage bound = {};
+    socklen_t boundBytes = sizeof(bound);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &boundBytes);
+    if (bound.ss_family == AF_INET6) port_ = ntohs(reinterpret_cast<sockaddr_in6*>(&bound)->sin6_port);
+    else port_ = ntohs(reinterpret_cast<sockaddr_in*>(&bound)->sin_port);
+
+    listener_ = listener;
+    wakeRead_ = wake[0];
+    wakeWrite_ = wake[1];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = Snapshot();
+        havePending_ = false;
+        error_.clear();
+    }
+    current_ = Snapshot();
+    frameNumber_ = 0;
+    tilesAcross_ = 0;
+    tileFrames_.clear();
+    encodedTiles_.clear();
+    encodedFrames_.clear();
+    population_ = 0;
+    nextFrameTime_ = Clock::now();
+    frameWanted_ = false;
+    stopping_ = false;
+    clientCount_ = 0;
+    frameCount_ = 0;
+    messageCount_ = 0;
+    bytesSent_ = 0;
+    serving_ = true;
+    worker_ = std::thread(&FrameServer::serveLoop_, this);
+    return true;
+#else
+    (void)port;
+    error = "Serving frames needs POSIX sockets, which this platform doesn't have";
+    return false;
+#endif
+}
+
+void FrameServer::stop()
+{
+    if (!serving_) return;
+#if !defined(_WIN32)
+    stopping_.store(true, std::memory_order_release);
+    wake(wakeWrite_);
+    worker_.join();
+    frameWanted_ = false;
+
+    //Going away, best effort: a client with a full socket just sees the connection drop.
+    const uint8_t goingAway[] = { 0x88, 0x02, 0x03, 0xe9 };
+    for (auto& client : clients_) {
+        if (client->state == Client::State::Streaming && client->isDrained()) send(client->socket, goingAway, sizeof(goingAway), SEND_FLAGS);
+        close(client->socket);
+    }
+    clients_.clear();
+    close(listener_);
+    close(wakeRead_);
+    close(wakeWrite_);
+#endif
+    listener_ = wakeRead_ = wakeWrite_ = -1;
+    clientCount_ = 0;
+    serving_ = false;
+}
+
+std::string FrameServer::getError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+void FrameServer::publish_(const GridEngine& board, long long generation)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const GridEngine::Words& words = board.getWords();
+        pending_.width = board.getWidth();
+        pending_.height = board.getHeight();
+        pending_.wordsPerRow = board.getWordsPerRow();
+        pending_.generation = generation;
+        pending_.words.assign(words.begin(), words.end());
+        havePending_ = true;
+        frameWanted_.store(false, std::memory_order_relaxed);
+    }
+#if !defined(_WIN32)
+    wake(wakeWrite_);
+#endif
+}
+
+void FrameServer::serveLoop_()
+{
+#if !defined(_WIN32)
+    std::vector<pollfd> descriptors;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        //Clients that have everything there is want a newer board, once the frame rate allows.
+        bool hungry = false;
+        for (auto& client : clients_) {
+            bool caughtUp = frameNumber_ == 0 || (!client->needsKeyframe && client->frame == frameNumber_);
+            hungry = hungry || (client->isReady() && caughtUp);
+        }
+        int timeout = -1;
+        auto now = Clock::now();
+        if (hungry && now < nextFrameTime_) {
+            timeout = (int)std::chrono::ceil<std::chrono::milliseconds>(nextFrameTime_ - now).count();
+        }
+        frameWanted_.store(hungry && timeout < 0, std::memory_order_relaxed);
+
+        descriptors.clear();
+        descriptors.push_back({ wakeRead_, POLLIN, 0 });
+        descriptors.push_back({ listener_, POLLIN, 0 });
+        for (auto& client : clients_) descriptors.push_back({ client->socket, (short)(POLLIN | (client->isDrained() ? 0 : POLLOUT)), 0 });
+        if (poll(descriptors.data(), (nfds_t)descriptors.size(), timeout) < 0 && errno != EINTR) {
+            fail_(std::string("poll failed: ") + std::strerror(errno));
+            return;
+        }
+
+        if (descriptors[0].revents & POLLIN) {
+            uint8_t bytes[64];
+            while (read(wakeRead_, bytes, sizeof(bytes)) > 0) {}
+        }
+        takeFrame_();
+        if (descriptors[1].revents & POLLIN) acceptClients_();
+
+        //Clients accepted just now have no entry yet, and are handled next time round.
+        const size_t polled = descriptors.size() - 2;
+        for (size_t index = 0; index < clients_.size(); index++) {
+            Client& client = *clients_[index];
+            short events = (index < polled) ? descriptors[index + 2].revents : 0;
+            bool keep = true;
+            if (events & (POLLIN | POLLHUP | POLLERR)) keep = receive_(client);
+            if (keep && !client.isDrained()) keep = send_(client);
+            if (keep) queueFrame_(client);
+            if (!keep || client.socket < 0) {
+                if (client.socket >= 0) close(client.socket);
+                client.socket = -1;
+            }
+        }
+        auto gone = std::remove_if(clients_.begin(), clients_.end(), [](const std::unique_ptr<Client>& client) { return client->socket < 0; });
+        clients_.erase(gone, clients_.end());
+        int streaming = 0;
+        for (auto& client : clients_) streaming += (client->state == Client::State::Streaming) ? 1 : 0;
+        clientCount_.store(streaming, std::memory_order_relaxed);
+    }
+#endif
+}
+
+void FrameServer::takeFrame_()
+{
+    Snapshot frame;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!havePending_) return;
+        std::swap(frame, pending_);
+        havePending_ = false;
+    }
+    nextFrameTime_ = Clock::now() + std::chrono::microseconds(1000000 / std::max(maxFramesPerSecond, 1));
+
+    const uint64_t frameNumber = frameNumber_ + 1;
+    const int tilesDown = (frame.height + TILE_SIZE - 1) / TILE_SIZE;
+    const size_t tileCount = (size_t)frame.wordsPerRow * tilesDown;
+    bool changed = false;
+    if (frame.width != current_.width || frame.height != current_.height || frame.wordsPerRow != current_.wordsPerRow) {
+        //A new board: everyone starts again from a keyframe.
+        tilesAcross_ = frame.wordsPerRow;
+        tileFrames_.assign(tileCount, frameNumber);
+        encodedTiles_.assign(tileCount, std::vector<uint8_t>());
+        encodedFrames_.assign(tileCount, 0);
+        for (auto& client : clients_) client->needsKeyframe = true;
+        changed = true;
+    }
+    else {
+        for (int row = 0; row < frame.height; row++) {
+            const size_t rowStart = (size_t)row * frame.wordsPerRow;
+            uint64_t* tileFrames = &tileFrames_[(size_t)(row / TILE_SIZE) * tilesAcross_];
+            for (int word = 0; word < frame.wordsPerRow; word++) {
+                if (frame.words[rowStart + word] != current_.words[rowStart + word]) {
+                    tileFrames[word] = frameNumber;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    //The same board offered again, e.g. by a paused gui, isn't a new frame.
+    if (changed || frame.generation != current_.generation) {
+        std::swap(current_, frame);
+        frameNumber_ = frameNumber;
+        population_ = 0;
+        for (uint64_t word : current_.words) population_ += (uint64_t)std::popcount(word);
+        frameCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    //Handed back so the next publish reuses its memory.
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!havePending_) std::swap(pending_, frame);
+}
+
+void FrameServer::acceptClients_()
+{
+#if !defined(_WIN32)
+    while (true) {
+        int socketHandle = accept(listener_, nullptr, nullptr);
+        if (socketHandle < 0) return;
+        if ((int)clients_.size() >= maxClients || !setNonBlocking(socketHandle)) {
+            close(socketHandle);
+            continue;
+        }
+        int enabled = 1;
+        setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        auto client = std::make_unique<Client>();
+        client->socket = socketHandle;
+        clients_.push_back(std::move(client));
+    }
+#endif
+}
+
+bool FrameServer::receive_(Client& client)
+{
+#if !defined(_WIN32)
+    char buffer[4096];
+    while (true) {
+        ssize_t received = recv(client.socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received == 0) return false;
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        //A client that is being hung up on has nothing more worth reading.
+        if (client.state != Client::State::Closing) client.received.append(buffer, (size_t)received);
+    }
+    if (client.state == Client::State::Request) return handleRequest_(client);
+    if (client.state == Client::State::Streaming) return handleWebSocket_(client);
+    return true;
+#else
+    (void)client;
+    return false;
+#endif
+}
+
+bool FrameServer::handleRequest_(Client& client)
+{
+    size_t end = client.received.find("\r\n\r\n");
+    if (end == std::string::npos) return client.received.size() < MAX_REQUEST_BYTES;
+    std::string request = client.received.substr(0, end + 2);
+    client.received.erase(0, end + 4);
+
+    size_t lineEnd = request.find("\r\n");
+    std::string requestLine = request.substr(0, lineEnd);
+    std::string upgrade;
+    std::string key;
+    std::string origin;
+    bool hasOrigin = false;
+    for (size_t lineStart = lineEnd + 2; lineStart < request.size();) {
+        size_t next = request.find("\r\n", lineStart);
+        std::string line = request.substr(lineStart, next - lineStart);
+        lineStart = next + 2;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = toLower(trim(line.substr(0, colon)));
+        if (name == "upgrade") upgrade = toLower(trim(line.substr(colon + 1)));
+        else if (name == "sec-websocket-key") key = trim(line.substr(colon + 1));
+        else if (name == "origin") {
+            origin = toLower(trim(line.substr(colon + 1)));
+            hasOrigin = true;
+        }
+    }
+
+    size_t pathStart = requestLine.find(' ');
+    size_t pathEnd = requestLine.find(' ', pathStart + 1);
+    std::string method = requestLine.substr(0, pathStart);
+    std::string path = (pathStart == std::string::npos) ? std::string() : requestLine.substr(pathStart + 1, pathEnd - pathStart - 1);
+
+    std::string response;
+    const bool webSocket = method == "GET" && upgrade.find("websocket") != std::string::npos && !key.empty();
+    if (webSocket && hasOrigin && !isOwnOrigin_(client, origin)) {
+        const std::string body = "Forbidden origin\n";
+        response = "HTTP/1.1 403 Forbidden\r\n"
+            "Content-Type: text/plain; charset=utf-8\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Connection: close\r\n\r\n" + body;
+        client.state = Client::State::Closing;
+        client.received.clear();
+    }
+    else if (webSocket) {
+        response = "HTTP/1.1 101 Switching Protocols\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: " + getWebSocketAccept(key) + "\r\n\r\n";
+        client.state = Client::State::Streaming;
+        client.needsKeyframe = true;
+    }
+    else {
+        const bool page = method == "GET" && (path == "/" || path == "/index.html");
+        std::string body = page ? VIEWER_PAGE : "Not found\n";
+        response = std::string(page ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n")
+            + "Content-Type: " + (page ? "text/html" : "text/plain") + "; charset=utf-8\r\n"
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + "Cache-Control: no-store\r\n"
+            + "Connection: close\r\n\r\n" + body;
+        client.state = Client::State::Closing;
+        client.received.clear();
+    }
+    client.outbox.insert(client.outbox.end(), response.begin(), response.end());
+    if (!send_(client)) return false;
+    return (client.state == Client::State::Streaming) ? handleWebSocket_(client) : true;
+}
+
+bool FrameServer::isOwnOrigin_(const Client& client, const std::string& origin) const
+{
+    constexpr std::string_view scheme = "http://";
+    if (origin.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string hostAndPort = origin.substr(scheme.size());
+    //Browsers send the bare origin, but a trailing slash costs nothing to allow.
+    if (!hostAndPort.empty() && hostAndPort.back() == '/') hostAndPort.pop_back();
+
+    //IPv6 hosts come in brackets, so the port is after the last colon past them.
+    size_t colon = hostAndPort.rfind(':');
+    size_t bracket = hostAndPort.rfind(']');
+    if (colon != std::string::npos && bracket != std::string::npos && colon < bracket) colon = std::string::npos;
+    std::string host = hostAndPort.substr(0, colon);
+    std::string port = (colon == std::string::npos) ? "80" : hostAndPort.substr(colon + 1);
+    if (port != std::to_string(port_)) return false;
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    if (host == "localhost" || host == "127.0.0.1" || host == "::1") return true;
+    if (!bindAddress.empty() && host == toLower(bindAddress) && bindAddress != "0.0.0.0" && bindAddress != "::") return true;
+#if !defined(_WIN32)
+    //Bound to every address, the page was loaded from whichever one this connection came in on.
+    sockaddr_storage local{};
+    socklen_t localBytes = sizeof(local);
+    char localHost[NI_MAXHOST];
+    if (getsockname(client.socket, reinterpret_cast<sockaddr*>(&local), &localBytes) == 0
+        && getnameinfo(reinterpret_cast<sockaddr*>(&local), localBytes, localHost, sizeof(localHost), nullptr, 0, NI_NUMERICHOST) == 0) {
+        return host == toLower(localHost);
+    }
+#endif
+    return false;
+}
+
+bool FrameServer::handleWebSocket_(Client& client)
+{
+    std::string& received = client.received;
+    while (received.size() >= 2) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(received.data());
+        const uint8_t opcode = bytes[0] & 0x0f;
+        const bool finalFrame = (bytes[0] & 0x80) != 0;
+        const bool masked = (bytes[1] & 0x80) != 0;
+        uint64_t payloadBytes = bytes[1] & 0x7f;
+        size_t headerBytes = 2;
+        if (payloadBytes == 126) {
+            if (received.size() < 4) return true;
+            payloadBytes = (uint64_t)bytes[2] << 8 | bytes[3];
+            headerBytes = 4;
+        }
+        else if (payloadBytes == 127) {
+            if (received.size() < 10) return true;
+            payloadBytes = 0;
+            for (int byte = 0; byte < 8; byte++) payloadBytes = payloadBytes << 8 | bytes[2 + byte];
+            headerBytes = 10;
+        }
+        //Clients always mask what they send.
+        if (!masked || payloadBytes > MAX_CLIENT_FRAME_BYTES) return false;
+        if (received.size() < headerBytes + 4 + payloadBytes) return true;
+
+        const uint8_t* mask = bytes + headerBytes;
+        std::vector<uint8_t> payload(bytes + headerBytes + 4, bytes + headerBytes + 4 + payloadBytes);
+        for (size_t index = 0; index < payload.size(); index++) payload[index] ^= mask[index % 4];
+        received.erase(0, headerBytes + 4 + (size_t)payloadBytes);
+
+        if (opcode == 0x8) {
+            //Close: answer with the same status, then hang up.
+            putFrameHeader(client.outbox, 0x8, std::min<size_t>(payload.size(), 2));
+            client.outbox.insert(client.outbox.end(), payload.begin(), payload.begin() + std::min<size_t>(payload.size(), 2));
+            client.state = Client::State::Closing;
+            received.clear();
+            return send_(client);
+        }
+        if (opcode == 0x9) {
+            putFrameHeader(client.outbox, 0xa, payload.size());
+            client.outbox.insert(client.outbox.end(), payload.begin(), payload.end());
+        }
+        //The end of any other message answers a frame.
+        if (finalFrame && opcode <= 0x2) client.framesInFlight = std::max(client.framesInFlight - 1, 0);
+    }
+    return send_(client);
+}
+
+bool FrameServer::send_(Client& client)
+{
+#if !defined(_WIN32)
+    while (!client.isDrained()) {
+        ssize_t sent = send(client.socket, client.outbox.data() + client.sent, client.outbox.size() - client.sent, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        client.sent += (size_t)sent;
+        bytesSent_.fetch_add((uint64_t)sent, std::memory_order_relaxed);
+    }
+    client.outbox.clear();
+    client.sent = 0;
+    return client.state != Client::State::Closing;
+#else
+    (void)client;
+    return false;
+#endif
+}
+
+void FrameServer::queueFrame_(Client& client)
+{
+    //Only once the client has caught up, so a slow one gets the newest board and skips the rest.
+    if (!client.isReady() || frameNumber_ == 0) return;
+    if (!client.needsKeyframe && client.frame == frameNumber_) return;
+
+    const bool keyframe = client.needsKeyframe;
+    std::vector<uint8_t> message;
+    message.reserve(HEADER_BYTES + 1024);
+    message.push_back((uint8_t)(keyframe ? MessageType::Keyframe : MessageType::Delta));
+    message.push_back(VERSION);
+    putLittle(message, TILE_SIZE, 2);
+    putLittle(message, 0, 4);
+    putLittle(message, (uint64_t)current_.width, 4);
+    putLittle(message, (uint64_t)current_.height, 4);
+    putLittle(message, (uint64_t)current_.generation, 8);
+    putLittle(message, population_, 8);
+    uint32_t tileCount = 0;
+    for (size_t tile = 0; tile < tileFrames_.size(); tile++) {
+        if (!keyframe && tileFrames_[tile] <= client.frame) continue;
+        const std::vector<uint8_t>& encoded = getEncodedTile_(tile);
+        //A keyframe starts from a clear board.
+        if (keyframe && encoded[4] == (uint8_t)TileEncoding::Empty) continue;
+        message.insert(message.end(), encoded.begin(), encoded.end());
+        tileCount++;
+    }
+    for (int byte = 0; byte < 4; byte++) message[4 + byte] = (uint8_t)(tileCount >> (8 * byte));
+
+    client.outbox.clear();
+    client.sent = 0;
+    putFrameHeader(client.outbox, 0x2, message.size());
+    client.outbox.insert(client.outbox.end(), message.begin(), message.end());
+    client.needsKeyframe = false;
+    client.frame = frameNumber_;
+    client.framesInFlight++;
+    messageCount_.fetch_add(1, std::memory_order_relaxed);
+    if (!send_(client)) {
+#if !defined(_WIN32)
+        close(client.socket);
+#endif
+        client.socket = -1;
+    }
+}
+
+const std::vector<uint8_t>& FrameServer::getEncodedTile_(size_t tile)
+{
+    if (encodedFrames_[tile] < tileFrames_[tile]) {
+        encodeTile(current_.words.data(), current_.wordsPerRow, current_.width, current_.height, tile, encodedTiles_[tile]);
+        encodedFrames_[tile] = frameNumber_;
+    }
+    return encodedTiles_[tile];
+}
+
+void FrameServer::fail_(const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) error_ = error;
+}
+
+bool FrameServer::applyMessage(const uint8_t* message, size_t size, ClientBoard& board, std::string& error)
+{
+    if (size < HEADER_BYTES) {
+        error = "A message shorter than its header";
+        return false;
+    }
+    const uint8_t type = message[0];
+    const uint64_t tileSize = getLittle(message + 2, 2);
+    const uint64_t tileCount = getLittle(message + 4, 4);
+    const uint64_t width = getLittle(message + 8, 4);
+    const uint64_t height = getLittle(message + 12, 4);
+    if (message[1] != VERSION || tileSize != TILE_SIZE) {
+        error = "A message from a different version of the server";
+        return false;
+    }
+    if (type != (uint8_t)MessageType::Keyframe && type != (uint8_t)MessageType::Delta) {
+        error = "A message of unknown type " + std::to_string(type);
+        return false;
+    }
+    const uint64_t wordsPerRow = (width + TILE_SIZE - 1) / TILE_SIZE;
+    if (width == 0 || height == 0 || wordsPerRow * height > MAX_CLIENT_WORDS) {
+        error = "A message for a " + std::to_string(width) + "x" + std::to_string(height) + " board";
+        return false;
+    }
+    const bool keyframe = type == (uint8_t)MessageType::Keyframe;
+    if (!keyframe && (board.width != (int)width || board.height != (int)height)) {
+        error = "A delta for a different board than the one held";
+        return false;
+    }
+    const uint64_t tilesDown = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    //Checked whole before anything is applied, so a bad message leaves the board alone.
+    for (int pass = 0; pass < 2; pass++) {
+        const bool apply = pass == 1;
+        if (apply && keyframe) {
+            board.width = (int)width;
+            board.height = (int)height;
+            board.wordsPerRow = (int)wordsPerRow;
+            board.words.assign((size_t)(wordsPerRow * height), 0);
+        }
+        size_t offset = HEADER_BYTES;
+        for (uint64_t index = 0; index < tileCount; index++) {
+            if (size - offset < TILE_HEADER_BYTES) {
+                error = "A message cut off in its tiles";
+                return false;
+            }
+            const uint64_t tile = getLittle(message + offset, 4);
+            const uint8_t encoding = message[offset + 4];
+            const uint64_t payloadBytes = getLittle(message + offset + 5, 4);
+            offset += TILE_HEADER_BYTES;
+            if (tile >= wordsPerRow * tilesDown || payloadBytes > size - offset) {
+                error = "A message with a tile out of bounds";
+                return false;
+            }
+            const uint8_t* payload = message + offset;
+            offset += (size_t)payloadBytes;
+
+            const uint64_t tileX = tile % wordsPerRow;
+            const uint64_t rowBegin = tile / wordsPerRow * TILE_SIZE;
+            const int columns = (int)std::min<uint64_t>(TILE_SIZE, width - tileX * TILE_SIZE);
+            const int rows = (int)std::min<uint64_t>(TILE_SIZE, height - rowBegin);
+            uint64_t* first = apply ? board.words.data() + rowBegin * wordsPerRow + tileX : nullptr;
+            auto getRow = [&](int row) -> uint64_t& { return first[(size_t)row * wordsPerRow]; };
+
+            if (encoding == (uint8_t)TileEncoding::Empty || encoding == (uint8_t)TileEncoding::Packed) {
+                const bool packed = encoding == (uint8_t)TileEncoding::Packed;
+                if (payloadBytes != (packed ? (uint64_t)rows * sizeof(uint64_t) : 0)) {
+                    error = "A message with a tile of the wrong size";
+                    return false;
+                }
+                for (int row = 0; row < rows && apply; row++) getRow(row) = packed ? getLittle(payload + row * 8, 8) & getColumnMask(columns) : 0;
+            }
+            else if (encoding == (uint8_t)TileEncoding::Runs) {
+                const uint64_t cellCount = (uint64_t)rows * columns;
+                for (int row = 0; row < rows && apply; row++) getRow(row) = 0;
+                uint64_t cell = 0;
+                bool alive = false;
+                for (size_t at = 0; at < payloadBytes; alive = !alive) {
+                    uint64_t run = 0;
+                    int shift = 0;
+                    uint8_t byte = 0x80;
+                    while ((byte & 0x80) && at < payloadBytes && shift < 64) {
+                        byte = payload[at++];
+                        run |= (uint64_t)(byte & 0x7f) << shift;
+                        shift += 7;
+                    }
+                    if ((byte & 0x80) || run > cellCount - cell) {
+                        error = "A message with a tile whose runs don't fit it";
+                        return false;
+                    }
+                    for (uint64_t end = cell + run; alive && apply && cell < end;) {
+                        int row = (int)(cell / columns);
+                        int column = (int)(cell % columns);
+                        int span = (int)std::min<uint64_t>(end - cell, columns - column);
+                        getRow(row) |= getColumnMask(span) << column;
+                        cell += span;
+                    }
+                    cell += (alive && apply) ? 0 : run;
+                }
+                if (cell != cellCount) {
+                    error = "A message with a tile whose runs don't fit it";
+                    return false;
+                }
+            }
+            else {
+                error = "A message with a tile of unknown encoding " + std::to_string(encoding);
+                return false;
+            }
+        }
+    }
+    board.generation = (long long)getLittle(message + 16, 8);
+    board.population = getLittle(message + 24, 8);
+    return true;
+}
+
+std::string FrameServer::getWebSocketAccept(const std::string& key)
+{
+    std::array<uint8_t, 20> digest = sha1(key + WEBSOCKET_GUID);
+    return toBase64(digest.data(), digest.size());
+}
@@ -0,0 +1,177 @@
+#ifndef FRAME_SERVER_HPP
+#define FRAME_SERVER_HPP
+
+#include "GridEngine.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Streams the live board to browsers and other local clients over WebSocket, from a thread of its own.
+//A plain GET of / returns a small viewer page; a WebSocket upgrade on any path starts a stream.
+//Browsers let any page open a WebSocket to localhost, so an upgrade is only taken without an Origin, as
+//from a program, or with an http Origin naming this server: its port and loopback, bindAddress or the
+//address the connection came in on. Anything else is refused with 403.
+//Each client is sent a keyframe when it connects and after that deltas: only the TILE_SIZE x TILE_SIZE
+//tiles that changed since the last frame that client was sent, each packed as bits or as runs of dead and
+//live cells, whichever is smaller. A client answers each frame with a message of its own, any message, once
+//it has shown it, and is only sent a new frame with fewer than MAX_FRAMES_IN_FLIGHT unanswered, so a slow
+//client skips the generations in between and never holds up the others or the run.
+//The run only copies its board out when a client is ready for one, and at most maxFramesPerSecond times
+//a second, so publish() is a relaxed load and nothing else the rest of the time.
+//
+//Every message is one binary WebSocket message, little endian:
+//  header   u8 type, u8 version, u16 tile size, u32 tile count, u32 width, u32 height,
+//           i64 generation, u64 population
+//  tiles    u32 index (row of tiles * tiles across + column of tiles), u8 encoding, u32 payload bytes, payload
+//A keyframe clears the board first and lists only the tiles with live cells; a delta lists every tile
+//that changed, Empty ones included. A tile's cells are the ones on the board, so edge tiles are smaller.
+//Packed is a u64 per row of the tile, bit x for column x; Runs is LEB128 lengths in row order, alternating
+//dead and live and starting with dead. Sockets are POSIX; elsewhere start() fails with an error.
+class FrameServer
+{
+public:
+	enum class MessageType : uint8_t
+	{
+		Keyframe = 1,
+		Delta = 2
+	};
+
+	enum class TileEncoding : uint8_t
+	{
+		Empty = 0,
+		Packed = 1,
+		Runs = 2
+	};
+
+	constexpr static int DEFAULT_PORT = 8765;
+	constexpr static uint8_t VERSION = 1;
+	//One packed word across, so a tile's rows are whole words of the board.
+	constexpr static int TILE_SIZE = 64;
+	constexpr static size_t HEADER_BYTES = 32;
+	constexpr static size_t TILE_HEADER_BYTES = 9;
+	//Two, so the next frame is on its way while the client draws the last one.
+	constexpr static int MAX_FRAMES_IN_FLIGHT = 2;
+
+	//A board put together from messages, as a client keeps it. Laid out like GridEngine::getWords().
+	struct ClientBoard
+	{
+		int width = 0;
+		int height = 0;
+		int wordsPerRow = 0;
+		long long generation = 0;
+		//As the server counted it.
+		uint64_t population = 0;
+		std::vector<uint64_t> words;
+	};
+
+	//Read by the thread, so set these before start().
+	//Which address to listen on. Loopback by default; reach it from elsewhere through an SSH tunnel,
+	//or set "0.0.0.0" to serve everyone who can reach the port.
+	std::string bindAddress = "127.0.0.1";
+	int maxClients = 16;
+	int maxFramesPerSecond = 30;
+
+	FrameServer();
+	~FrameServer();
+
+	FrameServer(const FrameServer&) = delete;
+	FrameServer& operator=(const FrameServer&) = delete;
+
+	//Listens on port and starts the thread. Port 0 picks a free one; getPort() says which.
+	//Stops any server already running.
+	bool start(int port, std::string& error);
+	//Says goodbye to every client and stops the thread.
+	void stop();
+
+	//Offers the server the board after a step. Copies it only if a client is ready for a new frame.
+	//Only call it from one thread at a time.
+	void publish(const GridEngine& board, long long generation)
+	{
+		if (frameWanted_.load(std::memory_order_relaxed)) publish_(board, generation);
+	}
+
+	bool isServing() const { return serving_; }
+	int getPort() const { return port_; }
+	int getClientCount() const { return clientCount_.load(std::memory_order_relaxed); }
+	//Boards taken from the run, and messages and bytes sent to all the clients.
+	long long getFrameCount() const { return frameCount_.load(std::memory_order_relaxed); }
+	long long getMessageCount() const { return messageCount_.load(std::memory_order_relaxed); }
+	uint64_t getBytesSent() const { return bytesSent_.load(std::memory_order_relaxed); }
+	std::string getError() const;
+
+	//Applies one message to board. False, with board left as it was, if the message is malformed.
+	static bool applyMessage(const uint8_t* message, size_t size, ClientBoard& board, std::string& error);
+	//The Sec-WebSocket-Accept value for a Sec-WebSocket-Key.
+	static std::string getWebSocketAccept(const std::string& key);
+
+private:
+	struct Snapshot
+	{
+		int width = 0;
+		int height = 0;
+		int wordsPerRow = 0;
+		long long generation = 0;
+		std::vector<uint64_t> words;
+	};
+
+	struct Client;
+
+	void publish_(const GridEngine& board, long long generation);
+	void serveLoop_();
+	//Moves the run's latest board into current_ and marks the tiles that changed with a new frame number.
+	void takeFrame_();
+	void acceptClients_();
+	//False once the client should be dropped.
+	bool receive_(Client& client);
+	bool handleRequest_(Client& client);
+	bool handleWebSocket_(Client& client);
+	//origin is the request's Origin header, lower cased.
+	bool isOwnOrigin_(const Client& client, const std::string& origin) const;
+	bool send_(Client& client);
+	void queueFrame_(Client& client);
+	//The tile as it is in current_, header and all, encoded once per frame however many clients want it.
+	const std::vector<uint8_t>& getEncodedTile_(size_t tile);
+	void fail_(const std::string& error);
+
+	bool serving_ = false;
+	int port_ = 0;
+	std::thread worker_;
+	int listener_ = -1;
+	//The run writes a byte to wakeWrite_ to get the thread out of poll().
+	int wakeRead_ = -1;
+	int wakeWrite_ = -1;
+
+	std::atomic<bool> frameWanted_ = false;
+	std::atomic<bool> stopping_ = false;
+	std::atomic<int> clientCount_ = 0;
+	std::atomic<long long> frameCount_ = 0;
+	std::atomic<long long> messageCount_ = 0;
+	std::atomic<uint64_t> bytesSent_ = 0;
+
+	mutable std::mutex mutex_;
+	//Filled by publish_(), taken by the thread.
+	Snapshot pending_;
+	bool havePending_ = false;
+	std::string error_;
+
+	//The thread's side.
+	Snapshot current_;
+	//Which frame each tile last changed in, counting from 1; 0 before the first.
+	uint64_t frameNumber_ = 0;
+	int tilesAcross_ = 0;
+	std::vector<uint64_t> tileFrames_;
+	std::vector<std::vector<uint8_t>> encodedTiles_;
+	std::vector<uint64_t> encodedFrames_;
+	uint64_t population_ = 0;
+	std::chrono::steady_clock::time_point nextFrameTime_;
+	std::vector<std::unique_ptr<Client>> clients_;
+};
+
+#endif //FRAME_SERVER_HPP
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <SDL3/SDL_render.h>
 #include "GlRenderer.hpp"
@@ -149,47 +151,74 @@ GL_Renderer::GL_Renderer(SDL_Window * sdlWindow):
     }
 }
 
+GL_Renderer::~GL_Renderer()
+{
+    cleanup();
+    if (glContext)
+        SDL_GL_DestroyContext(glContext);
+}
+
+void
+GL_Renderer::makeCurrent()
+{
+    if (SDL_GL_GetCurrentContext() != glContext)
+        SDL_GL_MakeCurrent(window, glContext);
+}
+
 void
 GL_Renderer::gatherPoint(float x, float y, float zoomLevel)
 {
-    if (points.size() >= 4)
+    if (points.size() >= MaxPoints)
         return;
 
     points.emplace_back(x, y, zoomLevel);
+    pointsChanged = true;
 }
 
 void
 GL_Renderer::setMotionPoint(float x, float y, float zoomLevel)
 {
-    if (points.size() != 4)
+    if (points.size() != MaxPoints)
         return;
 
-    points.back() = {x, y, zoomLevel};
+    Point& last = points.back();
+    if (last.x == x && last.y == y && last.zoom == zoomLevel)
+        return;
+
+    last = {x, y, zoomLevel};
+    pointsChanged = true;
 }
 
 void
 GL_Renderer::setBlendFactor(GLenum srcColor, GLenum dstColor, GLenum srcAlpha, GLenum dstAlpha, GLenum equation, std::vector<float> constant)
 {
-    blendFactors[SrcColor] = srcColor;
-    blendFactors[DstColor] = dstColor;
-    blendFactors[SrcAlpha] = srcAlpha;
-    blendFactors[DstAlpha] = dstAlpha;
-    blendFactors[Equation] = equation;
+    std::array<GLenum, 5> factors{srcColor, dstColor, srcAlpha, dstAlpha, equation};
+    if (factors == blendFactors && constant == blendConstant)
+        return;
+
+    blendFactors = factors;
     blendConstant = constant;
+    blendChanged = true;
 }
 
 void
 GL_Renderer::clearPoint()
 {
+    if (points.empty())
+        return;
+
     points.clear();
+    pointsChanged = true;
 }
 
 void
 GL_Renderer::prepare()
 {
+    makeCurrent();
+
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1260, 720,
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, Width, Height,
                  0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -209,6 +238,27 @@ GL_Renderer::prepare()
 
     glEnable(GL_BLEND);
 
+    // Transparent so the cells drawn underneath show through the overlay
+    glClearColor(0.0, 0.188, 0.286, 0.0);
+    glViewport(0, 0, Width, Height);
+
+    // Room for every point gatherPoint() takes, filled in by drawToSDLTexture() when they change
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, MaxPoints * sizeof(Point), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Point), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+
+    for (Readback &readback : readbacks) {
+        glGenBuffers(1, &readback.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, Width * Height * sizeof(Uint16), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
     // Compile and link the shaders for drawing points
     drawPoint.shaders[Shader::Vertex] = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(drawPoint.shaders[0], 1, &vertexShaderSource, nullptr);
@@ -247,78 +297,170 @@ GL_Renderer::prepare()
     glDeleteShader(drawPoint.shaders[Shader::Fragment]);
     glDeleteShader(drawTriangle.shaders[Shader::Geometry]);
     glDeleteShader(drawTriangle.shaders[Shader::Fragment]);
+
+    // The viewport never changes and uniforms stay with their program, so set it once
+    GLfloat values[] = { Width, Height };
+    glUseProgram(drawTriangle.prog);
+    glUniform2fv(glGetUniformLocation(drawTriangle.prog, "viewport"), 1, values);
+    glUseProgram(drawPoint.prog);
+    glUniform2fv(glGetUniformLocation(drawPoint.prog, "viewport"), 1, values);
+    currentProgram = drawPoint.prog;
+
+    pointsChanged = true;
+    blendChanged = true;
 }
 
 void
 GL_Renderer::cleanup()
 {
+    if (!glContext)
+        return;
+
+    makeCurrent();
+    for (Readback &readback : readbacks) {
+        releaseReadback(readback);
+        glDeleteBuffers(1, &readback.pbo);
+        readback.pbo = 0;
+    }
+    newestReadback = -1;
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(1, &vbo);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
     glDeleteProgram(drawTriangle.prog);
     glDeleteProgram(drawPoint.prog);
+    vao = vbo = fbo = texture = 0;
+    drawTriangle.prog = drawPoint.prog = currentProgram = 0;
 }
 
-void
+bool
 GL_Renderer::drawToSDLTexture(SDL_Texture* sdlTexture)
 {
-    int pitch = 0;
-    Uint16* pixels;
     int pointNum = points.size();
 
-    // Create a vertex buffer object (VBO)
-    GLuint VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, pointNum * sizeof(Point), points.data(), GL_STATIC_DRAW);
-
-    // Create a vertex array object (VAO)
-    GLuint VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Point), (GLvoid*)0);
-    glEnableVertexAttribArray(0);
-
-    glBlendColor(blendConstant[0], blendConstant[1], blendConstant[2], blendConstant[3]);
-    glBlendFuncSeparate(blendFactors[SrcColor], blendFactors[DstColor],
-                        blendFactors[SrcAlpha], blendFactors[DstAlpha]);
-    glBlendEquation(blendFactors[Equation]);
+    makeCurrent();
+
+    if (pointsChanged || blendChanged) {
+        // Everything else was bound in prepare(); only send what moved since the last frame
+        if (pointsChanged) {
+            // Orphan the old storage so the driver never waits for a draw still reading it
+            glBufferData(GL_ARRAY_BUFFER, MaxPoints * sizeof(Point), nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, pointNum * sizeof(Point), points.data());
+            pointsChanged = false;
+        }
+
+        if (blendChanged) {
+            glBlendColor(blendConstant[0], blendConstant[1], blendConstant[2], blendConstant[3]);
+            glBlendFuncSeparate(blendFactors[SrcColor], blendFactors[DstColor],
+                                blendFactors[SrcAlpha], blendFactors[DstAlpha]);
+            glBlendEquation(blendFactors[Equation]);
+            blendChanged = false;
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Draw independent triangles only when there are proper number of points
+        if (pointNum == MaxPoints) {
+            useProgram(drawTriangle.prog);
+            glDrawArrays(GL_LINES_ADJACENCY, 0, pointNum);
+        }
+
+        // Always draw points
+        useProgram(drawPoint.prog);
+        glDrawArrays(GL_POINTS, 0, pointNum);
+
+        // With a pack buffer bound glReadPixels only queues the copy, and the fence says when it is done
+        newestReadback = (newestReadback + 1) % ReadbackSlots;
+        Readback &readback = readbacks[newestReadback];
+        releaseReadback(readback);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 
-    glClearColor(0.0, 0.188, 0.286, 1.0);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glViewport(0, 0, 1260, 720);
+    if (!sdlTextureCleared) {
+        float textureHeight = 0;
+        void *pixels = nullptr;
+        int pitch = 0;
+        SDL_GetTextureSize(sdlTexture, nullptr, &textureHeight);
+        if (SDL_LockTexture(sdlTexture, nullptr, &pixels, &pitch)) {
+            std::memset(pixels, 0, (size_t)pitch * (size_t)textureHeight);
+            SDL_UnlockTexture(sdlTexture);
+        }
+        sdlTextureCleared = true;
+    }
 
-    glClear(GL_COLOR_BUFFER_BIT);
+    if (newestReadback < 0)
+        return false;
 
-    GLfloat values[] = { 1260, 720 };
+    // Show the newest frame that has landed, never waiting for one that hasn't.
+    // The first look flushes, so the fence is sure to reach the GPU.
+    for (int age = 0; age < ReadbackSlots; age++) {
+        Readback &readback = readbacks[(newestReadback + ReadbackSlots - age) % ReadbackSlots];
+        if (!readback.fence)
+            continue;
 
-    // Render loop
-    glBindVertexArray(VAO);
+        GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            continue;
 
-    // Draw independent triangles only when there are proper number of points
-    if (pointNum == 4) {
-        glUseProgram(drawTriangle.prog);
-        GLuint viewport = glGetUniformLocation(drawTriangle.prog, "viewport");
-        glUniform2fv(viewport, 1, values);
+        if (status != GL_WAIT_FAILED)
+            copyToSDLTexture(sdlTexture, readback.pbo);
 
-        glDrawArrays(GL_LINES_ADJACENCY, 0, pointNum);
+        // Anything older than the frame just shown would only take it back
+        for (int older = age; older < ReadbackSlots; older++)
+            releaseReadback(readbacks[(newestReadback + ReadbackSlots - older) % ReadbackSlots]);
+        break;
     }
 
-    // Always draw points
-    glUseProgram(drawPoint.prog);
-    GLuint viewport = glGetUniformLocation(drawPoint.prog, "viewport");
-    glUniform2fv(viewport, 1, values);
-    glDrawArrays(GL_POINTS, 0, pointNum);
-
-    glBindVertexArray(0);
-    // We are rendering to texture and glGetTexImage later
-    // It is okay to omit glFlush at this point
-    // glFlush();
+    for (const Readback &readback : readbacks) {
+        if (readback.fence)
+            return true;
+    }
+    return false;
+}
 
-    // Clean up
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+void
+GL_Renderer::copyToSDLTexture(SDL_Texture* sdlTexture, GLuint pbo)
+{
+    float textureWidth = 0;
+    float textureHeight = 0;
+    SDL_GetTextureSize(sdlTexture, &textureWidth, &textureHeight);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+    auto *source = static_cast<const Uint8 *>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, Width * Height * sizeof(Uint16), GL_MAP_READ_BIT));
+    if (source) {
+        Uint8 *pixels = nullptr;
+        int pitch = 0;
+        if (SDL_LockTexture(sdlTexture, nullptr, (void **)&pixels, &pitch)) {
+            // Row by row, as the SDL texture has its own pitch and may be smaller than the overlay
+            int rows = std::min((int)textureHeight, Height);
+            size_t rowBytes = std::min((int)textureWidth, Width) * sizeof(Uint16);
+            for (int row = 0; row < rows; row++)
+                std::memcpy(pixels + (size_t)row * pitch, source + (size_t)row * Width * sizeof(Uint16), rowBytes);
+            SDL_UnlockTexture(sdlTexture);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
 
-    SDL_LockTexture(sdlTexture, nullptr, (void **)&pixels, &pitch);
+void
+GL_Renderer::releaseReadback(Readback &readback)
+{
+    if (readback.fence)
+        glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+}
 
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, pixels);
+void
+GL_Renderer::useProgram(GLuint program)
+{
+    if (program == currentProgram)
+        return;
 
-    SDL_UnlockTexture(sdlTexture);
+    glUseProgram(program);
+    currentProgram = program;
 }
@@ -10,10 +10,16 @@ struct SDL_Texture;
 class GL_Renderer {
 public:
     GL_Renderer(SDL_Window *sdlWindow);
+    ~GL_Renderer();
+
+    GL_Renderer(const GL_Renderer&) = delete;
+    GL_Renderer& operator=(const GL_Renderer&) = delete;
 
     void prepare();
     void cleanup();
-    void drawToSDLTexture(SDL_Texture *sdlTexture);
+    // Renders if anything changed and shows the newest frame the GPU has finished, one frame behind.
+    // Returns true while a frame is still on its way, so call again on a later frame to pick it up.
+    bool drawToSDLTexture(SDL_Texture *sdlTexture);
     void gatherPoint(float x, float y, float zoomLevel);
     void setMotionPoint(float x, float y, float zoomLevel);
     void setBlendFactor(GLenum srcColor, GLenum dstColor, GLenum srcAlpha, GLenum dstAlpha, GLenum equation, std::vector<float> constant);
@@ -40,12 +46,31 @@ public:
     };
 
     struct Program {
-        GLuint prog;
+        GLuint prog{0};
         // Note that always push back in order of vs, tcs, tes, gs, fs
-        std::array<GLuint, 3> shaders;
+        std::array<GLuint, 3> shaders{};
     };
 
 private:
+    // gatherPoint() stops at four, the corners the triangles are drawn from
+    static constexpr int MaxPoints = 4;
+    static constexpr int Width = 1260;
+    static constexpr int Height = 720;
+    // Two, so the GPU can fill one while the other is copied out
+    static constexpr int ReadbackSlots = 2;
+
+    // A pixel pack buffer the frame is read into, and the fence that says when it is there
+    struct Readback {
+        GLuint pbo{0};
+        GLsync fence{nullptr};
+    };
+
+    // The objects below live in glContext, which SDL's own renderer may have swapped out
+    void makeCurrent();
+    void useProgram(GLuint program);
+    void copyToSDLTexture(SDL_Texture *sdlTexture, GLuint pbo);
+    void releaseReadback(Readback &readback);
+
     SDL_GLContext glContext = nullptr;
     SDL_Window *window = nullptr;
     GLuint texture{0};
@@ -53,7 +78,19 @@ private:
     Program drawPoint;
     Program drawTriangle;
 
-    std::array<GLenum, 5> blendFactors;
+    // Created once in prepare() and kept bound, so a frame only touches what changed
+    GLuint vbo{0};
+    GLuint vao{0};
+    GLuint currentProgram{0};
+    bool pointsChanged{true};
+    bool blendChanged{true};
+
+    std::array<Readback, ReadbackSlots> readbacks{};
+    int newestReadback{-1};
+    // The SDL texture starts out undefined, so it is cleared before the first frame lands
+    bool sdlTextureCleared{false};
+
+    std::array<GLenum, 5> blendFactors{GL_ONE, GL_ZERO, GL_ONE, GL_ZERO, GL_FUNC_ADD};
     std::vector<GLfloat> blendConstant{0.0, 0.0, 0.0, 1.0};
     std::vector<Point> points;
 };
@@ -0,0 +1,59 @@
+#include "GridAllocator.hpp"
+
+#include <atomic>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<bool> hugePageAdvised = false;
+
+    size_t roundUpToHugePage(size_t bytes)
+    {
+        return (bytes + GridMemory::HUGE_PAGE_BYTES - 1) / GridMemory::HUGE_PAGE_BYTES * GridMemory::HUGE_PAGE_BYTES;
+    }
+}
+
+void* GridMemory::allocate(size_t bytes)
+{
+    if (bytes < HUGE_PAGE_BYTES) return ::operator new(bytes);
+
+    //Rounded up so the last huge page isn't shared with anything else.
+    size_t rounded = roundUpToHugePage(bytes);
+    void* pointer = nullptr;
+#if defined(_WIN32)
+    pointer = _aligned_malloc(rounded, HUGE_PAGE_BYTES);
+#else
+    if (posix_memalign(&pointer, HUGE_PAGE_BYTES, rounded) != 0) pointer = nullptr;
+#endif
+    if (!pointer) throw std::bad_alloc();
+
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    hugePageAdvised = (madvise(pointer, rounded, MADV_HUGEPAGE) == 0);
+#endif
+    return pointer;
+}
+
+void GridMemory::deallocate(void* pointer, size_t bytes)
+{
+    if (!pointer) return;
+    if (bytes < HUGE_PAGE_BYTES) {
+        ::operator delete(pointer);
+        return;
+    }
+#if defined(_WIN32)
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+bool GridMemory::isHugePageAdvised()
+{
+    return hugePageAdvised;
+}
@@ -0,0 +1,47 @@
+#ifndef GRID_ALLOCATOR_HPP
+#define GRID_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//Raw memory for big boards. Blocks of a huge page or more are aligned to HUGE_PAGE_BYTES and, on Linux,
+//marked with madvise(MADV_HUGEPAGE) so the kernel backs them with 2 MiB pages and a board needs far fewer
+//TLB entries. Smaller blocks come from plain operator new.
+namespace GridMemory
+{
+	constexpr size_t HUGE_PAGE_BYTES = (size_t)2 << 20;
+
+	void* allocate(size_t bytes);
+	void deallocate(void* pointer, size_t bytes);
+	//Whether the last large block was accepted for huge pages. Informational; the kernel may still decline.
+	bool isHugePageAdvised();
+}
+
+//Standard allocator over GridMemory. Elements are default initialized rather than zeroed, so a vector
+//resized with it leaves its pages untouched; the owner then writes each band from the thread that will
+//step it, and on NUMA machines the first touch puts those pages on that thread's node.
+template <typename T>
+class GridAllocator
+{
+public:
+	using value_type = T;
+
+	GridAllocator() = default;
+	template <typename U>
+	GridAllocator(const GridAllocator<U>&) {}
+
+	T* allocate(size_t count) { return static_cast<T*>(GridMemory::allocate(count * sizeof(T))); }
+	void deallocate(T* pointer, size_t count) { GridMemory::deallocate(pointer, count * sizeof(T)); }
+
+	template <typename U>
+	void construct(U* pointer) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new (static_cast<void*>(pointer)) U; }
+	template <typename U, typename... Args>
+	void construct(U* pointer, Args&&... args) { ::new (static_cast<void*>(pointer)) U(std::forward<Args>(args)...); }
+
+	template <typename U>
+	bool operator==(const GridAllocator<U>&) const { return true; }
+};
+
+#endif //GRID_ALLOCATOR_HPP
@@ -0,0 +1,616 @@
+#include "GridEngine.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GOL_X86_KERNELS 1
+#define GOL_TARGET(isa) __attribute__((target(isa)))
+#else
+#define GOL_X86_KERNELS 0
+#endif
+
+#if defined(_MSC_VER)
+#define GOL_ALWAYS_INLINE __forceinline
+#else
+#define GOL_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace
+{
+    //Everything the kernel needs for one row.
+    struct RowContext
+    {
+        const uint64_t* above;
+        const uint64_t* row;
+        const uint64_t* below;
+        uint64_t* next;
+        int wordCount;
+        int lastBit;
+        uint64_t lastWordMask;
+        //Per neighbor count, all ones if the rule births or keeps a cell with that many neighbors.
+        const uint64_t* bornMask;
+        const uint64_t* surviveMask;
+    };
+
+    //Word i of a row plus its west and east neighbor planes: bit k of west is the cell at column k-1.
+    //Rows wrap, and the last word may be partial, so the first and last words take this slow path.
+    GOL_ALWAYS_INLINE void loadEdgeNeighborhood(
+        const uint64_t* row, int i, int wordCount, int lastBit,
+        uint64_t& west, uint64_t& center, uint64_t& east)
+    {
+        center = row[i];
+        if (i > 0) west = (center << 1) | (row[i - 1] >> 63);
+        else west = (center << 1) | ((row[wordCount - 1] >> lastBit) & 1);
+
+        if (i < wordCount - 1) east = (center >> 1) | (row[i + 1] << 63);
+        else east = (center >> 1) | ((row[0] & 1) << lastBit);
+    }
+
+    //Three one-bit inputs to a sum bit and a carry bit, 64 lanes at a time.
+    GOL_ALWAYS_INLINE void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry)
+    {
+        uint64_t partial = a ^ b;
+        sum = partial ^ c;
+        carry = (a & b) | (c & partial);
+    }
+
+    template <bool ConwayRule>
+    GOL_ALWAYS_INLINE uint64_t nextWord(
+        uint64_t aboveWest, uint64_t aboveCenter, uint64_t aboveEast,
+        uint64_t west, uint64_t center, uint64_t east,
+        uint64_t belowWest, uint64_t belowCenter, uint64_t belowEast,
+        const RowContext& context)
+    {
+        //Add up the 8 neighbor planes into a 4 bit count per lane: ones, twos, fours, eights.
+        uint64_t aboveSum, aboveCarry, belowSum, belowCarry;
+        fullAdd(aboveWest, aboveCenter, aboveEast, aboveSum, aboveCarry);
+        fullAdd(belowWest, belowCenter, belowEast, belowSum, belowCarry);
+        uint64_t middleSum = west ^ east;
+        uint64_t middleCarry = west & east;
+
+        uint64_t ones, onesCarry;
+        fullAdd(aboveSum, middleSum, belowSum, ones, onesCarry);
+        uint64_t twosPartial, twosCarry;
+        fullAdd(aboveCarry, middleCarry, belowCarry, twosPartial, twosCarry);
+        uint64_t twos = twosPartial ^ onesCarry;
+        uint64_t foursCarry = twosPartial & onesCarry;
+        uint64_t fours = twosCarry ^ foursCarry;
+        uint64_t eights = twosCarry & foursCarry;
+
+        if constexpr (ConwayRule) {
+            //Exactly 3, or exactly 2 and already alive.
+            return ~eights & ~fours & twos & (ones | center);
+        }
+        else {
+            //No branches, so the loop stays vectorizable.
+            uint64_t next = 0;
+            for (int neighbors = 0; neighbors <= 8; neighbors++) {
+                uint64_t keep = (center & context.surviveMask[neighbors]) | (~center & context.bornMask[neighbors]);
+                uint64_t equal =
+                    ((neighbors & 1) ? ones : ~ones) &
+                    ((neighbors & 2) ? twos : ~twos) &
+                    ((neighbors & 4) ? fours : ~fours) &
+                    ((neighbors & 8) ? eights : ~eights);
+                next |= equal & keep;
+            }
+            return next;
+        }
+    }
+
+    template <bool ConwayRule>
+    GOL_ALWAYS_INLINE void stepEdgeWord(const RowContext& context, int i)
+    {
+        uint64_t aboveWest, aboveCenter, aboveEast;
+        uint64_t west, center, east;
+        uint64_t belowWest, belowCenter, belowEast;
+        loadEdgeNeighborhood(context.above, i, context.wordCount, context.lastBit, aboveWest, aboveCenter, aboveEast);
+        loadEdgeNeighborhood(context.row, i, context.wordCount, context.lastBit, west, center, east);
+        loadEdgeNeighborhood(context.below, i, context.wordCount, context.lastBit, belowWest, belowCenter, belowEast);
+
+        uint64_t next = nextWord<ConwayRule>(
+            aboveWest, aboveCenter, aboveEast, west, center, east, belowWest, belowCenter, belowEast, context);
+        //Keep the bits past the width clear, B0 style rules would otherwise fill them.
+        if (i == context.wordCount - 1) next &= context.lastWordMask;
+        context.next[i] = next;
+    }
+
+    //Words [wordBegin, wordEnd) of one row. Interior words read their neighbors directly with no branches.
+    template <bool ConwayRule>
+    GOL_ALWAYS_INLINE void stepWords(const RowContext& context, int wordBegin, int wordEnd)
+    {
+        if (wordBegin == 0) {
+            stepEdgeWord<ConwayRule>(context, 0);
+            wordBegin = 1;
+        }
+        if (wordEnd == context.wordCount && wordEnd > wordBegin) {
+            stepEdgeWord<ConwayRule>(context, wordEnd - 1);
+            wordEnd--;
+        }
+
+        const uint64_t* above = context.above;
+        const uint64_t* row = context.row;
+        const uint64_t* below = context.below;
+        uint64_t* next = context.next;
+        for (int i = wordBegin; i < wordEnd; i++) {
+            next[i] = nextWord<ConwayRule>(
+                (above[i] << 1) | (above[i - 1] >> 63), above[i], (above[i] >> 1) | (above[i + 1] << 63),
+                (row[i] << 1) | (row[i - 1] >> 63), row[i], (row[i] >> 1) | (row[i + 1] << 63),
+                (below[i] << 1) | (below[i - 1] >> 63), below[i], (below[i] >> 1) | (below[i + 1] << 63),
+                context);
+        }
+    }
+
+    //Hash contribution of one word. Zero words still count, so a word's contribution can be swapped
+    //out by XORing the old and new values without special cases.
+    inline uint64_t hashWord(size_t index, uint64_t word)
+    {
+        //One multiply is plenty; a collision only costs a wasted check, never a wrong playback.
+        uint64_t mixed = (word ^ (index * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+        return mixed ^ (mixed >> 29);
+    }
+
+    //Adds one row tile of the new generation to the band's stats. The rows are still in cache from the kernel.
+    GOL_ALWAYS_INLINE void addRowStats(const uint64_t* before, const uint64_t* after, int wordBegin, int wordEnd, int row, GridEngine::Stats& stats)
+    {
+        //Kept in locals: stats could alias the rows as far as the compiler knows, and would be stored every word.
+        uint64_t population = 0;
+        uint64_t births = 0;
+        uint64_t deaths = 0;
+        uint64_t changedWords = 0;
+        for (int i = wordBegin; i < wordEnd; i++) {
+            population += std::popcount(after[i]);
+            births += std::popcount(after[i] & ~before[i]);
+            deaths += std::popcount(before[i] & ~after[i]);
+            changedWords += (after[i] != before[i]);
+        }
+        stats.population += population;
+        stats.births += births;
+        stats.deaths += deaths;
+        stats.changedWords += changedWords;
+        if (population == 0) return;
+
+        int firstWord = wordBegin;
+        while (after[firstWord] == 0) firstWord++;
+        int lastWord = wordEnd - 1;
+        while (after[lastWord] == 0) lastWord--;
+
+        GridEngine::Stats rowBounds;
+        rowBounds.left = firstWord * GridEngine::BITS_PER_WORD + std::countr_zero(after[firstWord]);
+        rowBounds.right = lastWord * GridEngine::BITS_PER_WORD + GridEngine::BITS_PER_WORD - 1 - std::countl_zero(after[lastWord]);
+        rowBounds.top = row;
+        rowBounds.bottom = row;
+        stats.merge(rowBounds);
+    }
+
+    using RowStats = void (*)(const uint64_t*, const uint64_t*, int, int, int, GridEngine::Stats&);
+
+    void addRowStatsGeneric(const uint64_t* before, const uint64_t* after, int wordBegin, int wordEnd, int row, GridEngine::Stats& stats)
+    {
+        addRowStats(before, after, wordBegin, wordEnd, row, stats);
+    }
+
+#if GOL_X86_KERNELS
+    //popcnt isn't in baseline x86-64, so without it each std::popcount is a library call and the stats
+    //cost several times what the kernel does. Every CPU with AVX2 has it, and most without.
+    GOL_TARGET("popcnt") void addRowStatsPopcnt(const uint64_t* before, const uint64_t* after, int wordBegin, int wordEnd, int row, GridEngine::Stats& stats)
+    {
+        addRowStats(before, after, wordBegin, wordEnd, row, stats);
+    }
+#endif
+
+    RowStats getRowStats()
+    {
+#if GOL_X86_KERNELS
+        static const RowStats rowStats = __builtin_cpu_supports("popcnt") ? addRowStatsPopcnt : addRowStatsGeneric;
+        return rowStats;
+#else
+        return addRowStatsGeneric;
+#endif
+    }
+
+    using WordKernel = void (*)(const RowContext&, int, int);
+
+    template <bool ConwayRule>
+    void stepWordsGeneric(const RowContext& context, int wordBegin, int wordEnd)
+    {
+        stepWords<ConwayRule>(context, wordBegin, wordEnd);
+    }
+
+#if GOL_X86_KERNELS
+    template <bool ConwayRule>
+    GOL_TARGET("avx2") void stepWordsAvx2(const RowContext& context, int wordBegin, int wordEnd)
+    {
+        stepWords<ConwayRule>(context, wordBegin, wordEnd);
+    }
+
+    template <bool ConwayRule>
+    GOL_TARGET("avx512f") void stepWordsAvx512(const RowContext& context, int wordBegin, int wordEnd)
+    {
+        stepWords<ConwayRule>(context, wordBegin, wordEnd);
+    }
+#endif
+
+    WordKernel getWordKernel(GridEngine::Isa isa, bool conwayRule)
+    {
+        switch (isa)
+        {
+#if GOL_X86_KERNELS
+            case GridEngine::Isa::Avx2: return conwayRule ? stepWordsAvx2<true> : stepWordsAvx2<false>;
+            case GridEngine::Isa::Avx512: return conwayRule ? stepWordsAvx512<true> : stepWordsAvx512<false>;
+#endif
+            default: return conwayRule ? stepWordsGeneric<true> : stepWordsGeneric<false>;
+        }
+    }
+}
+
+bool GridEngine::isIsaSupported(Isa isa)
+{
+    switch (isa)
+    {
+        case Isa::Generic: return true;
+#if GOL_X86_KERNELS
+        case Isa::Avx2: return __builtin_cpu_supports("avx2");
+        case Isa::Avx512: return __builtin_cpu_supports("avx512f");
+#endif
+        default: return false;
+    }
+}
+
+void GridEngine::setThreadCount(int threadCount)
+{
+    int bandRows = getBandRows_();
+    workers_.resize(threadCount);
+    kernelConfig_.threadCount = workers_.size();
+    if (getBandRows_() != bandRows) placeBuffers_(true);
+}
+
+void GridEngine::setKernelConfig(const KernelConfig& config)
+{
+    int bandRows = getBandRows_();
+    kernelConfig_ = config;
+    kernelConfig_.bandRows = std::max(kernelConfig_.bandRows, 0);
+    kernelConfig_.tileWords = std::max(kernelConfig_.tileWords, 0);
+    if (!isIsaSupported(kernelConfig_.isa)) kernelConfig_.isa = Isa::Generic;
+    workers_.resize(config.threadCount);
+    kernelConfig_.threadCount = workers_.size();
+    if (getBandRows_() != bandRows) placeBuffers_(true);
+}
+
+bool GridEngine::setAffinity(const std::vector<int>& cpus)
+{
+    if (cpus == workers_.getAffinity()) return true;
+    if (!workers_.setAffinity(cpus)) return false;
+    placeBuffers_(true);
+    return true;
+}
+
+int GridEngine::getBandRows_() const
+{
+    //By default a few bands per thread, so an uneven band doesn't leave the others waiting.
+    return (kernelConfig_.bandRows > 0)
+        ? kernelConfig_.bandRows
+        : std::max(1, height_ / (workers_.size() * 4));
+}
+
+void GridEngine::placeBuffers_(bool keepCells)
+{
+    //Fresh pages, first written by the thread that steps each band, so each band's memory lands on the
+    //NUMA node that thread runs on. The same static schedule is used to step.
+    const size_t wordCount = (size_t)wordsPerRow_ * height_;
+    if (wordCount == 0) return;
+    Words cells(wordCount);
+    Words nextCells(wordCount);
+
+    const int bandRows = getBandRows_();
+    const int bandCount = (height_ + bandRows - 1) / bandRows;
+    workers_.run(bandCount, [&](int band) {
+        size_t begin = (size_t)band * bandRows * wordsPerRow_;
+        size_t end = std::min(begin + (size_t)bandRows * wordsPerRow_, wordCount);
+        if (keepCells) std::copy(cells_.begin() + begin, cells_.begin() + end, cells.begin() + begin);
+        else std::fill(cells.begin() + begin, cells.begin() + end, 0);
+        std::fill(nextCells.begin() + begin, nextCells.begin() + end, 0);
+    }, WorkerPool::Schedule::Static);
+
+    cells_.swap(cells);
+    nextCells_.swap(nextCells);
+}
+
+void GridEngine::resize(int width, int height)
+{
+    width_ = std::max(width, 1);
+    height_ = std::max(height, 1);
+    wordsPerRow_ = (width_ + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    lastBit_ = (width_ - 1) % BITS_PER_WORD;
+    lastWordMask_ = (lastBit_ == BITS_PER_WORD - 1) ? ~0ull : ((1ull << (lastBit_ + 1)) - 1);
+
+    placeBuffers_(false);
+    generation_ = 0;
+    invalidateBoard_();
+}
+
+void GridEngine::clear()
+{
+    std::fill(cells_.begin(), cells_.end(), 0);
+    generation_ = 0;
+    invalidateBoard_();
+}
+
+bool GridEngine::getCell(int row, int column) const
+{
+    return (getRow(row)[column / BITS_PER_WORD] >> (column % BITS_PER_WORD)) & 1;
+}
+
+void GridEngine::setCell(int row, int column, bool alive)
+{
+    size_t index = (size_t)row * wordsPerRow_ + column / BITS_PER_WORD;
+    uint64_t& word = cells_[index];
+    uint64_t bit = 1ull << (column % BITS_PER_WORD);
+    uint64_t changed = alive ? (word | bit) : (word & ~bit);
+    if (changed == word) return;
+    if (hashValid_) hash_ ^= hashWord(index, word) ^ hashWord(index, changed);
+    word = changed;
+
+    if (!statsValid_) return;
+    stats_.births = 0;
+    stats_.deaths = 0;
+    stats_.changedWords = 0;
+    if (alive) {
+        stats_.population++;
+        GridEngine::Stats cell;
+        cell.left = cell.right = column;
+        cell.top = cell.bottom = row;
+        stats_.merge(cell);
+    }
+    else {
+        stats_.population--;
+        //A cell off the edge of the box can't shrink it; one on the edge might, so count again later.
+        if (column == stats_.left || column == stats_.right || row == stats_.top || row == stats_.bottom) invalidateStats_();
+    }
+}
+
+void GridEngine::loadCells(const std::vector<uint8_t>& aliveFlags)
+{
+    clear();
+    if (aliveFlags.size() < (size_t)width_ * height_) return;
+
+    for (int row = 0; row < height_; row++) {
+        const uint8_t* flags = &aliveFlags[(size_t)row * width_];
+        uint64_t* words = &cells_[(size_t)row * wordsPerRow_];
+        for (int column = 0; column < width_; column++) {
+            if (flags[column]) words[column / BITS_PER_WORD] |= 1ull << (column % BITS_PER_WORD);
+        }
+    }
+}
+
+void GridEngine::loadPattern(const PackedPattern& pattern, int row, int column)
+{
+    clear();
+    if (width_ == 0 || height_ == 0 || pattern.isEmpty()) return;
+
+    bool fits = column >= 0 && column + pattern.width <= width_;
+    int firstWord = column / BITS_PER_WORD;
+    int shift = column % BITS_PER_WORD;
+    for (int patternRow = 0; patternRow < pattern.height; patternRow++) {
+        int boardRow = ((row + patternRow) % height_ + height_) % height_;
+        uint64_t* words = &cells_[(size_t)boardRow * wordsPerRow_];
+        const uint64_t* source = pattern.getRow(patternRow);
+        if (fits) {
+            //Bits shifted past the last word would be past the pattern's width, so there are none.
+            for (int word = 0; word < pattern.wordsPerRow; word++) {
+                words[firstWord + word] |= source[word] << shift;
+                if (shift > 0 && firstWord + word + 1 < wordsPerRow_) words[firstWord + word + 1] |= source[word] >> (BITS_PER_WORD - shift);
+            }
+            continue;
+        }
+        for (int patternColumn = 0; patternColumn < pattern.width; patternColumn++) {
+            if (!pattern.getCell(patternRow, patternColumn)) continue;
+            int boardColumn = ((column + patternColumn) % width_ + width_) % width_;
+            words[boardColumn / BITS_PER_WORD] |= 1ull << (boardColumn % BITS_PER_WORD);
+        }
+    }
+    invalidateBoard_();
+}
+
+void GridEngine::copyCellsFrom(const GridEngine& board)
+{
+    if (board.width_ != width_ || board.height_ != height_) resize(board.width_, board.height_);
+    cells_ = board.cells_;
+    generation_ = board.generation_;
+    invalidateBoard_();
+}
+
+void GridEngine::setWords(const Words& words, const Stats* stats)
+{
+    if (words.size() != cells_.size()) return;
+    cells_ = words;
+    invalidateBoard_();
+    if (stats) {
+        stats_ = *stats;
+        statsValid_ = true;
+    }
+}
+
+void GridEngine::setHashTracking(bool enabled)
+{
+    hashTracking_ = enabled;
+    if (!enabled) invalidateHash_();
+}
+
+void GridEngine::setChangeTracking(bool enabled)
+{
+    changeTracking_ = enabled;
+    if (!enabled) bandChanges_.clear();
+}
+
+uint64_t GridEngine::getHash()
+{
+    if (!hashValid_) {
+        hash_ = 0;
+        for (size_t index = 0; index < cells_.size(); index++) hash_ ^= hashWord(index, cells_[index]);
+        hashValid_ = true;
+    }
+    return hash_;
+}
+
+void GridEngine::Stats::merge(const Stats& stats)
+{
+    population += stats.population;
+    births += stats.births;
+    deaths += stats.deaths;
+    changedWords += stats.changedWords;
+    if (stats.isEmpty()) return;
+    if (isEmpty()) {
+        left = stats.left;
+        top = stats.top;
+        right = stats.right;
+        bottom = stats.bottom;
+        return;
+    }
+    left = std::min(left, stats.left);
+    top = std::min(top, stats.top);
+    right = std::max(right, stats.right);
+    bottom = std::max(bottom, stats.bottom);
+}
+
+const GridEngine::Stats& GridEngine::getStats() const
+{
+    if (!statsValid_) {
+        //Only after edits or loads; stepping keeps the stats current. Comparing the board with itself
+        //gives the population and box with no births or deaths.
+        stats_ = countStats(cells_, cells_);
+        statsValid_ = true;
+    }
+    return stats_;
+}
+
+GridEngine::Stats GridEngine::countStats(const Words& before, const Words& after) const
+{
+    Stats stats;
+    if (before.size() != cells_.size() || after.size() != cells_.size()) return stats;
+    const RowStats rowStats = getRowStats();
+    for (int row = 0; row < height_; row++) {
+        size_t rowStart = (size_t)row * wordsPerRow_;
+        rowStats(&before[rowStart], &after[rowStart], 0, wordsPerRow_, row, stats);
+    }
+    return stats;
+}
+
+void GridEngine::step(int generations, bool updateStats)
+{
+    if (cells_.empty() || generations < 1) return;
+
+    const int bandRows = getBandRows_();
+    const int bandCount = (height_ + bandRows - 1) / bandRows;
+    const bool conwayRule = (rule_ == LifeRule());
+    //Stats are only wanted for the generation left on the board, so earlier ones skip the extra work.
+    bool lastGeneration = false;
+    bandStats_.assign(bandCount, Stats());
+    //Each generation's lists replace the last; the vectors keep their capacity between steps.
+    bandChanges_.resize(changeTracking_ ? bandCount : 0);
+    const std::function<void(int)> stepBand = [this, bandRows, conwayRule, &lastGeneration](int band) {
+        int rowBegin = band * bandRows;
+        std::vector<WordChange>* changes = changeTracking_ ? &bandChanges_[band] : nullptr;
+        if (changes) changes->clear();
+        stepBand_(rowBegin, std::min(rowBegin + bandRows, height_), conwayRule, lastGeneration ? &bandStats_[band] : nullptr, changes);
+    };
+
+    if (hashTracking_) getHash();
+    else invalidateHash_();
+
+    for (int generation = 0; generation < generations; generation++) {
+        lastGeneration = updateStats && (generation == generations - 1);
+        workers_.run(bandCount, stepBand, WorkerPool::Schedule::Static);
+        cells_.swap(nextCells_);
+        generation_++;
+        if (hashTracking_) hash_ ^= hashDelta_.exchange(0, std::memory_order_relaxed);
+    }
+
+    if (!updateStats) {
+        invalidateStats_();
+        return;
+    }
+    stats_ = Stats();
+    for (const Stats& band : bandStats_) stats_.merge(band);
+    statsValid_ = true;
+}
+
+void GridEngine::stepRows(int rowBegin, int rowEnd)
+{
+    rowBegin = std::max(rowBegin, 0);
+    rowEnd = std::min(rowEnd, height_);
+    if (rowBegin >= rowEnd) return;
+
+    //Same bands and threads as step(), clipped to the rows asked for.
+    const int bandRows = getBandRows_();
+    const int bandCount = (height_ + bandRows - 1) / bandRows;
+    const bool conwayRule = (rule_ == LifeRule());
+    workers_.run(bandCount, [&](int band) {
+        int begin = std::max(band * bandRows, rowBegin);
+        int end = std::min(band * bandRows + bandRows, rowEnd);
+        if (begin < end) stepBand_(begin, end, conwayRule, nullptr, nullptr);
+    }, WorkerPool::Schedule::Static);
+}
+
+void GridEngine::finishStep()
+{
+    cells_.swap(nextCells_);
+    generation_++;
+    hashDelta_ = 0;
+    bandChanges_.clear();
+    invalidateBoard_();
+}
+
+void GridEngine::setRows(int row, int rowCount, const uint64_t* words)
+{
+    if (row < 0 || rowCount <= 0 || row + rowCount > height_) return;
+    std::copy(words, words + (size_t)rowCount * wordsPerRow_, cells_.begin() + (size_t)row * wordsPerRow_);
+    invalidateBoard_();
+}
+
+void GridEngine::stepBand_(int rowBegin, int rowEnd, bool conwayRule, Stats* stats, std::vector<WordChange>* changes)
+{
+    uint64_t bornMask[9];
+    uint64_t surviveMask[9];
+    for (int neighbors = 0; neighbors <= 8; neighbors++) {
+        bornMask[neighbors] = rule_.isBorn(neighbors) ? ~0ull : 0;
+        surviveMask[neighbors] = rule_.survives(neighbors) ? ~0ull : 0;
+    }
+
+    const WordKernel kernel = getWordKernel(kernelConfig_.isa, conwayRule);
+    const RowStats rowStats = getRowStats();
+    const int tileWords = (kernelConfig_.tileWords > 0) ? kernelConfig_.tileWords : wordsPerRow_;
+
+    RowContext context{};
+    context.wordCount = wordsPerRow_;
+    context.lastBit = lastBit_;
+    context.lastWordMask = lastWordMask_;
+    context.bornMask = bornMask;
+    context.surviveMask = surviveMask;
+
+    uint64_t hashDelta = 0;
+    for (int wordBegin = 0; wordBegin < wordsPerRow_; wordBegin += tileWords) {
+        int wordEnd = std::min(wordBegin + tileWords, wordsPerRow_);
+        for (int rowIndex = rowBegin; rowIndex < rowEnd; rowIndex++) {
+            //wrap the rows
+            context.above = getRow((rowIndex == 0) ? height_ - 1 : rowIndex - 1);
+            context.row = getRow(rowIndex);
+            context.below = getRow((rowIndex == height_ - 1) ? 0 : rowIndex + 1);
+            context.next = &nextCells_[(size_t)rowIndex * wordsPerRow_];
+            kernel(context, wordBegin, wordEnd);
+            if (stats) rowStats(context.row, context.next, wordBegin, wordEnd, rowIndex, *stats);
+
+            //Both rows are still in cache, and quiet boards rarely take the branch.
+            if (hashTracking_ || changes) {
+                size_t rowStart = (size_t)rowIndex * wordsPerRow_;
+                for (int i = wordBegin; i < wordEnd; i++) {
+                    if (context.next[i] != context.row[i]) {
+                        if (hashTracking_) hashDelta ^= hashWord(rowStart + i, context.row[i]) ^ hashWord(rowStart + i, context.next[i]);
+                        if (changes) changes->push_back(WordChange{ rowStart + i, context.row[i] ^ context.next[i] });
+                    }
+                }
+            }
+        }
+    }
+    if (hashDelta) hashDelta_.fetch_xor(hashDelta, std::memory_order_relaxed);
+}
@@ -0,0 +1,194 @@
+#ifndef GRID_ENGINE_HPP
+#define GRID_ENGINE_HPP
+
+#include "GridAllocator.hpp"
+#include "LifeRule.hpp"
+#include "PackedPattern.hpp"
+#include "WorkerPool.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+//Dense toroidal board with one bit per cell, 64 cells to a word.
+//A generation is computed a whole word at a time with a bit-sliced adder over the 8 neighbor bit planes,
+//and the rows are split into bands that run on a WorkerPool.
+//Bands always go to the same thread, and each band's memory is first written by that thread, so on NUMA
+//machines it sits on the node that steps it. Big boards are held in huge pages via GridAllocator.
+//It knows nothing about drawing; colors and trails are up to whoever reads the rows.
+class GridEngine
+{
+public:
+	static constexpr int BITS_PER_WORD = 64;
+
+	using Words = std::vector<uint64_t, GridAllocator<uint64_t>>;
+
+	//Instruction sets the step kernel is compiled for. The same code is built for each; wider vectors
+	//let the compiler do several words at once.
+	enum class Isa
+	{
+		Generic,
+		Avx2,
+		Avx512
+	};
+
+	constexpr static const char* IsaNames[3] = { "Generic", "AVX2", "AVX-512" };
+
+	static bool isIsaSupported(Isa isa);
+
+	//How a step is split up. Rows are cut into bands of bandRows, one task each, and every band is
+	//walked in column tiles of tileWords words so the three rows being read stay in cache.
+	struct KernelConfig
+	{
+		int threadCount = 1;
+		//0 splits the board into 4 bands per thread.
+		int bandRows = 0;
+		//0 walks whole rows.
+		int tileWords = 0;
+		Isa isa = Isa::Generic;
+
+		bool operator==(const KernelConfig& config) const = default;
+	};
+
+	//Board statistics, gathered by the kernel while it writes the last generation of each step().
+	//Births and deaths are for that generation; after an edit or a load they are zero until the next step.
+	struct Stats
+	{
+		uint64_t population = 0;
+		uint64_t births = 0;
+		uint64_t deaths = 0;
+		//Words, 64 cells of one row each, that the last generation changed: how much of the board is active.
+		uint64_t changedWords = 0;
+		//Inclusive bounding box of the live cells. Empty when right < left.
+		int left = 0;
+		int top = 0;
+		int right = -1;
+		int bottom = -1;
+
+		bool isEmpty() const { return right < left; }
+		void merge(const Stats& stats);
+	};
+
+	//A word the last generation changed: where it is in getWords(), and which of its bits flipped.
+	struct WordChange
+	{
+		size_t index = 0;
+		uint64_t flipped = 0;
+	};
+
+	GridEngine() = default;
+
+	//Resizing clears the board.
+	void resize(int width, int height);
+	void clear();
+
+	int getWidth() const { return width_; }
+	int getHeight() const { return height_; }
+	int getWordsPerRow() const { return wordsPerRow_; }
+
+	void setRule(const LifeRule& rule) { rule_ = rule; }
+	const LifeRule& getRule() const { return rule_; }
+
+	void setThreadCount(int threadCount);
+	int getThreadCount() const { return workers_.size(); }
+
+	//Unsupported instruction sets fall back to Generic.
+	void setKernelConfig(const KernelConfig& config);
+	const KernelConfig& getKernelConfig() const { return kernelConfig_; }
+
+	//Pins the worker threads, see WorkerPool::setAffinity, and moves the board so each band is local to its thread.
+	bool setAffinity(const std::vector<int>& cpus);
+	const std::vector<int>& getAffinity() const { return workers_.getAffinity(); }
+
+	bool getCell(int row, int column) const;
+	void setCell(int row, int column, bool alive);
+
+	//Replace the whole board from one byte per cell, row major, width * height. Nonzero is alive.
+	void loadCells(const std::vector<uint8_t>& aliveFlags);
+	//Replace the whole board with a packed pattern, its top left cell at row, column. A pattern that fits is
+	//copied a word at a time; one that doesn't wraps around the edges.
+	void loadPattern(const PackedPattern& pattern, int row, int column);
+	//Resize to match board and copy its cells. The rule and kernel settings are left alone.
+	void copyCellsFrom(const GridEngine& board);
+
+	//Without updateStats the kernel skips the stats, and getStats() counts them if it is asked.
+	void step(int generations = 1, bool updateStats = true);
+
+	//A generation in pieces: stepRows() computes the next generation of some rows, and finishStep() makes
+	//it current once every row is done. Lets rows that only need local neighbors be computed while the
+	//others are still being filled in, e.g. halo rows arriving from another process.
+	void stepRows(int rowBegin, int rowEnd);
+	void finishStep();
+	//Overwrite rowCount whole rows starting at row, wordsPerRow words each.
+	void setRows(int row, int rowCount, const uint64_t* words);
+
+	long long getGeneration() const { return generation_; }
+	void setGeneration(long long generation) { generation_ = generation; }
+
+	//From the kernel's last pass where possible, otherwise counted once and kept until the board changes.
+	const Stats& getStats() const;
+	uint64_t countPopulation() const { return getStats().population; }
+	//Stats for a generation after, given the one before it, both laid out like getWords(). A full pass.
+	Stats countStats(const Words& before, const Words& after) const;
+
+	//Packed row, bit (column % 64) of word (column / 64). Bits past the width are always zero.
+	const uint64_t* getRow(int row) const { return &cells_[(size_t)row * wordsPerRow_]; }
+	//All rows back to back, wordsPerRow words each.
+	const Words& getWords() const { return cells_; }
+	//Replace the board with words from getWords() of a board the same size. Pass the stats that went
+	//with them, if known, to save recounting.
+	void setWords(const Words& words, const Stats* stats = nullptr);
+
+	//Zobrist style hash of the board: the XOR over every word of a mix of its index and value.
+	//With tracking on, the kernel folds in only the words that changed as it writes each row,
+	//so keeping the hash costs a compare per word rather than a pass over the board.
+	void setHashTracking(bool enabled);
+	uint64_t getHash();
+
+	//With change tracking on, the kernel lists every word it changes, from the same compare the hash uses.
+	//Only the last generation of a step() is kept, one list per band in board order. stepRows() and edits
+	//don't add to them.
+	void setChangeTracking(bool enabled);
+	const std::vector<std::vector<WordChange>>& getChanges() const { return bandChanges_; }
+
+private:
+	void stepBand_(int rowBegin, int rowEnd, bool conwayRule, Stats* stats, std::vector<WordChange>* changes);
+	int getBandRows_() const;
+	//Reallocates both buffers with each band first touched by its thread. Changing the band layout or
+	//the pinning calls it with keepCells, since the old placement no longer matches.
+	void placeBuffers_(bool keepCells);
+	void invalidateHash_() { hashValid_ = false; }
+	void invalidateStats_() { statsValid_ = false; }
+	//Hash and stats both describe the whole board, so anything replacing cells in bulk drops both.
+	void invalidateBoard_() { invalidateHash_(); invalidateStats_(); }
+
+	Words cells_;
+	Words nextCells_;
+	int width_ = 0;
+	int height_ = 0;
+	int wordsPerRow_ = 0;
+	//Bit index of the last column within its word, and the valid bits of the last word.
+	int lastBit_ = 0;
+	uint64_t lastWordMask_ = ~0ull;
+
+	LifeRule rule_;
+	KernelConfig kernelConfig_;
+	WorkerPool workers_;
+	long long generation_ = 0;
+
+	bool hashTracking_ = false;
+	bool hashValid_ = false;
+	uint64_t hash_ = 0;
+	//Bands XOR their changes in here; folded into hash_ after each generation.
+	std::atomic<uint64_t> hashDelta_ = 0;
+
+	mutable Stats stats_;
+	mutable bool statsValid_ = false;
+	//One per band, merged once the band tasks are done.
+	std::vector<Stats> bandStats_;
+
+	bool changeTracking_ = false;
+	std::vector<std::vector<WordChange>> bandChanges_;
+};
+
+#endif //GRID_ENGINE_HPP
@@ -0,0 +1,524 @@
+#include "HashLifeEngine.hpp"
+#include "GridEngine.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+
+size_t HashLifeEngine::NodeKeyHash::operator()(const NodeKey& key) const
+{
+    //Nodes are at least 8 byte aligned, so the low bits carry nothing.
+    uint64_t hash = (uint64_t)(uintptr_t)key.northWest >> 3;
+    hash = hash * 0x9E3779B97F4A7C15ull + ((uint64_t)(uintptr_t)key.northEast >> 3);
+    hash = hash * 0x9E3779B97F4A7C15ull + ((uint64_t)(uintptr_t)key.southWest >> 3);
+    hash = hash * 0x9E3779B97F4A7C15ull + ((uint64_t)(uintptr_t)key.southEast >> 3);
+    return (size_t)(hash ^ (hash >> 32));
+}
+
+HashLifeEngine::HashLifeEngine()
+{
+    setRule(LifeRule());
+    clear();
+}
+
+void HashLifeEngine::resetNodes_()
+{
+    nodes_.clear();
+    nodeTable_.clear();
+    emptyNodes_.clear();
+
+    Node cell;
+    deadCell_ = &nodes_.emplace_back(cell);
+    cell.population = 1;
+    aliveCell_ = &nodes_.emplace_back(cell);
+    emptyNodes_.push_back(deadCell_);
+}
+
+void HashLifeEngine::clear()
+{
+    resetNodes_();
+    root_ = getEmpty_(3);
+    originX_ = 0;
+    originY_ = 0;
+}
+
+void HashLifeEngine::setRule(const LifeRule& rule)
+{
+    if (rule == rule_ && !baseTable_.empty()) return;
+    rule_ = rule;
+
+    baseTable_.assign(1 << 16, 0);
+    for (int cells = 0; cells < (1 << 16); cells++) {
+        auto isAlive = [cells](int x, int y) { return (cells >> (y * 4 + x)) & 1; };
+        const int centers[4][2] = { {1, 1}, {2, 1}, {1, 2}, {2, 2} };
+        for (int index = 0; index < 4; index++) {
+            int x = centers[index][0];
+            int y = centers[index][1];
+            int neighbors = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (dx != 0 || dy != 0) neighbors += isAlive(x + dx, y + dy);
+                }
+            }
+            bool alive = isAlive(x, y) ? rule_.survives(neighbors) : rule_.isBorn(neighbors);
+            if (alive) baseTable_[cells] |= (uint8_t)(1 << index);
+        }
+    }
+
+    for (const Node& node : nodes_) {
+        node.result = nullptr;
+        node.resultStep = -1;
+    }
+}
+
+const HashLifeEngine::Node* HashLifeEngine::join_(
+    const Node* northWest, const Node* northEast, const Node* southWest, const Node* southEast)
+{
+    NodeKey key{ northWest, northEast, southWest, southEast };
+    auto found = nodeTable_.find(key);
+    if (found != nodeTable_.end()) return found->second;
+
+    Node node;
+    node.northWest = northWest;
+    node.northEast = northEast;
+    node.southWest = southWest;
+    node.southEast = southEast;
+    node.population = northWest->population + northEast->population + southWest->population + southEast->population;
+    node.level = northWest->level + 1;
+    const Node* added = &nodes_.emplace_back(node);
+    nodeTable_.emplace(key, added);
+    return added;
+}
+
+const HashLifeEngine::Node* HashLifeEngine::getEmpty_(int level)
+{
+    while ((int)emptyNodes_.size() <= level) {
+        const Node* smaller = emptyNodes_.back();
+        emptyNodes_.push_back(join_(smaller, smaller, smaller, smaller));
+    }
+    return emptyNodes_[level];
+}
+
+const HashLifeEngine::Node* HashLifeEngine::centre_(const Node* node)
+{
+    return join_(
+        node->northWest->southEast, node->northEast->southWest,
+        node->southWest->northEast, node->southEast->northWest);
+}
+
+const HashLifeEngine::Node* HashLifeEngine::expand_(const Node* node)
+{
+    const Node* empty = getEmpty_(node->level - 1);
+    return join_(
+        join_(empty, empty, empty, node->northWest),
+        join_(empty, empty, node->northEast, empty),
+        join_(empty, node->southWest, empty, empty),
+        join_(node->southEast, empty, empty, empty));
+}
+
+const HashLifeEngine::Node* HashLifeEngine::stepBase_(const Node* node)
+{
+    auto quadrantBits = [](const Node* quadrant, int x, int y) {
+        int bits = 0;
+        if (quadrant->northWest->population) bits |= 1 << (y * 4 + x);
+        if (quadrant->northEast->population) bits |= 1 << (y * 4 + x + 1);
+        if (quadrant->southWest->population) bits |= 1 << ((y + 1) * 4 + x);
+        if (quadrant->southEast->population) bits |= 1 << ((y + 1) * 4 + x + 1);
+        return bits;
+    };
+    int cells =
+        quadrantBits(node->northWest, 0, 0) | quadrantBits(node->northEast, 2, 0) |
+        quadrantBits(node->southWest, 0, 2) | quadrantBits(node->southEast, 2, 2);
+
+    uint8_t next = baseTable_[cells];
+    auto cell = [this](bool alive) { return alive ? aliveCell_ : deadCell_; };
+    return join_(cell(next & 1), cell(next & 2), cell(next & 4), cell(next & 8));
+}
+
+const HashLifeEngine::Node* HashLifeEngine::advance_(const Node* node, int stepLog2)
+{
+    if (node->population == 0) return getEmpty_(node->level - 1);
+    if (node->resultStep == stepLog2) return node->result;
+
+    const Node* result = nullptr;
+    if (node->level == 2) {
+        result = stepBase_(node);
+    }
+    else {
+        const Node* northWest = node->northWest;
+        const Node* northEast = node->northEast;
+        const Node* southWest = node->southWest;
+        const Node* southEast = node->southEast;
+
+        //Nine overlapping squares of half the size, row by row.
+        const Node* squares[9] = {
+            northWest,
+            join_(northWest->northEast, northEast->northWest, northWest->southEast, northEast->southWest),
+            northEast,
+            join_(northWest->southWest, northWest->southEast, southWest->northWest, southWest->northEast),
+            centre_(node),
+            join_(northEast->southWest, northEast->southEast, southEast->northWest, southEast->northEast),
+            southWest,
+            join_(southWest->northEast, southEast->northWest, southWest->southEast, southEast->southWest),
+            southEast
+        };
+
+        //At full speed both halves of the step advance, otherwise only the second one does.
+        const bool fullSpeed = (stepLog2 == node->level - 2);
+        const int innerStep = fullSpeed ? stepLog2 - 1 : stepLog2;
+        const Node* inner[9];
+        for (int index = 0; index < 9; index++) {
+            inner[index] = fullSpeed ? advance_(squares[index], innerStep) : centre_(squares[index]);
+        }
+
+        result = join_(
+            advance_(join_(inner[0], inner[1], inner[3], inner[4]), innerStep),
+            advance_(join_(inner[1], inner[2], inner[4], inner[5]), innerStep),
+            advance_(join_(inner[3], inner[4], inner[6], inner[7]), innerStep),
+            advance_(join_(inner[4], inner[5], inner[7], inner[8]), innerStep));
+    }
+
+    node->result = result;
+    node->resultStep = stepLog2;
+    return result;
+}
+
+void HashLifeEngine::advanceRoot_(int stepLog2)
+{
+    //True if every living cell is inside the center half of the node.
+    auto centredInHalf = [](const Node* node) {
+        return node->population ==
+            node->northWest->southEast->population + node->northEast->southWest->population +
+            node->southWest->northEast->population + node->southEast->northWest->population;
+    };
+    auto expandRoot = [this]() {
+        long long half = 1ll << (root_->level - 1);
+        root_ = expand_(root_);
+        originX_ -= half;
+        originY_ -= half;
+    };
+
+    //The result is the center half of the root, so leave room for the pattern to grow by 2^stepLog2 on every side.
+    while (root_->level < stepLog2 + 3 || !centredInHalf(root_)) expandRoot();
+    expandRoot();
+
+    long long quarter = 1ll << (root_->level - 2);
+    root_ = advance_(root_, stepLog2);
+    originX_ += quarter;
+    originY_ += quarter;
+
+    //Trim the empty border again so the next step doesn't start from a needlessly big root.
+    while (root_->level > 3 && centredInHalf(root_)) {
+        quarter = 1ll << (root_->level - 2);
+        root_ = centre_(root_);
+        originX_ += quarter;
+        originY_ += quarter;
+    }
+}
+
+void HashLifeEngine::step(long long generations)
+{
+    //Split into power of two steps, smallest first.
+    for (int stepLog2 = 0; generations > 0; stepLog2++, generations >>= 1) {
+        if (!(generations & 1)) continue;
+        if (nodes_.size() > maxNodeCount) collectGarbage_();
+        advanceRoot_(stepLog2);
+    }
+}
+
+const HashLifeEngine::Node* HashLifeEngine::copyNode_(
+    const Node* node, std::unordered_map<const Node*, const Node*>& copied)
+{
+    auto found = copied.find(node);
+    if (found != copied.end()) return found->second;
+
+    const Node* copy = join_(
+        copyNode_(node->northWest, copied), copyNode_(node->northEast, copied),
+        copyNode_(node->southWest, copied), copyNode_(node->southEast, copied));
+    copied.emplace(node, copy);
+    return copy;
+}
+
+void HashLifeEngine::collectGarbage_()
+{
+    //Rebuild the node store from the root alone. Memoized results are lost along with the dropped nodes.
+    std::deque<Node> oldNodes = std::move(nodes_);
+    const Node* oldDeadCell = deadCell_;
+    const Node* oldAliveCell = aliveCell_;
+    resetNodes_();
+
+    std::unordered_map<const Node*, const Node*> copied;
+    copied.emplace(oldDeadCell, deadCell_);
+    copied.emplace(oldAliveCell, aliveCell_);
+    root_ = copyNode_(root_, copied);
+}
+
+const HashLifeEngine::Node* HashLifeEngine::buildFromGrid_(const GridEngine& grid, int level, long long x, long long y)
+{
+    if (x >= grid.getWidth() || y >= grid.getHeight()) return getEmpty_(level);
+    if (level == 0) return grid.getCell((int)y, (int)x) ? aliveCell_ : deadCell_;
+
+    //A 64 cell square starts on a word boundary, so checking it for life is one word per row.
+    if (level == 6) {
+        int word = (int)(x / GridEngine::BITS_PER_WORD);
+        int rowEnd = (int)std::min<long long>(y + 64, grid.getHeight());
+        bool empty = true;
+        for (int row = (int)y; row < rowEnd && empty; row++) empty = (grid.getRow(row)[word] == 0);
+        if (empty) return getEmpty_(level);
+    }
+
+    long long half = 1ll << (level - 1);
+    return join_(
+        buildFromGrid_(grid, level - 1, x, y),
+        buildFromGrid_(grid, level - 1, x + half, y),
+        buildFromGrid_(grid, level - 1, x, y + half),
+        buildFromGrid_(grid, level - 1, x + half, y + half));
+}
+
+void HashLifeEngine::loadFromGrid(const GridEngine& grid)
+{
+    clear();
+    int level = 3;
+    while ((1ll << level) < std::max(grid.getWidth(), grid.getHeight())) level++;
+    root_ = buildFromGrid_(grid, level, 0, 0);
+}
+
+void HashLifeEngine::storeNode_(GridEngine& grid, const Node* node, long long x, long long y) const
+{
+    if (node->population == 0) return;
+    long long size = 1ll << node->level;
+    if (x >= grid.getWidth() || y >= grid.getHeight() || x + size <= 0 || y + size <= 0) return;
+
+    if (node->level == 0) {
+        grid.setCell((int)y, (int)x, true);
+        return;
+    }
+    long long half = size / 2;
+    storeNode_(grid, node->northWest, x, y);
+    storeNode_(grid, node->northEast, x + half, y);
+    storeNode_(grid, node->southWest, x, y + half);
+    storeNode_(grid, node->southEast, x + half, y + half);
+}
+
+void HashLifeEngine::storeToGrid(GridEngine& grid) const
+{
+    grid.clear();
+    storeNode_(grid, root_, originX_, originY_);
+}
+
+HashLifeEngine::Bounds HashLifeEngine::findBounds_(const Node* node, std::unordered_map<const Node*, Bounds>& found) const
+{
+    if (node->population == 0) return Bounds();
+    if (node->level == 0) return Bounds{ 0, 0, 0, 0 };
+    auto known = found.find(node);
+    if (known != found.end()) return known->second;
+
+    //Each distinct square is measured once, relative to its own corner, so repetitive patterns far too
+    //big to visit cell by cell still take time in proportion to their node count.
+    long long half = 1ll << (node->level - 1);
+    Bounds bounds;
+    auto merge = [&bounds](Bounds quadrant, long long x, long long y) {
+        if (quadrant.isEmpty()) return;
+        quadrant = Bounds{ quadrant.left + x, quadrant.top + y, quadrant.right + x, quadrant.bottom + y };
+        if (bounds.isEmpty()) {
+            bounds = quadrant;
+            return;
+        }
+        bounds.left = std::min(bounds.left, quadrant.left);
+        bounds.top = std::min(bounds.top, quadrant.top);
+        bounds.right = std::max(bounds.right, quadrant.right);
+        bounds.bottom = std::max(bounds.bottom, quadrant.bottom);
+    };
+    merge(findBounds_(node->northWest, found), 0, 0);
+    merge(findBounds_(node->northEast, found), half, 0);
+    merge(findBounds_(node->southWest, found), 0, half);
+    merge(findBounds_(node->southEast, found), half, half);
+    found.emplace(node, bounds);
+    return bounds;
+}
+
+HashLifeEngine::Bounds HashLifeEngine::getBounds() const
+{
+    std::unordered_map<const Node*, Bounds> found;
+    Bounds bounds = findBounds_(root_, found);
+    if (bounds.isEmpty()) return bounds;
+    return Bounds{ bounds.left + originX_, bounds.top + originY_, bounds.right + originX_, bounds.bottom + originY_ };
+}
+
+const HashLifeEngine::Node* HashLifeEngine::buildLeaf_(uint64_t cells)
+{
+    auto cell = [this, cells](int x, int y) { return ((cells >> (y * 8 + x)) & 1) ? aliveCell_ : deadCell_; };
+    auto square = [&](int level, int x, int y, auto& self) -> const Node* {
+        if (level == 0) return cell(x, y);
+        int half = 1 << (level - 1);
+        return join_(self(level - 1, x, y, self), self(level - 1, x + half, y, self),
+            self(level - 1, x, y + half, self), self(level - 1, x + half, y + half, self));
+    };
+    return square(3, 0, 0, square);
+}
+
+uint64_t HashLifeEngine::getLeafCells_(const Node* node) const
+{
+    uint64_t cells = 0;
+    auto collect = [&](const Node* square, int x, int y, auto& self) -> void {
+        if (square->population == 0) return;
+        if (square->level == 0) {
+            cells |= 1ull << (y * 8 + x);
+            return;
+        }
+        int half = 1 << (square->level - 1);
+        self(square->northWest, x, y, self);
+        self(square->northEast, x + half, y, self);
+        self(square->southWest, x, y + half, self);
+        self(square->southEast, x + half, y + half, self);
+    };
+    collect(node, 0, 0, collect);
+    return cells;
+}
+
+bool HashLifeEngine::loadMacrocell(std::string_view text, MacrocellHeader& header, std::string& error)
+{
+    header = MacrocellHeader();
+    clear();
+    //Line n of the cells is nodes[n]; 0 stands for an empty square of whatever size is needed.
+    std::vector<const Node*> nodes = { nullptr };
+    size_t lineNumber = 0;
+    auto fail = [&](const std::string& message) {
+        error = "line " + std::to_string(lineNumber) + ": " + message;
+        clear();
+        return false;
+    };
+
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t lineEnd = text.find('\n', position);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        std::string_view line = text.substr(position, lineEnd - position);
+        position = lineEnd + 1;
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+
+        if (line[0] == '[') {
+            if (lineNumber == 1 && line.substr(0, 4) == "[M2]") continue;
+            return fail("not a macrocell file");
+        }
+        if (line[0] == '#') {
+            std::string_view value = line.size() > 2 ? line.substr(3) : std::string_view();
+            if (line.substr(0, 2) == "#R") {
+                header.rule = LifeRule::parse(value);
+                if (!header.rule) return fail("unsupported rule " + std::string(value));
+                if (!supportsRule(*header.rule)) return fail("rule " + header.rule->toString() + " has B0, which HashLife can't run");
+            }
+            else if (line.substr(0, 2) == "#G") {
+                std::from_chars(value.data(), value.data() + value.size(), header.generation);
+            }
+            continue;
+        }
+
+        if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+            //An 8x8 leaf, row by row with $ between rows and trailing dead cells left off.
+            uint64_t cells = 0;
+            int x = 0;
+            int y = 0;
+            for (char c : line) {
+                if (c == '$') {
+                    x = 0;
+                    y++;
+                    continue;
+                }
+                if ((c != '.' && c != '*') || x > 7 || y > 7) return fail("bad leaf");
+                if (c == '*') cells |= 1ull << (y * 8 + x);
+                x++;
+            }
+            nodes.push_back(buildLeaf_(cells));
+            continue;
+        }
+
+        //level northWest northEast southWest southEast
+        long long fields[5];
+        const char* cursor = line.data();
+        const char* end = line.data() + line.size();
+        for (long long& field : fields) {
+            while (cursor < end && *cursor == ' ') cursor++;
+            auto [next, status] = std::from_chars(cursor, end, field);
+            if (status != std::errc() || field < 0) return fail("expected a level and four node numbers");
+            cursor = next;
+        }
+        int level = (int)fields[0];
+        //Levels below 4 are the multi-state form, with single cells as nodes.
+        if (level < 4) return fail("multi-state macrocells aren't supported");
+        if (level > 60) return fail("pattern is too large");
+        const Node* children[4];
+        for (int index = 0; index < 4; index++) {
+            long long number = fields[index + 1];
+            if (number >= (long long)nodes.size()) return fail("refers to a later line");
+            children[index] = (number == 0) ? getEmpty_(level - 1) : nodes[number];
+            if (children[index]->level != level - 1) return fail("quadrant is the wrong size");
+        }
+        nodes.push_back(join_(children[0], children[1], children[2], children[3]));
+    }
+
+    if (nodes.size() > 1) root_ = nodes.back();
+    if (header.rule) setRule(*header.rule);
+    return true;
+}
+
+bool HashLifeEngine::saveMacrocell(std::ostream& stream, long long generation, std::string_view comment) const
+{
+    std::string output = "[M2] (GameOfLife)\n#R " + rule_.toString() + "\n";
+    if (generation != 0) output += "#G " + std::to_string(generation) + "\n";
+    if (!comment.empty()) output += "#C " + std::string(comment) + "\n";
+
+    //Children are written before their parents, each distinct square once. Empty squares are 0.
+    std::unordered_map<const Node*, uint64_t> numbers;
+    uint64_t nextNumber = 1;
+    auto flush = [&]() {
+        stream.write(output.data(), (std::streamsize)output.size());
+        output.clear();
+    };
+    auto write = [&](const Node* node, auto& self) -> uint64_t {
+        if (node->population == 0) return 0;
+        auto found = numbers.find(node);
+        if (found != numbers.end()) return found->second;
+
+        if (node->level == 3) {
+            uint64_t cells = getLeafCells_(node);
+            int lastRow = 7;
+            while (((cells >> (lastRow * 8)) & 0xFF) == 0) lastRow--;
+            for (int y = 0; y <= lastRow; y++) {
+                uint64_t row = (cells >> (y * 8)) & 0xFF;
+                for (int x = 0; row != 0; x++, row >>= 1) output += (row & 1) ? '*' : '.';
+                output += '$';
+            }
+            output += '\n';
+        }
+        else {
+            uint64_t children[4] = {
+                self(node->northWest, self), self(node->northEast, self),
+                self(node->southWest, self), self(node->southEast, self) };
+            char line[128];
+            char* end = std::to_chars(line, line + sizeof(line), node->level).ptr;
+            for (uint64_t child : children) {
+                *end++ = ' ';
+                end = std::to_chars(end, line + sizeof(line), child).ptr;
+            }
+            *end++ = '\n';
+            output.append(line, end);
+        }
+        if (output.size() > ((size_t)1 << 20)) flush();
+        numbers.emplace(node, nextNumber);
+        return nextNumber++;
+    };
+
+    //The root is at least level 3, so the last line is a leaf or a square of leaves. An empty board has no lines.
+    write(root_, write);
+    flush();
+    return (bool)stream;
+}
+
+void HashLifeEngine::translate(long long dx, long long dy)
+{
+    originX_ += dx;
+    originY_ += dy;
+}
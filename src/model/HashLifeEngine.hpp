@@ -0,0 +1,151 @@
+#ifndef HASH_LIFE_ENGINE_HPP
+#define HASH_LIFE_ENGINE_HPP
+
+#include "LifeRule.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class GridEngine;
+
+//HashLife on an unbounded plane. Every distinct square of cells is stored once (hash consed), and the
+//result of advancing a square is memoized on its node, so repetitive patterns step exponentially fast.
+//Coordinates match the GridEngine it was loaded from: x is the column and y the row.
+//Rules with B0 don't work on an unbounded plane; check supportsRule first.
+class HashLifeEngine
+{
+public:
+	//Level 0 is a single cell, level n is a square of 2^n cells on a side.
+	struct Node
+	{
+		const Node* northWest = nullptr;
+		const Node* northEast = nullptr;
+		const Node* southWest = nullptr;
+		const Node* southEast = nullptr;
+		uint64_t population = 0;
+		int level = 0;
+		//This node's center square, advanced 2^resultStep generations. Only one step size is kept.
+		mutable const Node* result = nullptr;
+		mutable int resultStep = -1;
+	};
+
+	//Inclusive cell bounds of the living cells.
+	struct Bounds
+	{
+		long long left = 0;
+		long long top = 0;
+		long long right = -1;
+		long long bottom = -1;
+
+		bool isEmpty() const { return right < left; }
+	};
+
+	//What a macrocell file says besides its cells.
+	struct MacrocellHeader
+	{
+		std::optional<LifeRule> rule;
+		long long generation = 0;
+	};
+
+	HashLifeEngine();
+
+	HashLifeEngine(const HashLifeEngine&) = delete;
+	HashLifeEngine& operator=(const HashLifeEngine&) = delete;
+	//Nodes live in a deque and the table points at them, both of which keep their addresses when moved.
+	HashLifeEngine(HashLifeEngine&&) = default;
+	HashLifeEngine& operator=(HashLifeEngine&&) = default;
+
+	static bool supportsRule(const LifeRule& rule) { return !rule.isBorn(0); }
+
+	void clear();
+
+	//Changing the rule drops every memoized result.
+	void setRule(const LifeRule& rule);
+	const LifeRule& getRule() const { return rule_; }
+
+	void loadFromGrid(const GridEngine& grid);
+	//Clears the grid and writes the living cells into it. Cells outside the grid are dropped.
+	void storeToGrid(GridEngine& grid) const;
+
+	//Golly's macrocell format: every distinct 8x8 leaf and every distinct square above it is one line,
+	//and squares refer to their quadrants by line number. Loading joins those lines straight into nodes,
+	//so a file is read in time proportional to its length however many cells it describes.
+	//The root's north west corner goes at the origin. Takes the file's rule if it has one.
+	bool loadMacrocell(std::string_view text, MacrocellHeader& header, std::string& error);
+	bool saveMacrocell(std::ostream& stream, long long generation, std::string_view comment = {}) const;
+	//Moves every cell by dx columns and dy rows.
+	void translate(long long dx, long long dy);
+
+	void step(long long generations);
+
+	uint64_t getPopulation() const { return root_->population; }
+	Bounds getBounds() const;
+	size_t getNodeCount() const { return nodes_.size(); }
+
+	//Past this many nodes the unreachable ones are dropped before the next step.
+	size_t maxNodeCount = 1 << 22;
+
+private:
+	struct NodeKey
+	{
+		const Node* northWest;
+		const Node* northEast;
+		const Node* southWest;
+		const Node* southEast;
+
+		bool operator==(const NodeKey& key) const = default;
+	};
+
+	struct NodeKeyHash
+	{
+		size_t operator()(const NodeKey& key) const;
+	};
+
+	//The canonical node with these four children.
+	const Node* join_(const Node* northWest, const Node* northEast, const Node* southWest, const Node* southEast);
+	const Node* getEmpty_(int level);
+	//Square of half the size around the center of node.
+	const Node* centre_(const Node* node);
+	//Same cells with an empty border, one level up.
+	const Node* expand_(const Node* node);
+	//Center square of node advanced 2^stepLog2 generations. stepLog2 is at most node level - 2.
+	const Node* advance_(const Node* node, int stepLog2);
+	//One generation of a 4x4 square down to its center 2x2, from the lookup table.
+	const Node* stepBase_(const Node* node);
+	void advanceRoot_(int stepLog2);
+	void collectGarbage_();
+	const Node* copyNode_(const Node* node, std::unordered_map<const Node*, const Node*>& copied);
+	void resetNodes_();
+
+	const Node* buildFromGrid_(const GridEngine& grid, int level, long long x, long long y);
+	void storeNode_(GridEngine& grid, const Node* node, long long x, long long y) const;
+	//Bounds of the live cells relative to the node's corner, memoized in found.
+	Bounds findBounds_(const Node* node, std::unordered_map<const Node*, Bounds>& found) const;
+	//The level 3 node for an 8x8 square, bit y*8+x set for an alive cell at x,y.
+	const Node* buildLeaf_(uint64_t cells);
+	uint64_t getLeafCells_(const Node* node) const;
+
+	std::deque<Node> nodes_;
+	std::unordered_map<NodeKey, const Node*, NodeKeyHash> nodeTable_;
+	std::vector<const Node*> emptyNodes_;
+	const Node* deadCell_ = nullptr;
+	const Node* aliveCell_ = nullptr;
+
+	const Node* root_ = nullptr;
+	//Cell coordinates of the root's north west corner.
+	long long originX_ = 0;
+	long long originY_ = 0;
+
+	LifeRule rule_;
+	//Next state of the center 2x2 for every 4x4 square. Bit y*4+x of the index is the cell at x,y,
+	//bits 0, 1, 2, 3 of the value are the north west, north east, south west and south east results.
+	std::vector<uint8_t> baseTable_;
+};
+
+#endif //HASH_LIFE_ENGINE_HPP
@@ -0,0 +1,182 @@
+#include "HistoryRing.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    //Each change is a 32 bit index and a 64 bit word.
+    constexpr size_t CHANGE_BYTES = sizeof(uint32_t) + sizeof(uint64_t);
+}
+
+size_t HistoryRing::Segment::getBytes() const
+{
+    return keyIndices.capacity() * sizeof(uint32_t)
+        + keyWords.capacity() * sizeof(uint64_t)
+        + changeIndices.capacity() * sizeof(uint32_t)
+        + changeBits.capacity() * sizeof(uint64_t)
+        + changeEnds.capacity() * sizeof(size_t);
+}
+
+size_t HistoryRing::Segment::getChangeBytes() const
+{
+    return changeIndices.size() * CHANGE_BYTES + changeEnds.size() * sizeof(size_t);
+}
+
+void HistoryRing::clear()
+{
+    segments_.clear();
+    wordCount_ = 0;
+    bytes_ = 0;
+}
+
+void HistoryRing::recordKeyframe(const GridEngine& board, long long generation)
+{
+    size_t wordCount = board.getWords().size();
+    if (segments_.empty() || wordCount != wordCount_) {
+        clear();
+    }
+    else if (contains(generation)) {
+        if (generation == getOldestGeneration()) clear();
+        else truncateAfter_(generation - 1);
+    }
+    else if (generation != getNewestGeneration() + 1) {
+        clear();
+    }
+    //Changes store their index in 32 bits; boards past that many words aren't recorded.
+    if (wordCount > std::numeric_limits<uint32_t>::max()) return;
+
+    wordCount_ = wordCount;
+    pushKeyframe_(board, generation);
+    enforceLimit_();
+}
+
+bool HistoryRing::recordStep(const GridEngine& board, long long generation)
+{
+    const std::vector<std::vector<GridEngine::WordChange>>& bandChanges = board.getChanges();
+    if (segments_.empty() || bandChanges.empty() || board.getWords().size() != wordCount_) return false;
+    if (generation != getNewestGeneration() + 1) {
+        if (!contains(generation - 1)) return false;
+        truncateAfter_(generation - 1);
+    }
+
+    //Past this the segment's deltas would take more to replay than a keyframe takes to copy.
+    if (segments_.back().getChangeBytes() >= wordCount_ * sizeof(uint64_t)) {
+        pushKeyframe_(board, generation);
+        enforceLimit_();
+        return true;
+    }
+
+    Segment& segment = segments_.back();
+    bytes_ -= segment.getBytes();
+    for (const std::vector<GridEngine::WordChange>& changes : bandChanges) {
+        for (const GridEngine::WordChange& change : changes) {
+            segment.changeIndices.push_back((uint32_t)change.index);
+            segment.changeBits.push_back(change.flipped);
+        }
+    }
+    segment.changeEnds.push_back(segment.changeIndices.size());
+    bytes_ += segment.getBytes();
+    enforceLimit_();
+    return true;
+}
+
+bool HistoryRing::contains(long long generation) const
+{
+    return findSegment_(generation) < segments_.size();
+}
+
+long long HistoryRing::getOldestGeneration() const
+{
+    return segments_.empty() ? -1 : segments_.front().generation;
+}
+
+long long HistoryRing::getNewestGeneration() const
+{
+    return segments_.empty() ? -1 : segments_.back().getNewestGeneration();
+}
+
+bool HistoryRing::restore(long long generation, GridEngine::Words& words) const
+{
+    size_t index = findSegment_(generation);
+    if (index == segments_.size()) return false;
+    const Segment& segment = segments_[index];
+
+    if (segment.sparse) {
+        words.assign(wordCount_, 0);
+        for (size_t i = 0; i < segment.keyIndices.size(); i++) words[segment.keyIndices[i]] = segment.keyWords[i];
+    }
+    else {
+        words.assign(segment.keyWords.begin(), segment.keyWords.end());
+    }
+
+    size_t end = (generation > segment.generation) ? segment.changeEnds[(size_t)(generation - segment.generation - 1)] : 0;
+    for (size_t i = 0; i < end; i++) words[segment.changeIndices[i]] ^= segment.changeBits[i];
+    return true;
+}
+
+void HistoryRing::pushKeyframe_(const GridEngine& board, long long generation)
+{
+    //The finished segment won't grow again, so give back what its vectors reserved.
+    if (!segments_.empty()) {
+        Segment& previous = segments_.back();
+        bytes_ -= previous.getBytes();
+        previous.changeIndices.shrink_to_fit();
+        previous.changeBits.shrink_to_fit();
+        previous.changeEnds.shrink_to_fit();
+        bytes_ += previous.getBytes();
+    }
+
+    const GridEngine::Words& words = board.getWords();
+    size_t nonzero = (size_t)std::count_if(words.begin(), words.end(), [](uint64_t word) { return word != 0; });
+
+    Segment& segment = segments_.emplace_back();
+    segment.generation = generation;
+    segment.sparse = nonzero * CHANGE_BYTES < words.size() * sizeof(uint64_t);
+    if (segment.sparse) {
+        segment.keyIndices.reserve(nonzero);
+        segment.keyWords.reserve(nonzero);
+        for (size_t i = 0; i < words.size(); i++) {
+            if (words[i] == 0) continue;
+            segment.keyIndices.push_back((uint32_t)i);
+            segment.keyWords.push_back(words[i]);
+        }
+    }
+    else {
+        segment.keyWords.assign(words.begin(), words.end());
+    }
+    bytes_ += segment.getBytes();
+}
+
+void HistoryRing::truncateAfter_(long long generation)
+{
+    while (segments_.back().generation > generation) {
+        bytes_ -= segments_.back().getBytes();
+        segments_.pop_back();
+    }
+
+    //Capacity is kept for the run that carries on from here.
+    Segment& segment = segments_.back();
+    size_t keep = (size_t)(generation - segment.generation);
+    size_t end = (keep > 0) ? segment.changeEnds[keep - 1] : 0;
+    segment.changeEnds.resize(keep);
+    segment.changeIndices.resize(end);
+    segment.changeBits.resize(end);
+}
+
+void HistoryRing::enforceLimit_()
+{
+    while (bytes_ > maxBytes && segments_.size() > 1) {
+        bytes_ -= segments_.front().getBytes();
+        segments_.pop_front();
+    }
+}
+
+size_t HistoryRing::findSegment_(long long generation) const
+{
+    auto after = std::upper_bound(segments_.begin(), segments_.end(), generation,
+        [](long long value, const Segment& segment) { return value < segment.generation; });
+    if (after == segments_.begin()) return segments_.size();
+    size_t index = (size_t)(after - segments_.begin()) - 1;
+    return (generation <= segments_[index].getNewestGeneration()) ? index : segments_.size();
+}
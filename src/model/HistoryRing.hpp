@@ -0,0 +1,80 @@
+#ifndef HISTORY_RING_HPP
+#define HISTORY_RING_HPP
+
+#include "GridEngine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+//Past generations of a grid, kept so a run can be rewound and scrubbed through.
+//The history is a run of segments, each a keyframe followed by one delta per generation after it. A delta
+//is the list of words the kernel changed, as (index, flipped bits) pairs, so a still life costs nothing and
+//memory follows how busy the board is rather than its size. A segment ends once its deltas take as much
+//room as a full keyframe would, which also bounds how far a seek has to replay. Keyframes of mostly empty
+//boards only keep their nonzero words. Once the history takes more than maxBytes, the oldest segments go.
+class HistoryRing
+{
+public:
+	HistoryRing() = default;
+
+	//Always keeps the newest segment, even if that alone is over.
+	size_t maxBytes = (size_t)256 << 20;
+
+	void clear();
+	bool isEmpty() const { return segments_.empty(); }
+
+	//Stores board as it is at generation. The generation after the newest carries on the history; one
+	//already held replaces it and drops everything after; anything else starts over.
+	void recordKeyframe(const GridEngine& board, long long generation);
+	//Stores the generation board has just stepped to, from its change lists. A generation already held
+	//drops everything after the one before it, as when a run carries on from a seek. Returns false, storing
+	//nothing, if the changes can't follow on from the history, e.g. change tracking is off or there is a
+	//gap; a keyframe has to be recorded instead.
+	bool recordStep(const GridEngine& board, long long generation);
+
+	bool contains(long long generation) const;
+	//-1 while empty.
+	long long getOldestGeneration() const;
+	long long getNewestGeneration() const;
+
+	//Rebuilds the board of a held generation into words, laid out like GridEngine::getWords().
+	//The nearest keyframe at or before it is copied and the deltas up to it applied.
+	bool restore(long long generation, GridEngine::Words& words) const;
+
+	size_t getBytes() const { return bytes_; }
+	size_t getKeyframeCount() const { return segments_.size(); }
+
+private:
+	struct Segment
+	{
+		long long generation = 0;
+		//Sparse keyframes list the indices of their nonzero words; dense ones hold every word.
+		bool sparse = false;
+		std::vector<uint32_t> keyIndices;
+		std::vector<uint64_t> keyWords;
+		//Changes of every generation after the keyframe back to back; changeEnds[i] is where those of
+		//generation + i + 1 end.
+		std::vector<uint32_t> changeIndices;
+		std::vector<uint64_t> changeBits;
+		std::vector<size_t> changeEnds;
+
+		long long getNewestGeneration() const { return generation + (long long)changeEnds.size(); }
+		size_t getBytes() const;
+		size_t getChangeBytes() const;
+	};
+
+	void pushKeyframe_(const GridEngine& board, long long generation);
+	//Drops every generation after generation, which has to be held.
+	void truncateAfter_(long long generation);
+	void enforceLimit_();
+	//Segment holding generation, or segments_.size().
+	size_t findSegment_(long long generation) const;
+
+	std::deque<Segment> segments_;
+	size_t wordCount_ = 0;
+	size_t bytes_ = 0;
+};
+
+#endif //HISTORY_RING_HPP
@@ -0,0 +1,255 @@
+#include "KernelTuner.hpp"
+#include "ConfigDirectory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace
+{
+    //Each trial runs at least this long, so timer resolution and thread wakeups don't dominate small boards.
+    constexpr double MIN_TRIAL_SECONDS = 0.005;
+    constexpr int MAX_TRIAL_GENERATIONS = 64;
+    constexpr int TRIALS = 3;
+    //Density of the soup candidates are timed on. An empty board would flatter whichever kernel skips the most.
+    constexpr double SOUP_DENSITY = 0.3;
+    constexpr unsigned int SOUP_SEED = 12345;
+
+    std::string getCpuBrand()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int registers[4] = {};
+        char brand[49] = {};
+        __cpuid(registers, 0x80000000);
+        if ((unsigned int)registers[0] < 0x80000004) return "";
+        for (int leaf = 0; leaf < 3; leaf++) {
+            __cpuid(registers, 0x80000002 + leaf);
+            std::memcpy(brand + leaf * 16, registers, 16);
+        }
+        return brand;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+        unsigned int registers[4] = {};
+        char brand[49] = {};
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004) return "";
+        for (unsigned int leaf = 0; leaf < 3; leaf++) {
+            __get_cpuid(0x80000002 + leaf, &registers[0], &registers[1], &registers[2], &registers[3]);
+            for (int index = 0; index < 4; index++) {
+                for (int byte = 0; byte < 4; byte++) brand[leaf * 16 + index * 4 + byte] = (char)(registers[index] >> (byte * 8));
+            }
+        }
+        return brand;
+#else
+        //Elsewhere, Linux at least names the CPU in /proc/cpuinfo.
+        std::ifstream cpuInfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuInfo, line)) {
+            if (line.rfind("model name", 0) == 0 || line.rfind("Hardware", 0) == 0) {
+                size_t colon = line.find(':');
+                if (colon != std::string::npos) return line.substr(colon + 1);
+            }
+        }
+        return "";
+#endif
+    }
+
+    std::string trim(const std::string& text)
+    {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) return "";
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    struct CacheEntry
+    {
+        std::string cpuName;
+        int width = 0;
+        int height = 0;
+        std::string rule;
+        KernelTuner::Result result;
+    };
+
+    //One entry per line, tab separated: cpu, width, height, threads, band rows, tile words, isa, ns per generation, rule.
+    //Lines from before the rule was recorded have none and are skipped, so those sizes are tuned again.
+    std::vector<CacheEntry> readCache(const std::string& cachePath)
+    {
+        std::vector<CacheEntry> entries;
+        std::ifstream file(cachePath);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            CacheEntry entry;
+            int isa = 0;
+            if (!std::getline(fields, entry.cpuName, '\t')) continue;
+            if (!(fields >> entry.width >> entry.height
+                >> entry.result.config.threadCount >> entry.result.config.bandRows >> entry.result.config.tileWords
+                >> isa >> entry.result.nanosecondsPerGeneration >> entry.rule)) continue;
+            if (isa < 0 || isa > (int)GridEngine::Isa::Avx512) continue;
+            entry.result.config.isa = (GridEngine::Isa)isa;
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    void writeCache(const std::string& cachePath, const std::vector<CacheEntry>& entries)
+    {
+        std::ofstream file(cachePath, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cout << "Could not write kernel tuning cache " << cachePath << std::endl;
+            return;
+        }
+        for (const auto& entry : entries) {
+            const auto& config = entry.result.config;
+            file << entry.cpuName << '\t' << entry.width << '\t' << entry.height << '\t'
+                << config.threadCount << '\t' << config.bandRows << '\t' << config.tileWords << '\t'
+                << (int)config.isa << '\t' << entry.result.nanosecondsPerGeneration << '\t' << entry.rule << '\n';
+        }
+    }
+
+    //Best of a few trials, in nanoseconds per generation.
+    double measure(GridEngine& scratch, const GridEngine::KernelConfig& config)
+    {
+        scratch.setKernelConfig(config);
+        //Wakes the workers and pulls the board into cache.
+        scratch.step(1);
+
+        double best = std::numeric_limits<double>::max();
+        for (int trial = 0; trial < TRIALS; trial++) {
+            int generations = 0;
+            double seconds = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            do {
+                scratch.step(1);
+                generations++;
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (seconds < MIN_TRIAL_SECONDS && generations < MAX_TRIAL_GENERATIONS);
+            best = std::min(best, seconds * 1e9 / generations);
+        }
+        return best;
+    }
+}
+
+std::string KernelTuner::getCpuName()
+{
+    std::string brand = trim(getCpuBrand());
+    if (brand.empty()) brand = "unknown cpu";
+    return brand + " x" + std::to_string(std::max(std::thread::hardware_concurrency(), 1u));
+}
+
+std::string KernelTuner::describe(const GridEngine::KernelConfig& config)
+{
+    std::string text = std::string(GridEngine::IsaNames[(int)config.isa]) + ", " + std::to_string(config.threadCount) + " threads, ";
+    text += (config.bandRows > 0) ? std::to_string(config.bandRows) + " row bands, " : "auto bands, ";
+    text += (config.tileWords > 0) ? std::to_string(config.tileWords * GridEngine::BITS_PER_WORD) + " cell tiles" : "whole rows";
+    return text;
+}
+
+std::string KernelTuner::getDefaultCachePath()
+{
+    return ConfigDirectory::getFilePath(CACHE_FILE_NAME);
+}
+
+bool KernelTuner::findCached(int width, int height, const LifeRule& rule, Result& result, const std::string& cachePath)
+{
+    const std::string cpuName = getCpuName();
+    const std::string ruleName = rule.toString();
+    for (const auto& entry : readCache(cachePath)) {
+        if (entry.cpuName == cpuName && entry.width == width && entry.height == height && entry.rule == ruleName
+            && GridEngine::isIsaSupported(entry.result.config.isa)) {
+            result = entry.result;
+            result.fromCache = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+KernelTuner::Result KernelTuner::tune(int width, int height, const LifeRule& rule, const std::string& cachePath, bool useCache,
+    const std::atomic<bool>* cancelled)
+{
+    Result cachedResult;
+    if (useCache && findCached(width, height, rule, cachedResult, cachePath)) return cachedResult;
+
+    auto tuneStart = std::chrono::steady_clock::now();
+    GridEngine scratch;
+    scratch.resize(width, height);
+    scratch.setRule(rule);
+    {
+        std::mt19937 random(SOUP_SEED);
+        std::bernoulli_distribution alive(SOUP_DENSITY);
+        std::vector<uint8_t> cells((size_t)width * height);
+        for (auto& cell : cells) cell = alive(random) ? 1 : 0;
+        scratch.loadCells(cells);
+    }
+
+    const int hardwareThreads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    Result best;
+    best.config.threadCount = hardwareThreads;
+    best.nanosecondsPerGeneration = std::numeric_limits<double>::max();
+    auto isCancelled = [&]() { return cancelled && cancelled->load(std::memory_order_relaxed); };
+
+    //Try each value of one setting with the others at their best so far.
+    auto tryCandidates = [&](auto setValue, const std::vector<int>& values) {
+        GridEngine::KernelConfig bestConfig = best.config;
+        for (int value : values) {
+            if (isCancelled()) return;
+            GridEngine::KernelConfig config = bestConfig;
+            setValue(config, value);
+            double nanoseconds = measure(scratch, config);
+            if (nanoseconds < best.nanosecondsPerGeneration) {
+                best.nanosecondsPerGeneration = nanoseconds;
+                best.config = config;
+            }
+        }
+    };
+
+    std::vector<int> isas;
+    for (int isa = 0; isa <= (int)GridEngine::Isa::Avx512; isa++) {
+        if (GridEngine::isIsaSupported((GridEngine::Isa)isa)) isas.push_back(isa);
+    }
+    tryCandidates([](GridEngine::KernelConfig& config, int value) { config.isa = (GridEngine::Isa)value; }, isas);
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < hardwareThreads; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(hardwareThreads);
+    tryCandidates([](GridEngine::KernelConfig& config, int value) { config.threadCount = value; }, threadCounts);
+
+    std::vector<int> bandRows = { 0 };
+    for (int rows : { 4, 16, 64 }) if (rows < height) bandRows.push_back(rows);
+    tryCandidates([](GridEngine::KernelConfig& config, int value) { config.bandRows = value; }, bandRows);
+
+    std::vector<int> tileWords = { 0 };
+    for (int words : { 16, 64, 256 }) if (words < scratch.getWordsPerRow()) tileWords.push_back(words);
+    tryCandidates([](GridEngine::KernelConfig& config, int value) { config.tileWords = value; }, tileWords);
+
+    if (isCancelled()) return best;
+
+    double tuneSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tuneStart).count();
+    std::cout << "Kernel tuned for " << width << "x" << height << " " << rule.toString() << " in " << tuneSeconds * 1000.0
+        << " ms: " << describe(best.config) << ", " << best.nanosecondsPerGeneration << " ns per generation" << std::endl;
+
+    const std::string cpuName = getCpuName();
+    const std::string ruleName = rule.toString();
+    std::vector<CacheEntry> entries = readCache(cachePath);
+    CacheEntry entry{ cpuName, width, height, ruleName, best };
+    auto cached = std::find_if(entries.begin(), entries.end(), [&](const CacheEntry& existing) {
+        return existing.cpuName == cpuName && existing.width == width && existing.height == height && existing.rule == ruleName;
+    });
+    if (cached != entries.end()) *cached = entry;
+    else entries.push_back(entry);
+    writeCache(cachePath, entries);
+    return best;
+}
@@ -0,0 +1,43 @@
+#ifndef KERNEL_TUNER_HPP
+#define KERNEL_TUNER_HPP
+
+#include "GridEngine.hpp"
+#include "LifeRule.hpp"
+
+#include <atomic>
+#include <string>
+
+//Picks the fastest GridEngine::KernelConfig for this machine, board size and rule.
+//Candidates are timed for a few generations on a scratch board seeded with random soup, one setting at a time
+//(instruction set, then threads, then band rows, then tile width), so tuning stays well under a second.
+//Winners are cached in a small text file keyed by CPU model, board size and rule, so later launches skip the timing.
+namespace KernelTuner
+{
+	//Name of the cache file, kept in ConfigDirectory with the other settings.
+	constexpr const char* CACHE_FILE_NAME = "kernel_tuning.txt";
+
+	struct Result
+	{
+		GridEngine::KernelConfig config;
+		double nanosecondsPerGeneration = 0.0;
+		bool fromCache = false;
+	};
+
+	//CPU brand string where the platform offers one, plus the hardware thread count.
+	std::string getCpuName();
+
+	std::string getDefaultCachePath();
+
+	//Only reads the cache, so it is cheap enough to call on every resize. False if this CPU, size and rule haven't been tuned.
+	bool findCached(int width, int height, const LifeRule& rule, Result& result, const std::string& cachePath = getDefaultCachePath());
+
+	//Times the candidates for a width x height board under rule. With useCache, a cached result is returned without timing anything.
+	//Blocks for up to a second or so, so the gui calls it from a thread of its own. Once cancelled becomes true it
+	//returns the best so far, which isn't cached.
+	Result tune(int width, int height, const LifeRule& rule, const std::string& cachePath = getDefaultCachePath(), bool useCache = true,
+		const std::atomic<bool>* cancelled = nullptr);
+
+	std::string describe(const GridEngine::KernelConfig& config);
+}
+
+#endif //KERNEL_TUNER_HPP
@@ -0,0 +1,84 @@
+#ifndef LIFE_RULE_HPP
+#define LIFE_RULE_HPP
+
+#include "modelparameters.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//Outer totalistic rule in B/S notation.
+//Bit n of birth is set if a dead cell with n living neighbors becomes alive,
+//bit n of survive is set if a living cell with n living neighbors stays alive.
+struct LifeRule
+{
+	uint16_t birth = 1 << 3;
+	uint16_t survive = (1 << 2) | (1 << 3);
+
+	bool operator==(const LifeRule& rule) const = default;
+
+	bool isBorn(int neighbors) const { return (birth >> neighbors) & 1; }
+	bool survives(int neighbors) const { return (survive >> neighbors) & 1; }
+
+	//The gui's three rules: survive with rule1..rule3 neighbors, born with exactly rule4.
+	//A pattern's own rule in ruleString wins over them.
+	static LifeRule fromParameters(const ModelParameters& parameters)
+	{
+		if (!parameters.ruleString.empty()) {
+			if (auto parsed = parse(parameters.ruleString)) return *parsed;
+		}
+		LifeRule rule;
+		rule.birth = 0;
+		rule.survive = 0;
+		if (parameters.rule4 >= 0 && parameters.rule4 <= 8) rule.birth = (uint16_t)(1 << parameters.rule4);
+		for (int neighbors = std::max(parameters.rule1, 0); neighbors <= std::min(parameters.rule3, 8); neighbors++) {
+			rule.survive |= (uint16_t)(1 << neighbors);
+		}
+		return rule;
+	}
+
+	//Accepts "B3/S23", "b3/s23", "B3S23" and the older survive/birth form "23/3".
+	static std::optional<LifeRule> parse(std::string_view text)
+	{
+		LifeRule rule;
+		rule.birth = 0;
+		rule.survive = 0;
+
+		uint16_t* target = nullptr;
+		bool sawLetter = false;
+		bool afterSlash = false;
+		for (char c : text) {
+			if (c == 'B' || c == 'b') { target = &rule.birth; sawLetter = true; }
+			else if (c == 'S' || c == 's') { target = &rule.survive; sawLetter = true; }
+			else if (c == '/') {
+				afterSlash = true;
+				//Old style: survive counts come first, birth after the slash.
+				if (!sawLetter) target = &rule.birth;
+			}
+			else if (c >= '0' && c <= '8') {
+				if (!target) {
+					if (sawLetter || afterSlash) return std::nullopt;
+					target = &rule.survive;
+				}
+				*target |= (uint16_t)(1 << (c - '0'));
+			}
+			else if (!std::isspace((unsigned char)c)) return std::nullopt;
+		}
+		if (!sawLetter && !afterSlash) return std::nullopt;
+		return rule;
+	}
+
+	std::string toString() const
+	{
+		std::string text = "B";
+		for (int neighbors = 0; neighbors <= 8; neighbors++) if (isBorn(neighbors)) text += char('0' + neighbors);
+		text += "/S";
+		for (int neighbors = 0; neighbors <= 8; neighbors++) if (survives(neighbors)) text += char('0' + neighbors);
+		return text;
+	}
+};
+
+#endif //LIFE_RULE_HPP
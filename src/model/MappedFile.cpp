@@ -0,0 +1,80 @@
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+    error_.clear();
+
+#if !defined(_WIN32)
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        error_ = "Could not open " + path;
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode)) {
+        size_t size = (size_t)status.st_size;
+        if (size == 0) {
+            ::close(descriptor);
+            isOpen_ = true;
+            return true;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED) {
+            //The parser reads front to back once, so read ahead aggressively and drop pages behind it.
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            ::close(descriptor);
+            data_ = static_cast<const char*>(mapping);
+            size_ = size;
+            isMapped_ = true;
+            isOpen_ = true;
+            return true;
+        }
+    }
+    ::close(descriptor);
+#endif
+
+    //Pipes, special files and platforms without mmap.
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error_ = "Could not open " + path;
+        return false;
+    }
+    contents_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (file.bad()) {
+        contents_.clear();
+        error_ = "Could not read " + path;
+        return false;
+    }
+    data_ = contents_.data();
+    size_ = contents_.size();
+    isOpen_ = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+#if !defined(_WIN32)
+    if (isMapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+    contents_.clear();
+    contents_.shrink_to_fit();
+    data_ = nullptr;
+    size_ = 0;
+    isMapped_ = false;
+    isOpen_ = false;
+}
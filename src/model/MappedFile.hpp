@@ -0,0 +1,37 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//A whole file as read only text. On POSIX systems it is mapped rather than read, so a pattern of hundreds
+//of megabytes is parsed straight out of the page cache without a copy; elsewhere it is read into memory.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return isOpen_; }
+	std::string_view getText() const { return std::string_view(data_, size_); }
+	size_t getSize() const { return size_; }
+	const std::string& getError() const { return error_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool isOpen_ = false;
+	bool isMapped_ = false;
+	//Used when the file can't be mapped.
+	std::string contents_;
+	std::string error_;
+};
+
+#endif //MAPPED_FILE_HPP
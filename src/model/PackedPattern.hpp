@@ -0,0 +1,106 @@
+#ifndef PACKED_PATTERN_HPP
+#define PACKED_PATTERN_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//A pattern as packed rows, laid out like GridEngine's: bit (column % 64) of word (column / 64), each row
+//wordsPerRow words. Built in patterns are decoded from RLE by PackedRle::decode() while compiling, so the
+//words sit in read only data, nothing runs at startup and placing one on a board is a copy.
+struct PackedPattern
+{
+	int width = 0;
+	int height = 0;
+	int wordsPerRow = 0;
+	const uint64_t* words = nullptr;
+
+	constexpr bool isEmpty() const { return words == nullptr; }
+	constexpr const uint64_t* getRow(int row) const { return words + (size_t)row * wordsPerRow; }
+	constexpr bool getCell(int row, int column) const { return (getRow(row)[column / 64] >> (column % 64)) & 1; }
+};
+
+//The runs of an RLE body decoded at compile time from a constexpr string_view with static storage:
+//
+//	inline constexpr std::string_view gliderRle = "bo$2bo$3o!";
+//	constexpr PackedPattern glider = PackedRle::decode<gliderRle>();
+//
+//The text is taken by reference, so symbols carry the variable's name rather than the whole pattern.
+//Only the runs are read, with no x = header; b and . are dead, o is alive, $ ends a row and ! the pattern.
+//Malformed text stops the build at the call to invalidRle().
+namespace PackedRle
+{
+	//Not constexpr, so reaching it while decoding at compile time is an error that points at the message.
+	inline void invalidRle(const char*) {}
+
+	struct Size
+	{
+		//Of the live cells, from the top left corner the runs start at.
+		int width = 0;
+		int height = 0;
+	};
+
+	//Calls liveRun(row, column, length) for each run of live cells and returns the size they cover.
+	template<typename LiveRun>
+	constexpr Size forEachRun(std::string_view text, LiveRun liveRun)
+	{
+		Size size;
+		int row = 0;
+		int column = 0;
+		int count = 0;
+		for (char c : text) {
+			if (c >= '0' && c <= '9') {
+				count = count * 10 + (c - '0');
+				continue;
+			}
+			int run = (count > 0) ? count : 1;
+			count = 0;
+			if (c == 'o') {
+				liveRun(row, column, run);
+				column += run;
+				if (column > size.width) size.width = column;
+				size.height = row + 1;
+			}
+			else if (c == 'b' || c == '.') column += run;
+			else if (c == '$') {
+				row += run;
+				column = 0;
+			}
+			else if (c == '!') return size;
+			else if (c != ' ' && c != '\n' && c != '\r' && c != '\t') invalidRle("unexpected character in RLE");
+		}
+		invalidRle("RLE should end with !");
+		return size;
+	}
+
+	template<const std::string_view& Text>
+	struct Decoded
+	{
+		static constexpr Size size = forEachRun(Text, [](int, int, int) {});
+		static constexpr int wordsPerRow = (size.width + 63) / 64;
+		static constexpr std::array<uint64_t, (size_t)wordsPerRow * size.height> words = []() {
+			std::array<uint64_t, (size_t)wordsPerRow * size.height> words{};
+			forEachRun(Text, [&words](int row, int column, int length) {
+				uint64_t* rowWords = &words[(size_t)row * wordsPerRow];
+				for (int end = column + length; column < end; ) {
+					int bit = column % 64;
+					int bits = (end - column < 64 - bit) ? end - column : 64 - bit;
+					uint64_t mask = (bits == 64) ? ~0ull : ((1ull << bits) - 1);
+					rowWords[column / 64] |= mask << bit;
+					column += bits;
+				}
+			});
+			return words;
+		}();
+	};
+
+	template<const std::string_view& Text>
+	constexpr PackedPattern decode()
+	{
+		using Pattern = Decoded<Text>;
+		return PackedPattern{ Pattern::size.width, Pattern::size.height, Pattern::wordsPerRow, Pattern::words.data() };
+	}
+}
+
+#endif //PACKED_PATTERN_HPP
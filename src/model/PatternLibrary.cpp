@@ -0,0 +1,424 @@
+#include "PatternLibrary.hpp"
+#include "MappedFile.hpp"
+#include "RleParser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <unordered_map>
+
+namespace
+{
+    constexpr std::string_view INDEX_VERSION = "gol-library-index 1";
+
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && std::isspace((unsigned char)text.front())) text.remove_prefix(1);
+        while (!text.empty() && std::isspace((unsigned char)text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    std::string toLower(std::string_view text)
+    {
+        std::string lower(text);
+        for (char& c : lower) c = (char)std::tolower((unsigned char)c);
+        return lower;
+    }
+
+    bool lessIgnoringCase(std::string_view left, std::string_view right)
+    {
+        return std::lexicographical_compare(left.begin(), left.end(), right.begin(), right.end(),
+            [](char a, char b) { return std::tolower((unsigned char)a) < std::tolower((unsigned char)b); });
+    }
+
+    bool isPatternFile(const std::filesystem::path& path)
+    {
+        std::string extension = toLower(path.extension().string());
+        return extension == ".rle" || extension == ".mc";
+    }
+
+    //Tabs and line breaks would split the index's lines and fields.
+    std::string clean(std::string_view text)
+    {
+        std::string cleaned(trim(text));
+        for (char& c : cleaned) if (c == '\t' || c == '\r' || c == '\n') c = ' ';
+        return cleaned;
+    }
+
+    int readNumber(std::string_view text, size_t position)
+    {
+        int number = 0;
+        std::from_chars(text.data() + position, text.data() + text.size(), number);
+        return number;
+    }
+
+    //Patterns say their period many ways: "period 46", "period-3", "p138 oscillator", "still life".
+    int findPeriod(std::string_view comment)
+    {
+        std::string lower = toLower(comment);
+        std::string_view text = lower;
+
+        size_t found = text.find("period");
+        while (found != std::string_view::npos) {
+            size_t position = found + 6;
+            while (position < text.size() && (text[position] == ' ' || text[position] == '-' || text[position] == ':' || text[position] == '=')) position++;
+            if (position < text.size() && std::isdigit((unsigned char)text[position])) return readNumber(text, position);
+            found = text.find("period", found + 6);
+        }
+        if (text.find("still life") != std::string_view::npos) return 1;
+
+        for (size_t position = 0; position + 1 < text.size(); position++) {
+            if (text[position] != 'p' || !std::isdigit((unsigned char)text[position + 1])) continue;
+            if (position > 0 && std::isalnum((unsigned char)text[position - 1])) continue;
+            size_t end = position + 1;
+            while (end < text.size() && std::isdigit((unsigned char)text[end])) end++;
+            if (end < text.size() && std::isalpha((unsigned char)text[end])) continue;
+            return readNumber(text, position + 1);
+        }
+        return 0;
+    }
+
+    std::vector<std::string_view> splitFields(std::string_view line)
+    {
+        std::vector<std::string_view> fields;
+        size_t start = 0;
+        while (true) {
+            size_t end = line.find('\t', start);
+            fields.push_back(line.substr(start, end - start));
+            if (end == std::string_view::npos) return fields;
+            start = end + 1;
+        }
+    }
+
+    template<typename T>
+    bool parseField(std::string_view field, T& value)
+    {
+        auto [end, status] = std::from_chars(field.data(), field.data() + field.size(), value);
+        return status == std::errc() && end == field.data() + field.size();
+    }
+
+    //Entries from the last scan, by file. A missing or unreadable index is just empty.
+    std::unordered_map<std::string, PatternLibrary::Entry> readIndex(const std::filesystem::path& path)
+    {
+        std::unordered_map<std::string, PatternLibrary::Entry> index;
+        MappedFile file;
+        if (!file.open(path.string())) return index;
+
+        std::string_view text = file.getText();
+        size_t position = 0;
+        bool first = true;
+        while (position < text.size()) {
+            size_t lineEnd = text.find('\n', position);
+            if (lineEnd == std::string_view::npos) lineEnd = text.size();
+            std::string_view line = text.substr(position, lineEnd - position);
+            position = lineEnd + 1;
+
+            if (first) {
+                if (trim(line) != INDEX_VERSION) return index;
+                first = false;
+                continue;
+            }
+            std::vector<std::string_view> fields = splitFields(line);
+            if (fields.size() != 8) continue;
+
+            PatternLibrary::Entry entry;
+            entry.file = fields[0];
+            if (!parseField(fields[1], entry.fileSize) || !parseField(fields[2], entry.modifiedTime)
+                || !parseField(fields[3], entry.width) || !parseField(fields[4], entry.height)
+                || !parseField(fields[5], entry.period)) continue;
+            entry.rule = fields[6];
+            entry.name = fields[7];
+            index[entry.file] = std::move(entry);
+        }
+        return index;
+    }
+
+    //Written aside and renamed over the old one, so a crash never leaves half an index.
+    bool writeIndex(const std::filesystem::path& path, const std::vector<PatternLibrary::Entry>& entries)
+    {
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file << INDEX_VERSION << '\n';
+            for (const PatternLibrary::Entry& entry : entries) {
+                //A file name with a tab or line break can't be stored without changing it, so it is left out
+                //and its header read again next scan.
+                if (entry.file != clean(entry.file)) continue;
+                file << entry.file << '\t' << entry.fileSize << '\t' << entry.modifiedTime << '\t'
+                    << entry.width << '\t' << entry.height << '\t' << entry.period << '\t'
+                    << entry.rule << '\t' << entry.name << '\n';
+            }
+            if (!file.flush()) return false;
+        }
+        std::error_code code;
+        std::filesystem::rename(temporaryPath, path, code);
+        if (code) std::filesystem::remove(temporaryPath, code);
+        return !code;
+    }
+}
+
+PatternLibrary::~PatternLibrary()
+{
+    cancel();
+    if (worker_.joinable()) worker_.join();
+}
+
+void PatternLibrary::scan(const std::string& directory)
+{
+    //Only one scan at a time. The old worker notices the flag before its next file.
+    cancel();
+    if (worker_.joinable()) worker_.join();
+
+    {
+        std::lock_guard lock(mutex_);
+        resultReady_ = false;
+        pendingEntries_.clear();
+        message_.clear();
+    }
+    cancelled_ = false;
+    progress_ = 0.0f;
+    scanning_ = true;
+    worker_ = std::thread([this, directory]() {
+        std::vector<Entry> entries;
+        std::string error;
+        ScanStats stats;
+        bool scanned = scanDirectory(directory, entries, error, &stats, &progress_, &cancelled_);
+        {
+            std::lock_guard lock(mutex_);
+            if (scanned) {
+                pendingDirectory_ = directory;
+                pendingEntries_ = std::move(entries);
+                resultReady_ = true;
+                char summary[160];
+                std::snprintf(summary, sizeof(summary), "%zu patterns, %zu headers read in %.2f s%s",
+                    stats.files, stats.headersRead, stats.seconds, stats.indexSaved ? "" : ", index not saved");
+                message_ = summary;
+                if (stats.failed > 0) message_ += ", " + std::to_string(stats.failed) + " unreadable";
+            }
+            else {
+                message_ = cancelled_ ? "Scan cancelled" : error;
+            }
+        }
+        if (!scanned && !cancelled_) std::cerr << error << std::endl;
+        progress_ = scanned ? 1.0f : 0.0f;
+        scanning_ = false;
+        if (finishedCallback_) finishedCallback_();
+    });
+}
+
+void PatternLibrary::cancel()
+{
+    cancelled_ = true;
+}
+
+std::string PatternLibrary::getStatusText() const
+{
+    if (scanning_) return "Scanning...";
+    std::lock_guard lock(mutex_);
+    return message_;
+}
+
+bool PatternLibrary::takeResult()
+{
+    if (scanning_) return false;
+
+    std::lock_guard lock(mutex_);
+    if (!resultReady_) return false;
+    directory_ = std::move(pendingDirectory_);
+    entries_ = std::move(pendingEntries_);
+    pendingEntries_.clear();
+    resultReady_ = false;
+    buildSearchText_();
+    return true;
+}
+
+std::string PatternLibrary::getPath(const Entry& entry) const
+{
+    return (std::filesystem::path(directory_) / std::filesystem::path(entry.file)).string();
+}
+
+void PatternLibrary::search(std::string_view query, std::vector<int>& matches) const
+{
+    std::vector<std::string> words;
+    size_t position = 0;
+    while (position < query.size()) {
+        size_t end = position;
+        while (end < query.size() && !std::isspace((unsigned char)query[end])) end++;
+        if (end > position) words.push_back(toLower(query.substr(position, end - position)));
+        position = end + 1;
+    }
+
+    matches.clear();
+    matches.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); i++) {
+        const std::string& text = searchText_[i];
+        bool matched = std::all_of(words.begin(), words.end(),
+            [&text](const std::string& word) { return text.find(word) != std::string::npos; });
+        if (matched) matches.push_back((int)i);
+    }
+}
+
+bool PatternLibrary::scanDirectory(
+    const std::string& directory,
+    std::vector<Entry>& entries,
+    std::string& error,
+    ScanStats* stats,
+    std::atomic<float>* progress,
+    const std::atomic<bool>* cancelled)
+{
+    namespace fs = std::filesystem;
+    auto startTime = std::chrono::steady_clock::now();
+    ScanStats scanStats;
+    entries.clear();
+
+    std::error_code code;
+    fs::path root(directory);
+    if (!fs::is_directory(root, code)) {
+        error = directory + " is not a directory";
+        return false;
+    }
+
+    //Sizes and times first, so progress can count files.
+    fs::recursive_directory_iterator iterator(root, fs::directory_options::skip_permission_denied, code);
+    if (code) {
+        error = "Could not read " + directory + ": " + code.message();
+        return false;
+    }
+    for (; iterator != fs::recursive_directory_iterator(); iterator.increment(code)) {
+        if (code) break;
+        if (cancelled && *cancelled) {
+            error = "Scan cancelled";
+            return false;
+        }
+        const fs::directory_entry& file = *iterator;
+        if (!file.is_regular_file(code) || !isPatternFile(file.path())) continue;
+
+        Entry entry;
+        entry.file = file.path().lexically_relative(root).generic_string();
+        entry.fileSize = file.file_size(code);
+        if (code) continue;
+        entry.modifiedTime = (long long)file.last_write_time(code).time_since_epoch().count();
+        if (code) continue;
+        entries.push_back(std::move(entry));
+    }
+    if (code) {
+        error = "Could not read " + directory + ": " + code.message();
+        return false;
+    }
+
+    fs::path indexPath = root / INDEX_FILE_NAME;
+    std::unordered_map<std::string, Entry> index = readIndex(indexPath);
+    size_t reused = 0;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (cancelled && *cancelled) {
+            error = "Scan cancelled";
+            return false;
+        }
+        if (progress) *progress = (float)i / (float)entries.size();
+
+        Entry& entry = entries[i];
+        auto indexed = index.find(entry.file);
+        if (indexed != index.end() && indexed->second.fileSize == entry.fileSize && indexed->second.modifiedTime == entry.modifiedTime) {
+            entries[kept++] = std::move(indexed->second);
+            reused++;
+            continue;
+        }
+
+        scanStats.headersRead++;
+        MappedFile file;
+        entry.name = fs::path(entry.file).stem().string();
+        if (!file.open((root / fs::path(entry.file)).string()) || !readHeader(file.getText(), entry)) {
+            scanStats.failed++;
+            continue;
+        }
+        entry.name = clean(entry.name);
+        entry.rule = clean(entry.rule);
+        if (kept != i) entries[kept] = std::move(entry);
+        kept++;
+    }
+    entries.resize(kept);
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& left, const Entry& right) {
+        if (lessIgnoringCase(left.name, right.name)) return true;
+        if (lessIgnoringCase(right.name, left.name)) return false;
+        return left.file < right.file;
+    });
+
+    //A read only directory still gets listed; it is just read in full every time.
+    bool indexChanged = reused != kept || reused != index.size();
+    scanStats.indexSaved = !indexChanged || writeIndex(indexPath, entries);
+    scanStats.files = entries.size();
+    scanStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (stats) *stats = scanStats;
+    return true;
+}
+
+bool PatternLibrary::readHeader(std::string_view text, Entry& entry)
+{
+    bool macrocell = text.substr(0, 4) == "[M2]";
+    entry.rule = LifeRule().toString();
+    entry.width = 0;
+    entry.height = 0;
+    entry.period = 0;
+
+    //Comments come first. Only the lines before the pattern itself are looked at.
+    size_t position = macrocell ? text.find('\n') : 0;
+    while (position < text.size()) {
+        size_t lineEnd = text.find('\n', position);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        std::string_view line = trim(text.substr(position, lineEnd - position));
+        position = lineEnd + 1;
+
+        if (line.empty()) continue;
+        if (line.front() != '#') break;
+        char kind = (line.size() > 1) ? line[1] : ' ';
+        std::string_view content = trim(line.substr(std::min<size_t>(line.size(), 2)));
+        if (kind == 'N' && !content.empty()) entry.name = content;
+        if (kind == 'R' && macrocell) {
+            std::optional<LifeRule> rule = LifeRule::parse(content);
+            if (!rule) return false;
+            entry.rule = rule->toString();
+        }
+        if (entry.period == 0 && (kind == 'C' || kind == 'c' || kind == 'N' || kind == 'O' || kind == 'D')) entry.period = findPeriod(content);
+    }
+    if (macrocell) return true;
+
+    RleParser::Header header;
+    std::string_view body;
+    RleParser::Error error;
+    if (!RleParser::parseHeader(text, header, body, error)) return false;
+    entry.width = header.width;
+    entry.height = header.height;
+    if (header.rule) entry.rule = header.rule->toString();
+    return true;
+}
+
+void PatternLibrary::buildSearchText_()
+{
+    searchText_.clear();
+    searchText_.reserve(entries_.size());
+    for (const Entry& entry : entries_) {
+        //Line breaks keep a word from matching across two fields.
+        std::string text = toLower(entry.name);
+        text += '\n';
+        text += toLower(entry.rule);
+        text += '\n';
+        if (entry.period > 0) {
+            text += 'p';
+            text += std::to_string(entry.period);
+        }
+        text += '\n';
+        text += toLower(entry.file);
+        searchText_.push_back(std::move(text));
+    }
+}
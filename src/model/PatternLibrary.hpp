@@ -0,0 +1,117 @@
+#ifndef PATTERN_LIBRARY_HPP
+#define PATTERN_LIBRARY_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//A directory of RLE and macrocell files, listed by name, size, rule and period without loading any of them.
+//A scan reads only the # comments and the x = header of each file, mapped rather than read, and keeps what
+//it found in an index file in the directory. The next scan trusts the index for every file whose size and
+//modification time haven't changed, so a corpus of thousands of patterns is only read in full once.
+//The pattern itself is parsed when it is chosen, by handing getPath() to a PatternLoader.
+//Scans run on a background thread; the owner polls takeResult() to swap the new list in.
+class PatternLibrary
+{
+public:
+	struct Entry
+	{
+		//Relative to the library's directory, with / between directories.
+		std::string file;
+		//From #N, or the file name without its extension.
+		std::string name;
+		//As B.../S..., B3/S23 when the file doesn't say.
+		std::string rule;
+		//From x = and y =. 0 for macrocell files, which don't give their size up front.
+		int width = 0;
+		int height = 0;
+		//From the comments, e.g. "period 46", "p138" or "still life". 0 if they don't say.
+		int period = 0;
+		uint64_t fileSize = 0;
+		long long modifiedTime = 0;
+	};
+
+	struct ScanStats
+	{
+		size_t files = 0;
+		//Files whose header had to be read because the index was missing or out of date.
+		size_t headersRead = 0;
+		//Files left out because their header couldn't be read.
+		size_t failed = 0;
+		bool indexSaved = false;
+		double seconds = 0.0;
+	};
+
+	constexpr static const char* INDEX_FILE_NAME = ".gol-library-index";
+
+	PatternLibrary() = default;
+	~PatternLibrary();
+
+	PatternLibrary(const PatternLibrary&) = delete;
+	PatternLibrary& operator=(const PatternLibrary&) = delete;
+
+	//Starts scanning directory and everything under it on the worker thread. Cancels a scan already running.
+	void scan(const std::string& directory);
+	void cancel();
+
+	//Called from the worker thread when a scan finishes. Intended for waking the main loop.
+	void setFinishedCallback(std::function<void()> callback) { finishedCallback_ = std::move(callback); }
+
+	bool isScanning() const { return scanning_.load(); }
+	//0 to 1 while scanning.
+	float getProgress() const { return progress_.load(); }
+	std::string getStatusText() const;
+
+	//If a finished scan is waiting, make its entries the library's and return true.
+	bool takeResult();
+
+	//Entries sorted by name. Only changed by takeResult(), so safe to read on the thread that calls it.
+	const std::vector<Entry>& getEntries() const { return entries_; }
+	const std::string& getDirectory() const { return directory_; }
+	std::string getPath(const Entry& entry) const;
+
+	//Indices of the entries matching every word of query, ignoring case, in their name, rule, file or
+	//period written as p46. An empty query matches everything.
+	void search(std::string_view query, std::vector<int>& matches) const;
+
+	//The scan itself, run synchronously. Reads the index, reads the headers it is missing and writes it back.
+	static bool scanDirectory(
+		const std::string& directory,
+		std::vector<Entry>& entries,
+		std::string& error,
+		ScanStats* stats = nullptr,
+		std::atomic<float>* progress = nullptr,
+		const std::atomic<bool>* cancelled = nullptr);
+
+	//Fills in name, rule, size and period from the start of a pattern file. False if it isn't one.
+	static bool readHeader(std::string_view text, Entry& entry);
+
+private:
+	//Lower case name, rule, period and file of each entry, so searching doesn't convert anything.
+	void buildSearchText_();
+
+	std::thread worker_;
+	std::atomic<bool> cancelled_ = false;
+	std::atomic<bool> scanning_ = false;
+	std::atomic<float> progress_ = 0.0f;
+
+	mutable std::mutex mutex_;
+	bool resultReady_ = false;
+	std::string pendingDirectory_;
+	std::vector<Entry> pendingEntries_;
+	std::string message_;
+
+	std::string directory_;
+	std::vector<Entry> entries_;
+	std::vector<std::string> searchText_;
+
+	std::function<void()> finishedCallback_;
+};
+
+#endif //PATTERN_LIBRARY_HPP
@@ -0,0 +1,359 @@
+#include "PatternLoader.hpp"
+#include "MappedFile.hpp"
+#include "RleParser.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+namespace
+{
+    //Largest board a macrocell pattern is given. Anything bigger only makes sense on HashLife alone.
+    constexpr long long MAX_TREE_BOARD_CELLS = 1ll << 30;
+    //Plaintext spends a byte per cell, so a short file of blank lines can still ask for a huge board.
+    constexpr long long MAX_PLAINTEXT_BOARD_CELLS = 1ll << 30;
+}
+
+PatternLoader::~PatternLoader()
+{
+    cancel();
+    if (worker_.joinable()) worker_.join();
+}
+
+void PatternLoader::loadFile(ChooseFileFunction chooseFile, const ModelParameters& activeParameters)
+{
+    start_([this, chooseFile, activeParameters]() {
+        state_ = State::ChoosingFile;
+        std::string filePath = chooseFile(cancelled_);
+        if (cancelled_ || filePath.empty()) {
+            finish_(State::Cancelled);
+            return;
+        }
+
+        state_ = State::Loading;
+        MappedFile file;
+        if (!file.open(filePath)) {
+            finish_(State::Failed, file.getError());
+            return;
+        }
+
+        LoadedPattern pattern;
+        std::string error;
+        if (!parsePattern(file.getText(), activeParameters, pattern, &error, &progress_, &cancelled_, filePath)) {
+            finish_(cancelled_ ? State::Cancelled : State::Failed, "Could not parse " + filePath + ": " + error);
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            result_ = std::move(pattern);
+        }
+        finish_(State::Ready, filePath);
+    });
+}
+
+void PatternLoader::loadString(std::string rleString, const ModelParameters& activeParameters)
+{
+    start_([this, rleString = std::move(rleString), activeParameters]() {
+        state_ = State::Loading;
+        LoadedPattern pattern;
+        std::string error;
+        if (!parsePattern(rleString, activeParameters, pattern, &error, &progress_, &cancelled_)) {
+            finish_(cancelled_ ? State::Cancelled : State::Failed, "Could not parse RLE string: " + error);
+            return;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            result_ = std::move(pattern);
+        }
+        finish_(State::Ready);
+    });
+}
+
+void PatternLoader::cancel()
+{
+    cancelled_ = true;
+}
+
+bool PatternLoader::isBusy() const
+{
+    State state = state_.load();
+    return state == State::ChoosingFile || state == State::Loading;
+}
+
+std::string PatternLoader::getStatusText() const
+{
+    switch (state_.load())
+    {
+        case State::ChoosingFile: return "Choosing file...";
+        case State::Loading: return "Loading pattern...";
+        case State::Ready: return "Pattern ready";
+        case State::Cancelled: return "Load cancelled";
+        case State::Failed:
+        {
+            std::lock_guard lock(mutex_);
+            return message_;
+        }
+        default: return "";
+    }
+}
+
+bool PatternLoader::takeResult(LoadedPattern& pattern)
+{
+    if (state_.load() != State::Ready) return false;
+
+    std::lock_guard lock(mutex_);
+    if (!result_) return false;
+    pattern = std::move(*result_);
+    result_.reset();
+    state_ = State::Idle;
+    return true;
+}
+
+void PatternLoader::start_(std::function<void()> job)
+{
+    //Only one load at a time. The old worker notices the flag within its next megabyte of input.
+    cancel();
+    if (worker_.joinable()) worker_.join();
+
+    {
+        std::lock_guard lock(mutex_);
+        result_.reset();
+        message_.clear();
+    }
+    cancelled_ = false;
+    progress_ = 0.0f;
+    state_ = State::Loading;
+    worker_ = std::thread(std::move(job));
+}
+
+void PatternLoader::finish_(State state, std::string message)
+{
+    {
+        std::lock_guard lock(mutex_);
+        message_ = std::move(message);
+    }
+    progress_ = (state == State::Ready) ? 1.0f : 0.0f;
+    state_ = state;
+    if (state == State::Failed) std::cerr << message_ << std::endl;
+    if (finishedCallback_) finishedCallback_();
+}
+
+bool PatternLoader::parsePattern(
+    std::string_view text,
+    const ModelParameters& activeParameters,
+    LoadedPattern& pattern,
+    std::string* error,
+    std::atomic<float>* progress,
+    const std::atomic<bool>* cancelled,
+    std::string_view path)
+{
+    if (text.substr(0, 4) == "[M2]") return parseMacrocell(text, activeParameters, pattern, error);
+    if (isPlaintext(text, path)) return parsePlaintext(text, activeParameters, pattern, error, progress, cancelled);
+    return parseRLE(text, activeParameters, pattern, error, progress, cancelled);
+}
+
+bool PatternLoader::isPlaintext(std::string_view text, std::string_view path)
+{
+    auto hasExtension = [path](std::string_view extension) {
+        return path.size() >= extension.size() && std::equal(extension.begin(), extension.end(), path.end() - extension.size(),
+            [](char a, char b) { return a == (char)std::tolower((unsigned char)b); });
+    };
+    if (hasExtension(".cells")) return true;
+    //A .rle file that starts with ! is a broken RLE file, and should be reported as one.
+    if (hasExtension(".rle")) return false;
+    //RLE has no use for !, except at the very end.
+    return !text.empty() && text.front() == '!';
+}
+
+bool PatternLoader::parsePlaintext(
+    std::string_view text,
+    const ModelParameters& activeParameters,
+    LoadedPattern& pattern,
+    std::string* error,
+    std::atomic<float>* progress,
+    const std::atomic<bool>* cancelled)
+{
+    //Each line without its line break or a \r before it, with its 1 based number and where it starts.
+    auto forEachLine = [text](auto visit) {
+        size_t position = 0;
+        size_t line = 1;
+        while (position < text.size()) {
+            size_t lineEnd = text.find('\n', position);
+            if (lineEnd == std::string_view::npos) lineEnd = text.size();
+            std::string_view content = text.substr(position, lineEnd - position);
+            if (!content.empty() && content.back() == '\r') content.remove_suffix(1);
+            if (!visit(content, line, position)) return false;
+            position = lineEnd + 1;
+            line++;
+        }
+        return true;
+    };
+
+    //First pass: check every character and find the size. Blank lines at the end aren't rows.
+    int width = 0;
+    int height = 0;
+    long long rows = 0;
+    bool valid = forEachLine([&](std::string_view content, size_t line, size_t) {
+        if (!content.empty() && content.front() == '!') return true;
+        for (size_t column = 0; column < content.size(); column++) {
+            char c = content[column];
+            if (c != '.' && c != 'O' && c != 'o' && c != '*') {
+                if (error) *error = RleParser::Error{ line, column + 1, "unexpected '" + std::string(1, c) + "' in a plaintext pattern" }.toString();
+                return false;
+            }
+        }
+        rows++;
+        if (content.empty()) return true;
+        if ((long long)std::max<size_t>(width, content.size()) * rows > MAX_PLAINTEXT_BOARD_CELLS) {
+            if (error) *error = RleParser::Error{ line, 1, "pattern is too big for the board" }.toString();
+            return false;
+        }
+        width = (int)std::max<size_t>(width, content.size());
+        height = (int)rows;
+        return true;
+    });
+    if (!valid) return false;
+
+    ModelParameters params = activeParameters;
+    params.minWidth = width;
+    params.minHeight = height;
+    params.modelWidth = std::max<int>(params.modelWidth, params.minWidth);
+    params.modelHeight = std::max<int>(params.modelHeight, params.minHeight);
+    pattern.cells.assign((size_t)params.modelWidth * params.modelHeight, 0);
+    const size_t originColumn = (size_t)((params.modelWidth / 2) - (params.minWidth / 2));
+    const size_t originRow = (size_t)((params.modelHeight - params.minHeight) / 2);
+
+    //Second pass: write the live cells. Everything was checked above, so only cancelling stops it.
+    int row = 0;
+    size_t nextCheck = 0;
+    valid = forEachLine([&](std::string_view content, size_t, size_t position) {
+        if (position >= nextCheck) {
+            if (cancelled && *cancelled) return false;
+            if (progress) *progress = (float)position / (float)text.size();
+            nextCheck = position + ((size_t)1 << 20);
+        }
+        if (!content.empty() && content.front() == '!') return true;
+        if (row >= height) return true;
+        uint8_t* cells = pattern.cells.data() + (originRow + row) * (size_t)params.modelWidth + originColumn;
+        for (size_t column = 0; column < content.size(); column++) cells[column] = (content[column] != '.') ? 1 : 0;
+        row++;
+        return true;
+    });
+    if (!valid) {
+        if (error) error->clear();
+        return false;
+    }
+
+    pattern.parameters = params;
+    pattern.parameters.random = false;
+    return true;
+}
+
+bool PatternLoader::parseRLE(
+    std::string_view text,
+    const ModelParameters& activeParameters,
+    LoadedPattern& pattern,
+    std::string* error,
+    std::atomic<float>* progress,
+    const std::atomic<bool>* cancelled)
+{
+    RleParser::Header header;
+    RleParser::Error parseError;
+    std::string_view body;
+    auto failed = [&]() {
+        if (error) *error = parseError.toString();
+        return false;
+    };
+    if (!RleParser::parseHeader(text, header, body, parseError)) return failed();
+    //Only x = 0, y = 0 makes an empty pattern. Anything else needs runs, and parseBody() says where they are missing,
+    //so text that isn't RLE at all doesn't load as an empty board.
+    const bool explicitlyEmpty = header.present && header.width == 0 && header.height == 0;
+
+    ModelParameters params = activeParameters;
+    if (header.width > 0) params.minWidth = header.width;
+    if (header.height > 0) params.minHeight = header.height;
+    params.ruleString.clear();
+    if (header.rule) applyRule_(params, *header.rule);
+
+    params.modelWidth = std::max<int>(params.modelWidth, params.minWidth);
+    params.modelHeight = std::max<int>(params.modelHeight, params.minHeight);
+    pattern.cells.assign((size_t)params.modelWidth * params.modelHeight, 0);
+
+    RleParser::Target target;
+    target.cells = pattern.cells.data();
+    target.width = params.modelWidth;
+    target.height = params.modelHeight;
+    target.originColumn = (params.modelWidth / 2) - (params.minWidth / 2);
+    target.originRow = (params.modelHeight - params.minHeight) / 2;
+    if (!RleParser::parseBody(body, header.bodyLine, target, !explicitlyEmpty, parseError, progress, cancelled)) return failed();
+
+    pattern.parameters = params;
+    pattern.parameters.random = false;
+    return true;
+}
+
+bool PatternLoader::parseMacrocell(
+    std::string_view text,
+    const ModelParameters& activeParameters,
+    LoadedPattern& pattern,
+    std::string* error)
+{
+    ModelParameters params = activeParameters;
+    auto tree = std::make_unique<HashLifeEngine>();
+    //Without a rule in the file, keep the one already in use.
+    tree->setRule(LifeRule::fromParameters(params));
+    HashLifeEngine::MacrocellHeader header;
+    std::string parseError;
+    if (!tree->loadMacrocell(text, header, parseError)) {
+        if (error) *error = parseError;
+        return false;
+    }
+    params.ruleString.clear();
+    if (header.rule) applyRule_(params, *header.rule);
+
+    HashLifeEngine::Bounds bounds = tree->getBounds();
+    if (!bounds.isEmpty()) {
+        long long width = bounds.right - bounds.left + 1;
+        long long height = bounds.bottom - bounds.top + 1;
+        if (width * height > MAX_TREE_BOARD_CELLS) {
+            if (error) *error = "pattern is " + std::to_string(width) + "x" + std::to_string(height) + " cells, too big for the board";
+            return false;
+        }
+        params.minWidth = (int)width;
+        params.minHeight = (int)height;
+    }
+    params.modelWidth = std::max<int>(params.modelWidth, params.minWidth);
+    params.modelHeight = std::max<int>(params.modelHeight, params.minHeight);
+    //Same placement as RLE.
+    if (!bounds.isEmpty()) {
+        long long column = (params.modelWidth / 2) - (params.minWidth / 2);
+        long long row = (params.modelHeight - params.minHeight) / 2;
+        tree->translate(column - bounds.left, row - bounds.top);
+    }
+
+    pattern.cells.clear();
+    pattern.tree = std::move(tree);
+    pattern.generation = header.generation;
+    pattern.parameters = params;
+    pattern.parameters.random = false;
+    return true;
+}
+
+void PatternLoader::applyRule_(ModelParameters& parameters, const LifeRule& rule)
+{
+    parameters.ruleString = rule.toString();
+    //Show the rule in the gui's three inputs too when it fits them: one birth count and a survival range.
+    auto isSinglePowerOfTwo = [](unsigned bits) { return bits != 0 && (bits & (bits - 1)) == 0; };
+    int lowest = 0;
+    while (lowest < 8 && !rule.survives(lowest)) lowest++;
+    unsigned survivors = rule.survive >> lowest;
+    if (isSinglePowerOfTwo(rule.birth) && rule.survive != 0 && isSinglePowerOfTwo(survivors + 1)) {
+        int born = 0;
+        while (!rule.isBorn(born)) born++;
+        int highest = lowest;
+        while (highest < 8 && rule.survives(highest + 1)) highest++;
+        parameters.rule1 = lowest;
+        parameters.rule3 = highest;
+        parameters.rule4 = born;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef PATTERN_LOADER_HPP
+#define PATTERN_LOADER_HPP
+
+#include "HashLifeEngine.hpp"
+#include "modelparameters.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//A board built from a pattern, ready to be swapped in for the live one.
+struct LoadedPattern
+{
+	//The active parameters with the pattern's size and rules applied.
+	ModelParameters parameters;
+	//Alive flags, row major, parameters.modelWidth * parameters.modelHeight.
+	std::vector<uint8_t> cells;
+	//Macrocell patterns are kept as a HashLife tree, already placed on the board, and cells is left empty.
+	std::unique_ptr<HashLifeEngine> tree;
+	long long generation = 0;
+};
+
+//Loads RLE and macrocell patterns on a background thread so a large file doesn't freeze the window.
+//The owner polls takeResult() between generations and swaps the board in when one is ready.
+//Only one load runs at a time; starting a new one cancels the old one.
+class PatternLoader
+{
+public:
+	enum class State
+	{
+		Idle,
+		ChoosingFile,
+		Loading,
+		Ready,
+		Failed,
+		Cancelled
+	};
+
+	//Runs on the worker thread and returns the chosen path, or an empty string if the user backed out.
+	//It should give up promptly once cancelled becomes true.
+	using ChooseFileFunction = std::function<std::string(const std::atomic<bool>& cancelled)>;
+
+	PatternLoader() = default;
+	~PatternLoader();
+
+	void loadFile(ChooseFileFunction chooseFile, const ModelParameters& activeParameters);
+	void loadString(std::string rleString, const ModelParameters& activeParameters);
+	void cancel();
+
+	//Called from the worker thread when a load finishes, fails or is cancelled. Intended for waking the main loop.
+	void setFinishedCallback(std::function<void()> callback) { finishedCallback_ = std::move(callback); }
+
+	bool isBusy() const;
+	State getState() const { return state_.load(); }
+	//0 to 1 while loading.
+	float getProgress() const { return progress_.load(); }
+	std::string getStatusText() const;
+
+	//If a finished board is waiting, move it into pattern and return true.
+	bool takeResult(LoadedPattern& pattern);
+
+	//Macrocell if the text starts with a macrocell header, plaintext if isPlaintext(), RLE otherwise.
+	//path is only looked at for its extension, and may be left empty.
+	static bool parsePattern(
+		std::string_view text,
+		const ModelParameters& activeParameters,
+		LoadedPattern& pattern,
+		std::string* error = nullptr,
+		std::atomic<float>* progress = nullptr,
+		const std::atomic<bool>* cancelled = nullptr,
+		std::string_view path = {});
+
+	//A .cells path, or text whose first line is a ! comment such as !Name:, unless the path ends in .rle.
+	static bool isPlaintext(std::string_view text, std::string_view path = {});
+
+	//Parse RLE text into a board. The text is read in place; only the board itself is allocated.
+	//Returns false if cancelled became true or the text is malformed, in which case error says where.
+	static bool parseRLE(
+		std::string_view text,
+		const ModelParameters& activeParameters,
+		LoadedPattern& pattern,
+		std::string* error = nullptr,
+		std::atomic<float>* progress = nullptr,
+		const std::atomic<bool>* cancelled = nullptr);
+
+	//Parse plaintext into a board: ! comment lines, then a line per row with . for dead and O for alive.
+	//Short lines are padded with dead cells. The text is read in place, and the board keeps the rule in use.
+	static bool parsePlaintext(
+		std::string_view text,
+		const ModelParameters& activeParameters,
+		LoadedPattern& pattern,
+		std::string* error = nullptr,
+		std::atomic<float>* progress = nullptr,
+		const std::atomic<bool>* cancelled = nullptr);
+
+	//Build the pattern's tree without expanding it. The board is sized to fit it as for RLE, so it
+	//fails if the pattern is too big to ever show on a grid.
+	static bool parseMacrocell(
+		std::string_view text,
+		const ModelParameters& activeParameters,
+		LoadedPattern& pattern,
+		std::string* error = nullptr);
+
+private:
+	//Sets the parameters' rule to a pattern's own rule.
+	static void applyRule_(ModelParameters& parameters, const LifeRule& rule);
+	void start_(std::function<void()> job);
+	void finish_(State state, std::string message = "");
+
+	std::thread worker_;
+	std::atomic<bool> cancelled_ = false;
+	std::atomic<State> state_ = State::Idle;
+	std::atomic<float> progress_ = 0.0f;
+
+	mutable std::mutex mutex_;
+	std::optional<LoadedPattern> result_;
+	std::string message_;
+
+	std::function<void()> finishedCallback_;
+};
+
+#endif //PATTERN_LOADER_HPP
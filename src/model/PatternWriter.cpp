@@ -0,0 +1,219 @@
+#include "PatternWriter.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+    constexpr int BITS_PER_WORD = 64;
+    constexpr size_t BUFFER_BYTES = (size_t)1 << 20;
+    //Longest line in an RLE body, by convention.
+    constexpr int RLE_LINE_LENGTH = 70;
+
+    //Collects output and passes it to the stream a buffer at a time.
+    class OutputBuffer
+    {
+    public:
+        explicit OutputBuffer(std::ostream& stream) : stream_(stream), buffer_(BUFFER_BYTES) {}
+
+        //Room for at least bytes more characters, to be written at the returned pointer and then committed.
+        char* reserve(size_t bytes)
+        {
+            if (used_ + bytes > buffer_.size()) flush();
+            if (bytes > buffer_.size()) buffer_.resize(bytes);
+            return buffer_.data() + used_;
+        }
+        void commit(size_t bytes) { used_ += bytes; }
+
+        void append(std::string_view text)
+        {
+            std::copy(text.begin(), text.end(), reserve(text.size()));
+            commit(text.size());
+        }
+        void append(char c, size_t count = 1)
+        {
+            while (count > 0) {
+                size_t chunk = std::min(count, BUFFER_BYTES);
+                std::fill_n(reserve(chunk), chunk, c);
+                commit(chunk);
+                count -= chunk;
+            }
+        }
+        bool flush()
+        {
+            if (used_ > 0) stream_.write(buffer_.data(), (std::streamsize)used_);
+            used_ = 0;
+            return (bool)stream_;
+        }
+
+    private:
+        std::ostream& stream_;
+        std::vector<char> buffer_;
+        size_t used_ = 0;
+    };
+
+    //Calls runFunction(length, alive) for each run of cells in columns [left, end) of a row, left to right,
+    //except a trailing dead one. A run starts where a cell differs from the one before it, so each word's run
+    //boundaries are the set bits of the word XORed with itself shifted by one, and a word with none costs one test.
+    template <typename RunFunction>
+    void forEachRun(const uint64_t* row, int left, int end, RunFunction runFunction)
+    {
+        const int firstWord = left / BITS_PER_WORD;
+        const int lastWord = (end - 1) / BITS_PER_WORD;
+        uint64_t previousBit = 0;
+        bool alive = false;
+        int runStart = left;
+        for (int wordIndex = firstWord; wordIndex <= lastWord; wordIndex++) {
+            uint64_t word = row[wordIndex];
+            if (wordIndex == firstWord) word &= ~0ull << (left % BITS_PER_WORD);
+            if (wordIndex == lastWord && end % BITS_PER_WORD != 0) word &= ~(~0ull << (end % BITS_PER_WORD));
+            uint64_t boundaries = word ^ ((word << 1) | previousBit);
+            previousBit = word >> (BITS_PER_WORD - 1);
+            while (boundaries != 0) {
+                int column = wordIndex * BITS_PER_WORD + std::countr_zero(boundaries);
+                boundaries &= boundaries - 1;
+                if (column > runStart) runFunction(column - runStart, alive);
+                runStart = column;
+                alive = !alive;
+            }
+        }
+        if (alive) runFunction(end - runStart, true);
+    }
+
+    //RLE body tokens, wrapped so no line passes RLE_LINE_LENGTH and no token is split.
+    class RunWriter
+    {
+    public:
+        explicit RunWriter(OutputBuffer& output) : output_(output) {}
+
+        void run(long long count, char symbol)
+        {
+            if (count <= 0) return;
+            //A count, the symbol and a line break always fit.
+            constexpr size_t MAX_TOKEN = 24;
+            char* token = output_.reserve(MAX_TOKEN + 1);
+            char* end = token;
+            if (count > 1) end = std::to_chars(token, token + MAX_TOKEN, count).ptr;
+            *end++ = symbol;
+            int length = (int)(end - token);
+            if (lineLength_ + length > RLE_LINE_LENGTH) {
+                std::copy_backward(token, end, end + 1);
+                *token = '\n';
+                output_.commit(1);
+                lineLength_ = 0;
+            }
+            output_.commit((size_t)length);
+            lineLength_ += length;
+        }
+        void finish()
+        {
+            run(1, '!');
+            output_.append('\n');
+        }
+
+    private:
+        OutputBuffer& output_;
+        int lineLength_ = 0;
+    };
+
+    void writeRLE(const GridEngine& board, const GridEngine::Stats& stats, OutputBuffer& output)
+    {
+        const int width = stats.isEmpty() ? 0 : stats.right - stats.left + 1;
+        const int height = stats.isEmpty() ? 0 : stats.bottom - stats.top + 1;
+        output.append("x = " + std::to_string(width) + ", y = " + std::to_string(height) + ", rule = " + board.getRule().toString() + "\n");
+
+        RunWriter runs(output);
+        //Blank rows, and the row breaks before them, are held back until a live cell shows they weren't trailing.
+        long long pendingRows = 0;
+        for (int row = stats.top; row <= stats.bottom; row++) {
+            bool started = false;
+            forEachRun(board.getRow(row), stats.left, stats.right + 1, [&](int length, bool alive) {
+                if (!started) {
+                    runs.run(pendingRows, '$');
+                    pendingRows = 0;
+                    started = true;
+                }
+                runs.run(length, alive ? 'o' : 'b');
+            });
+            pendingRows++;
+        }
+        runs.finish();
+    }
+
+    void writePlaintext(const GridEngine& board, const GridEngine::Stats& stats, OutputBuffer& output)
+    {
+        //Trailing dead cells are left off each line, as other programs do.
+        for (int row = stats.top; !stats.isEmpty() && row <= stats.bottom; row++) {
+            forEachRun(board.getRow(row), stats.left, stats.right + 1, [&](int length, bool alive) {
+                output.append(alive ? 'O' : '.', (size_t)length);
+            });
+            output.append('\n');
+        }
+    }
+}
+
+PatternWriter::Format PatternWriter::getFormat(std::string_view path)
+{
+    auto hasExtension = [path](std::string_view extension) {
+        return path.size() >= extension.size() &&
+            std::equal(extension.begin(), extension.end(), path.end() - extension.size(),
+                [](char a, char b) { return a == (char)std::tolower((unsigned char)b); });
+    };
+    if (hasExtension(".cells")) return Format::Plaintext;
+    if (hasExtension(".mc")) return Format::Macrocell;
+    return Format::RLE;
+}
+
+bool PatternWriter::write(const GridEngine& board, std::ostream& stream, Format format, std::string_view comment)
+{
+    if (format == Format::Macrocell) {
+        HashLifeEngine tree;
+        tree.setRule(board.getRule());
+        tree.loadFromGrid(board);
+        return tree.saveMacrocell(stream, 0, comment);
+    }
+
+    OutputBuffer output(stream);
+    const GridEngine::Stats& stats = board.getStats();
+    if (!comment.empty()) {
+        output.append(format == Format::Plaintext ? "!" : "#C ");
+        output.append(comment);
+        output.append('\n');
+    }
+    if (format == Format::Plaintext) writePlaintext(board, stats, output);
+    else writeRLE(board, stats, output);
+    return output.flush();
+}
+
+bool PatternWriter::save(const GridEngine& board, const std::string& path, Format format, std::string& error, std::string_view comment)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    if (!write(board, file, format, comment) || !file.flush()) {
+        error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool PatternWriter::save(const HashLifeEngine& tree, const std::string& path, std::string& error, long long generation, std::string_view comment)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    if (!tree.saveMacrocell(file, generation, comment) || !file.flush()) {
+        error = "Could not write " + path;
+        return false;
+    }
+    return true;
+}
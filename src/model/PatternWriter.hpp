@@ -0,0 +1,36 @@
+#ifndef PATTERN_WRITER_HPP
+#define PATTERN_WRITER_HPP
+
+#include "GridEngine.hpp"
+#include "HashLifeEngine.hpp"
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+//Writes the live part of a board out as a pattern file, the reverse of PatternLoader.
+//Rows are read a packed word at a time and runs are found with bit scans, so empty stretches cost one
+//compare per 64 cells. Output is built in a large buffer and handed to the stream in big blocks.
+namespace PatternWriter
+{
+	enum class Format
+	{
+		RLE,
+		Plaintext,
+		Macrocell
+	};
+
+	constexpr static const char* FormatNames[3] = { "RLE", "Plaintext", "Macrocell" };
+
+	//Plaintext for .cells, macrocell for .mc, RLE for anything else.
+	Format getFormat(std::string_view path);
+
+	//Only the bounding box of the live cells is written. comment goes in a comment line at the top if not empty.
+	//Macrocell output builds a HashLife tree of the board first.
+	bool write(const GridEngine& board, std::ostream& stream, Format format, std::string_view comment = {});
+	bool save(const GridEngine& board, const std::string& path, Format format, std::string& error, std::string_view comment = {});
+	//A tree is written as a macrocell as it stands, without expanding it.
+	bool save(const HashLifeEngine& tree, const std::string& path, std::string& error, long long generation = 0, std::string_view comment = {});
+}
+
+#endif //PATTERN_WRITER_HPP
@@ -0,0 +1,372 @@
+#include "PosterExporter.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#if defined(GOL_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+namespace
+{
+    constexpr int BITS_PER_WORD = 64;
+    //Raw image bytes in each band. A few of these per thread is all the memory an export takes.
+    constexpr size_t BAND_BYTES = (size_t)4 << 20;
+    //PNG wants IDAT chunks under 2^31 bytes; smaller keeps each one's CRC pass in cache.
+    constexpr size_t MAX_CHUNK_BYTES = (size_t)1 << 20;
+    constexpr size_t MAX_STORED_BLOCK = 65535;
+    constexpr uint32_t ADLER_BASE = 65521;
+
+    constexpr std::array<uint32_t, 256> makeCrcTable()
+    {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t index = 0; index < 256; index++) {
+            uint32_t crc = index;
+            for (int bit = 0; bit < 8; bit++) crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+            table[index] = crc;
+        }
+        return table;
+    }
+    constexpr std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+    uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size)
+    {
+        crc = ~crc;
+        for (size_t index = 0; index < size; index++) crc = CRC_TABLE[(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    uint32_t adler32(const uint8_t* data, size_t size)
+    {
+        uint32_t a = 1;
+        uint32_t b = 0;
+        while (size > 0) {
+            //The most bytes that can be summed before b could overflow 32 bits.
+            size_t chunk = std::min<size_t>(size, 5552);
+            for (size_t index = 0; index < chunk; index++) {
+                a += data[index];
+                b += a;
+            }
+            a %= ADLER_BASE;
+            b %= ADLER_BASE;
+            data += chunk;
+            size -= chunk;
+        }
+        return (b << 16) | a;
+    }
+
+    //Adler-32 of two pieces back to back, from each piece's own, as zlib's adler32_combine.
+    uint32_t combineAdler32(uint32_t first, uint32_t second, uint64_t secondSize)
+    {
+        uint32_t remainder = (uint32_t)(secondSize % ADLER_BASE);
+        uint32_t sum1 = first & 0xFFFF;
+        uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % ADLER_BASE);
+        sum1 += (second & 0xFFFF) + ADLER_BASE - 1;
+        sum2 += ((first >> 16) & 0xFFFF) + ((second >> 16) & 0xFFFF) + ADLER_BASE - remainder;
+        if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+        if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+        if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+        if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+        return (sum2 << 16) | sum1;
+    }
+
+    void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back((uint8_t)(value >> shift));
+    }
+
+    //Appends a whole PNG chunk: length, type, data and CRC.
+    void putChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size)
+    {
+        putBigEndian(out, (uint32_t)size);
+        size_t crcStart = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size > 0) out.insert(out.end(), data, data + size);
+        putBigEndian(out, updateCrc(0, &out[crcStart], out.size() - crcStart));
+    }
+
+    //Live cells among columns [begin, end) of a packed row.
+    int countLive(const uint64_t* row, int begin, int end)
+    {
+        int firstWord = begin / BITS_PER_WORD;
+        int lastWord = (end - 1) / BITS_PER_WORD;
+        uint64_t firstMask = ~0ull << (begin % BITS_PER_WORD);
+        uint64_t lastMask = (end % BITS_PER_WORD == 0) ? ~0ull : ~(~0ull << (end % BITS_PER_WORD));
+        if (firstWord == lastWord) return std::popcount(row[firstWord] & firstMask & lastMask);
+        int count = std::popcount(row[firstWord] & firstMask) + std::popcount(row[lastWord] & lastMask);
+        for (int word = firstWord + 1; word < lastWord; word++) count += std::popcount(row[word]);
+        return count;
+    }
+
+    //Everything a band needs between rendering and writing.
+    struct Band
+    {
+        int rowBegin = 0;
+        int rowEnd = 0;
+        std::vector<uint8_t> raw;
+        std::vector<uint8_t> encoded;
+        uint32_t adler = 1;
+    };
+
+    class Exporter
+    {
+    public:
+        Exporter(const GridEngine& board, const PosterExporter::Settings& settings, PosterExporter::Format format) :
+            board_(board),
+            settings_(settings),
+            format_(format),
+            cellsPerPixel_(std::max(settings.cellsPerPixel, 1)),
+            pixelsPerCell_(std::max(settings.pixelsPerCell, 1))
+        {
+            blockColumns_ = (board.getWidth() + cellsPerPixel_ - 1) / cellsPerPixel_;
+            blockRows_ = (board.getHeight() + cellsPerPixel_ - 1) / cellsPerPixel_;
+            width_ = (long long)blockColumns_ * pixelsPerCell_;
+            height_ = (long long)blockRows_ * pixelsPerCell_;
+            //PNG rows start with a filter type byte.
+            rowBytes_ = (format == PosterExporter::Format::Png) ? (size_t)width_ + 1 : (size_t)width_ * 3;
+        }
+
+        long long getWidth() const { return width_; }
+        long long getHeight() const { return height_; }
+        size_t getBandRows() const { return std::max<size_t>(1, BAND_BYTES / rowBytes_); }
+
+        void render(Band& band) const
+        {
+            band.raw.resize((size_t)(band.rowEnd - band.rowBegin) * rowBytes_);
+            std::vector<uint8_t> indices(blockColumns_);
+            int indexedBlockRow = -1;
+            for (int row = band.rowBegin; row < band.rowEnd; row++) {
+                int blockRow = row / pixelsPerCell_;
+                if (blockRow != indexedBlockRow) {
+                    indexBlockRow_(blockRow, indices);
+                    indexedBlockRow = blockRow;
+                }
+                uint8_t* out = &band.raw[(size_t)(row - band.rowBegin) * rowBytes_];
+                if (format_ == PosterExporter::Format::Png) {
+                    *out++ = 0;
+                    for (int column = 0; column < blockColumns_; column++) out = std::fill_n(out, pixelsPerCell_, indices[column]);
+                }
+                else {
+                    for (int column = 0; column < blockColumns_; column++) {
+                        const FrameRecorder::Color& color = settings_.palette[indices[column]];
+                        for (int repeat = 0; repeat < pixelsPerCell_; repeat++) {
+                            *out++ = color.r;
+                            *out++ = color.g;
+                            *out++ = color.b;
+                        }
+                    }
+                }
+            }
+        }
+
+        //The band's piece of the zlib stream. Only the last band ends it.
+        bool compress(Band& band, bool last) const
+        {
+            band.adler = adler32(band.raw.data(), band.raw.size());
+            band.encoded.clear();
+#if defined(GOL_HAVE_ZLIB)
+            z_stream stream{};
+            if (deflateInit2(&stream, std::clamp(settings_.compressionLevel, 1, 9), Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+            band.encoded.resize(deflateBound(&stream, (uLong)band.raw.size()) + 16);
+            stream.next_in = band.raw.data();
+            stream.avail_in = (uInt)band.raw.size();
+            stream.next_out = band.encoded.data();
+            stream.avail_out = (uInt)band.encoded.size();
+            //A sync flush ends on a byte boundary without marking the last block, so the next band's stream follows on.
+            int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+            band.encoded.resize(stream.total_out);
+            deflateEnd(&stream);
+            return status == (last ? Z_STREAM_END : Z_OK) && stream.avail_in == 0;
+#else
+            //Stored blocks: a header byte, then the length and its complement, then the bytes as they are.
+            size_t position = 0;
+            do {
+                size_t size = std::min(band.raw.size() - position, MAX_STORED_BLOCK);
+                bool final = last && position + size == band.raw.size();
+                band.encoded.push_back(final ? 1 : 0);
+                band.encoded.push_back((uint8_t)(size & 0xFF));
+                band.encoded.push_back((uint8_t)(size >> 8));
+                band.encoded.push_back((uint8_t)(~size & 0xFF));
+                band.encoded.push_back((uint8_t)((~size >> 8) & 0xFF));
+                band.encoded.insert(band.encoded.end(), band.raw.begin() + position, band.raw.begin() + position + size);
+                position += size;
+            } while (position < band.raw.size());
+            return true;
+#endif
+        }
+
+    private:
+        //Palette index of each block along one row of blocks.
+        void indexBlockRow_(int blockRow, std::vector<uint8_t>& indices) const
+        {
+            int cellRowBegin = blockRow * cellsPerPixel_;
+            int cellRowEnd = std::min(cellRowBegin + cellsPerPixel_, board_.getHeight());
+            if (cellsPerPixel_ == 1) {
+                const uint64_t* cells = board_.getRow(cellRowBegin);
+                for (int column = 0; column < blockColumns_; column++) {
+                    indices[column] = ((cells[column / BITS_PER_WORD] >> (column % BITS_PER_WORD)) & 1) ? 255 : 0;
+                }
+                return;
+            }
+            for (int column = 0; column < blockColumns_; column++) {
+                int cellColumnBegin = column * cellsPerPixel_;
+                int cellColumnEnd = std::min(cellColumnBegin + cellsPerPixel_, board_.getWidth());
+                long long live = 0;
+                for (int row = cellRowBegin; row < cellRowEnd; row++) live += countLive(board_.getRow(row), cellColumnBegin, cellColumnEnd);
+                long long cells = (long long)(cellRowEnd - cellRowBegin) * (cellColumnEnd - cellColumnBegin);
+                indices[column] = (uint8_t)((live * 255 + cells / 2) / cells);
+            }
+        }
+
+        const GridEngine& board_;
+        const PosterExporter::Settings& settings_;
+        PosterExporter::Format format_;
+        int cellsPerPixel_;
+        int pixelsPerCell_;
+        int blockColumns_ = 0;
+        int blockRows_ = 0;
+        long long width_ = 0;
+        long long height_ = 0;
+        size_t rowBytes_ = 0;
+    };
+}
+
+PosterExporter::Format PosterExporter::getFormat(std::string_view path)
+{
+    size_t dot = path.rfind('.');
+    std::string extension(dot == std::string_view::npos ? std::string_view() : path.substr(dot));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return (extension == ".ppm") ? Format::Ppm : Format::Png;
+}
+
+FrameRecorder::Palette PosterExporter::getGrayscalePalette()
+{
+    FrameRecorder::Palette palette;
+    for (int index = 0; index < 256; index++) palette[index] = FrameRecorder::Color{ (uint8_t)index, (uint8_t)index, (uint8_t)index };
+    return palette;
+}
+
+bool PosterExporter::save(const GridEngine& board, const std::string& path, const Settings& settings, std::string& error, Result* result)
+{
+    auto start = std::chrono::steady_clock::now();
+    Format format = getFormat(path);
+    if (board.getWidth() <= 0 || board.getHeight() <= 0) {
+        error = "The board is empty";
+        return false;
+    }
+    Exporter exporter(board, settings, format);
+    if (exporter.getWidth() > INT32_MAX || exporter.getHeight() > INT32_MAX) {
+        error = "The image would be more than 2^31 pixels a side; use more cells per pixel";
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        error = "Could not open " + path + " for writing";
+        return false;
+    }
+    uint64_t bytesWritten = 0;
+    auto write = [&](const std::vector<uint8_t>& bytes) {
+        file.write(reinterpret_cast<const char*>(bytes.data()), (std::streamsize)bytes.size());
+        bytesWritten += bytes.size();
+    };
+
+    std::vector<uint8_t> out;
+    if (format == Format::Png) {
+        const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        out.assign(signature, signature + sizeof(signature));
+        std::vector<uint8_t> header;
+        putBigEndian(header, (uint32_t)exporter.getWidth());
+        putBigEndian(header, (uint32_t)exporter.getHeight());
+        //8 bit palette indices, no interlacing.
+        const uint8_t rest[] = { 8, 3, 0, 0, 0 };
+        header.insert(header.end(), rest, rest + sizeof(rest));
+        putChunk(out, "IHDR", header.data(), header.size());
+        std::vector<uint8_t> palette;
+        for (const FrameRecorder::Color& color : settings.palette) {
+            palette.push_back(color.r);
+            palette.push_back(color.g);
+            palette.push_back(color.b);
+        }
+        putChunk(out, "PLTE", palette.data(), palette.size());
+        //zlib header: deflate with a 32 KiB window.
+        const uint8_t zlibHeader[] = { 0x78, 0x01 };
+        putChunk(out, "IDAT", zlibHeader, sizeof(zlibHeader));
+    }
+    else {
+        std::string header = "P6\n" + std::to_string(exporter.getWidth()) + " " + std::to_string(exporter.getHeight()) + "\n255\n";
+        out.insert(out.end(), header.begin(), header.end());
+    }
+    write(out);
+
+    int threadCount = (settings.threadCount > 0) ? settings.threadCount : (int)std::max(std::thread::hardware_concurrency(), 1u);
+    WorkerPool workers(threadCount);
+    std::vector<Band> bands(threadCount);
+    const int height = (int)exporter.getHeight();
+    const int bandRows = (int)std::min<size_t>(exporter.getBandRows(), (size_t)height);
+    uint32_t adler = 1;
+    bool compressed = true;
+
+    for (int groupStart = 0; groupStart < height && compressed && file; groupStart += bandRows * threadCount) {
+        int bandCount = std::min(threadCount, (height - groupStart + bandRows - 1) / bandRows);
+        std::vector<uint8_t> failed(bandCount, 0);
+        workers.run(bandCount, [&](int index) {
+            Band& band = bands[index];
+            band.rowBegin = groupStart + index * bandRows;
+            band.rowEnd = std::min(band.rowBegin + bandRows, height);
+            exporter.render(band);
+            if (format == Format::Png && !exporter.compress(band, band.rowEnd == height)) failed[index] = 1;
+        });
+        for (int index = 0; index < bandCount && file; index++) {
+            Band& band = bands[index];
+            if (failed[index]) {
+                compressed = false;
+                break;
+            }
+            if (format == Format::Ppm) {
+                write(band.raw);
+                continue;
+            }
+            adler = (band.rowBegin == 0) ? band.adler : combineAdler32(adler, band.adler, band.raw.size());
+            out.clear();
+            for (size_t position = 0; position < band.encoded.size(); position += MAX_CHUNK_BYTES) {
+                putChunk(out, "IDAT", band.encoded.data() + position, std::min(MAX_CHUNK_BYTES, band.encoded.size() - position));
+            }
+            write(out);
+        }
+    }
+    if (!compressed) {
+        error = "Could not compress " + path;
+        return false;
+    }
+
+    if (format == Format::Png) {
+        out.clear();
+        std::vector<uint8_t> checksum;
+        putBigEndian(checksum, adler);
+        putChunk(out, "IDAT", checksum.data(), checksum.size());
+        putChunk(out, "IEND", nullptr, 0);
+        write(out);
+    }
+    file.close();
+    if (!file) {
+        error = "Could not write " + path;
+        return false;
+    }
+
+    if (result) {
+        result->width = (int)exporter.getWidth();
+        result->height = (int)exporter.getHeight();
+        result->bytesWritten = bytesWritten;
+        result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef POSTER_EXPORTER_HPP
+#define POSTER_EXPORTER_HPP
+
+#include "FrameRecorder.hpp"
+#include "GridEngine.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//Renders a whole board into one image file, however big, without ever holding the image in memory.
+//The image is cut into bands of rows. A group of bands, one per thread, is rendered and compressed at
+//once, then written out in order before the next group starts, so memory stays at a few bands a thread.
+//PNG is 8 bit indexed with the palette as its color table. Every band is its own deflate stream flushed
+//to a byte boundary, so the bands join into one valid zlib stream. Without zlib at build time the
+//bands are stored uncompressed. PPM is plain RGB.
+namespace PosterExporter
+{
+	enum class Format
+	{
+		Png,
+		Ppm
+	};
+
+	constexpr static const char* FormatNames[2] = { "PNG", "PPM" };
+
+	struct Settings
+	{
+		//Each pixel is the share of live cells in a square of cellsPerPixel cells a side, as a palette
+		//index from 0 for empty to 255 for full. At 1 a live cell is 255 and a dead one 0.
+		int cellsPerPixel = 1;
+		//Each of those pixels drawn as a square this many pixels a side, for small boards.
+		int pixelsPerCell = 1;
+		FrameRecorder::Palette palette;
+		//0 for one per core.
+		int threadCount = 0;
+		//zlib level for PNG, 1 fastest to 9 smallest.
+		int compressionLevel = 1;
+	};
+
+	struct Result
+	{
+		int width = 0;
+		int height = 0;
+		uint64_t bytesWritten = 0;
+		double seconds = 0.0;
+	};
+
+	//PPM for .ppm, otherwise PNG.
+	Format getFormat(std::string_view path);
+
+	//Live cells white on black, the shades between showing how full each pixel's square is.
+	FrameRecorder::Palette getGrayscalePalette();
+
+	bool save(const GridEngine& board, const std::string& path, const Settings& settings, std::string& error, Result* result = nullptr);
+}
+
+#endif //POSTER_EXPORTER_HPP
@@ -0,0 +1,292 @@
+#include "RleParser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    //Progress and cancellation are checked once per chunk, not per character.
+    constexpr size_t CHECK_INTERVAL_BYTES = (size_t)1 << 20;
+    //Counts past this are surely corrupt, and keep the position arithmetic well inside long long.
+    constexpr long long MAX_RUN = std::numeric_limits<int>::max();
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && (isSpace(text.front()) || text.front() == '\n')) text.remove_prefix(1);
+        while (!text.empty() && (isSpace(text.back()) || text.back() == '\n')) text.remove_suffix(1);
+        return text;
+    }
+
+    //Line and column of position within text, counting from firstLine. Only used once something went wrong.
+    void locate(std::string_view text, size_t position, size_t firstLine, RleParser::Error& error)
+    {
+        error.line = firstLine;
+        size_t lineStart = 0;
+        for (size_t index = 0; index < position && index < text.size(); index++) {
+            if (text[index] == '\n') {
+                error.line++;
+                lineStart = index + 1;
+            }
+        }
+        error.column = position - lineStart + 1;
+    }
+
+    bool fail(std::string_view text, size_t position, size_t firstLine, std::string message, RleParser::Error& error)
+    {
+        locate(text, position, firstLine, error);
+        error.message = std::move(message);
+        return false;
+    }
+
+    enum class CharacterClass : uint8_t
+    {
+        Invalid,
+        Digit,
+        Dead,
+        Alive,
+        Row,
+        End,
+        Newline,
+        Space,
+        Comment
+    };
+
+    //One lookup per character instead of a chain of comparisons.
+    //b is dead and o alive; other letters are states of multi-state rules, which count as alive here.
+    constexpr std::array<CharacterClass, 256> makeCharacterClasses()
+    {
+        std::array<CharacterClass, 256> classes{};
+        for (int c = '0'; c <= '9'; c++) classes[c] = CharacterClass::Digit;
+        for (int c = 'a'; c <= 'z'; c++) classes[c] = CharacterClass::Alive;
+        for (int c = 'A'; c <= 'Z'; c++) classes[c] = CharacterClass::Alive;
+        classes['b'] = CharacterClass::Dead;
+        classes['$'] = CharacterClass::Row;
+        classes['!'] = CharacterClass::End;
+        classes['\n'] = CharacterClass::Newline;
+        classes[' '] = CharacterClass::Space;
+        classes['\t'] = CharacterClass::Space;
+        classes['\r'] = CharacterClass::Space;
+        classes['#'] = CharacterClass::Comment;
+        return classes;
+    }
+    constexpr std::array<CharacterClass, 256> CHARACTER_CLASSES = makeCharacterClasses();
+
+    std::string describeCharacter(char c)
+    {
+        if ((unsigned char)c >= 0x20 && (unsigned char)c < 0x7F) return std::string("'") + c + "'";
+        char code[8];
+        std::snprintf(code, sizeof(code), "0x%02X", (unsigned char)c);
+        return code;
+    }
+}
+
+std::string RleParser::Error::toString() const
+{
+    if (line == 0) return message;
+    return "line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + message;
+}
+
+bool RleParser::parseHeader(std::string_view text, Header& header, std::string_view& body, Error& error)
+{
+    header = Header();
+    size_t position = 0;
+    size_t line = 1;
+    while (position < text.size()) {
+        size_t lineEnd = text.find('\n', position);
+        if (lineEnd == std::string_view::npos) lineEnd = text.size();
+        std::string_view content = trim(text.substr(position, lineEnd - position));
+
+        if (content.empty() || content.front() == '#') {
+            position = lineEnd + 1;
+            line++;
+            continue;
+        }
+        if (content.front() != 'x' && content.front() != 'X') break;
+        header.present = true;
+
+        //Comma separated key = value pairs. Keys other than x, y and rule are ignored.
+        size_t fieldStart = 0;
+        while (fieldStart <= content.size()) {
+            size_t fieldEnd = content.find(',', fieldStart);
+            if (fieldEnd == std::string_view::npos) fieldEnd = content.size();
+            std::string_view field = content.substr(fieldStart, fieldEnd - fieldStart);
+            size_t fieldPosition = (size_t)(content.data() - text.data()) + fieldStart;
+
+            size_t equals = field.find('=');
+            if (equals == std::string_view::npos) {
+                fieldStart = fieldEnd + 1;
+                if (trim(field).empty()) continue;
+                return fail(text, fieldPosition, 1, "expected key = value in the header", error);
+            }
+            std::string_view key = trim(field.substr(0, equals));
+            std::string_view value = trim(field.substr(equals + 1));
+            if (key == "rule") {
+                //The rule comes last and may itself hold commas, as in B3/S23:T100,100.
+                value = trim(content.substr(fieldStart + equals + 1));
+                fieldEnd = content.size();
+            }
+            fieldStart = fieldEnd + 1;
+
+            if (key == "x" || key == "X" || key == "y" || key == "Y") {
+                int number = 0;
+                auto [end, status] = std::from_chars(value.data(), value.data() + value.size(), number);
+                if (status != std::errc() || end != value.data() + value.size() || number < 0) {
+                    return fail(text, fieldPosition, 1, "header " + std::string(key) + " should be a whole number", error);
+                }
+                ((key == "x" || key == "X") ? header.width : header.height) = number;
+            }
+            else if (key == "rule") {
+                //Drop a bounded grid suffix such as B3/S23:T100,100; the board here is always a torus.
+                std::string_view ruleText = value.substr(0, value.find(':'));
+                header.rule = LifeRule::parse(ruleText);
+                if (!header.rule) return fail(text, fieldPosition, 1, "unsupported rule " + std::string(value), error);
+            }
+        }
+        position = lineEnd + 1;
+        line++;
+        break;
+    }
+
+    position = std::min(position, text.size());
+    body = text.substr(position);
+    header.bodyLine = line;
+    return true;
+}
+
+bool RleParser::parseBody(
+    std::string_view body,
+    size_t firstLine,
+    const Target& target,
+    bool requireRuns,
+    Error& error,
+    std::atomic<float>* progress,
+    const std::atomic<bool>* cancelled,
+    float progressBegin,
+    float progressEnd)
+{
+    const char* const begin = body.data();
+    const char* const end = begin + body.size();
+    const char* cursor = begin;
+    const char* nextCheck = begin + std::min(body.size(), CHECK_INTERVAL_BYTES);
+
+    //Board position of the next cell, and the start of its row if the row is on the board.
+    long long row = target.originRow;
+    long long column = target.originColumn;
+    uint8_t* rowCells = nullptr;
+    auto enterRow = [&]() {
+        rowCells = (row >= 0 && row < target.height) ? target.cells + row * target.width : nullptr;
+    };
+    enterRow();
+    long long count = 0;
+    bool haveCount = false;
+    bool lineStart = true;
+    bool sawRun = false;
+
+    //Runs are short in most patterns, so rather than a call per run each one stores a whole word of its value
+    //and only runs past WINDOW cells need a fill. A store reaching beyond its run leaves at most WINDOW - 1
+    //stray cells after it, which the next run or the end of the row overwrites before anything reads them.
+    constexpr long long WINDOW = sizeof(uint64_t);
+    const long long fastLimit = (long long)target.width - WINDOW;
+    auto clearWindow = [&]() {
+        if (!rowCells) return;
+        long long first = std::max<long long>(column, 0);
+        long long last = std::min<long long>(column + WINDOW, target.width);
+        if (first < last) std::memset(rowCells + first, 0, (size_t)(last - first));
+    };
+    auto writeRun = [&](long long length, uint8_t value) {
+        if (!rowCells) return;
+        if (column >= 0 && column + length <= fastLimit) {
+            uint64_t word = value * 0x0101010101010101ull;
+            std::memcpy(rowCells + column, &word, sizeof(word));
+            if (length > WINDOW && value) std::memset(rowCells + column + WINDOW, 1, (size_t)(length - WINDOW));
+            return;
+        }
+        //Near or past an edge: clip, and clear what an earlier store may have left.
+        clearWindow();
+        long long first = std::max<long long>(column, 0);
+        long long last = std::min<long long>(column + length, target.width);
+        if (value && first < last) std::memset(rowCells + first, 1, (size_t)(last - first));
+    };
+
+    while (cursor < end) {
+        if (cursor >= nextCheck) {
+            if (cancelled && *cancelled) {
+                error = Error();
+                return false;
+            }
+            if (progress) *progress = progressBegin + (progressEnd - progressBegin) * (float)(cursor - begin) / (float)body.size();
+            nextCheck = std::min(end, nextCheck + CHECK_INTERVAL_BYTES);
+        }
+
+        CharacterClass characterClass = CHARACTER_CLASSES[(unsigned char)*cursor];
+        if (characterClass == CharacterClass::Digit) {
+            //A whole count at once. Ten digits can't overflow, so only longer counts need checking.
+            const char* digits = cursor;
+            count = 0;
+            do {
+                count = count * 10 + (*cursor - '0');
+                cursor++;
+            } while (cursor < end && CHARACTER_CLASSES[(unsigned char)*cursor] == CharacterClass::Digit && cursor - digits < 10);
+            if (count > MAX_RUN || (cursor < end && CHARACTER_CLASSES[(unsigned char)*cursor] == CharacterClass::Digit)) {
+                return fail(body, digits - begin, firstLine, "run count too large", error);
+            }
+            haveCount = true;
+            lineStart = false;
+            continue;
+        }
+
+        long long run = (haveCount && count > 0) ? count : 1;
+        switch (characterClass) {
+        case CharacterClass::Dead:
+        case CharacterClass::Alive:
+            writeRun(run, characterClass == CharacterClass::Alive);
+            sawRun = true;
+            column += run;
+            if (column > MAX_RUN + (long long)target.originColumn) return fail(body, cursor - begin, firstLine, "pattern is too wide", error);
+            break;
+        case CharacterClass::Row:
+            clearWindow();
+            sawRun = true;
+            row += run;
+            column = target.originColumn;
+            if (row > MAX_RUN + (long long)target.originRow) return fail(body, cursor - begin, firstLine, "pattern is too tall", error);
+            enterRow();
+            break;
+        case CharacterClass::End:
+            clearWindow();
+            if (requireRuns && !sawRun) return fail(body, cursor - begin, firstLine, "no cells before '!'; only an x = 0, y = 0 header makes an empty pattern", error);
+            return true;
+        case CharacterClass::Newline:
+            lineStart = true;
+            cursor++;
+            continue;
+        case CharacterClass::Space:
+            cursor++;
+            continue;
+        case CharacterClass::Comment:
+            //Some writers put comments between the lines of runs.
+            if (!lineStart || haveCount) return fail(body, cursor - begin, firstLine, "unexpected '#'", error);
+            cursor = std::find(cursor, end, '\n');
+            continue;
+        default:
+            return fail(body, cursor - begin, firstLine, "unexpected " + describeCharacter(*cursor), error);
+        }
+        haveCount = false;
+        lineStart = false;
+        cursor++;
+    }
+
+    clearWindow();
+    if (haveCount) return fail(body, body.size(), firstLine, "run count with no cell after it", error);
+    if (requireRuns && !sawRun) return fail(body, body.size(), firstLine, "no cells; only an x = 0, y = 0 header makes an empty pattern", error);
+    return true;
+}
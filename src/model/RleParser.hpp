@@ -0,0 +1,71 @@
+#ifndef RLE_PARSER_HPP
+#define RLE_PARSER_HPP
+
+#include "LifeRule.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+//Run length encoded patterns, parsed straight out of a buffer such as a MappedFile.
+//Nothing is copied or allocated per line or per run: counts are read digit by digit, and each run of
+//live cells is written into the target with one fill. Malformed input is reported with its line and column.
+namespace RleParser
+{
+	struct Header
+	{
+		//Pattern size from x = and y =, or 0 without a header.
+		int width = 0;
+		int height = 0;
+		//From rule =, if the header has one.
+		std::optional<LifeRule> rule;
+		//True if there was an x = ... line, so a width and height of 0 were given rather than left out.
+		bool present = false;
+		//Line the runs start on, 1 based.
+		size_t bodyLine = 1;
+	};
+
+	struct Error
+	{
+		//1 based. 0 if the problem isn't tied to a place in the text.
+		size_t line = 0;
+		size_t column = 0;
+		std::string message;
+
+		std::string toString() const;
+	};
+
+	//Where the cells go: one byte per cell, row major, all dead to begin with. Runs falling outside are clipped.
+	struct Target
+	{
+		uint8_t* cells = nullptr;
+		int width = 0;
+		int height = 0;
+		//Board position of the pattern's top left cell.
+		int originRow = 0;
+		int originColumn = 0;
+	};
+
+	//Skips the # comment lines and reads the x = ..., y = ..., rule = ... line if there is one.
+	//body is set to the rest of the text.
+	bool parseHeader(std::string_view text, Header& header, std::string_view& body, Error& error);
+
+	//Expands the runs up to ! or the end of the text. Returns false on malformed input, or with an empty
+	//message if cancelled became true. progress goes from progressBegin to progressEnd.
+	//With requireRuns, a body without a single run is malformed rather than an empty pattern.
+	bool parseBody(
+		std::string_view body,
+		size_t firstLine,
+		const Target& target,
+		bool requireRuns,
+		Error& error,
+		std::atomic<float>* progress = nullptr,
+		const std::atomic<bool>* cancelled = nullptr,
+		float progressBegin = 0.0f,
+		float progressEnd = 1.0f);
+}
+
+#endif //RLE_PARSER_HPP
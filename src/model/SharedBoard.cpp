@@ -0,0 +1,291 @@
+#include "SharedBoard.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t PAGE_BYTES = 4096;
+    //A reader gives up on a frame after this many tries; only a publisher far faster than a copy gets there.
+    constexpr int MAX_READ_ATTEMPTS = 64;
+    constexpr uint32_t NO_FRAME = 2;
+
+    size_t roundUpToPage(size_t bytes)
+    {
+        return (bytes + PAGE_BYTES - 1) / PAGE_BYTES * PAGE_BYTES;
+    }
+
+    //POSIX wants one leading slash and no others.
+    std::string getSegmentName(const std::string& name)
+    {
+        return (!name.empty() && name[0] == '/') ? name : "/" + name;
+    }
+}
+
+bool SharedBoard::isSupported()
+{
+#if !defined(_WIN32)
+    return true;
+#else
+    return false;
+#endif
+}
+
+SharedBoard::Publisher::~Publisher()
+{
+    stop();
+}
+
+bool SharedBoard::Publisher::start(const std::string& name, std::string& error)
+{
+    stop();
+    if (!isSupported()) {
+        error = "Sharing the board needs POSIX shared memory, which this platform doesn't have";
+        return false;
+    }
+    if (name.empty() || name.find('/', 1) != std::string::npos) {
+        error = "A shared memory name can't be empty or have / after the start, got " + name;
+        return false;
+    }
+    name_ = getSegmentName(name);
+    publishedCount_ = 0;
+    error_.clear();
+    publishing_ = true;
+    return true;
+}
+
+void SharedBoard::Publisher::stop()
+{
+    if (!publishing_) return;
+    release_(true);
+    publishing_ = false;
+}
+
+bool SharedBoard::Publisher::publish(const GridEngine& board, long long generation)
+{
+    if (!publishing_) return false;
+    const GridEngine::Words& words = board.getWords();
+    const size_t bytes = words.size() * sizeof(uint64_t);
+    if ((!layout_ || bytes > layout_->bufferBytes) && !create_(roundUpToPage(std::max(bytes, (size_t)1)))) return false;
+
+    //The buffer readers aren't pointed at. Anyone still reading it started a whole publish ago, and
+    //the odd sequence tells them to drop what they read.
+    uint32_t latest = layout_->latest.load(std::memory_order_relaxed);
+    uint32_t slotIndex = (latest == 0) ? 1 : 0;
+    Slot& slot = layout_->slots[slotIndex];
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.generation = generation;
+    slot.width = board.getWidth();
+    slot.height = board.getHeight();
+    slot.wordsPerRow = board.getWordsPerRow();
+    slot.population = board.getStats().population;
+    std::string rule = board.getRule().toString();
+    std::memset(slot.rule, 0, RULE_BYTES);
+    std::memcpy(slot.rule, rule.data(), std::min(rule.size(), RULE_BYTES - 1));
+    char* buffer = reinterpret_cast<char*>(layout_) + layout_->bufferOffsets[slotIndex];
+    std::memcpy(buffer, words.data(), bytes);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    layout_->latest.store(slotIndex, std::memory_order_release);
+    layout_->published.fetch_add(1, std::memory_order_relaxed);
+    publishedCount_++;
+    return true;
+}
+
+bool SharedBoard::Publisher::create_(size_t bufferBytes)
+{
+    release_(false);
+#if !defined(_WIN32)
+    //Readers of a segment already under this name, e.g. from a publisher that crashed, are told to move on.
+    int oldDescriptor = shm_open(name_.c_str(), O_RDWR, 0);
+    if (oldDescriptor >= 0) {
+        void* mapping = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, oldDescriptor, 0);
+        ::close(oldDescriptor);
+        if (mapping != MAP_FAILED) {
+            Layout* oldLayout = static_cast<Layout*>(mapping);
+            if (std::memcmp(oldLayout->magic, MAGIC, sizeof(MAGIC)) == 0) oldLayout->closed.store(1, std::memory_order_release);
+            munmap(mapping, sizeof(Layout));
+        }
+    }
+    shm_unlink(name_.c_str());
+
+    const size_t layoutBytes = roundUpToPage(sizeof(Layout));
+    const size_t segmentBytes = layoutBytes + 2 * bufferBytes;
+    int descriptor = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (descriptor < 0) {
+        error_ = "Could not create shared memory " + name_;
+        return false;
+    }
+    void* mapping = MAP_FAILED;
+    if (ftruncate(descriptor, (off_t)segmentBytes) == 0) {
+        mapping = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    }
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        error_ = "Could not map " + std::to_string(segmentBytes >> 20) + " MiB of shared memory for " + name_;
+        return false;
+    }
+
+    //Fresh from ftruncate, so everything else starts at zero.
+    layout_ = new (mapping) Layout{};
+    segmentBytes_ = segmentBytes;
+    std::memcpy(layout_->magic, MAGIC, sizeof(MAGIC));
+    layout_->version = VERSION;
+    layout_->layoutBytes = (uint32_t)sizeof(Layout);
+    layout_->bufferBytes = bufferBytes;
+    layout_->bufferOffsets[0] = layoutBytes;
+    layout_->bufferOffsets[1] = layoutBytes + bufferBytes;
+    layout_->publisherId = (int64_t)getpid();
+    layout_->latest.store(NO_FRAME, std::memory_order_release);
+    return true;
+#else
+    (void)bufferBytes;
+    error_ = "Sharing the board needs POSIX shared memory, which this platform doesn't have";
+    return false;
+#endif
+}
+
+void SharedBoard::Publisher::release_(bool unlink)
+{
+#if !defined(_WIN32)
+    if (!layout_) return;
+    layout_->closed.store(1, std::memory_order_release);
+    munmap(layout_, segmentBytes_);
+    //Readers keep what they have mapped; the name goes so nobody new opens a dead board.
+    if (unlink) shm_unlink(name_.c_str());
+#else
+    (void)unlink;
+#endif
+    layout_ = nullptr;
+    segmentBytes_ = 0;
+}
+
+SharedBoard::Reader::~Reader()
+{
+    close();
+}
+
+bool SharedBoard::Reader::open(const std::string& name, std::string& error)
+{
+    close();
+#if !defined(_WIN32)
+    const std::string segmentName = getSegmentName(name);
+    int descriptor = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (descriptor < 0) {
+        error = "Nothing is published as " + segmentName;
+        return false;
+    }
+    off_t size = lseek(descriptor, 0, SEEK_END);
+    void* mapping = MAP_FAILED;
+    if (size >= (off_t)sizeof(Layout)) mapping = mmap(nullptr, (size_t)size, PROT_READ, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+        error = "Could not map " + segmentName;
+        return false;
+    }
+
+    const Layout* layout = static_cast<const Layout*>(mapping);
+    const bool valid = std::memcmp(layout->magic, MAGIC, sizeof(MAGIC)) == 0
+        && layout->version == VERSION
+        && layout->layoutBytes == sizeof(Layout)
+        && layout->bufferOffsets[1] + layout->bufferBytes <= (uint64_t)size;
+    if (!valid) {
+        munmap(mapping, (size_t)size);
+        error = segmentName + " isn't a board published by this version";
+        return false;
+    }
+    layout_ = layout;
+    segmentBytes_ = (size_t)size;
+    return true;
+#else
+    (void)name;
+    error = "Reading a shared board needs POSIX shared memory, which this platform doesn't have";
+    return false;
+#endif
+}
+
+void SharedBoard::Reader::close()
+{
+#if !defined(_WIN32)
+    if (layout_) munmap(const_cast<Layout*>(layout_), segmentBytes_);
+#endif
+    layout_ = nullptr;
+    segmentBytes_ = 0;
+}
+
+bool SharedBoard::Reader::isClosed() const
+{
+    return !layout_ || layout_->closed.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t SharedBoard::Reader::getPublishedCount() const
+{
+    return layout_ ? layout_->published.load(std::memory_order_relaxed) : 0;
+}
+
+bool SharedBoard::Reader::acquire(Frame& frame) const
+{
+    if (!layout_) return false;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        uint32_t latest = layout_->latest.load(std::memory_order_acquire);
+        if (latest >= NO_FRAME) return false;
+        const Slot& slot = layout_->slots[latest];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) continue;
+
+        frame.generation = slot.generation;
+        frame.width = slot.width;
+        frame.height = slot.height;
+        frame.wordsPerRow = slot.wordsPerRow;
+        frame.population = slot.population;
+        char rule[RULE_BYTES];
+        std::memcpy(rule, slot.rule, RULE_BYTES);
+        rule[RULE_BYTES - 1] = '\0';
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+        //Torn values are caught above, so these only fail for a publisher that is broken.
+        if (frame.width <= 0 || frame.height <= 0 || frame.wordsPerRow <= 0
+            || (uint64_t)frame.wordsPerRow * frame.height * sizeof(uint64_t) > layout_->bufferBytes) return false;
+
+        frame.rule = rule;
+        frame.words = reinterpret_cast<const uint64_t*>(reinterpret_cast<const char*>(layout_) + layout_->bufferOffsets[latest]);
+        frame.slot = (int)latest;
+        frame.sequence = sequence;
+        return true;
+    }
+    return false;
+}
+
+bool SharedBoard::Reader::isIntact(const Frame& frame) const
+{
+    if (!layout_ || frame.slot < 0 || frame.slot >= (int)NO_FRAME) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return layout_->slots[frame.slot].sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+bool SharedBoard::Reader::copy(Frame& frame, GridEngine::Words& words) const
+{
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; attempt++) {
+        if (!acquire(frame)) return false;
+        size_t wordCount = (size_t)frame.wordsPerRow * frame.height;
+        words.resize(wordCount);
+        std::memcpy(words.data(), frame.words, wordCount * sizeof(uint64_t));
+        if (isIntact(frame)) {
+            frame.words = words.data();
+            return true;
+        }
+    }
+    return false;
+}
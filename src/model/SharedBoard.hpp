@@ -0,0 +1,150 @@
+#ifndef SHARED_BOARD_HPP
+#define SHARED_BOARD_HPP
+
+#include "GridEngine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//The live board published in a POSIX shared memory segment, so other processes can watch the run
+//without sockets or copies. The segment is a Layout header followed by two buffers of packed rows laid
+//out like GridEngine::getWords(). Each publish writes the buffer readers weren't pointed at, then points
+//them at it, so the simulation never waits for a reader and a reader has a whole publish to finish with
+//a frame. Each buffer is guarded by a seqlock: its sequence is odd while being written, so a reader that
+//sees the same even sequence before and after reading knows it read one whole frame.
+//Numbers are in the publisher's byte order; readers on the same machine share it.
+namespace SharedBoard
+{
+	constexpr const char* DEFAULT_NAME = "/gol-board";
+	constexpr char MAGIC[8] = { 'G', 'O', 'L', 'B', 'O', 'A', 'R', 'D' };
+	constexpr uint32_t VERSION = 1;
+	constexpr size_t RULE_BYTES = 48;
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "the seqlock has to work across processes");
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "the seqlock has to work across processes");
+
+	//What one buffer holds, written along with its cells.
+	struct alignas(64) Slot
+	{
+		//Odd while the publisher is writing this buffer.
+		std::atomic<uint64_t> sequence;
+		int64_t generation;
+		int32_t width;
+		int32_t height;
+		int32_t wordsPerRow;
+		int32_t reserved;
+		uint64_t population;
+		//As B.../S..., null terminated.
+		char rule[RULE_BYTES];
+	};
+
+	//At the start of the segment.
+	struct alignas(64) Layout
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t layoutBytes;
+		//Each buffer's capacity, and where each one starts from the start of the segment.
+		uint64_t bufferBytes;
+		uint64_t bufferOffsets[2];
+		int64_t publisherId;
+		//The buffer with the newest whole frame, or 2 before the first.
+		std::atomic<uint32_t> latest;
+		//Set when the publisher stops or moves to a bigger segment under the same name; open it again.
+		std::atomic<uint32_t> closed;
+		std::atomic<uint64_t> published;
+		Slot slots[2];
+	};
+
+	//One frame as a Reader sees it. words points into the segment, so check it with Reader::isIntact()
+	//after using it, or take a copy with Reader::copy().
+	struct Frame
+	{
+		long long generation = 0;
+		int width = 0;
+		int height = 0;
+		int wordsPerRow = 0;
+		uint64_t population = 0;
+		std::string rule;
+		const uint64_t* words = nullptr;
+
+		int slot = -1;
+		uint64_t sequence = 0;
+	};
+
+	//True where POSIX shared memory is available.
+	bool isSupported();
+
+	class Publisher
+	{
+	public:
+		Publisher() = default;
+		~Publisher();
+
+		Publisher(const Publisher&) = delete;
+		Publisher& operator=(const Publisher&) = delete;
+
+		//Starts publishing under name, e.g. /gol-board. The segment is made on the first publish and
+		//replaces any left by an earlier publisher.
+		bool start(const std::string& name, std::string& error);
+		//Tells readers the publisher is gone and removes the segment.
+		void stop();
+
+		//Copies board's cells into the buffer readers aren't pointed at, then points them at it. A board
+		//bigger than the segment moves to a new one, and readers of the old one see it closed.
+		bool publish(const GridEngine& board, long long generation);
+
+		bool isPublishing() const { return publishing_; }
+		const std::string& getName() const { return name_; }
+		long long getPublishedCount() const { return publishedCount_; }
+		const std::string& getError() const { return error_; }
+
+	private:
+		bool create_(size_t bufferBytes);
+		void release_(bool unlink);
+
+		std::string name_;
+		bool publishing_ = false;
+		Layout* layout_ = nullptr;
+		size_t segmentBytes_ = 0;
+		long long publishedCount_ = 0;
+		std::string error_;
+	};
+
+	class Reader
+	{
+	public:
+		Reader() = default;
+		~Reader();
+
+		Reader(const Reader&) = delete;
+		Reader& operator=(const Reader&) = delete;
+
+		bool open(const std::string& name, std::string& error);
+		void close();
+
+		bool isOpen() const { return layout_ != nullptr; }
+		//The publisher stopped or moved to a new segment; open() again to follow it.
+		bool isClosed() const;
+		//Frames published since the segment was made.
+		uint64_t getPublishedCount() const;
+
+		//Points frame at the newest whole frame without copying its cells. False if nothing has been
+		//published yet, or the publisher overwrote it every time it was tried.
+		bool acquire(Frame& frame) const;
+		//True if the publisher hasn't started overwriting frame since acquire(), so what was read from
+		//its words is one consistent generation.
+		bool isIntact(const Frame& frame) const;
+		//acquire() and copy the cells into words, retrying if the publisher overwrote them part way.
+		//frame.words points at words afterwards.
+		bool copy(Frame& frame, GridEngine::Words& words) const;
+
+	private:
+		const Layout* layout_ = nullptr;
+		size_t segmentBytes_ = 0;
+	};
+}
+
+#endif //SHARED_BOARD_HPP
@@ -0,0 +1,334 @@
+#include "TelemetrySink.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr size_t CHUNK_BYTES = TelemetrySink::CHUNK_ROWS * sizeof(int64_t);
+    constexpr const char* ENDIAN_NAME = (std::endian::native == std::endian::little) ? "little" : "big";
+
+#if !defined(_WIN32)
+    size_t getPageSize()
+    {
+        static const size_t pageSize = (size_t)std::max(sysconf(_SC_PAGESIZE), 1l);
+        return pageSize;
+    }
+#endif
+}
+
+TelemetrySink::~TelemetrySink()
+{
+    stop();
+}
+
+std::string TelemetrySink::getColumnPath(const std::string& directory, int column)
+{
+    return (std::filesystem::path(directory) / (std::string(ColumnNames[column]) + COLUMN_EXTENSION)).string();
+}
+
+std::string TelemetrySink::getManifestPath(const std::string& directory)
+{
+    return (std::filesystem::path(directory) / MANIFEST_FILE_NAME).string();
+}
+
+bool TelemetrySink::readManifest(const std::string& directory, uint64_t& rowCount, std::string& error)
+{
+    std::string path = getManifestPath(directory);
+    std::ifstream file(path);
+    std::string line;
+    if (!file.is_open() || !std::getline(file, line) || line != MANIFEST_MAGIC) {
+        error = "No telemetry manifest at " + path;
+        return false;
+    }
+    bool haveRows = false;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        std::string value;
+        fields >> key >> value;
+        if (key == "rows") {
+            rowCount = std::strtoull(value.c_str(), nullptr, 10);
+            haveRows = true;
+        }
+        else if (key == "endian" && value != ENDIAN_NAME) {
+            error = path + " was written on a " + value + " endian machine";
+            return false;
+        }
+    }
+    if (!haveRows) {
+        error = path + " doesn't say how many rows there are";
+        return false;
+    }
+    return true;
+}
+
+bool TelemetrySink::start(const std::string& directory, std::string& error)
+{
+    stop();
+    std::error_code code;
+    std::filesystem::create_directories(directory, code);
+    if (code) {
+        error = "Could not create " + directory + ": " + code.message();
+        return false;
+    }
+
+    directory_ = directory;
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        std::string path = getColumnPath(directory, column);
+#if !defined(_WIN32)
+        descriptors_[column] = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        bool opened = descriptors_[column] >= 0;
+#else
+        files_[column].open(path, std::ios::binary | std::ios::trunc);
+        bool opened = files_[column].is_open();
+#endif
+        if (!opened) {
+            error = "Could not open " + path + " for writing";
+            for (int index = 0; index < column; index++) {
+#if !defined(_WIN32)
+                ::close(descriptors_[index]);
+#else
+                files_[index].close();
+#endif
+            }
+            return false;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        full_.clear();
+        spare_ = Chunk();
+        stopping_ = false;
+        failed_ = false;
+        error_.clear();
+    }
+    row_ = 0;
+    rowCount_ = 0;
+    flushedRows_ = 0;
+    //The first chunk is mapped here so the first row has somewhere to go; the thread maps the rest ahead.
+    recording_ = true;
+    if (!mapChunk_(0, current_) || !writeManifest_(0)) {
+        error = getError();
+        stop();
+        return false;
+    }
+    nextSpareIndex_ = 1;
+    worker_ = std::thread(&TelemetrySink::flushLoop_, this);
+    return true;
+}
+
+bool TelemetrySink::stop()
+{
+    if (!recording_) return getError().empty();
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        worker_.join();
+    }
+    //The thread flushed every row on its way out, and nothing else can be mapped now.
+    releaseChunk_(current_);
+    releaseChunk_(spare_);
+    for (Chunk& chunk : full_) releaseChunk_(chunk);
+    full_.clear();
+    row_ = 0;
+
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+#if !defined(_WIN32)
+        //Chunks are mapped whole, so trim the files back to the rows written.
+        if (ftruncate(descriptors_[column], (off_t)(flushedRows_ * sizeof(int64_t))) != 0) fail_("Could not trim " + getColumnPath(directory_, column));
+        ::close(descriptors_[column]);
+#else
+        files_[column].close();
+        if (files_[column].fail()) fail_("Could not finish writing " + getColumnPath(directory_, column));
+#endif
+    }
+    writeManifest_(flushedRows_);
+    recording_ = false;
+    return getError().empty();
+}
+
+std::string TelemetrySink::getError() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return error_;
+}
+
+bool TelemetrySink::nextChunk_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (current_.isReady()) full_.push_back(std::move(current_));
+    current_ = Chunk();
+    wake_.notify_one();
+    //Only waits if the thread has fallen a whole chunk behind, e.g. a disk that has stalled.
+    spareMapped_.wait(lock, [this]() { return spare_.isReady() || failed_; });
+    if (!spare_.isReady()) return false;
+    current_ = std::move(spare_);
+    spare_ = Chunk();
+    row_ = 0;
+    //The thread starts mapping the one after.
+    wake_.notify_one();
+    return true;
+}
+
+void TelemetrySink::flushLoop_()
+{
+    const auto interval = std::chrono::milliseconds(FLUSH_INTERVAL_MILLISECONDS);
+    auto nextFlush = std::chrono::steady_clock::now() + interval;
+    while (true) {
+        std::deque<Chunk> full;
+        //Just the mapping of the writer's chunk; only this thread unmaps, so it stays good unlocked.
+        Chunk current;
+        bool mapSpare = false;
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_until(lock, nextFlush, [this]() { return stopping_ || !full_.empty() || (!spare_.isReady() && !failed_); });
+            full.swap(full_);
+            current.index = current_.index;
+            current.columns = current_.columns;
+            stopping = stopping_;
+            mapSpare = !stopping && !spare_.isReady() && !failed_;
+        }
+
+        for (Chunk& chunk : full) {
+            flushRows_(chunk, (chunk.index + 1) * CHUNK_ROWS);
+            releaseChunk_(chunk);
+        }
+        if (mapSpare) {
+            Chunk spare;
+            bool mapped = mapChunk_(nextSpareIndex_, spare);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (mapped) spare_ = std::move(spare);
+                else failed_ = true;
+            }
+            if (mapped) nextSpareIndex_++;
+            spareMapped_.notify_one();
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (stopping || now >= nextFlush) {
+            if (current.isReady()) {
+                uint64_t rowEnd = std::min<uint64_t>(rowCount_.load(std::memory_order_acquire), (current.index + 1) * CHUNK_ROWS);
+                flushRows_(current, rowEnd);
+            }
+            if (!stopping) writeManifest_(flushedRows_);
+            nextFlush = now + interval;
+        }
+        if (stopping) return;
+    }
+}
+
+bool TelemetrySink::mapChunk_(uint64_t index, Chunk& chunk)
+{
+    chunk = Chunk();
+    chunk.index = index;
+#if !defined(_WIN32)
+    off_t offset = (off_t)(index * CHUNK_BYTES);
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        void* mapping = MAP_FAILED;
+        if (ftruncate(descriptors_[column], offset + (off_t)CHUNK_BYTES) == 0) {
+            mapping = mmap(nullptr, CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, descriptors_[column], offset);
+        }
+        if (mapping == MAP_FAILED) {
+            releaseChunk_(chunk);
+            fail_("Could not map " + getColumnPath(directory_, column));
+            return false;
+        }
+        //Write to every page now, so the writer never takes a fault on a fresh one.
+        volatile char* bytes = static_cast<char*>(mapping);
+        for (size_t byte = 0; byte < CHUNK_BYTES; byte += getPageSize()) bytes[byte] = 0;
+        chunk.columns[column] = static_cast<int64_t*>(mapping);
+    }
+#else
+    chunk.buffer.assign((size_t)COLUMN_COUNT * CHUNK_ROWS, 0);
+    for (int column = 0; column < COLUMN_COUNT; column++) chunk.columns[column] = chunk.buffer.data() + (size_t)column * CHUNK_ROWS;
+#endif
+    return true;
+}
+
+void TelemetrySink::releaseChunk_(Chunk& chunk)
+{
+#if !defined(_WIN32)
+    for (int64_t* column : chunk.columns) {
+        if (column) munmap(column, CHUNK_BYTES);
+    }
+#endif
+    chunk = Chunk();
+}
+
+bool TelemetrySink::flushRows_(const Chunk& chunk, uint64_t rowEnd)
+{
+    const uint64_t chunkStart = chunk.index * CHUNK_ROWS;
+    if (rowEnd <= flushedRows_) return true;
+    //A failed flush leaves a gap, and nothing after it is worth syncing.
+    if (flushedRows_ < chunkStart) return false;
+    size_t begin = (size_t)(flushedRows_ - chunkStart) * sizeof(int64_t);
+    size_t end = (size_t)(rowEnd - chunkStart) * sizeof(int64_t);
+    for (int column = 0; column < COLUMN_COUNT; column++) {
+        char* bytes = reinterpret_cast<char*>(chunk.columns[column]);
+#if !defined(_WIN32)
+        size_t pageStart = begin - begin % getPageSize();
+        bool flushed = msync(bytes + pageStart, end - pageStart, MS_SYNC) == 0;
+#else
+        bool flushed = (bool)files_[column].write(bytes + begin, (std::streamsize)(end - begin)).flush();
+#endif
+        if (!flushed) {
+            fail_("Could not write " + getColumnPath(directory_, column));
+            return false;
+        }
+    }
+    flushedRows_ = rowEnd;
+    return true;
+}
+
+bool TelemetrySink::writeManifest_(uint64_t rowCount)
+{
+    //Written aside and renamed over the old one, so a reader never sees half a manifest.
+    std::filesystem::path path = getManifestPath(directory_);
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file << MANIFEST_MAGIC << '\n';
+        file << "rows " << rowCount << '\n';
+        file << "type int64\n";
+        file << "endian " << ENDIAN_NAME << '\n';
+        file << "columns";
+        for (const char* name : ColumnNames) file << ' ' << name;
+        file << '\n';
+        if (!file.flush()) {
+            fail_("Could not write " + temporaryPath.string());
+            return false;
+        }
+    }
+    std::error_code code;
+    std::filesystem::rename(temporaryPath, path, code);
+    if (code) {
+        std::filesystem::remove(temporaryPath, code);
+        fail_("Could not write " + path.string());
+        return false;
+    }
+    return true;
+}
+
+void TelemetrySink::fail_(const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error_.empty()) error_ = error;
+}
@@ -0,0 +1,152 @@
+#ifndef TELEMETRY_SINK_HPP
+#define TELEMETRY_SINK_HPP
+
+#include "GridEngine.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A time series of the run, a row every so many generations, kept as columns: a file per column in a directory,
+//each a plain array of native 64 bit integers, plus a small text manifest saying how many rows are valid.
+//The files are mapped CHUNK_ROWS rows at a time, so recording a row is ten stores into memory that is
+//already mapped and paged in. A background thread grows the files and maps the next chunk ahead of the
+//writer, syncs full chunks to disk and unmaps them, and every FLUSH_INTERVAL_MILLISECONDS syncs the current
+//one and rewrites the manifest, so a run that is killed still leaves everything up to its last flush.
+//Without mmap the chunks are buffers in memory, appended to the files by the same thread.
+//An empty board's bounding box is recorded as GridEngine::Stats has it, with right < left. Births, deaths
+//and changed words are those of the row's own generation; step_ns is the average per generation since
+//the row before.
+//tools/gol_telemetry.cpp turns a directory of columns back into CSV.
+class TelemetrySink
+{
+public:
+	enum class Column
+	{
+		Generation,
+		Population,
+		Births,
+		Deaths,
+		Left,
+		Top,
+		Right,
+		Bottom,
+		ChangedWords,
+		StepNanoseconds
+	};
+
+	constexpr static int COLUMN_COUNT = 10;
+	//Also the file names, with COLUMN_EXTENSION after them.
+	constexpr static const char* ColumnNames[COLUMN_COUNT] = {
+		"generation", "population", "births", "deaths", "left", "top", "right", "bottom", "changed_words", "step_ns" };
+	constexpr static const char* COLUMN_EXTENSION = ".i64";
+	constexpr static const char* MANIFEST_FILE_NAME = "telemetry.txt";
+	//The manifest's first line.
+	constexpr static const char* MANIFEST_MAGIC = "gol-telemetry 1";
+	//Rows per chunk: 512 KiB of each column, a whole number of pages.
+	constexpr static size_t CHUNK_ROWS = 1 << 16;
+	constexpr static int FLUSH_INTERVAL_MILLISECONDS = 1000;
+
+	TelemetrySink() = default;
+	~TelemetrySink();
+
+	TelemetrySink(const TelemetrySink&) = delete;
+	TelemetrySink& operator=(const TelemetrySink&) = delete;
+
+	//Creates directory if need be, replaces any columns already in it and starts the flushing thread.
+	//Stops any recording already running.
+	bool start(const std::string& directory, std::string& error);
+	//Flushes what is recorded, trims the files to the rows written and writes the final manifest.
+	//False if anything failed; getError() says why.
+	bool stop();
+
+	bool isRecording() const { return recording_; }
+	const std::string& getDirectory() const { return directory_; }
+	uint64_t getRowCount() const { return rowCount_.load(std::memory_order_relaxed); }
+	std::string getError() const;
+
+	//One row. Only call it from one thread at a time, and only while recording.
+	void record(long long generation, const GridEngine::Stats& stats, long long stepNanoseconds)
+	{
+		if (row_ == CHUNK_ROWS && !nextChunk_()) return;
+		int64_t* const* columns = current_.columns.data();
+		columns[(int)Column::Generation][row_] = generation;
+		columns[(int)Column::Population][row_] = (int64_t)stats.population;
+		columns[(int)Column::Births][row_] = (int64_t)stats.births;
+		columns[(int)Column::Deaths][row_] = (int64_t)stats.deaths;
+		columns[(int)Column::Left][row_] = stats.left;
+		columns[(int)Column::Top][row_] = stats.top;
+		columns[(int)Column::Right][row_] = stats.right;
+		columns[(int)Column::Bottom][row_] = stats.bottom;
+		columns[(int)Column::ChangedWords][row_] = (int64_t)stats.changedWords;
+		columns[(int)Column::StepNanoseconds][row_] = stepNanoseconds;
+		row_++;
+		rowCount_.store(current_.index * CHUNK_ROWS + row_, std::memory_order_release);
+	}
+
+	static std::string getColumnPath(const std::string& directory, int column);
+	static std::string getManifestPath(const std::string& directory);
+	//The rows the manifest says are valid. False if it is missing or isn't a telemetry manifest.
+	static bool readManifest(const std::string& directory, uint64_t& rowCount, std::string& error);
+
+private:
+	//CHUNK_ROWS rows of every column, starting at row index * CHUNK_ROWS.
+	struct Chunk
+	{
+		uint64_t index = 0;
+		std::array<int64_t*, COLUMN_COUNT> columns{};
+		//The columns when the files aren't mapped.
+		std::vector<int64_t> buffer;
+
+		bool isReady() const { return columns[0] != nullptr; }
+	};
+
+	//Called by record() when a chunk fills: hands it to the thread and takes the one mapped ahead of it.
+	bool nextChunk_();
+	void flushLoop_();
+	//These run on the thread, or on the caller's while it isn't running.
+	bool mapChunk_(uint64_t index, Chunk& chunk);
+	void releaseChunk_(Chunk& chunk);
+	//Syncs the rows from flushedRows_ up to rowEnd, all of them in chunk, to the files.
+	bool flushRows_(const Chunk& chunk, uint64_t rowEnd);
+	bool writeManifest_(uint64_t rowCount);
+	void fail_(const std::string& error);
+
+	std::string directory_;
+	bool recording_ = false;
+	std::thread worker_;
+#if !defined(_WIN32)
+	std::array<int, COLUMN_COUNT> descriptors_;
+#else
+	std::array<std::ofstream, COLUMN_COUNT> files_;
+#endif
+
+	//The writer's side.
+	Chunk current_;
+	size_t row_ = 0;
+	std::atomic<uint64_t> rowCount_ = 0;
+
+	//The thread's side.
+	uint64_t flushedRows_ = 0;
+	uint64_t nextSpareIndex_ = 0;
+
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable spareMapped_;
+	//The chunk after current_, mapped by the thread before the writer needs it.
+	Chunk spare_;
+	std::deque<Chunk> full_;
+	bool stopping_ = false;
+	bool failed_ = false;
+	std::string error_;
+};
+
+#endif //TELEMETRY_SINK_HPP
@@ -0,0 +1,154 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace
+{
+    //Returns false where the platform can't pin or the CPU doesn't exist.
+    bool pinThread(std::thread& thread, int cpu)
+    {
+        if (cpu >= WorkerPool::getCpuLimit()) return false;
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (cpu >= 0) CPU_SET(cpu, &cpus);
+        else for (int index = 0; index < CPU_SETSIZE; index++) CPU_SET(index, &cpus);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#elif defined(_WIN32)
+        DWORD_PTR mask = (cpu >= 0) ? ((DWORD_PTR)1 << cpu) : ~(DWORD_PTR)0;
+        return SetThreadAffinityMask((HANDLE)thread.native_handle(), mask) != 0;
+#else
+        (void)thread;
+        (void)cpu;
+        return false;
+#endif
+    }
+}
+
+WorkerPool::WorkerPool(int threadCount)
+{
+    resize(threadCount);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopThreads_();
+}
+
+void WorkerPool::resize(int threadCount)
+{
+    threadCount = std::max(threadCount, 1);
+    if (threadCount == size()) return;
+
+    stopThreads_();
+    stopping_ = false;
+    for (int index = 1; index < threadCount; index++) threads_.emplace_back(&WorkerPool::workerLoop_, this, jobId_, index);
+    applyAffinity_();
+}
+
+bool WorkerPool::setAffinity(const std::vector<int>& cpus)
+{
+    if (std::any_of(cpus.begin(), cpus.end(), [](int cpu) { return cpu >= getCpuLimit(); })) return false;
+    if (cpus.empty() && affinity_.empty()) return true;
+    affinity_ = cpus;
+    applyAffinity_();
+    return true;
+}
+
+std::vector<int> WorkerPool::getCompactAffinity(int threadCount)
+{
+    std::vector<int> cpus;
+    for (int cpu = 1; cpu < std::min(threadCount, getCpuLimit()); cpu++) cpus.push_back(cpu);
+    return cpus;
+}
+
+int WorkerPool::getCpuLimit()
+{
+#if defined(__linux__)
+    return CPU_SETSIZE;
+#elif defined(_WIN32)
+    return (int)(sizeof(DWORD_PTR) * CHAR_BIT);
+#else
+    return INT_MAX;
+#endif
+}
+
+void WorkerPool::applyAffinity_()
+{
+    for (size_t index = 0; index < threads_.size(); index++) {
+        pinThread(threads_[index], (index < affinity_.size()) ? affinity_[index] : -1);
+    }
+}
+
+void WorkerPool::stopThreads_()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    wakeCondition_.notify_all();
+    for (auto& thread : threads_) thread.join();
+    threads_.clear();
+}
+
+void WorkerPool::run(int taskCount, const std::function<void(int)>& task, Schedule schedule)
+{
+    if (taskCount <= 0) return;
+    if (threads_.empty() || taskCount == 1) {
+        for (int index = 0; index < taskCount; index++) task(index);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        taskCount_ = taskCount;
+        schedule_ = schedule;
+        nextTask_ = 0;
+        busyWorkers_ = (int)threads_.size();
+        jobId_++;
+    }
+    wakeCondition_.notify_all();
+
+    runTasks_(0);
+
+    std::unique_lock lock(mutex_);
+    doneCondition_.wait(lock, [this]() { return busyWorkers_ == 0; });
+    task_ = nullptr;
+}
+
+void WorkerPool::runTasks_(int threadIndex)
+{
+    if (schedule_ == Schedule::Static) {
+        int end = (int)((long long)taskCount_ * (threadIndex + 1) / size());
+        for (int index = (int)((long long)taskCount_ * threadIndex / size()); index < end; index++) (*task_)(index);
+        return;
+    }
+    for (int index = nextTask_.fetch_add(1); index < taskCount_; index = nextTask_.fetch_add(1)) (*task_)(index);
+}
+
+void WorkerPool::workerLoop_(uint64_t lastJob, int threadIndex)
+{
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wakeCondition_.wait(lock, [&]() { return stopping_ || jobId_ != lastJob; });
+            if (stopping_) return;
+            lastJob = jobId_;
+        }
+
+        runTasks_(threadIndex);
+
+        std::lock_guard lock(mutex_);
+        if (--busyWorkers_ == 0) doneCondition_.notify_one();
+    }
+}
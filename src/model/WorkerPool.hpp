@@ -0,0 +1,71 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A fixed set of threads that stay alive between generations, so stepping doesn't pay for
+//thread creation every time. The calling thread works too, so a pool of size 1 has no extra threads.
+class WorkerPool
+{
+public:
+	//Dynamic hands out tasks to whichever thread is free. Static gives thread t (the caller is 0) the t-th
+	//contiguous block of tasks every run, so data a thread touched first stays with that thread.
+	enum class Schedule
+	{
+		Dynamic,
+		Static
+	};
+
+	explicit WorkerPool(int threadCount = 1);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	//Total threads including the caller of run().
+	void resize(int threadCount);
+	int size() const { return (int)threads_.size() + 1; }
+
+	//CPU for each of the pool's own threads in order; the thread calling run() is left alone. Threads past
+	//the end of the map, or with a negative entry, float. Empty unpins everything. Only Linux and Windows pin.
+	//False, with the affinity left as it was, if an entry is getCpuLimit() or more.
+	bool setAffinity(const std::vector<int>& cpus);
+	const std::vector<int>& getAffinity() const { return affinity_; }
+	//Threads 1..count-1 on CPUs 1..count-1, leaving CPU 0 to the caller.
+	static std::vector<int> getCompactAffinity(int threadCount);
+	//CPUs a thread can be pinned to are numbered below this: CPU_SETSIZE on Linux, the bits of an affinity mask on Windows.
+	static int getCpuLimit();
+
+	//Calls task(index) once for every index in [0, taskCount), spread over the pool. Blocks until all are done.
+	void run(int taskCount, const std::function<void(int)>& task, Schedule schedule = Schedule::Dynamic);
+
+private:
+	//lastJob is the job id at creation, so a new thread doesn't rerun a finished job.
+	void workerLoop_(uint64_t lastJob, int threadIndex);
+	void stopThreads_();
+	void runTasks_(int threadIndex);
+	void applyAffinity_();
+
+	std::vector<std::thread> threads_;
+
+	std::mutex mutex_;
+	std::condition_variable wakeCondition_;
+	std::condition_variable doneCondition_;
+
+	const std::function<void(int)>* task_ = nullptr;
+	int taskCount_ = 0;
+	Schedule schedule_ = Schedule::Dynamic;
+	std::atomic<int> nextTask_ = 0;
+	int busyWorkers_ = 0;
+	uint64_t jobId_ = 0;
+	bool stopping_ = false;
+	std::vector<int> affinity_;
+};
+
+#endif //WORKER_POOL_HPP
@@ -19,6 +19,8 @@ struct ModelParameters {
 	int displacementX = 0;
 	int displacementY = 0;
 	int zoomLevel = 1;
+	//Full B/S rule from a pattern's header, e.g. B36/S23. While set it takes the place of rule1..rule4.
+	std::string ruleString = "";
 };
 
 #endif
\ No newline at end of file
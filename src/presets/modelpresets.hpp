@@ -2,133 +2,181 @@
 #define GAMEOFLIFE_MODELPRESETS_H
 
 #include <model/modelparameters.hpp>
+#include <model/PackedPattern.hpp>
 
 #include <string_view>
 
-//Preset parameters for models.
-//In order to add a new model, add a new ModelPresetName, a new getModelPresetStringView, and a new getModelPresetParameters
-//If this gets to unwieldly, we can have the parmeters in a separate file.
-//Buttons for the presets will be generated in the GUI using the ModelPresetName enum and the getModelPresetStringView function.
+//Built in presets. Each pattern is decoded from its RLE while compiling, so the presets are constants in
+//read only data: nothing is built at startup and nothing is parsed when one is picked.
+//To add a preset, add it here, to allPresets, and give it a button in WidgetFunctions::drawPresetsHeader.
 
 namespace ModelPresets {
 
-	const ModelParameters randomParams = ModelParameters();
+	struct Preset
+	{
+		//Short name for picking it without the gui, e.g. gol-run --preset.
+		std::string_view name;
+		bool random = true;
+		//Negative values are ignored, as in ModelParameters.
+		float fillFactor = 0.2f;
+		int rule1 = 2;
+		int rule3 = 3;
+		int rule4 = 3;
+		//Board size the pattern is centered in, like an RLE header's x and y.
+		int minWidth = 10;
+		int minHeight = 10;
+		//Empty for random presets.
+		PackedPattern pattern;
 
-	const ModelParameters swissCheeseParams = ModelParameters(
+		//As generateModel takes them, without the pattern. Not constexpr, since ModelParameters holds strings.
+		ModelParameters getParameters() const
+		{
+			ModelParameters parameters;
+			parameters.random = random;
+			parameters.fillFactor = fillFactor;
+			parameters.rule1 = rule1;
+			parameters.rule3 = rule3;
+			parameters.rule4 = rule4;
+			parameters.minWidth = (pattern.width > minWidth) ? pattern.width : minWidth;
+			parameters.minHeight = (pattern.height > minHeight) ? pattern.height : minHeight;
+			return parameters;
+		}
+	};
+
+	inline constexpr Preset randomParams = {
+		"random",
+		true,
+		0.2f,
+		2,
+		3,
+		3,
+		10,
+		10,
+		{}
+	};
+
+	inline constexpr Preset swissCheeseParams = {
+		"swisscheese",
 		true,
-		-1,
-		-1,
 		0.9f,
 		5,
 		8,
-		1
-	);
+		1,
+		10,
+		10,
+		{}
+	};
 
-	const ModelParameters decompositionParams = ModelParameters(
+	inline constexpr Preset decompositionParams = {
+		"decomposition",
 		true,
-		-1,
-		-1,
 		0.9f,
 		5,
 		8,
-		3
-	);
+		3,
+		10,
+		10,
+		{}
+	};
+
+	inline constexpr std::string_view blinkerRle =
+		"3o!";
 
-	const ModelParameters blinkerParams = ModelParameters(
+	inline constexpr Preset blinkerParams = {
+		"blinker",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
 		3,
 		3,
-		"3o!"
-	);
+		PackedRle::decode<blinkerRle>()
+	};
 
-	const ModelParameters lightweightSpaceshipParams = ModelParameters(
+	inline constexpr std::string_view lightweightSpaceshipRle =
+		"bo2bo$o4b$o3bo$4o!";
+
+	inline constexpr Preset lightweightSpaceshipParams = {
+		"lwss",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
 		40,
 		40,
-		"bo2bo$o4b$o3bo$4o!"
-	);
+		PackedRle::decode<lightweightSpaceshipRle>()
+	};
+
+	inline constexpr std::string_view blockerRle =
+		"6bobob$5bo4b$2o2bo4bo$2obo2bob2o$4b2o!";
 
-	const ModelParameters blockerParams = {
+	inline constexpr Preset blockerParams = {
+		"blocker",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
 		110,
 		110,
-		"6bobob$5bo4b$2o2bo4bo$2obo2bob2o$4b2o!"
+		PackedRle::decode<blockerRle>()
 	};
 
-	const ModelParameters nihoniumParams = {
-	false,
-	-1,
-	-1,
-	-1,
-	2,
-	3,
-	3,
-	58,
-	37,
-	"42b2o$42b2o5b2o$49b2o$13b2o$14bo$13bo33b2o$13b2o32b2o$53b2o$2o51b2o$b"
-	"o$bob2o$2bo$14b2o$4bobo8bo$5bo7b3o$6bo46bo$3b4o45bobo$2bo49bobo$2b2ob"
-	"2o44b2ob2o$3bobo49bo$3bobo45b4o$4bo46bo$42b3o7bo$42bo8bobo$42b2o$55bo"
-	"$53b2obo$56bo$3b2o51b2o$3b2o$9b2o32b2o$9b2o33bo$43bo$43b2o$7b2o$7b2o5b"
-	"2o$14b2o!"
-	};
+	inline constexpr std::string_view nihoniumRle =
+		"42b2o$42b2o5b2o$49b2o$13b2o$14bo$13bo33b2o$13b2o32b2o$53b2o$2o51b2o$b"
+		"o$bob2o$2bo$14b2o$4bobo8bo$5bo7b3o$6bo46bo$3b4o45bobo$2bo49bobo$2b2ob"
+		"2o44b2ob2o$3bobo49bo$3bobo45b4o$4bo46bo$42b3o7bo$42bo8bobo$42b2o$55bo"
+		"$53b2obo$56bo$3b2o51b2o$3b2o$9b2o32b2o$9b2o33bo$43bo$43b2o$7b2o$7b2o5b"
+		"2o$14b2o!";
 
-const ModelParameters gabrielsPOneThirtyEightParams = {
-	false,
-	-1,
-	-1,
-	-1,
-	2,
-	3,
-	3,
-	21,
-	21,
-	"8b3o10b$7bo2bo10b$7bo2bo10b$7b2o12b4$17b3ob$17bo2bo$20bo$3o15b3o$o20b$"
-	"o2bo17b$b3o17b4$12b2o7b$10bo2bo7b$10bo2bo7b$10b3o!"
+	inline constexpr Preset nihoniumParams = {
+		"nihonium",
+		false,
+		-1,
+		2,
+		3,
+		3,
+		58,
+		37,
+		PackedRle::decode<nihoniumRle>()
 	};
 
-	const ModelParameters backrakeOnePufferVarTwo = {
+	inline constexpr std::string_view gabrielsPOneThirtyEightRle =
+		"8b3o10b$7bo2bo10b$7bo2bo10b$7b2o12b4$17b3ob$17bo2bo$20bo$3o15b3o$o20b$"
+		"o2bo17b$b3o17b4$12b2o7b$10bo2bo7b$10bo2bo7b$10b3o!";
+
+	inline constexpr Preset gabrielsPOneThirtyEightParams = {
+		"p138",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		30,
-		800,
+		21,
+		21,
+		PackedRle::decode<gabrielsPOneThirtyEightRle>()
+	};
+
+	inline constexpr std::string_view backrakeOnePufferVarTwoRle =
 		"5b3o11b3o$4bo3bo9bo3bo$3b2o4bo7bo4b2o$2bobob2ob2o5b2ob2obobo$b2obo4bo"
 		"b2ob2obo4bob2o$o4bo3bo2bobo2bo3bo4bo$12bobo$2o7b2obobob2o7b2o$12bobo$"
-		"6b3o9b3o$6bo3bo5bo3bo$6bobo9bobo!"
-	};
+		"6b3o9b3o$6bo3bo5bo3bo$6bobo9bobo!";
 
-	const ModelParameters connectedPhoenix = {
+	inline constexpr Preset backrakeOnePufferVarTwo = {
+		"backrake",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		58,
-		95,
+		30,
+		800,
+		PackedRle::decode<backrakeOnePufferVarTwoRle>()
+	};
+
+	inline constexpr std::string_view connectedPhoenixRle =
 		"3bo$3bobo$bo5bo$7bobo9bo7bo$2o15bobo5bobo$10b2o9bobo5bo$2bo12b2o6bo$10b"
 		"o18b2o$2b2o12bo$8bobo17bo$4bobo10b2o$6bo3bobo14b2o$14bobo2bobo$10bo3b"
 		"o6bo7bo$8bobo12bo$29b2o$6b2o3b2o10b2o$28bo$6bo5bo9bo$4bo15bobo4b2o$2b"
@@ -141,19 +189,21 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"o4b2o3b2o$43b2o8bobo$29b2o4bobo15bo$35bo9bo5bo$29bo$33b2o10b2o3b2o$27b"
 		"2o$34bo12bobo$28bo7bo6bo3bo$36bobo2bobo$29b2o14bobo3bo$39b2o10bobo$29b"
 		"o17bobo$41bo12b2o$27b2o18bo$34bo6b2o12bo$28bo5bobo9b2o$30bobo5bobo15b"
-		"2o$30bo7bo9bobo$50bo5bo$52bobo$54bo!"
-	};
+		"2o$30bo7bo9bobo$50bo5bo$52bobo$54bo!";
 
-	const ModelParameters doubleX = {
+	inline constexpr Preset connectedPhoenix = {
+		"phoenix",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		131,
-		63,
+		58,
+		95,
+		PackedRle::decode<connectedPhoenixRle>()
+	};
+
+	inline constexpr std::string_view doubleXRle =
 		"b2o125b2ob$b2o125b2ob$7b3o111b3o7b$6bo3bo109bo3bo6b$6b2ob2o41b2o23b2o"
 		"41b2ob2o6b$30b2o19b4o21b4o19b2o30b$6b2ob2o17b2ob2o18b2ob2o19b2ob2o18b"
 		"2ob2o17b2ob2o6b$8bo19b4o21b2o21b2o21b4o19bo8b$16b2o11b2o69b2o11b2o16b$"
@@ -168,19 +218,21 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"14bobo4b$4bobo15b2o83b2o15bobo4b$4bobo117bobo4b$o2bo3bo2bo109bo2bo3bo"
 		"2bo$b3o3b3o111b3o3b3ob3$16bo2bo42b2o3b2o42bo2bo16b$20bo19b4o18bobobobo"
 		"18b4o19bo20b$16bo3bo18bo3bo18bo5bo18bo3bo18bo3bo16b$17b4o22bo43bo22b4o"
-		"17b$39bo2bo45bo2bo39b3$b2o125b2ob$b2o125b2o!"
-	};
+		"17b$39bo2bo45bo2bo39b3$b2o125b2ob$b2o125b2o!";
 
-	const ModelParameters frothingPufferRake = {
+	inline constexpr Preset doubleX = {
+		"doublex",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		249,
-		800,
+		131,
+		63,
+		PackedRle::decode<doubleXRle>()
+	};
+
+	inline constexpr std::string_view frothingPufferRakeRle =
 		"72bo85bo$71b3o83b3o$52boboo14bo3bo14boobo45boboo14bo3bo14boobo$51boob"
 		"ooboobo10b3o10boboobooboo43boobooboobo10b3o10boboobooboo$50bobboboboob"
 		"oo8b5o8booboobobobbo41bobbobobooboo8b5o8booboobobobbo$51bo6bo5bo4boo3b"
@@ -322,19 +374,21 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"o9boo$67bo12bo8bobbo3boo65boo$76boobbobobb3o77bo$75bob4ob4obo$76bobobo"
 		"bobobobbo62b3o$66b3o83bo$68bo84bo$67bo74bo$78bo62boo$78boo61bobo$77bob"
 		"o$130boo$89boo39bobo$88bobo39bo$90bo$119boo$100boo16boo$101boo17bo$"
-		"100bo$$111b3o$113bo$112bo20$179boo$178bobo$180bo21$246b3o$248bo$247bo!"
-	};
+		"100bo$$111b3o$113bo$112bo20$179boo$178bobo$180bo21$246b3o$248bo$247bo!";
 
-	const ModelParameters newShuttle = {
+	inline constexpr Preset frothingPufferRake = {
+		"frothingpufferrake",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		51,
-		51,
+		249,
+		800,
+		PackedRle::decode<frothingPufferRakeRle>()
+	};
+
+	inline constexpr std::string_view newShuttleRle =
 		"26b2o$20bo3bo2bo2bo$18b3o3b3o3b3o$8b2o7bo15bo7b2o$9bo7b2o5b3o5b2o7bo$"
 		"9bobo11bo3bo11bobo$10b2o11b2ob2o11b2o2$3bo10b3o17b3o10bo$3b3o9bo19bo9b"
 		"3o$6bo13b3o5b3o13bo$5b2o14bo7bo14b2o3$8bo33bo$8b2o31b2o$8bo33bo$3b2o"
@@ -345,37 +399,41 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"2bo21b3o21bo$2bobo18bo3bo18bobo$3b2o18b2ob2o18b2o$8bo33bo$8b2o31b2o$8b"
 		"o33bo3$5b2o14bo7bo14b2o$6bo13b3o5b3o13bo$3b3o9bo19bo9b3o$3bo10b3o17b3o"
 		"10bo2$10b2o11b2ob2o11b2o$9bobo11bo3bo11bobo$9bo7b2o5b3o5b2o7bo$8b2o7bo"
-		"15bo7b2o$18b3o3b3o3b3o$20bo2bo2bo3bo$23b2o!"
-	};
+		"15bo7b2o$18b3o3b3o3b3o$20bo2bo2bo3bo$23b2o!";
 
-	const ModelParameters pTwentyEightGliderShuttle = {
+	inline constexpr Preset newShuttle = {
+		"newshuttle",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		42,
-		42,
+		51,
+		51,
+		PackedRle::decode<newShuttleRle>()
+	};
+
+	inline constexpr std::string_view pTwentyEightGliderShuttleRle =
 		"25b2o$17b2o5bob2o2b2o$17b2o5bobo3b2o$24bo$22bo2$22bo$24bo$17b2o5bobo3b"
 		"2o$17b2o5bob2o2b2o$b2o5b2o15b2o$b2o5b2o3$bo7bo$3o5b3o$o9bo5b2o5bobo$b"
 		"3o3b3o7b2o5b2o6b2o5b2o$16bo7bo7b2o5b2o$4bobo3$35bobo$b2o5b2o7bo7bo$b2o"
 		"5b2o6b2o5b2o7b3o3b3o$16bobo5b2o5bo9bo$31b3o5b3o$32bo7bo3$32b2o5b2o$15b"
 		"2o15b2o5b2o$10b2o2b2obo5b2o$10b2o3bobo5b2o$17bo$19bo2$19bo$17bo$10b2o"
-		"3bobo5b2o$10b2o2b2obo5b2o$15b2o!"
-	};
+		"3bobo5b2o$10b2o2b2obo5b2o$15b2o!";
 
-	const ModelParameters pFourtySevenBHeptominoHassler = {
+	inline constexpr Preset pTwentyEightGliderShuttle = {
+		"p28glidershuttle",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		83,
-		65,
+		42,
+		42,
+		PackedRle::decode<pTwentyEightGliderShuttleRle>()
+	};
+
+	inline constexpr std::string_view pFourtySevenBHeptominoHasslerRle =
 		"12bo4bo47bo4bo$10b3o4b3o43b3o4b3o$9bo10bo41bo10bo$9b2o8b2o41b2o8b2o3$"
 		"6b3o12b3o35b3o12b3o$14b2o51b2o$14b2o51b2o2$bo9bo6bo9bo25bo9bo6bo9bo$ob"
 		"o7bo8bo7bobo23bobo7bo8bo7bobo$bo8bo8bo8bo25bo8bo8bo8bo$10bo8bo43bo8bo$"
@@ -390,19 +448,21 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"o43bo8bo$11bo6bo45bo6bo2$11bo6bo45bo6bo$10bo8bo43bo8bo$bo8bo8bo8bo25bo"
 		"8bo8bo8bo$obo7bo8bo7bobo23bobo7bo8bo7bobo$bo9bo6bo9bo25bo9bo6bo9bo2$"
 		"14b2o51b2o$14b2o51b2o$6b3o12b3o35b3o12b3o3$9b2o8b2o41b2o8b2o$9bo10bo"
-		"41bo10bo$10b3o4b3o43b3o4b3o$12bo4bo47bo4bo!"
-	};
+		"41bo10bo$10b3o4b3o43b3o4b3o$12bo4bo47bo4bo!";
 
-	const ModelParameters prePulsarShuttle26 = {
+	inline constexpr Preset pFourtySevenBHeptominoHassler = {
+		"p47hassler",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		37,
-		37,
+		83,
+		65,
+		PackedRle::decode<pFourtySevenBHeptominoHasslerRle>()
+	};
+
+	inline constexpr std::string_view prePulsarShuttle26Rle =
 		"16bo3bo16b$10b2o4bo3bo4b2o10b$10bo5bo3bo5bo10b$7b2obo15bob2o7b$6bobob"
 		"2o13b2obobo6b$6bobo6bo5bo6bobo6b$4b2o2bo5b3o3b3o5bo2b2o4b$3bo4b2o17b2o"
 		"4bo3b$3b5o21b5o3b$7bo21bo7b$b4o27b4ob$bo2bo27bo2bob2$15b2o3b2o15b$6bo"
@@ -410,38 +470,42 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"3o$5b2o6bo9bo6b2o5b$6bo9bo3bo9bo6b$15b2o3b2o15b2$bo2bo27bo2bob$b4o27b"
 		"4ob$7bo21bo7b$3b5o21b5o3b$3bo4b2o17b2o4bo3b$4b2o2bo5b3o3b3o5bo2b2o4b$"
 		"6bobo6bo5bo6bobo6b$6bobob2o13b2obobo6b$7b2obo15bob2o7b$10bo5bo3bo5bo"
-		"10b$10b2o4bo3bo4b2o10b$16bo3bo!"
-	};
+		"10b$10b2o4bo3bo4b2o10b$16bo3bo!";
 
-	const ModelParameters ringOfFire = {
+	inline constexpr Preset prePulsarShuttle26 = {
+		"prepulsarshuttle26",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		34,
-		30,
+		37,
+		37,
+		PackedRle::decode<prePulsarShuttle26Rle>()
+	};
+
+	inline constexpr std::string_view ringOfFireRle =
 		"16bo17b$14bobobo15b$12bobobobobo13b$10bobobobobobobo11b$8bobobo2b2obob"
 		"obobo9b$6bobobobo6bo2bobobo7b$4bobobo2bo10bobobobo5b$5b2obo14bo2bobobo"
 		"3b$3bo3bo18bob2o4b$4b3o20bo3bo2b$2bo25b3o3b$3b2o27bob$bo3bo24b2o2b$2b"
 		"4o23bo3bo$o29b3ob$b3o29bo$o3bo23b4o2b$2b2o24bo3bob$bo27b2o3b$3b3o25bo"
 		"2b$2bo3bo20b3o4b$4b2obo18bo3bo3b$3bobobo2bo14bob2o5b$5bobobobo10bo2bob"
 		"obo4b$7bobobo2bo6bobobobo6b$9bobobobob2o2bobobo8b$11bobobobobobobo10b$"
-		"13bobobobobo12b$15bobobo14b$17bo!"
-	};
+		"13bobobobobo12b$15bobobo14b$17bo!";
 
-	const ModelParameters sirRobbin = {
+	inline constexpr Preset ringOfFire = {
+		"ringoffire",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		31,
-		79,
+		34,
+		30,
+		PackedRle::decode<ringOfFireRle>()
+	};
+
+	inline constexpr std::string_view sirRobbinRle =
 		"4b2o$4bo2bo$4bo3bo$6b3o$2b2o6b4o$2bob2o4b4o$bo4bo6b3o$2b4o4b2o3bo$o9b"
 		"2o$bo3bo$6b3o2b2o2bo$2b2o7bo4bo$13bob2o$10b2o6bo$11b2ob3obo$10b2o3bo2b"
 		"o$10bobo2b2o$10bo2bobobo$10b3o6bo$11bobobo3bo$14b2obobo$11bo6b3o2$11bo"
@@ -451,52 +515,58 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"o$22b2o3bo$21bo$21b2obo$20bo$19b5o$19bo4bo$18b3ob3o$18bob5o$18bo$20bo$"
 		"16bo4b4o$20b4ob2o$17b3o4bo$24bobo$28bo$24bo2b2o$25b3o$22b2o$21b3o5bo$"
 		"24b2o2bobo$21bo2b3obobo$22b2obo2bo$24bobo2b2o$26b2o$22b3o4bo$22b3o4bo$"
-		"23b2o3b3o$24b2ob2o$25b2o$25bo2$24b2o$26bo!"
-	};
+		"23b2o3b3o$24b2ob2o$25b2o$25bo2$24b2o$26bo!";
 
-	const ModelParameters slowPuffer2 = {
+	inline constexpr Preset sirRobbin = {
+		"sirrobin",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		500,
-		119,
+		31,
+		79,
+		PackedRle::decode<sirRobbinRle>()
+	};
+
+	inline constexpr std::string_view slowPuffer2Rle =
 		"143bo$40bo102bobo$41bo101b2o$39b3o6$72bo$73b2o$72b2o5$56bo$57b2o$56b2o"
 		"87bo$143b2o$144b2o2$53bo$54bo$52b3o22$14bo$3bobo7bo$4b2o7b3o$4bo5$bo$b"
 		"2o$obo$11bo24bo$12b2o22bobo$11b2o23b2o19$72b2o$71bobo$8b2o63bo$9b2o$8b"
 		"o17$152bo$139b3o9b2o$139bo11bobo$140bo7$55b3o86b2o$57bo85b2o$56bo88bo"
-		"5$35b3o$37bo$36bo!"
-	};
+		"5$35b3o$37bo$36bo!";
 
-	const ModelParameters tNosedP8 = {
+	inline constexpr Preset slowPuffer2 = {
+		"slowpuffer2",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		25,
-		25,
+		500,
+		119,
+		PackedRle::decode<slowPuffer2Rle>()
+	};
+
+	inline constexpr std::string_view tNosedP8Rle =
 		"6b2o3b3o3b2o$7bo4bo4bo2$6b13o$5bo13bo$4bo15bo$o2bo17bo2bo$2obo5bobobobo5bob2o"
 		"$3bo5bobobobo5bo$3bo3b2obo3bob2o3bo$3bo5bo5bo5bo$o2bo3b2o7b2o3bo2bo$2obo17bob"
 		"2o$o2bo3b2o7b2o3bo2bo$3bo5bo5bo5bo$3bo3b2obo3bob2o3bo$3bo5bobobobo5bo$2obo5bo"
-		"bobobo5bob2o$o2bo17bo2bo$4bo15bo$5bo13bo$6b13o2$7bo4bo4bo$6b2o3b3o3b2o!"
-	};
+		"bobobo5bob2o$o2bo17bo2bo$4bo15bo$5bo13bo$6b13o2$7bo4bo4bo$6b2o3b3o3b2o!";
 
-	const ModelParameters vexStabilisation = {
+	inline constexpr Preset tNosedP8 = {
+		"tnosedp8",
 		false,
 		-1,
-		-1,
-		-1,
 		2,
 		3,
 		3,
-		145,
-		135,
+		25,
+		25,
+		PackedRle::decode<tNosedP8Rle>()
+	};
+
+	inline constexpr std::string_view vexStabilisationRle =
 		"40bo63bo$34b2o3bobo61bobo3b2o$35bo3bo2bo59bo2bo3bo$35bob2obobo59bobob"
 		"2obo$36bobobob2o57b2obobobo$31b2o4b2obobo2bo53bo2bobob2o4b2o$32bo5bob"
 		"2o2b2o53b2o2b2obo5bo$32bobo3b3o63b3o3bobo$33b2o3b2o65b2o3b2o5$33b3o73b"
@@ -532,12 +602,45 @@ const ModelParameters gabrielsPOneThirtyEightParams = {
 		"2o33b2o12b3o$40bo13bo35bo13bo$55b3o29b3o$57bo29bo$34bo75bo$35bo73bo$33b"
 		"3o73b3o5$33b2o3b2o65b2o3b2o$32bobo3b3o63b3o3bobo$32bo5bob2o2b2o53b2o2b"
 		"2obo5bo$31b2o4b2obobo2bo53bo2bobob2o4b2o$36bobobob2o57b2obobobo$35bob"
-		"2obobo59bobob2obo$35bo3bo2bo59bo2bo3bo$34b2o3bobo61bobo3b2o$40bo63bo!"
-	};
-
-}
+		"2obobo59bobob2obo$35bo3bo2bo59bo2bo3bo$34b2o3bobo61bobo3b2o$40bo63bo!";
 
+	inline constexpr Preset vexStabilisation = {
+		"vexstabilisation",
+		false,
+		-1,
+		2,
+		3,
+		3,
+		145,
+		135,
+		PackedRle::decode<vexStabilisationRle>()
+	};
 
+	//Every preset, in the order the gui lists them.
+	inline constexpr const Preset* allPresets[] = {
+		&randomParams,
+		&swissCheeseParams,
+		&decompositionParams,
+		&blinkerParams,
+		&lightweightSpaceshipParams,
+		&blockerParams,
+		&nihoniumParams,
+		&gabrielsPOneThirtyEightParams,
+		&backrakeOnePufferVarTwo,
+		&connectedPhoenix,
+		&doubleX,
+		&frothingPufferRake,
+		&newShuttle,
+		&pTwentyEightGliderShuttle,
+		&pFourtySevenBHeptominoHassler,
+		&prePulsarShuttle26,
+		&ringOfFire,
+		&sirRobbin,
+		&slowPuffer2,
+		&tNosedP8,
+		&vexStabilisation,
+	};
 
+}
 
 #endif //GAMEOFLIFE_MODELPRESETS_H
@@ -0,0 +1,105 @@
+//Example of watching a run from another process through SharedBoard. Maps the board a gol-run --share
+//or the gui publishes, and for each new generation counts the live cells straight out of shared memory,
+//with no copy, then checks the frame wasn't overwritten while it was being read.
+//
+//  gol-run --random 0.3 --size 4096x4096 --generations 100000 --share /gol-board
+//  gol-board-reader /gol-board --frames 20
+
+#include "model/SharedBoard.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout <<
+            "usage: gol-board-reader [NAME] [options]\n"
+            "Follows the board published under NAME (default " << SharedBoard::DEFAULT_NAME << ") and prints each new generation.\n"
+            "  --frames N          stop after N frames (default: until the publisher stops)\n"
+            "  --interval MS       milliseconds between looks (default 100)\n";
+    }
+
+    //Live cells in the frame, counted where the publisher left them.
+    uint64_t countPopulation(const SharedBoard::Frame& frame)
+    {
+        uint64_t population = 0;
+        size_t wordCount = (size_t)frame.wordsPerRow * frame.height;
+        for (size_t index = 0; index < wordCount; index++) population += std::popcount(frame.words[index]);
+        return population;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string name = SharedBoard::DEFAULT_NAME;
+    long long maxFrames = 0;
+    int intervalMilliseconds = 100;
+    for (int index = 1; index < argc; index++) {
+        std::string argument = argv[index];
+        if (argument == "--help" || argument == "-h") {
+            printUsage();
+            return 0;
+        }
+        else if ((argument == "--frames" || argument == "--interval") && index + 1 < argc) {
+            const char* value = argv[++index];
+            if (argument == "--frames") maxFrames = std::max(std::atoll(value), 0ll);
+            else intervalMilliseconds = std::max(std::atoi(value), 1);
+        }
+        else if (argument.rfind("--", 0) != 0) {
+            name = argument;
+        }
+        else {
+            std::cerr << "Unknown option " << argument << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+    SharedBoard::Reader reader;
+    SharedBoard::Frame frame;
+    long long lastGeneration = -1;
+    long long frames = 0;
+    long long tornFrames = 0;
+    while (maxFrames == 0 || frames < maxFrames) {
+        if (reader.isClosed()) {
+            //First time round, or the publisher stopped or moved to a bigger segment.
+            bool wasOpen = reader.isOpen();
+            std::string error;
+            if (!reader.open(name, error) || reader.isClosed()) {
+                if (wasOpen) {
+                    std::printf("publisher stopped after %lld frames, %lld torn and read again\n", frames, tornFrames);
+                    return 0;
+                }
+                std::cerr << error << std::endl;
+                return 1;
+            }
+        }
+
+        if (reader.acquire(frame) && frame.generation != lastGeneration) {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t population = countPopulation(frame);
+            double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            //Overwritten while counting; the next look gets a newer generation.
+            if (!reader.isIntact(frame)) {
+                tornFrames++;
+                continue;
+            }
+            std::printf("generation %lld  %dx%d  %s  population %llu%s  (%.0f us to count in place, %llu published)\n",
+                frame.generation, frame.width, frame.height, frame.rule.c_str(), (unsigned long long)population,
+                population == frame.population ? "" : " (publisher disagrees)", microseconds, (unsigned long long)reader.getPublishedCount());
+            std::fflush(stdout);
+            lastGeneration = frame.generation;
+            frames++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMilliseconds));
+    }
+    return 0;
+}
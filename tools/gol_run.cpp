@@ -0,0 +1,1016 @@
+//Headless runner for the simulation engines. Loads a pattern, preset or random board, steps it
+//as fast as it can and prints the throughput, so kernel changes can be timed without a window.
+//
+//  gol-run --preset p138 --size 2048x2048 --generations 1000 --threads 8
+//  gol-run --pattern puffer.rle --rule B36/S23 --generations 5000
+//  gol-run --random 0.3 --size 16384x16384 --processes 4 --halo 4
+//  gol-run --library ~/patterns --find "gun p30"
+//  gol-run --random 0.3 --generations 100000 --telemetry run1
+//  gol-run --random 0.3 --size 4096x4096 --generations 100000 --share /gol-board
+//  gol-run --random 0.3 --size 1024x1024 --generations 1000000 --serve 8765
+
+#include "model/Checkpoint.hpp"
+#include "model/DistributedStrip.hpp"
+#include "model/EngineManager.hpp"
+#include "model/FrameRecorder.hpp"
+#include "model/FrameServer.hpp"
+#include "model/KernelTuner.hpp"
+#include "model/LifeRule.hpp"
+#include "model/MappedFile.hpp"
+#include "model/PatternLibrary.hpp"
+#include "model/PatternLoader.hpp"
+#include "model/PatternWriter.hpp"
+#include "model/PosterExporter.hpp"
+#include "model/SharedBoard.hpp"
+#include "presets/modelpresets.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct Options
+    {
+        std::string patternPath = "";
+        std::string presetName = "";
+        std::string libraryPath = "";
+        std::string libraryQuery = "";
+        std::string savePath = "";
+        std::string checkpointPath = "";
+        long long checkpointInterval = 0;
+        std::string restorePath = "";
+        std::string posterPath = "";
+        int posterCellsPerPixel = 1;
+        int posterPixelsPerCell = 1;
+        std::string recordPath = "";
+        long long recordInterval = 1;
+        //MiB of rewind history to record, or 0 for none.
+        long long historyMegabytes = 0;
+        std::string telemetryPath = "";
+        int telemetryInterval = 64;
+        std::string shareName = "";
+        long long shareInterval = 1;
+        //-1 for not serving.
+        int servePort = -1;
+        //0 to match the server's frame rate.
+        long long serveInterval = 0;
+        float fillFactor = 0.2f;
+        std::optional<LifeRule> rule;
+        int width = 1024;
+        int height = 1024;
+        long long generations = 1000;
+        int threads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+        unsigned int seed = 1;
+        EngineManager::Mode engine = EngineManager::Mode::Grid;
+        bool tune = false;
+        bool cycleDetection = true;
+        std::vector<int> affinity;
+        bool compactAffinity = false;
+        int processes = 0;
+        std::vector<std::string> hosts;
+        int rank = 0;
+        int haloDepth = 1;
+    };
+
+    void printUsage()
+    {
+        std::cout <<
+            "usage: gol-run [options]\n"
+            "  --pattern FILE      load an RLE or macrocell file. A macrocell with --engine hashlife runs on an\n"
+            "                      unbounded plane, ignoring --size\n"
+            "  --preset NAME       load a built in preset\n"
+            "  --random FILL       random board with this fill factor (default 0.2)\n"
+            "  --rule RULE         rule in B/S notation, e.g. B3/S23 (default from the pattern)\n"
+            "  --size WxH          board size in cells (default 1024x1024, grown to fit the pattern)\n"
+            "  --generations N     generations to run (default 1000)\n"
+            "  --threads N         worker threads (default: all cores)\n"
+            "  --seed N            seed for --random (default 1)\n"
+            "  --engine NAME       grid, hashlife or auto (default grid)\n"
+            "  --affinity CPUS     pin the worker threads: a comma separated CPU list for threads 1, 2, ...,\n"
+            "                      or compact for CPUs 1..threads-1. The main thread stays unpinned\n"
+            "  --processes N       split the board into N strips, one local process each\n"
+            "  --hosts LIST        split the board over TCP, one strip per host:port in the comma separated list;\n"
+            "                      start one gol-run per entry with the same arguments and its own --rank\n"
+            "  --rank N            this process's place in --hosts (default 0)\n"
+            "  --halo K            rows swapped with each neighbor strip, every K generations (default 1)\n"
+            "  --save FILE         write the final board as RLE, or plaintext for .cells or macrocell for .mc\n"
+            "  --checkpoint FILE   write a binary checkpoint of the run to FILE at the end\n"
+            "  --checkpoint-every N  and every N generations along the way, in the background. After the first\n"
+            "                      only the tiles that changed are appended\n"
+            "  --restore FILE      carry on from a checkpoint, with its board, rule and generation\n"
+            "  --poster FILE       render the final board as a PNG, or PPM for .ppm, band by band on every thread\n"
+            "  --poster-scale N    cells per poster pixel, shaded by how many are alive (default 1)\n"
+            "  --poster-zoom N     poster pixels per cell, for small boards (default 1)\n"
+            "  --record FILE       record the run as an animated GIF, or raw video for .y4m, live cells white\n"
+            "                      with fading trails. Encoded in the background\n"
+            "  --record-every N    generations between recorded frames (default 1)\n"
+            "  --history MIB       record every generation in up to MIB MiB of history, then time seeking back\n"
+            "                      through it. Turns cycle detection off\n"
+            "  --telemetry DIR     record population, births, deaths, live bounds, changed words and step time as\n"
+            "                      binary columns in DIR; gol-telemetry turns them into CSV\n"
+            "  --telemetry-every N  generations between telemetry rows (default 64). 1 records every generation,\n"
+            "                      which gathers stats on each and costs about half as much again as the kernel\n"
+            "  --share NAME        publish the board in POSIX shared memory under NAME, e.g. /gol-board, for\n"
+            "                      other processes to read; see gol-board-reader\n"
+            "  --share-every N     generations between published boards (default 1)\n"
+            "  --serve PORT        stream the board over WebSocket on localhost:PORT; open it in a browser, or see\n"
+            "                      gol-stream-client. Slow clients skip generations rather than slow the run\n"
+            "  --serve-every N     generations between boards offered to the clients (default: enough for the\n"
+            "                      server's frame rate)\n"
+            "  --no-cycles         keep computing after the board starts repeating\n"
+            "  --tune              pick kernel settings by timing them, cached in " << KernelTuner::getDefaultCachePath() << ";\n"
+            "                      overrides --threads\n"
+            "  --list-presets      print the preset names\n"
+            "  --library DIR       index the RLE and macrocell files under DIR and list them, then exit. The\n"
+            "                      index is kept in DIR/" << PatternLibrary::INDEX_FILE_NAME << ", so later scans only read new files\n"
+            "  --find TEXT         with --library, list only the patterns matching every word, e.g. \"gun p30\"\n";
+    }
+
+    bool parseSize(const std::string& text, int& width, int& height)
+    {
+        size_t separator = text.find_first_of("xX");
+        if (separator == std::string::npos) return false;
+        width = std::atoi(text.substr(0, separator).c_str());
+        height = std::atoi(text.substr(separator + 1).c_str());
+        return width > 0 && height > 0;
+    }
+
+    //compact is resolved once the thread count is known, as an empty list with compactAffinity set.
+    bool parseAffinity(const std::string& text, Options& options)
+    {
+        options.affinity.clear();
+        options.compactAffinity = (text == "compact");
+        if (options.compactAffinity) return true;
+
+        std::istringstream stream(text);
+        std::string cpu;
+        while (std::getline(stream, cpu, ',')) {
+            //Anything longer is out of range anyway, and would overflow atoi.
+            if (cpu.empty() || cpu.size() > 9 || cpu.find_first_not_of("0123456789") != std::string::npos) return false;
+            options.affinity.push_back(std::atoi(cpu.c_str()));
+        }
+        return !options.affinity.empty();
+    }
+
+    //Returns false and prints why on bad arguments.
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        for (int index = 1; index < argc; index++) {
+            std::string argument = argv[index];
+            auto nextValue = [&]() -> const char* {
+                if (index + 1 >= argc) {
+                    std::cerr << argument << " needs a value" << std::endl;
+                    return nullptr;
+                }
+                return argv[++index];
+            };
+
+            if (argument == "--help" || argument == "-h") {
+                printUsage();
+                std::exit(0);
+            }
+            else if (argument == "--list-presets") {
+                for (const ModelPresets::Preset* preset : ModelPresets::allPresets) std::cout << preset->name << "\n";
+                std::exit(0);
+            }
+            else if (argument == "--pattern") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.patternPath = value;
+            }
+            else if (argument == "--library" || argument == "--find") {
+                const char* value = nextValue();
+                if (!value) return false;
+                (argument == "--library" ? options.libraryPath : options.libraryQuery) = value;
+            }
+            else if (argument == "--preset") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.presetName = value;
+            }
+            else if (argument == "--random") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.fillFactor = (float)std::atof(value);
+            }
+            else if (argument == "--rule") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.rule = LifeRule::parse(value);
+                if (!options.rule) {
+                    std::cerr << "Could not parse rule " << value << std::endl;
+                    return false;
+                }
+            }
+            else if (argument == "--size") {
+                const char* value = nextValue();
+                if (!value) return false;
+                if (!parseSize(value, options.width, options.height)) {
+                    std::cerr << "Size should look like 1024x768, got " << value << std::endl;
+                    return false;
+                }
+            }
+            else if (argument == "--generations") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.generations = std::max(std::atoll(value), 0ll);
+            }
+            else if (argument == "--threads") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.threads = std::max(std::atoi(value), 1);
+            }
+            else if (argument == "--seed") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.seed = (unsigned int)std::strtoul(value, nullptr, 10);
+            }
+            else if (argument == "--affinity") {
+                const char* value = nextValue();
+                if (!value) return false;
+                if (!parseAffinity(value, options)) {
+                    std::cerr << "Affinity should be compact or a list like 1,2,3, got " << value << std::endl;
+                    return false;
+                }
+            }
+            else if (argument == "--processes") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.processes = std::max(std::atoi(value), 1);
+            }
+            else if (argument == "--hosts") {
+                const char* value = nextValue();
+                if (!value) return false;
+                std::istringstream stream(value);
+                std::string host;
+                while (std::getline(stream, host, ',')) if (!host.empty()) options.hosts.push_back(host);
+            }
+            else if (argument == "--rank") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.rank = std::max(std::atoi(value), 0);
+            }
+            else if (argument == "--halo") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.haloDepth = std::max(std::atoi(value), 1);
+            }
+            else if (argument == "--save") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.savePath = value;
+            }
+            else if (argument == "--checkpoint") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.checkpointPath = value;
+            }
+            else if (argument == "--checkpoint-every") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.checkpointInterval = std::max(std::atoll(value), 0ll);
+            }
+            else if (argument == "--restore") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.restorePath = value;
+            }
+            else if (argument == "--poster") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.posterPath = value;
+            }
+            else if (argument == "--poster-scale" || argument == "--poster-zoom") {
+                const char* value = nextValue();
+                if (!value) return false;
+                int scale = std::atoi(value);
+                if (scale < 1) {
+                    std::cerr << argument << " should be a whole number from 1 up" << std::endl;
+                    return false;
+                }
+                (argument == "--poster-scale" ? options.posterCellsPerPixel : options.posterPixelsPerCell) = scale;
+            }
+            else if (argument == "--record") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.recordPath = value;
+            }
+            else if (argument == "--record-every") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.recordInterval = std::max(std::atoll(value), 1ll);
+            }
+            else if (argument == "--history") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.historyMegabytes = std::atoll(value);
+                if (options.historyMegabytes <= 0) {
+                    std::cerr << "--history should be a size in MiB" << std::endl;
+                    return false;
+                }
+            }
+            else if (argument == "--telemetry") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.telemetryPath = value;
+            }
+            else if (argument == "--telemetry-every") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.telemetryInterval = (int)std::clamp(std::atoll(value), 1ll, (long long)std::numeric_limits<int>::max());
+            }
+            else if (argument == "--share") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.shareName = value;
+            }
+            else if (argument == "--share-every") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.shareInterval = std::max(std::atoll(value), 1ll);
+            }
+            else if (argument == "--serve") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.servePort = std::clamp(std::atoi(value), 0, 65535);
+            }
+            else if (argument == "--serve-every") {
+                const char* value = nextValue();
+                if (!value) return false;
+                options.serveInterval = std::max(std::atoll(value), 1ll);
+            }
+            else if (argument == "--no-cycles") {
+                options.cycleDetection = false;
+            }
+            else if (argument == "--tune") {
+                options.tune = true;
+            }
+            else if (argument == "--engine") {
+                const char* value = nextValue();
+                if (!value) return false;
+                std::string name = value;
+                if (name == "grid") options.engine = EngineManager::Mode::Grid;
+                else if (name == "hashlife") options.engine = EngineManager::Mode::HashLife;
+                else if (name == "auto") options.engine = EngineManager::Mode::Automatic;
+                else {
+                    std::cerr << "Engine should be grid, hashlife or auto, got " << value << std::endl;
+                    return false;
+                }
+            }
+            else {
+                std::cerr << "Unknown option " << argument << std::endl;
+                printUsage();
+                return false;
+            }
+        }
+        if (!options.restorePath.empty() && (!options.patternPath.empty() || !options.presetName.empty())) {
+            std::cerr << "--restore brings its own board; drop --pattern and --preset" << std::endl;
+            return false;
+        }
+        if (options.checkpointInterval > 0 && options.checkpointPath.empty()) {
+            std::cerr << "--checkpoint-every needs --checkpoint FILE" << std::endl;
+            return false;
+        }
+        if ((!options.checkpointPath.empty() || !options.restorePath.empty()) && (options.processes > 1 || !options.hosts.empty())) {
+            std::cerr << "Checkpoints aren't supported for runs split over processes" << std::endl;
+            return false;
+        }
+        if (options.historyMegabytes > 0 && (options.processes > 1 || !options.hosts.empty())) {
+            std::cerr << "History isn't supported for runs split over processes" << std::endl;
+            return false;
+        }
+        if ((!options.recordPath.empty() || !options.posterPath.empty()) && (options.processes > 1 || !options.hosts.empty())) {
+            std::cerr << "Recording and posters aren't supported for runs split over processes" << std::endl;
+            return false;
+        }
+        if ((!options.telemetryPath.empty() || !options.shareName.empty() || options.servePort >= 0) && (options.processes > 1 || !options.hosts.empty())) {
+            std::cerr << "Telemetry, sharing and serving aren't supported for runs split over processes" << std::endl;
+            return false;
+        }
+        //No rank holds the whole board at the end, and the strips keep the kernel settings they are given.
+        if ((!options.savePath.empty() || options.tune || !options.affinity.empty() || options.compactAffinity)
+            && (options.processes > 1 || !options.hosts.empty())) {
+            std::cerr << "--save, --tune and --affinity aren't supported for runs split over processes" << std::endl;
+            return false;
+        }
+        for (int cpu : options.affinity) {
+            if (cpu >= WorkerPool::getCpuLimit()) {
+                std::cerr << "CPU " << cpu << " is out of range; --affinity takes CPUs 0 to " << WorkerPool::getCpuLimit() - 1 << std::endl;
+                return false;
+            }
+        }
+        if (!options.libraryQuery.empty() && options.libraryPath.empty()) {
+            std::cerr << "--find needs --library DIR" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //Scans the library, timing it, and lists the matching patterns.
+    int listLibrary(const Options& options)
+    {
+        PatternLibrary library;
+        library.scan(options.libraryPath);
+        while (library.isScanning()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        //The scan has already said why it failed.
+        if (!library.takeResult()) return 1;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> matches;
+        library.search(options.libraryQuery, matches);
+        double searchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (int index : matches) {
+            const PatternLibrary::Entry& entry = library.getEntries()[index];
+            std::string size = (entry.width > 0 || entry.height > 0) ? std::to_string(entry.width) + "x" + std::to_string(entry.height) : "?";
+            std::string period = (entry.period > 0) ? "p" + std::to_string(entry.period) : "";
+            std::printf("%-40s %-12s %-10s %-6s %s\n", entry.name.c_str(), size.c_str(), entry.rule.c_str(), period.c_str(), entry.file.c_str());
+        }
+        std::printf("%s\n%zu of %zu patterns matched in %.2f ms\n",
+            library.getStatusText().c_str(), matches.size(), library.getEntries().size(), searchSeconds * 1000.0);
+        return 0;
+    }
+
+    //Cell values as the viewer colors them: 255 while alive, fading by FADE_PER_GENERATION each generation after.
+    constexpr int FADE_PER_GENERATION = 10;
+
+    void updateFrameValues(const GridEngine& board, long long generations, std::vector<uint8_t>& values)
+    {
+        int fade = (int)std::min<long long>(generations * FADE_PER_GENERATION, 255);
+        for (int row = 0; row < board.getHeight(); row++) {
+            const uint64_t* cells = board.getRow(row);
+            uint8_t* rowValues = &values[(size_t)row * board.getWidth()];
+            for (int column = 0; column < board.getWidth(); column++) {
+                uint8_t& value = rowValues[column];
+                if ((cells[column / GridEngine::BITS_PER_WORD] >> (column % GridEngine::BITS_PER_WORD)) & 1) value = 255;
+                else value = (value >= fade) ? value - fade : 0;
+            }
+        }
+    }
+
+    //Seeks to generations spread over the recorded history and times them, then back to the newest.
+    void reportHistory(EngineManager& engine)
+    {
+        const HistoryRing& history = engine.getHistory();
+        long long oldest = history.getOldestGeneration();
+        long long newest = history.getNewestGeneration();
+        std::printf("history: generations %lld to %lld in %zu keyframes, %.1f MiB\n",
+            oldest, newest, history.getKeyframeCount(), history.getBytes() / (1024.0 * 1024.0));
+        if (history.isEmpty()) return;
+
+        constexpr int SEEKS = 64;
+        double totalSeconds = 0.0;
+        double slowestSeconds = 0.0;
+        for (int seek = 0; seek < SEEKS; seek++) {
+            long long generation = oldest + (newest - oldest) * seek / (SEEKS - 1);
+            auto start = std::chrono::steady_clock::now();
+            engine.seek(generation);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            totalSeconds += seconds;
+            slowestSeconds = std::max(slowestSeconds, seconds);
+        }
+        std::printf("seek: %.3f ms average, %.3f ms slowest over %d generations\n",
+            totalSeconds * 1000.0 / SEEKS, slowestSeconds * 1000.0, SEEKS);
+        engine.seek(newest);
+    }
+
+    //Every rank builds the whole board the same way and keeps its own strip, so nothing needs scattering.
+    int runDistributed(DistributedStrip& strip, EngineManager& engine, const LifeRule& rule, const Options& options)
+    {
+        const bool leader = strip.getRank() == 0;
+        const int width = engine.getWidth();
+        const int height = engine.getHeight();
+        uint64_t initialPopulation = engine.countPopulation();
+        if (!strip.load(engine.getGrid(), options.haloDepth)) {
+            std::cerr << strip.getError() << std::endl;
+            return 1;
+        }
+        strip.setRule(rule);
+        strip.setKernelConfig(engine.getKernelConfig());
+        //Only the strip is needed from here on.
+        engine.resize(1, 1);
+
+        if (leader) {
+            std::printf("board %dx%d, rule %s, %d ranks of about %d rows, halo %d, %d threads each, initial population %llu\n",
+                width, height, rule.toString().c_str(), strip.getRankCount(), strip.getStripHeight(), options.haloDepth,
+                engine.getKernelConfig().threadCount, (unsigned long long)initialPopulation);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool stepped = strip.step(options.generations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!stepped) {
+            std::cerr << strip.getError() << std::endl;
+            return 1;
+        }
+
+        //The slowest rank sets the pace, so report the worst of each.
+        const auto& timing = strip.getTiming();
+        uint64_t population = 0;
+        double slowestSeconds = 0.0;
+        double computeSeconds = 0.0;
+        double communicationSeconds = 0.0;
+        double exchangeSeconds = 0.0;
+        if (!strip.allReduceSum(strip.countPopulation(), population)
+            || !strip.allReduceMax(seconds, slowestSeconds)
+            || !strip.allReduceMax(timing.computeSeconds, computeSeconds)
+            || !strip.allReduceMax(timing.communicationSeconds, communicationSeconds)
+            || !strip.allReduceMax(timing.exchangeSeconds, exchangeSeconds)) {
+            std::cerr << strip.getError() << std::endl;
+            return 1;
+        }
+        if (!leader) return 0;
+
+        double generationsPerSecond = slowestSeconds > 0.0 ? options.generations / slowestSeconds : 0.0;
+        std::printf("generations: %lld\n", options.generations);
+        std::printf("seconds: %.3f\n", slowestSeconds);
+        std::printf("generations/s: %.1f\n", generationsPerSecond);
+        std::printf("cells/s: %.3e\n", generationsPerSecond * width * height);
+        std::printf("final population: %llu\n", (unsigned long long)population);
+        std::printf("compute: %.3f s\n", computeSeconds);
+        std::printf("communication wait: %.3f s\n", communicationSeconds);
+        std::printf("exchanges in flight: %.3f s over %lld exchanges, %llu bytes sent per rank\n",
+            exchangeSeconds, timing.exchanges, (unsigned long long)timing.bytesSent);
+        return 0;
+    }
+
+    //Parse the RLE, plaintext or macrocell into a board of at least the requested size, the same way the gui does.
+    bool loadPattern(std::string_view text, const Options& options, LoadedPattern& pattern, std::string& error)
+    {
+        ModelParameters parameters;
+        parameters.modelWidth = options.width;
+        parameters.modelHeight = options.height;
+        return PatternLoader::parsePattern(text, parameters, pattern, &error, nullptr, nullptr, options.patternPath);
+    }
+
+    //A macrocell run on HashLife alone, with no board, so patterns far bigger than any grid run as they are.
+    int runTree(std::string_view text, const Options& options)
+    {
+        if (!options.checkpointPath.empty()) {
+            std::cerr << "An unbounded run has no board to checkpoint; save it as a macrocell with --save" << std::endl;
+            return 1;
+        }
+        if (options.historyMegabytes > 0 || !options.recordPath.empty() || !options.posterPath.empty() || !options.telemetryPath.empty() || !options.shareName.empty() || options.servePort >= 0) {
+            std::cerr << "An unbounded run has no board to record, render, share or serve" << std::endl;
+            return 1;
+        }
+        HashLifeEngine tree;
+        HashLifeEngine::MacrocellHeader header;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (!tree.loadMacrocell(text, header, error)) {
+            std::cerr << "Could not parse " << options.patternPath << ": " << error << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (options.rule) {
+            if (!HashLifeEngine::supportsRule(*options.rule)) {
+                std::cerr << "Rule " << options.rule->toString() << " has B0, which HashLife can't run" << std::endl;
+                return 1;
+            }
+            tree.setRule(*options.rule);
+        }
+        auto printBounds = [&tree]() {
+            HashLifeEngine::Bounds bounds = tree.getBounds();
+            if (!bounds.isEmpty()) std::printf("live bounds: %lld,%lld to %lld,%lld\n", bounds.left, bounds.top, bounds.right, bounds.bottom);
+        };
+        std::printf("tree of %zu nodes loaded in %.3f s, rule %s, generation %lld, initial population %llu\n",
+            tree.getNodeCount(), seconds, tree.getRule().toString().c_str(), header.generation,
+            (unsigned long long)tree.getPopulation());
+        printBounds();
+
+        start = std::chrono::steady_clock::now();
+        tree.step(options.generations);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("generations: %lld\n", options.generations);
+        std::printf("seconds: %.3f\n", seconds);
+        std::printf("generations/s: %.1f\n", seconds > 0.0 ? options.generations / seconds : 0.0);
+        std::printf("final population: %llu\n", (unsigned long long)tree.getPopulation());
+        printBounds();
+        std::printf("engine: HashLife, unbounded\n");
+
+        if (!options.savePath.empty()) {
+            if (PatternWriter::getFormat(options.savePath) != PatternWriter::Format::Macrocell) {
+                std::cerr << "An unbounded run can only be saved as a macrocell (.mc)" << std::endl;
+                return 1;
+            }
+            start = std::chrono::steady_clock::now();
+            if (!PatternWriter::save(tree, options.savePath, error, header.generation + options.generations)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf("saved %s in %.3f s\n", options.savePath.c_str(), seconds);
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    if (!options.libraryPath.empty()) return listLibrary(options);
+
+    const bool distributed = options.processes > 1 || !options.hosts.empty();
+    //A macrocell on HashLife doesn't need a board at all.
+    if (!options.patternPath.empty() && options.engine == EngineManager::Mode::HashLife && !distributed) {
+        MappedFile file;
+        if (!file.open(options.patternPath)) {
+            std::cerr << file.getError() << std::endl;
+            return 1;
+        }
+        if (file.getText().substr(0, 4) == "[M2]") return runTree(file.getText(), options);
+    }
+
+    //Distributed runs connect first. Local ranks are forked before any worker threads exist.
+    DistributedStrip strip;
+#if !defined(_WIN32)
+    std::vector<pid_t> children;
+#endif
+    if (options.processes > 1) {
+#if !defined(_WIN32)
+        std::vector<std::pair<int, int>> links;
+        std::string error;
+        if (!DistributedStrip::makeLocalRing(options.processes, links, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        int rank = 0;
+        for (int child = 1; child < options.processes; child++) {
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "fork failed" << std::endl;
+                return 1;
+            }
+            if (pid == 0) {
+                rank = child;
+                children.clear();
+                break;
+            }
+            children.push_back(pid);
+        }
+        int upSocket = links[rank].second;
+        int downSocket = links[(rank + 1) % options.processes].first;
+        for (auto& link : links) {
+            if (link.first != downSocket) close(link.first);
+            if (link.second != upSocket) close(link.second);
+        }
+        strip.attach(rank, options.processes, upSocket, downSocket);
+        //Share the cores out rather than running every process on all of them.
+        options.threads = std::max(options.threads / options.processes, 1);
+#else
+        std::cerr << "--processes needs fork, which this platform doesn't have; use --hosts" << std::endl;
+        return 1;
+#endif
+    }
+    else if (!options.hosts.empty() && !strip.connect(options.hosts, options.rank)) {
+        std::cerr << strip.getError() << std::endl;
+        return 1;
+    }
+
+    EngineManager engine;
+    engine.selectedModeIndex = (int)options.engine;
+    engine.cycleDetection = options.cycleDetection;
+    engine.telemetryInterval = options.telemetryInterval;
+    LifeRule rule;
+    //Written into checkpoints, so a restored run knows what it was.
+    ModelParameters checkpointParameters;
+    checkpointParameters.random = false;
+    checkpointParameters.fillFactor = options.fillFactor;
+
+    if (!options.restorePath.empty()) {
+        Checkpoint::Reader reader;
+        if (!reader.open(options.restorePath)) {
+            std::cerr << reader.getError() << std::endl;
+            return 1;
+        }
+        auto restoreStart = std::chrono::steady_clock::now();
+        reader.load(engine);
+        double restoreSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - restoreStart).count();
+        const Checkpoint::Header& header = reader.getHeader();
+        rule = header.rule;
+        checkpointParameters = header.parameters;
+        std::printf("restored %s at generation %lld from %d segments in %.3f s\n",
+            options.restorePath.c_str(), header.generation, reader.getSegmentCount(), restoreSeconds);
+        if (reader.getIgnoredBytes() > 0) {
+            std::printf("ignored %llu bytes of an unfinished update at the end\n", (unsigned long long)reader.getIgnoredBytes());
+        }
+    }
+    else if (!options.patternPath.empty() || !options.presetName.empty()) {
+        LoadedPattern pattern;
+        if (!options.patternPath.empty()) {
+            MappedFile file;
+            if (!file.open(options.patternPath)) {
+                std::cerr << file.getError() << std::endl;
+                return 1;
+            }
+            std::string error;
+            if (!loadPattern(file.getText(), options, pattern, error)) {
+                std::cerr << "Could not parse " << options.patternPath << ": " << error << std::endl;
+                return 1;
+            }
+        }
+        else {
+            const auto preset = std::find_if(
+                std::begin(ModelPresets::allPresets), std::end(ModelPresets::allPresets),
+                [&](const ModelPresets::Preset* namedPreset) { return namedPreset->name == options.presetName; });
+            if (preset == std::end(ModelPresets::allPresets)) {
+                std::cerr << "No preset named " << options.presetName << ", try --list-presets" << std::endl;
+                return 1;
+            }
+            const ModelParameters parameters = (*preset)->getParameters();
+            rule = LifeRule::fromParameters(parameters);
+            if (parameters.random) {
+                options.fillFactor = parameters.fillFactor;
+            }
+            else {
+                //Decoded when this was compiled, so it only needs copying onto the board.
+                int width = std::max(options.width, parameters.minWidth);
+                int height = std::max(options.height, parameters.minHeight);
+                engine.resize(width, height);
+                engine.loadPattern((*preset)->pattern, (height - parameters.minHeight) / 2, (width / 2) - (parameters.minWidth / 2));
+            }
+        }
+
+        if (pattern.tree) {
+            rule = LifeRule::fromParameters(pattern.parameters);
+            engine.resize(pattern.parameters.modelWidth, pattern.parameters.modelHeight);
+            engine.loadTree(std::move(*pattern.tree), pattern.generation);
+        }
+        else if (!pattern.cells.empty()) {
+            rule = LifeRule::fromParameters(pattern.parameters);
+            engine.resize(pattern.parameters.modelWidth, pattern.parameters.modelHeight);
+            engine.loadCells(pattern.cells);
+        }
+    }
+
+    if (engine.getWidth() == 0) {
+        engine.resize(options.width, options.height);
+        std::mt19937 rng(options.seed);
+        std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+        for (int row = 0; row < engine.getHeight(); row++) {
+            for (int column = 0; column < engine.getWidth(); column++) {
+                if (distribution(rng) < options.fillFactor) engine.setCell(row, column, true);
+            }
+        }
+    }
+
+    if (options.rule) rule = *options.rule;
+    engine.setRule(rule);
+    checkpointParameters.ruleString = rule.toString();
+    engine.setThreadCount(options.threads);
+    if (options.historyMegabytes > 0) {
+        engine.recordHistory = true;
+        engine.getHistory().maxBytes = (size_t)options.historyMegabytes << 20;
+    }
+    if (distributed) {
+        int result = runDistributed(strip, engine, rule, options);
+#if !defined(_WIN32)
+        for (pid_t child : children) {
+            int status = 0;
+            waitpid(child, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) result = 1;
+        }
+#endif
+        return result;
+    }
+    if (options.tune) {
+        auto tuning = KernelTuner::tune(engine.getWidth(), engine.getHeight(), rule);
+        engine.setKernelConfig(tuning.config);
+        std::printf("kernel%s: %s\n", tuning.fromCache ? " (cached)" : "", KernelTuner::describe(tuning.config).c_str());
+    }
+    if (options.compactAffinity) options.affinity = WorkerPool::getCompactAffinity(engine.getKernelConfig().threadCount);
+    if (!options.affinity.empty()) {
+        engine.setAffinity(options.affinity);
+        std::printf("pinned %d worker threads\n", (int)std::min<size_t>(options.affinity.size(), engine.getKernelConfig().threadCount - 1));
+    }
+    std::printf("huge pages: %s\n", GridMemory::isHugePageAdvised() ? "advised" : "not used");
+
+    std::printf("board %dx%d, rule %s, %d threads, initial population %llu\n",
+        engine.getWidth(), engine.getHeight(), rule.toString().c_str(), engine.getKernelConfig().threadCount,
+        (unsigned long long)engine.countPopulation());
+
+    //Frames are queued between chunks and encoded while the next chunk runs. Every frame is wanted
+    //here, so a full queue waits for the encoder rather than dropping one.
+    FrameRecorder recorder;
+    recorder.dropWhenFull = false;
+    FrameRecorder::Palette grayscale;
+    for (int index = 0; index < 256; index++) grayscale[index] = FrameRecorder::Color{ (uint8_t)index, (uint8_t)index, (uint8_t)index };
+    std::vector<uint8_t> frameValues;
+    if (!options.recordPath.empty()) {
+        std::string error;
+        if (!recorder.start(options.recordPath, engine.getWidth(), engine.getHeight(), error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        frameValues.assign((size_t)engine.getWidth() * engine.getHeight(), 0);
+        updateFrameValues(engine.getGrid(), 0, frameValues);
+        recorder.addFrame(frameValues.data(), grayscale);
+    }
+
+    if (!options.telemetryPath.empty()) {
+        std::string error;
+        if (!engine.getTelemetry().start(options.telemetryPath, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    //Published between chunks; readers never hold the run up.
+    SharedBoard::Publisher publisher;
+    if (!options.shareName.empty()) {
+        std::string error;
+        if (!publisher.start(options.shareName, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        if (!publisher.publish(engine.getGrid(), engine.getGeneration())) {
+            std::cerr << publisher.getError() << std::endl;
+            return 1;
+        }
+    }
+
+    //Offered between chunks too; the server only takes a copy when a client is ready for one.
+    FrameServer server;
+    if (options.servePort >= 0) {
+        std::string error;
+        if (!server.start(options.servePort, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        std::printf("serving: http://%s:%d/\n", server.bindAddress.c_str(), server.getPort());
+        std::fflush(stdout);
+        server.publish(engine.getGrid(), engine.getGeneration());
+    }
+
+    //Checkpoints are copied out between chunks and written while the next chunk runs.
+    Checkpoint::Writer checkpointWriter;
+    auto start = std::chrono::steady_clock::now();
+    long long remaining = options.generations;
+    long long untilCheckpoint = options.checkpointInterval;
+    long long untilFrame = options.recordInterval;
+    long long untilShare = options.shareInterval;
+    //Without --serve-every the interval is doubled or halved until boards are offered about twice per frame
+    //the server may send. One generation at a time would cost a stats pass every generation.
+    long long serveInterval = std::max(options.serveInterval, 1ll);
+    const double serveSeconds = 0.5 / std::max(server.maxFramesPerSecond, 1);
+    long long untilServe = serveInterval;
+    auto chunkStart = start;
+    do {
+        long long chunk = remaining;
+        if (options.checkpointInterval > 0) chunk = std::min(chunk, untilCheckpoint);
+        if (recorder.isRecording()) chunk = std::min(chunk, untilFrame);
+        if (publisher.isPublishing()) chunk = std::min(chunk, untilShare);
+        if (server.isServing()) {
+            chunk = std::min(chunk, untilServe);
+            chunkStart = std::chrono::steady_clock::now();
+        }
+        engine.step((int)std::min<long long>(chunk, INT32_MAX));
+        remaining -= chunk;
+        untilCheckpoint -= chunk;
+        untilFrame -= chunk;
+        untilShare -= chunk;
+        untilServe -= chunk;
+        if (publisher.isPublishing() && untilShare == 0) {
+            if (!publisher.publish(engine.getGrid(), engine.getGeneration())) {
+                std::cerr << publisher.getError() << std::endl;
+                return 1;
+            }
+            untilShare = options.shareInterval;
+        }
+        if (server.isServing() && untilServe == 0) {
+            server.publish(engine.getGrid(), engine.getGeneration());
+            if (options.serveInterval == 0) {
+                double chunkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - chunkStart).count();
+                if (chunkSeconds < serveSeconds / 2) serveInterval *= 2;
+                else if (chunkSeconds > serveSeconds) serveInterval = std::max(serveInterval / 2, 1ll);
+            }
+            untilServe = serveInterval;
+        }
+        if (!options.checkpointPath.empty() && ((options.checkpointInterval > 0 && untilCheckpoint == 0) || remaining == 0)) {
+            checkpointWriter.write(options.checkpointPath, engine.getGrid(), engine.getGeneration(), checkpointParameters);
+            untilCheckpoint = options.checkpointInterval;
+        }
+        if (recorder.isRecording() && untilFrame == 0) {
+            //Trails fade by every generation stepped, not just the recorded ones.
+            updateFrameValues(engine.getGrid(), options.recordInterval, frameValues);
+            recorder.addFrame(frameValues.data(), grayscale);
+            untilFrame = options.recordInterval;
+        }
+    } while (remaining > 0);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double generationsPerSecond = seconds > 0.0 ? options.generations / seconds : 0.0;
+    double cellsPerSecond = generationsPerSecond * engine.getWidth() * engine.getHeight();
+    std::printf("generations: %lld\n", options.generations);
+    std::printf("seconds: %.3f\n", seconds);
+    std::printf("generations/s: %.1f\n", generationsPerSecond);
+    std::printf("cells/s: %.3e\n", cellsPerSecond);
+    const GridEngine::Stats stats = engine.getStats();
+    std::printf("final population: %llu\n", (unsigned long long)stats.population);
+    std::printf("last generation: %llu births, %llu deaths\n", (unsigned long long)stats.births, (unsigned long long)stats.deaths);
+    if (!stats.isEmpty()) std::printf("live bounds: %d,%d to %d,%d\n", stats.left, stats.top, stats.right, stats.bottom);
+    std::printf("engine: %s (%s)\n", EngineManager::EngineNames[(int)engine.getActiveEngine()], engine.getReason().c_str());
+    const CycleDetector& cycles = engine.getCycleDetector();
+    if (cycles.getState() == CycleDetector::State::Confirmed) {
+        std::printf("cycle: period %d since generation %lld\n", cycles.getPeriod(), cycles.getCycleStart());
+    }
+    if (options.historyMegabytes > 0) reportHistory(engine);
+
+    if (publisher.isPublishing()) {
+        std::printf("shared: %lld boards as %s\n", publisher.getPublishedCount(), publisher.getName().c_str());
+        publisher.stop();
+    }
+    if (server.isServing()) {
+        std::printf("served: %lld boards in %lld messages, %.1f MiB\n", server.getFrameCount(), server.getMessageCount(), server.getBytesSent() / 1048576.0);
+        std::string error = server.getError();
+        server.stop();
+        if (!error.empty()) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    TelemetrySink& telemetry = engine.getTelemetry();
+    if (telemetry.isRecording()) {
+        if (!telemetry.stop()) {
+            std::cerr << telemetry.getError() << std::endl;
+            return 1;
+        }
+        std::printf("telemetry: %llu rows to %s\n", (unsigned long long)telemetry.getRowCount(), options.telemetryPath.c_str());
+    }
+
+    if (!options.checkpointPath.empty()) {
+        if (!checkpointWriter.wait()) {
+            std::cerr << checkpointWriter.getError() << std::endl;
+            return 1;
+        }
+        Checkpoint::WriteTotals totals = checkpointWriter.getTotals();
+        std::printf("checkpoints: %d to %s, %d full, %llu tiles, %.1f MiB, %.3f s writing in the background\n",
+            totals.checkpoints, options.checkpointPath.c_str(), totals.bases, (unsigned long long)totals.tilesWritten,
+            totals.bytesWritten / (1024.0 * 1024.0), totals.seconds);
+    }
+
+    if (recorder.isRecording()) {
+        if (!recorder.stop()) {
+            std::cerr << recorder.getError() << std::endl;
+            return 1;
+        }
+        FrameRecorder::Status status = recorder.getStatus();
+        std::printf("recorded %lld frames to %s as %s, %.1f MiB, %.3f s encoding in the background\n",
+            status.framesWritten, options.recordPath.c_str(), FrameRecorder::FormatNames[(int)recorder.getActiveFormat()],
+            status.bytesWritten / (1024.0 * 1024.0), status.seconds);
+    }
+
+    if (!options.savePath.empty()) {
+        PatternWriter::Format format = PatternWriter::getFormat(options.savePath);
+        std::string comment = "generation " + std::to_string(engine.getGeneration());
+        std::string error;
+        start = std::chrono::steady_clock::now();
+        bool saved = (format == PatternWriter::Format::Macrocell && engine.getActiveEngine() == EngineManager::Engine::HashLife)
+            ? PatternWriter::save(engine.getHashLife(), options.savePath, error, engine.getGeneration(), comment)
+            : PatternWriter::save(engine.getGrid(), options.savePath, format, error, comment);
+        if (!saved) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("saved %s in %.3f s\n", options.savePath.c_str(), seconds);
+    }
+
+    if (!options.posterPath.empty()) {
+        PosterExporter::Settings settings;
+        settings.cellsPerPixel = options.posterCellsPerPixel;
+        settings.pixelsPerCell = options.posterPixelsPerCell;
+        settings.palette = PosterExporter::getGrayscalePalette();
+        settings.threadCount = engine.getKernelConfig().threadCount;
+        PosterExporter::Result poster;
+        std::string error;
+        if (!PosterExporter::save(engine.getGrid(), options.posterPath, settings, error, &poster)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        std::printf("poster %s: %dx%d %s, %.1f MiB in %.3f s\n",
+            options.posterPath.c_str(), poster.width, poster.height,
+            PosterExporter::FormatNames[(int)PosterExporter::getFormat(options.posterPath)],
+            poster.bytesWritten / (1024.0 * 1024.0), poster.seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+//Example of following a run a FrameServer streams, without a browser. Connects over WebSocket, rebuilds
+//the board from the keyframe and the deltas after it, and checks each one against the population the server
+//counted, then asks for the next. --delay makes it a slow client, which should see generations skipped rather
+//than fall behind.
+//
+//  gol-run --random 0.3 --size 1024x1024 --generations 1000000 --serve 8765
+//  gol-stream-client localhost:8765 --frames 50 --delay 100
+
+#include "model/FrameServer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //The example key from RFC 6455; the server's answer to it is known.
+    constexpr const char* WEBSOCKET_KEY = "dGhlIHNhbXBsZSBub25jZQ==";
+
+    void printUsage()
+    {
+        std::cout <<
+            "usage: gol-stream-client [HOST:PORT] [options]\n"
+            "Follows the board a FrameServer streams from HOST:PORT (default localhost:" << FrameServer::DEFAULT_PORT << ") and prints each frame.\n"
+            "  --frames N          stop after N frames (default: until the server stops)\n"
+            "  --delay MS          wait MS milliseconds after each frame, like a slow client (default 0)\n";
+    }
+
+#if !defined(_WIN32)
+#if defined(MSG_NOSIGNAL)
+    //A server that has gone shows up as a failed read, not a signal.
+    constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+    constexpr int SEND_FLAGS = 0;
+#endif
+
+    bool receiveAll(int socketHandle, uint8_t* bytes, size_t size)
+    {
+        while (size > 0) {
+            ssize_t received = recv(socketHandle, bytes, size, 0);
+            if (received <= 0) return false;
+            bytes += received;
+            size -= (size_t)received;
+        }
+        return true;
+    }
+
+    int connectTo(const std::string& host, const std::string& port)
+    {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) return -1;
+        int socketHandle = -1;
+        for (addrinfo* address = addresses; address && socketHandle < 0; address = address->ai_next) {
+            socketHandle = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (socketHandle >= 0 && connect(socketHandle, address->ai_addr, address->ai_addrlen) != 0) {
+                close(socketHandle);
+                socketHandle = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        return socketHandle;
+    }
+
+    //Sends the upgrade request and checks the server's answer.
+    bool handshake(int socketHandle, const std::string& host, std::string& error)
+    {
+        std::string request = "GET /stream HTTP/1.1\r\n"
+            "Host: " + host + "\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: Upgrade\r\n"
+            "Sec-WebSocket-Key: " + WEBSOCKET_KEY + "\r\n"
+            "Sec-WebSocket-Version: 13\r\n\r\n";
+        if (send(socketHandle, request.data(), request.size(), SEND_FLAGS) != (ssize_t)request.size()) {
+            error = "Could not send the upgrade request";
+            return false;
+        }
+        //Byte by byte, so nothing after the response is read into it.
+        std::string response;
+        uint8_t byte = 0;
+        while (response.size() < 4 || response.compare(response.size() - 4, 4, "\r\n\r\n") != 0) {
+            if (response.size() > 8192 || !receiveAll(socketHandle, &byte, 1)) {
+                error = "The server didn't answer the upgrade request";
+                return false;
+            }
+            response += (char)byte;
+        }
+        if (response.rfind("HTTP/1.1 101", 0) != 0 || response.find(FrameServer::getWebSocketAccept(WEBSOCKET_KEY)) == std::string::npos) {
+            error = "The server refused the upgrade: " + response.substr(0, response.find("\r\n"));
+            return false;
+        }
+        return true;
+    }
+
+    //The next message's opcode and payload. Servers don't mask.
+    bool receiveMessage(int socketHandle, uint8_t& opcode, std::vector<uint8_t>& payload)
+    {
+        uint8_t header[2];
+        if (!receiveAll(socketHandle, header, 2)) return false;
+        opcode = header[0] & 0x0f;
+        uint64_t size = header[1] & 0x7f;
+        int extendedBytes = (size == 126) ? 2 : (size == 127) ? 8 : 0;
+        uint8_t extended[8];
+        if (extendedBytes > 0) {
+            if (!receiveAll(socketHandle, extended, (size_t)extendedBytes)) return false;
+            size = 0;
+            for (int byte = 0; byte < extendedBytes; byte++) size = size << 8 | extended[byte];
+        }
+        payload.resize((size_t)size);
+        return receiveAll(socketHandle, payload.data(), payload.size());
+    }
+
+    //Any message asks for the next frame; this one is empty. Masked, as clients must.
+    void sendAnswer(int socketHandle)
+    {
+        const uint8_t frame[6] = { 0x81, 0x80, 0x12, 0x34, 0x56, 0x78 };
+        send(socketHandle, frame, sizeof(frame), SEND_FLAGS);
+    }
+
+    //A normal close.
+    void sendClose(int socketHandle)
+    {
+        const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+        const uint8_t frame[8] = { 0x88, 0x82, mask[0], mask[1], mask[2], mask[3], (uint8_t)(0x03 ^ mask[0]), (uint8_t)(0xe8 ^ mask[1]) };
+        send(socketHandle, frame, sizeof(frame), SEND_FLAGS);
+    }
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    std::string address = "localhost:" + std::to_string(FrameServer::DEFAULT_PORT);
+    long long maxFrames = 0;
+    int delayMilliseconds = 0;
+    for (int index = 1; index < argc; index++) {
+        std::string argument = argv[index];
+        if (argument == "--help" || argument == "-h") {
+            printUsage();
+            return 0;
+        }
+        else if ((argument == "--frames" || argument == "--delay") && index + 1 < argc) {
+            const char* value = argv[++index];
+            if (argument == "--frames") maxFrames = std::max(std::atoll(value), 0ll);
+            else delayMilliseconds = std::max(std::atoi(value), 0);
+        }
+        else if (argument.rfind("--", 0) != 0) {
+            address = argument;
+        }
+        else {
+            std::cerr << "Unknown option " << argument << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+
+#if !defined(_WIN32)
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        std::cerr << "expected host:port, got " << address << std::endl;
+        return 1;
+    }
+    const std::string host = address.substr(0, colon);
+    int socketHandle = connectTo(host, address.substr(colon + 1));
+    if (socketHandle < 0) {
+        std::cerr << "Could not connect to " << address << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!handshake(socketHandle, host, error)) {
+        std::cerr << error << std::endl;
+        close(socketHandle);
+        return 1;
+    }
+
+    FrameServer::ClientBoard board;
+    std::vector<uint8_t> payload;
+    long long frames = 0;
+    long long mismatches = 0;
+    long long lastGeneration = -1;
+    long long skipped = 0;
+    uint64_t keyframeBytes = 0;
+    uint64_t deltaBytes = 0;
+    long long deltas = 0;
+    bool serverClosed = false;
+    while (maxFrames == 0 || frames < maxFrames) {
+        uint8_t opcode = 0;
+        if (!receiveMessage(socketHandle, opcode, payload)) {
+            serverClosed = true;
+            break;
+        }
+        if (opcode == 0x8) {
+            serverClosed = true;
+            break;
+        }
+        if (opcode != 0x2) continue;
+
+        if (!FrameServer::applyMessage(payload.data(), payload.size(), board, error)) {
+            std::cerr << error << std::endl;
+            close(socketHandle);
+            return 1;
+        }
+        const bool keyframe = payload[0] == (uint8_t)FrameServer::MessageType::Keyframe;
+        const uint32_t tiles = (uint32_t)payload[4] | (uint32_t)payload[5] << 8 | (uint32_t)payload[6] << 16 | (uint32_t)payload[7] << 24;
+        uint64_t population = 0;
+        for (uint64_t word : board.words) population += (uint64_t)std::popcount(word);
+        if (population != board.population) mismatches++;
+        if (lastGeneration >= 0 && board.generation > lastGeneration + 1) skipped += board.generation - lastGeneration - 1;
+        lastGeneration = board.generation;
+        if (keyframe) keyframeBytes += payload.size();
+        else {
+            deltaBytes += payload.size();
+            deltas++;
+        }
+        std::printf("generation %lld  %dx%d  %s of %u tiles in %zu bytes  population %llu%s\n",
+            board.generation, board.width, board.height, keyframe ? "keyframe" : "delta", tiles, payload.size(),
+            (unsigned long long)population, population == board.population ? "" : " (server disagrees)");
+        std::fflush(stdout);
+        frames++;
+        if (delayMilliseconds > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMilliseconds));
+        sendAnswer(socketHandle);
+    }
+    if (!serverClosed) sendClose(socketHandle);
+    close(socketHandle);
+
+    const uint64_t rawBytes = (uint64_t)board.wordsPerRow * board.height * sizeof(uint64_t);
+    std::printf("%lld frames%s, %lld generations skipped, %llu keyframe bytes, %.0f bytes per delta against %llu for the whole board\n",
+        frames, serverClosed ? " until the server stopped" : "", skipped, (unsigned long long)keyframeBytes,
+        deltas > 0 ? (double)deltaBytes / deltas : 0.0, (unsigned long long)rawBytes);
+    if (mismatches > 0) {
+        std::printf("%lld frames didn't match the server's population\n", mismatches);
+        return 1;
+    }
+    return 0;
+#else
+    std::cerr << "gol-stream-client needs POSIX sockets" << std::endl;
+    return 1;
+#endif
+}
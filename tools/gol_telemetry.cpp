@@ -0,0 +1,130 @@
+//Turns the columns a TelemetrySink recorded into CSV, one line per row, for spreadsheets and
+//plotting scripts. Reads only the rows the manifest says were flushed, so it also works on a run that
+//is still going or was killed.
+//
+//  gol-run --random 0.3 --generations 100000 --telemetry run1
+//  gol-telemetry run1 --output run1.csv
+
+#include "model/MappedFile.hpp"
+#include "model/TelemetrySink.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    void printUsage()
+    {
+        std::cout <<
+            "usage: gol-telemetry DIR [options]\n"
+            "Writes the telemetry recorded in DIR as CSV, with a header line of column names.\n"
+            "  --output FILE       write to FILE rather than standard output\n"
+            "  --every N           only every Nth row (default 1)\n";
+    }
+
+    //Each cell of a row as text, comma separated. The box columns are left empty for an empty board.
+    size_t formatRow(const int64_t* const* columns, uint64_t row, char* line)
+    {
+        using Column = TelemetrySink::Column;
+        const bool emptyBox = columns[(int)Column::Right][row] < columns[(int)Column::Left][row];
+        char* end = line;
+        for (int column = 0; column < TelemetrySink::COLUMN_COUNT; column++) {
+            if (column > 0) *end++ = ',';
+            bool boxColumn = column >= (int)Column::Left && column <= (int)Column::Bottom;
+            if (emptyBox && boxColumn) continue;
+            end = std::to_chars(end, end + 24, columns[column][row]).ptr;
+        }
+        *end++ = '\n';
+        return (size_t)(end - line);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::string directory;
+    std::string outputPath;
+    long long every = 1;
+    for (int index = 1; index < argc; index++) {
+        std::string argument = argv[index];
+        if (argument == "--help" || argument == "-h") {
+            printUsage();
+            return 0;
+        }
+        else if ((argument == "--output" || argument == "--every") && index + 1 < argc) {
+            const char* value = argv[++index];
+            if (argument == "--output") outputPath = value;
+            else every = std::max(std::atoll(value), 1ll);
+        }
+        else if (directory.empty() && argument.rfind("--", 0) != 0) {
+            directory = argument;
+        }
+        else {
+            std::cerr << "Unknown option " << argument << std::endl;
+            printUsage();
+            return 1;
+        }
+    }
+    if (directory.empty()) {
+        printUsage();
+        return 1;
+    }
+
+    uint64_t rowCount = 0;
+    std::string error;
+    if (!TelemetrySink::readManifest(directory, rowCount, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::vector<MappedFile> files(TelemetrySink::COLUMN_COUNT);
+    const int64_t* columns[TelemetrySink::COLUMN_COUNT];
+    for (int column = 0; column < TelemetrySink::COLUMN_COUNT; column++) {
+        MappedFile& file = files[column];
+        if (!file.open(TelemetrySink::getColumnPath(directory, column))) {
+            std::cerr << file.getError() << std::endl;
+            return 1;
+        }
+        //A file cut short, e.g. by a full disk, limits every column to what it holds.
+        rowCount = std::min<uint64_t>(rowCount, file.getSize() / sizeof(int64_t));
+        columns[column] = reinterpret_cast<const int64_t*>(file.getText().data());
+    }
+
+    FILE* output = stdout;
+    if (!outputPath.empty()) {
+        output = std::fopen(outputPath.c_str(), "wb");
+        if (!output) {
+            std::cerr << "Could not open " << outputPath << " for writing" << std::endl;
+            return 1;
+        }
+    }
+
+    //Lines are gathered into a buffer and written a block at a time.
+    std::vector<char> buffer(1 << 20);
+    constexpr size_t MAX_LINE = TelemetrySink::COLUMN_COUNT * 24;
+    size_t used = 0;
+    for (int column = 0; column < TelemetrySink::COLUMN_COUNT; column++) {
+        used += std::snprintf(&buffer[used], MAX_LINE, "%s%s", column > 0 ? "," : "", TelemetrySink::ColumnNames[column]);
+    }
+    buffer[used++] = '\n';
+    bool written = true;
+    for (uint64_t row = 0; row < rowCount && written; row += every) {
+        used += formatRow(columns, row, &buffer[used]);
+        if (buffer.size() - used < MAX_LINE) {
+            written = std::fwrite(buffer.data(), 1, used, output) == used;
+            used = 0;
+        }
+    }
+    written = written && std::fwrite(buffer.data(), 1, used, output) == used;
+    written = (std::fflush(output) == 0) && written;
+    if (output != stdout) written = (std::fclose(output) == 0) && written;
+    if (!written) {
+        std::cerr << "Could not write " << (outputPath.empty() ? std::string("the output") : outputPath) << std::endl;
+        return 1;
+    }
+    std::cerr << rowCount << " rows of " << TelemetrySink::COLUMN_COUNT << " columns from " << directory << std::endl;
+    return 0;
+}